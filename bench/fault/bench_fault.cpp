@@ -0,0 +1,256 @@
+/*************************************************************************
+ * @file bench_fault.cpp
+ * @date 2026/10/18
+ * @brief Fault injection against the INA228 ALERT trip (host build, pio run -e bench_fault)
+ *
+ * Brings up one edugrid_channel like bench_mppt, but with its protection
+ * armed: the INA228 shims compare every conversion against the SOVL/BOVL
+ * limits the firmware wrote over Wire, pull the shared ALERT pin, and the
+ * falling edge runs edugrid_protection's ISR, which drops the SD pin the
+ * simulated buck stage is gated by.  Every TASK_CONTROL_INTERVAL_MS pass:
+ *
+ *   plant.solve()  ->  one INA conversion  ->  ch.service()
+ *
+ * Scenarios (all in AUTO on the default panel at 1000 W/m^2):
+ *
+ *   short_transient   load shorted for BENCH_SHORT_MS: one trip, automatic
+ *                     retry, tracking back at the MPP afterwards
+ *   short_persistent  load stays shorted: latched after PROT_MAX_RETRIES
+ *                     retries, reset() after the fault is gone restarts it
+ *   output_ov         load opens up (R_load x2) under a V_out limit: trips
+ *                     (or a latch) instead of a sustained overvoltage
+ *
+ * Every scenario also checks that SD is low in the same pass in which the
+ * plant first exceeds a limit, i.e. the trip does not wait for service().
+ *
+ * Usage:
+ *   program [--scenario NAME] [--verbose]
+ *
+ * Prints | OK | / |FAIL| per check and exits 1 on any failure.
+ ************************************************************************/
+
+/*************************************************************************
+ * Include
+ ************************************************************************/
+#include <Arduino.h>
+#include <bench_hal.h>
+#include <sim_pv.h>
+#include <bench_trackers.h>
+#include <edugrid_channel.h>
+
+#include <string>
+
+/*************************************************************************
+ * Define
+ ************************************************************************/
+#define BENCH_BOOT_MS             (1000UL)
+#define BENCH_SETTLE_MS           (45000UL)  /* AUTO from the lower border to the MPP */
+#define BENCH_SHORT_MS            (500UL)
+#define BENCH_SHORT_OHM           (0.2f)
+#define BENCH_RECOVER_MS          (45000UL)  /* retry + P&O back at the MPP */
+#define BENCH_TRACK_RATIO         (0.95f)    /* P_pv / P_mpp once recovered */
+#define BENCH_LATCH_MS            (30000UL)  /* retry + climb back into the short, x4 */
+#define BENCH_I_OUT_MAX_A         (6.5f)     /* lab stage: 6.0 A at the MPP into 2.5 Ohm, a short gives ~I_sc/D */
+#define BENCH_V_OUT_MAX_V         (17.5f)    /* ... 15.0 V, into 5 Ohm ~18 V */
+
+/*************************************************************************
+ * Types
+ ************************************************************************/
+/** One bench channel with its plant and the fault bookkeeping */
+struct FaultRig_t
+{
+  sim_pv_array   pv;
+  sim_buck_plant plant;
+  edugrid_channel ch;
+  uint8_t  sd_pin;
+  uint32_t t_ms;
+  float    i_out_max, v_out_max;
+  uint32_t over_passes;        // plant above a limit ...
+  uint32_t over_gate_on;       // ... while SD stayed high after the conversion
+
+  FaultRig_t() : plant(pv), sd_pin(0), t_ms(0), i_out_max(0.0f), v_out_max(0.0f),
+                 over_passes(0), over_gate_on(0) {}
+};
+
+/*************************************************************************
+ * Variable Definition
+ ************************************************************************/
+static uint32_t s_failures = 0;
+
+/*************************************************************************
+ * Helpers
+ ************************************************************************/
+static void _check(bool ok, const char* scenario, const char* what)
+{
+  printf("%s %s: %s\n", ok ? "| OK |" : "|FAIL|", scenario, what);
+  if (!ok) s_failures++;
+}
+
+static void _begin(FaultRig_t& rig, float i_out_max, float v_out_max)
+{
+  const ChannelConfig_t& cfg = edugrid_channel::config(0);
+  SimEnv_t env = {};
+  env.g_wm2 = SIM_G_STC_WM2;
+  env.t_c   = SIM_T_STC_C;
+  rig.pv.setEnvironment(env);
+  rig.plant.setLoad(SIM_LOAD_OHM);
+  bench_hal::setMillis(BENCH_BOOT_MS);
+
+  bench_channel_begin(rig.ch, rig.plant);
+  rig.sd_pin    = (uint8_t)cfg.sd_pin;
+  rig.i_out_max = i_out_max;
+  rig.v_out_max = v_out_max;
+  rig.ch.protect.begin(0, cfg.sd_pin, cfg.alert_pin);
+  bench_hal::setInaAlertPin(cfg.ina_pv_addr, cfg.alert_pin);
+  bench_hal::setInaAlertPin(cfg.ina_load_addr, cfg.alert_pin);
+  rig.plant.setGatePin(cfg.sd_pin);
+  rig.ch.protect.setLimits(PROT_I_IN_MAX_A, PROT_V_IN_MAX_V, i_out_max, v_out_max);
+  rig.ch.protect.arm();
+  rig.ch.mppt.set_mode_state(AUTO);
+}
+
+static void _end(FaultRig_t& rig)
+{
+  const ChannelConfig_t& cfg = edugrid_channel::config(0);
+  detachInterrupt(digitalPinToInterrupt(cfg.alert_pin));
+  bench_hal::setInaAlertPin(cfg.ina_pv_addr, -1);
+  bench_hal::setInaAlertPin(cfg.ina_load_addr, -1);
+  bench_hal::setInaSource(nullptr);
+  (void)rig;
+}
+
+/** One control pass; the conversion sees the plant before service() runs */
+static void _pass(FaultRig_t& rig)
+{
+  bench_hal::advanceToMillis(BENCH_BOOT_MS + rig.t_ms);
+  const SimPoint_t& pt = rig.plant.solve(bench_channel_duty(rig.ch));
+  bench_hal::inaConvert();
+  const bool over = (rig.i_out_max > 0.0f && pt.i_out > rig.i_out_max)
+                 || (rig.v_out_max > 0.0f && pt.v_out > rig.v_out_max);
+  if (over)
+  {
+    rig.over_passes++;
+    if (bench_hal::pinLevel(rig.sd_pin) != LOW) rig.over_gate_on++;
+  }
+  rig.ch.service();
+  rig.t_ms += TASK_CONTROL_INTERVAL_MS;
+}
+
+static void _run(FaultRig_t& rig, uint32_t ms)
+{
+  for (uint32_t end = rig.t_ms + ms; rig.t_ms < end; ) _pass(rig);
+}
+
+/** P_pv over the MPP, averaged over the last second */
+static float _trackRatio(FaultRig_t& rig)
+{
+  double p = 0.0;
+  uint32_t n = 0;
+  for (uint32_t end = rig.t_ms + 1000UL; rig.t_ms < end; ++n)
+  {
+    _pass(rig);
+    p += rig.plant.point().p_in;
+  }
+  float v_mpp, i_mpp, p_mpp;
+  rig.pv.mpp(v_mpp, i_mpp, p_mpp);
+  return (n > 0 && p_mpp > 0.0f) ? (float)(p / n) / p_mpp : 0.0f;
+}
+
+/*************************************************************************
+ * Scenarios
+ ************************************************************************/
+static void _shortTransient(void)
+{
+  const char* name = "short_transient";
+  FaultRig_t rig;
+  _begin(rig, BENCH_I_OUT_MAX_A, 0.0f);
+  _check(rig.ch.protect.state() == PROT_OK, name, "armed, gate driver on");
+
+  _run(rig, BENCH_SETTLE_MS);
+  _check(rig.ch.protect.tripCount() == 0, name, "no trip at the MPP");
+
+  rig.plant.setLoad(BENCH_SHORT_OHM);
+  _run(rig, BENCH_SHORT_MS);
+  rig.plant.setLoad(SIM_LOAD_OHM);
+  _check(rig.ch.protect.tripCount() == 1, name, "one trip");
+  _check(rig.ch.protect.lastCause() & INA_ALERT_I_OUT, name, "cause I_out");
+  _check(rig.over_passes > 0 && rig.over_gate_on == 0, name, "SD low in the pass of the over-current");
+
+  _run(rig, BENCH_RECOVER_MS);
+  _check(rig.ch.protect.state() == PROT_OK, name, "retried, gate driver on");
+  const float ratio = _trackRatio(rig);
+  printf("       P_pv/P_mpp %.3f after %lu ms\n", ratio, (unsigned long)BENCH_RECOVER_MS);
+  _check(ratio >= BENCH_TRACK_RATIO, name, "tracking recovered");
+  _end(rig);
+}
+
+static void _shortPersistent(void)
+{
+  const char* name = "short_persistent";
+  FaultRig_t rig;
+  _begin(rig, BENCH_I_OUT_MAX_A, 0.0f);
+  _run(rig, BENCH_SETTLE_MS);
+
+  rig.plant.setLoad(BENCH_SHORT_OHM);
+  _run(rig, BENCH_LATCH_MS);
+  _check(rig.ch.protect.state() == PROT_LATCHED, name, "latched");
+  _check(rig.ch.protect.tripCount() == PROT_MAX_RETRIES + 1, name, "PROT_MAX_RETRIES retries before the latch");
+  _check(rig.over_gate_on == 0, name, "SD low in every pass of the over-current");
+
+  rig.plant.setLoad(SIM_LOAD_OHM);
+  _run(rig, 2 * PROT_RETRY_MS);
+  _check(rig.ch.protect.state() == PROT_LATCHED, name, "stays latched without the fault");
+
+  rig.ch.protect.reset();
+  _run(rig, 2 * TASK_CONTROL_INTERVAL_MS);
+  _check(rig.ch.protect.state() == PROT_OK, name, "reset() re-enables the gate driver");
+  _run(rig, BENCH_RECOVER_MS);
+  _check(_trackRatio(rig) >= BENCH_TRACK_RATIO, name, "tracking recovered");
+  _end(rig);
+}
+
+static void _outputOv(void)
+{
+  const char* name = "output_ov";
+  FaultRig_t rig;
+  _begin(rig, 0.0f, BENCH_V_OUT_MAX_V);
+  _run(rig, BENCH_SETTLE_MS);
+  _check(rig.ch.protect.tripCount() == 0, name, "no trip at the MPP");
+
+  rig.plant.setLoad(2.0f * SIM_LOAD_OHM);
+  _run(rig, BENCH_RECOVER_MS);
+  printf("       %u trip(s), state %s\n", (unsigned)rig.ch.protect.tripCount(),
+         edugrid_protection::stateToStr(rig.ch.protect.state()));
+  _check(rig.ch.protect.tripCount() >= 1, name, "tripped");
+  _check(rig.ch.protect.lastCause() & INA_ALERT_V_OUT, name, "cause V_out");
+  _check(rig.over_gate_on == 0, name, "SD low in every pass of the overvoltage");
+  _end(rig);
+}
+
+/*************************************************************************
+ * Main
+ ************************************************************************/
+int main(int argc, char** argv)
+{
+  std::string only;
+  bool verbose = false;
+  for (int n = 1; n < argc; ++n)
+  {
+    const std::string a = argv[n];
+    if      (a == "--scenario" && n + 1 < argc) only = argv[++n];
+    else if (a == "--verbose") verbose = true;
+    else
+    {
+      fprintf(stderr, "usage: program [--scenario short_transient|short_persistent|output_ov] [--verbose]\n");
+      return 2;
+    }
+  }
+  bench_hal::setSerialEcho(verbose);
+
+  if (only.empty() || only == "short_transient")  _shortTransient();
+  if (only.empty() || only == "short_persistent") _shortPersistent();
+  if (only.empty() || only == "output_ov")        _outputOv();
+
+  printf("%s %lu failure(s)\n", s_failures ? "|FAIL|" : "| OK |", (unsigned long)s_failures);
+  return s_failures ? 1 : 0;
+}
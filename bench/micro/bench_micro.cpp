@@ -0,0 +1,435 @@
+/*************************************************************************
+ * @file bench_micro.cpp
+ * @date 2026/10/18
+ * @brief Microbenchmarks of the firmware hot paths (host build, pio run -e bench_micro)
+ *
+ * Times the real firmware functions against the host shims and counts the
+ * heap traffic they cause.  Prints one CSV row per case to stdout:
+ *
+ *   ns_per_op      median over the rounds of wall time / iterations
+ *   bytes_per_op   bytes requested from operator new per call
+ *   allocs_per_op  operator new calls per call
+ *
+ * Cases:
+ *   meas_update      edugrid_meas_channel::update() (sensor read + derived values)
+ *   find_mpp         one P&O step (clock advanced by the step period each call)
+ *   iv_sweep_step    one sweep point, re-armed when a sweep completes
+ *   log_format_row   edugrid_logging::formatRow() of one CSV row
+ *   append_log       appendLog() incl. the block flush every 100 rows
+ *   ws_live_json     WebSocket push document built and serialized
+ *   iv_sweep_json    /ivsweep/data body of a complete sweep
+ *   file_list_html   file manager table of a typical LittleFS image
+ *
+ * Usage:
+ *   program [--case NAME] [--rounds N] [--scale X] [--verbose]
+ *           [--baseline FILE] [--threshold PCT] [--alloc-only] [--list]
+ *
+ * With --baseline the run fails (exit 1) when a case got slower than the
+ * threshold allows or allocates more than in the baseline.  Timings only
+ * compare on the machine the baseline was taken on; --alloc-only checks
+ * just the heap columns, which are the same on every host.  Regenerate
+ * bench/micro/baseline.csv from stdout when a change is intended.
+ ************************************************************************/
+
+/*************************************************************************
+ * Include
+ ************************************************************************/
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <bench_hal.h>
+#include <sim_pv.h>
+#include <bench_trackers.h>
+#include <edugrid_channel.h>
+#include <edugrid_measurement.h>
+#include <edugrid_logging.h>
+#include <edugrid_config.h>
+#include <edugrid_filesystem.h>
+#include <edugrid_payload.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/*************************************************************************
+ * Define
+ ************************************************************************/
+#define BENCH_BOOT_MS               (1000UL)
+#define BENCH_DEFAULT_ROUNDS        (5)
+#define BENCH_DEFAULT_THRESHOLD     (15.0f)   /* [%] on ns_per_op */
+#define BENCH_ALLOC_EPS_BYTES       (1.0)     /* rounding slack on the heap columns */
+#define BENCH_ALLOC_EPS_COUNT       (0.01)
+
+/*************************************************************************
+ * Types
+ ************************************************************************/
+struct MicroCase_t
+{
+  const char* name;
+  uint32_t    iterations;
+  void (*setup)(void);      ///< once per round, not timed
+  void (*op)(void);         ///< the timed call
+};
+
+struct MicroResult_t
+{
+  std::string name;
+  uint32_t    iterations;
+  double      ns_per_op;
+  double      bytes_per_op;
+  double      allocs_per_op;
+};
+
+struct MicroOptions_t
+{
+  std::vector<std::string> cases;
+  uint32_t    rounds     = BENCH_DEFAULT_ROUNDS;
+  float       scale      = 1.0f;
+  std::string baseline_path;
+  float       threshold  = BENCH_DEFAULT_THRESHOLD;
+  bool        alloc_only = false;
+  bool        verbose    = false;
+};
+
+/*************************************************************************
+ * Heap accounting
+ * Every operator new of the process lands here, so the counters see the
+ * String buffers, the shim FS and anything ArduinoJson would allocate.
+ ************************************************************************/
+static uint64_t s_heap_bytes  = 0;
+static uint64_t s_heap_allocs = 0;
+
+static void* _counted(size_t n)
+{
+  s_heap_bytes += n;
+  s_heap_allocs++;
+  void* p = malloc(n ? n : 1);
+  if (!p) throw std::bad_alloc();
+  return p;
+}
+
+void* operator new(size_t n)                                 { return _counted(n); }
+void* operator new[](size_t n)                               { return _counted(n); }
+void* operator new(size_t n, const std::nothrow_t&) noexcept   { try { return _counted(n); } catch (...) { return nullptr; } }
+void* operator new[](size_t n, const std::nothrow_t&) noexcept { try { return _counted(n); } catch (...) { return nullptr; } }
+void  operator delete(void* p) noexcept                      { free(p); }
+void  operator delete[](void* p) noexcept                    { free(p); }
+void  operator delete(void* p, size_t) noexcept              { free(p); }
+void  operator delete[](void* p, size_t) noexcept            { free(p); }
+
+/*************************************************************************
+ * Variable Definition
+ ************************************************************************/
+static const char* kColumns = "case,iterations,ns_per_op,bytes_per_op,allocs_per_op";
+
+static sim_pv_array   s_pv;
+static sim_buck_plant s_plant(s_pv);
+static uint32_t       s_step_ms = 0;
+static volatile uint32_t s_sink = 0;   // keeps results observable to the optimizer
+
+/*************************************************************************
+ * Helpers
+ ************************************************************************/
+static edugrid_channel& _ch(void) { return edugrid_channel::at(0); }
+
+/** Channel 0 in MANUALLY at the init duty, fresh plant point and reading */
+static void _resetChannel(void)
+{
+  bench_hal::setMillis(BENCH_BOOT_MS);
+  s_pv.setEnvironment(SimEnv_t{ 1000.0f, 25.0f, { 1.0f, 1.0f, 1.0f, 1.0f } });
+  bench_channel_begin(_ch(), s_plant);
+  s_plant.setDynamics(0, 0.0f);   // time the firmware, not the plant lag
+  _ch().mppt.set_mode_state(MANUALLY);
+  s_step_ms = edugrid_measurement::stepPeriodFor(INA_AVG_SAMPLES, INA_CONV_US, INA_EXTRA_SETTLE_MS);
+}
+
+/** One sweep point against the plant, like the control task would see it */
+static void _sweepTick(void)
+{
+  bench_hal::advanceMillis(s_step_ms);
+  _ch().mppt.iv_sweep_step();
+  s_plant.solve(bench_channel_duty(_ch()));
+  _ch().meas.update();
+}
+
+/** Empty filesystem with a freshly written config blob, as after setup() */
+static void _bootFs(void)
+{
+  bench_hal::fsFormat();
+  edugrid_filesystem::init_filesystem();
+  edugrid_config::load();
+}
+
+/** Typical image: web UI, config blob and a log */
+static void _populateFs(void)
+{
+  static const struct { const char* path; size_t size; } kFiles[] = {
+    { "/www/index.html",  9216 },
+    { "/www/style.css",   4608 },
+    { "/www/script.js",  21504 },
+    { "/www/file.html",   3072 },
+    { "/www/admin.html",  5120 },
+    { "/log/log.csv",    19015 },
+  };
+  _bootFs();
+  std::vector<uint8_t> fill(32768, 'x');
+  for (const auto& f : kFiles)
+  {
+    File file = LittleFS.open(f.path, FILE_WRITE);
+    file.write(fill.data(), f.size);
+    file.close();
+  }
+}
+
+/*************************************************************************
+ * Cases
+ ************************************************************************/
+static void _setupMeas(void) { _resetChannel(); }
+static void _opMeas(void)
+{
+  _ch().meas.update();
+  s_sink += (uint32_t)_ch().meas.getPowerPV();
+}
+
+static void _setupFindMpp(void) { _resetChannel(); _ch().mppt.set_mode_state(AUTO); }
+static void _opFindMpp(void)
+{
+  bench_hal::advanceMillis(s_step_ms);
+  s_sink += (uint32_t)_ch().mppt.find_mpp();
+}
+
+static void _setupSweep(void) { _resetChannel(); _ch().mppt.request_iv_sweep(); }
+static void _opSweep(void)
+{
+  if (!_ch().mppt.iv_sweep_in_progress()) _ch().mppt.request_iv_sweep();
+  bench_hal::advanceMillis(s_step_ms);
+  _ch().mppt.iv_sweep_step();
+}
+
+static LogRow_t s_row = { 0, 17.832f, 11.904f, 5.412f, 7.655f, 0.9871f, 0.9804f };
+static void _setupFormatRow(void) { s_row.idx = 0; }
+static void _opFormatRow(void)
+{
+  char line[EDUGRID_LOGGING_MAX_LINE_LEN];
+  s_row.idx++;
+  s_sink += (uint32_t)edugrid_logging::formatRow(line, sizeof(line), s_row);
+}
+
+static void _setupAppendLog(void)
+{
+  _bootFs();
+  if (edugrid_logging::getLogState()) edugrid_logging::deactivateLogging();
+  edugrid_logging::appendLog(0, 0, 0, 0, NAN, NAN);   // flush whatever a previous round left
+  edugrid_logging::activateLogging();
+}
+static void _opAppendLog(void) { edugrid_logging::appendLog(17.832f, 11.904f, 5.412f, 7.655f, 0.9871f, 0.9804f); }
+
+static void _setupLiveJson(void) { _resetChannel(); }
+static void _opLiveJson(void)
+{
+  String out;
+  edugrid_payload::liveJson(out);
+  s_sink += out.length();
+}
+
+static void _setupSweepJson(void)
+{
+  _resetChannel();
+  _ch().mppt.request_iv_sweep();
+  while (!_ch().mppt.iv_sweep_done()) _sweepTick();
+}
+static void _opSweepJson(void)
+{
+  String out;
+  edugrid_payload::ivSweepJson(_ch().mppt, out);
+  s_sink += out.length();
+}
+
+static void _setupFileList(void) { _populateFs(); }
+static void _opFileList(void)
+{
+  const String html = edugrid_payload::fileListHtml();
+  s_sink += html.length();
+}
+
+static const MicroCase_t kCases[] = {
+  { "meas_update",    200000, _setupMeas,      _opMeas },
+  { "find_mpp",       200000, _setupFindMpp,   _opFindMpp },
+  { "iv_sweep_step",  200000, _setupSweep,     _opSweep },
+  { "log_format_row", 200000, _setupFormatRow, _opFormatRow },
+  { "append_log",     100000, _setupAppendLog, _opAppendLog },
+  { "ws_live_json",    50000, _setupLiveJson,  _opLiveJson },
+  { "iv_sweep_json",    5000, _setupSweepJson, _opSweepJson },
+  { "file_list_html",   5000, _setupFileList,  _opFileList },
+};
+
+/*************************************************************************
+ * Runner
+ ************************************************************************/
+static MicroResult_t _run(const MicroCase_t& c, const MicroOptions_t& opt)
+{
+  const uint32_t iters = std::max<uint32_t>(1, (uint32_t)(c.iterations * opt.scale));
+  std::vector<double> ns;
+  MicroResult_t r = { c.name, iters, 0.0, 0.0, 0.0 };
+
+  for (uint32_t round = 0; round < opt.rounds; ++round)
+  {
+    c.setup();
+    for (uint32_t n = 0; n < iters / 10; ++n) c.op();   // warm caches and buffers
+
+    const uint64_t bytes0  = s_heap_bytes;
+    const uint64_t allocs0 = s_heap_allocs;
+    const auto t0 = std::chrono::steady_clock::now();
+    for (uint32_t n = 0; n < iters; ++n) c.op();
+    const auto t1 = std::chrono::steady_clock::now();
+
+    ns.push_back(std::chrono::duration<double, std::nano>(t1 - t0).count() / iters);
+    // The heap columns are deterministic; the last round is as good as any
+    r.bytes_per_op  = (double)(s_heap_bytes  - bytes0)  / iters;
+    r.allocs_per_op = (double)(s_heap_allocs - allocs0) / iters;
+  }
+  std::sort(ns.begin(), ns.end());
+  r.ns_per_op = ns[ns.size() / 2];
+  return r;
+}
+
+static std::string _row(const MicroResult_t& r)
+{
+  char buf[160];
+  snprintf(buf, sizeof(buf), "%s,%lu,%.1f,%.1f,%.2f", r.name.c_str(), (unsigned long)r.iterations,
+           r.ns_per_op, r.bytes_per_op, r.allocs_per_op);
+  return buf;
+}
+
+static bool _selected(const std::vector<std::string>& names, const char* name)
+{
+  return names.empty() || std::find(names.begin(), names.end(), name) != names.end();
+}
+
+static std::vector<std::string> _split(const std::string& line)
+{
+  std::vector<std::string> out;
+  std::stringstream ss(line);
+  std::string cell;
+  while (std::getline(ss, cell, ',')) out.push_back(cell);
+  return out;
+}
+
+typedef std::map<std::string, std::map<std::string, std::string>> MicroTable_t;
+
+static bool _load(std::istream& in, MicroTable_t& table)
+{
+  std::string line;
+  if (!std::getline(in, line)) return false;
+  const std::vector<std::string> head = _split(line);
+  while (std::getline(in, line))
+  {
+    if (line.empty()) continue;
+    const std::vector<std::string> cells = _split(line);
+    std::map<std::string, std::string> row;
+    for (size_t n = 0; n < head.size() && n < cells.size(); ++n) row[head[n]] = cells[n];
+    table[row["case"]] = row;
+  }
+  return true;
+}
+
+/** Compare against the baseline, returns the number of regressions */
+static int _check(const std::vector<MicroResult_t>& results, const MicroOptions_t& opt)
+{
+  std::ifstream f(opt.baseline_path);
+  MicroTable_t base;
+  if (!f || !_load(f, base))
+  {
+    fprintf(stderr, "|FAIL| cannot read baseline %s\n", opt.baseline_path.c_str());
+    return 1;
+  }
+
+  int failures = 0;
+  size_t checked = 0;
+  for (const MicroResult_t& r : results)
+  {
+    auto it = base.find(r.name);
+    if (it == base.end())
+    {
+      fprintf(stderr, "|WARN| %s not in baseline\n", r.name.c_str());
+      continue;
+    }
+    checked++;
+    const double b_ns     = atof(it->second["ns_per_op"].c_str());
+    const double b_bytes  = atof(it->second["bytes_per_op"].c_str());
+    const double b_allocs = atof(it->second["allocs_per_op"].c_str());
+
+    if (!opt.alloc_only && r.ns_per_op > b_ns * (1.0 + opt.threshold / 100.0))
+    {
+      fprintf(stderr, "|FAIL| %s ns_per_op %.1f > baseline %.1f +%.0f%%\n",
+              r.name.c_str(), r.ns_per_op, b_ns, opt.threshold);
+      failures++;
+    }
+    if (r.bytes_per_op > b_bytes + BENCH_ALLOC_EPS_BYTES)
+    {
+      fprintf(stderr, "|FAIL| %s bytes_per_op %.1f > baseline %.1f\n", r.name.c_str(), r.bytes_per_op, b_bytes);
+      failures++;
+    }
+    if (r.allocs_per_op > b_allocs + BENCH_ALLOC_EPS_COUNT)
+    {
+      fprintf(stderr, "|FAIL| %s allocs_per_op %.2f > baseline %.2f\n", r.name.c_str(), r.allocs_per_op, b_allocs);
+      failures++;
+    }
+  }
+  if (failures == 0) fprintf(stderr, "| OK | %zu cases within baseline\n", checked);
+  return failures;
+}
+
+/*************************************************************************
+ * Main
+ ************************************************************************/
+int main(int argc, char** argv)
+{
+  const size_t n_cases = sizeof(kCases) / sizeof(kCases[0]);
+
+  MicroOptions_t opt;
+  for (int n = 1; n < argc; ++n)
+  {
+    const std::string a = argv[n];
+    const bool has_val = (n + 1 < argc);
+    if      (a == "--case"      && has_val) opt.cases.push_back(argv[++n]);
+    else if (a == "--rounds"    && has_val) opt.rounds = std::max(1, atoi(argv[++n]));
+    else if (a == "--scale"     && has_val) opt.scale = (float)atof(argv[++n]);
+    else if (a == "--baseline"  && has_val) opt.baseline_path = argv[++n];
+    else if (a == "--threshold" && has_val) opt.threshold = (float)atof(argv[++n]);
+    else if (a == "--alloc-only") opt.alloc_only = true;
+    else if (a == "--verbose")    opt.verbose = true;
+    else if (a == "--list")
+    {
+      for (size_t k = 0; k < n_cases; ++k) printf("case %s (%lu iterations)\n", kCases[k].name,
+                                                  (unsigned long)kCases[k].iterations);
+      return 0;
+    }
+    else
+    {
+      fprintf(stderr, "unknown argument: %s\n", a.c_str());
+      return 2;
+    }
+  }
+  bench_hal::setSerialEcho(opt.verbose);
+
+  std::vector<MicroResult_t> results;
+  printf("%s\n", kColumns);
+  for (size_t k = 0; k < n_cases; ++k)
+  {
+    if (!_selected(opt.cases, kCases[k].name)) continue;
+    results.push_back(_run(kCases[k], opt));
+    printf("%s\n", _row(results.back()).c_str());
+    fflush(stdout);
+  }
+
+  if (!opt.baseline_path.empty())
+  {
+    return (_check(results, opt) == 0) ? 0 : 1;
+  }
+  return 0;
+}
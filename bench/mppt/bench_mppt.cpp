@@ -0,0 +1,748 @@
+/*************************************************************************
+ * @file bench_mppt.cpp
+ * @date 2026/10/18
+ * @brief MPPT efficiency benchmark (host build, pio run -e bench_mppt)
+ *
+ * Runs every tracker of bench/sim/bench_trackers.cpp through every profile
+ * of bench_profiles.cpp.  The tracker is the real firmware code: one
+ * edugrid_channel serviced every TASK_CONTROL_INTERVAL_MS against the
+ * simulated panel + buck stage of bench/sim.  Prints one CSV row per
+ * (profile, tracker) to stdout:
+ *
+ *   eta_total    P_pv energy / available MPP energy over the whole profile
+ *   eta_static   same, only over constant-environment stretches that are
+ *                BENCH_STATIC_SETTLE_MS old and have converged (see below)
+ *   eta_dynamic  same, over everything else: ramps, steps, start-up and
+ *                the time until the tracker converged again
+ *   conv_*       time from the end of a step or ramp until P_pv first
+ *                reaches BENCH_CONV_THRESHOLD of P_mpp; "missed" events
+ *                never got there before the environment moved again
+ *   ripple_*     duty peak-to-peak over the last BENCH_RIPPLE_WINDOW_MS of
+ *                every settled stretch (P&O limit cycle)
+ *   e_out_j      energy delivered to the load
+ *   eta_out      e_out_j / the most any duty could have delivered; only
+ *                with --losses (the lossy stage of sim_pv.h), empty
+ *                otherwise
+ *
+ * Usage:
+ *   program [--profile NAME] [--tracker NAME] [--seed N]
+ *           [--no-noise] [--load-noise X] [--losses] [--dither] [--track-eff] [--energy] [--scope]
+ *           [--charge cv|cc]
+ *           [--trace FILE] [--verbose] [--baseline FILE] [--tolerance X] [--list]
+ *
+ * --load-noise scales the noise of the load-side INA against the PV side.
+ * --dither runs every tracker with fractional LEDC duty (PWM_DITHER); the
+ * baseline is taken without it.
+ * --track-eff runs a background IV sweep at the start and every
+ * BENCH_TEFF_BG_S, and ends with the firmware's tracking efficiency
+ * (edugrid_track_eff) against the true P_pv / P_mpp over the same control
+ * passes, per row (stderr).
+ * --energy runs one INA conversion per pass (the shim integrates ENERGY /
+ * CHARGE like the device; it draws noise, so the rows differ from the
+ * baseline) and ends with the firmware's lifetime Wh / Ah (edugrid_energy)
+ * against the plant's up to the last accumulator read, per row (stderr).
+ * --scope takes one duty-step capture (edugrid_scope) BENCH_SCOPE_AT_MS
+ * into every row, reads it back like GET /api/scope?raw=1 and reports the
+ * 63 % rise of V_in against the plant's SIM_BUCK_TAU_MS and whether the
+ * INA setting came back, per row (stderr).
+ * --charge sets a CV (or CC) limit of BENCH_CHARGE_FRAC of what the
+ * simulated load gets at the start of the profile, so edugrid_charger
+ * takes over from the tracker, and ends with the hand-over and the
+ * overshoot of the true V_out (I_out) per row (stderr).  The run fails when
+ * a row never hands over, the duty jumps at a hand-over in a settled
+ * stretch or the overshoot while the ceiling regulates exceeds
+ * BENCH_CHARGE_OVER_PCT (not within BENCH_CHARGE_GRACE_MS of a hand-over or
+ * a step of the environment); the rows are limited, so they differ from
+ * the baseline.
+ * With --losses the run ends with the delivered energy of every tracker
+ * against the first one selected, per profile (stderr), e.g.
+ *
+ *   program --losses --tracker po_freeze --tracker po_pout
+ *
+ * With --baseline the run fails (exit 1) when an efficiency drops by more
+ * than the tolerance or more convergence events are missed than in the
+ * baseline; regenerate bench/mppt/baseline.csv from stdout when a change
+ * is intended.
+ ************************************************************************/
+
+/*************************************************************************
+ * Include
+ ************************************************************************/
+#include <Arduino.h>
+#include <bench_hal.h>
+#include <sim_pv.h>
+#include <bench_profiles.h>
+#include <bench_trackers.h>
+
+#include <map>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+
+/*************************************************************************
+ * Define
+ ************************************************************************/
+#define BENCH_BOOT_MS              (1000UL)   /* clock at the first pass */
+#define BENCH_STATIC_SETTLE_MS     (10000UL)  /* constant env this long = static */
+#define BENCH_RIPPLE_WINDOW_MS     (5000UL)
+#define BENCH_CONV_THRESHOLD       (0.98f)
+#define BENCH_NOISE_SIGMA_V        (0.005f)   /* [V] */
+#define BENCH_NOISE_SIGMA_I        (0.002f)   /* [A] */
+#define BENCH_DEFAULT_SEED         (1)
+#define BENCH_DEFAULT_TOLERANCE    (0.005f)   /* absolute, on the eta columns */
+#define BENCH_TEFF_BG_S            (60)       /* background sweep interval with --track-eff */
+#define BENCH_SCOPE_AT_MS          (10000UL)  /* step capture with --scope */
+#define BENCH_CHARGE_FRAC          (0.8f)     /* --charge limit against the start output */
+#define BENCH_CHARGE_GRACE_MS      (500UL)    /* after a hand-over or a step of the environment */
+#define BENCH_CHARGE_OVER_PCT      (2.0f)     /* [%] of the limit while regulating (~1 LEDC tick at low duty) */
+#define BENCH_CHARGE_JUMP_PCT      (1.5f)     /* [%] duty at a settled hand-over */
+
+/*************************************************************************
+ * Types
+ ************************************************************************/
+struct BenchResult_t
+{
+  std::string profile;
+  std::string tracker;
+  float  duration_s;
+  double e_mpp_j, e_pv_j;
+  double e_static_mpp_j, e_static_pv_j;
+  uint32_t conv_events, conv_missed;
+  double conv_sum_ms;
+  uint32_t conv_max_ms;
+  uint32_t ripple_windows;
+  double ripple_sum_pct;
+  float  ripple_max_pct;
+  double e_out_j, e_out_max_j;
+  double teff_mpp_j, teff_pv_j;   // passes edugrid_track_eff counted
+  float  teff_est;
+  double energy_fw[4];            // edugrid_energy lifetime: PV Wh, PV Ah, load Wh, load Ah
+  double energy_true[4];          // plant, up to the last accumulator read
+  int    scope_result;            // ScopeResult_t, -1 = no capture finished
+  bool   scope_restored;          // INA setting as before the capture
+  uint16_t scope_n, scope_pre;
+  uint8_t  scope_from, scope_to;  // [%]
+  float  scope_dv;                // V_in step [V]
+  float  scope_t63_ms;            // V_in 63 % of the step after the duty write
+  float  charge_limit;            // --charge: V or A, 0 = off
+  float  charge_engage_ms;        // first hand-over, NAN = never
+  float  charge_jump_pct;         // largest duty change at a settled hand-over [%]
+  uint32_t charge_handovers;
+  uint32_t charge_handover_ms;    // the last one
+  uint32_t charge_passes;         // passes under the ceiling
+  float  charge_over_pct;         // regulating, outside the grace [% of the limit]
+  float  charge_over_step_pct;    // anywhere
+};
+
+struct BenchOptions_t
+{
+  std::vector<std::string> profiles;
+  std::vector<std::string> trackers;
+  uint32_t    seed      = BENCH_DEFAULT_SEED;
+  bool        noise     = true;
+  float       load_noise = 1.0f;
+  bool        losses    = false;
+  bool        dither    = false;
+  bool        track_eff = false;
+  bool        energy    = false;
+  bool        scope     = false;
+  std::string charge;             // "cv", "cc" or empty
+  bool        verbose   = false;
+  std::string trace_path;
+  std::string baseline_path;
+  float       tolerance = BENCH_DEFAULT_TOLERANCE;
+};
+
+/*************************************************************************
+ * Helpers
+ ************************************************************************/
+static bool _selected(const std::vector<std::string>& filter, const char* name)
+{
+  if (filter.empty()) return true;
+  for (const std::string& f : filter) { if (f == name) return true; }
+  return false;
+}
+
+static float _ratio(double num, double den)
+{
+  return (den > 0.0) ? (float)(num / den) : NAN;
+}
+
+/** Print into memory, for the binary dumps */
+struct BenchBytes_t : public Print
+{
+  std::vector<uint8_t> data;
+  size_t write(uint8_t c) override { data.push_back(c); return 1; }
+};
+
+/** --scope: one step capture per row, evaluated once the channel is back */
+struct BenchScope_t
+{
+  bool     requested = false;
+  bool     done      = false;
+  uint16_t avg = 0, conv = 0;   // INA setting before the capture
+};
+
+static void _scopeService(edugrid_channel& ch, uint32_t t, BenchScope_t& s, BenchResult_t& r)
+{
+  if (s.done) return;
+  if (!s.requested)
+  {
+    if (t < BENCH_SCOPE_AT_MS) return;
+    s.avg = ch.meas.avgSamples();
+    s.conv = ch.meas.convUs();
+    ch.scope.request(edugrid_scope::defaultRequest());
+    s.requested = true;
+    return;
+  }
+  if (ch.scope.active() || ch.scope.lastResult() == SCOPE_NEVER) return;
+  s.done = true;
+  r.scope_result   = ch.scope.lastResult();
+  r.scope_restored = (ch.meas.avgSamples() == s.avg) && (ch.meas.convUs() == s.conv);
+
+  BenchBytes_t out;
+  if (!edugrid_scope::dump(out)) return;
+  ScopeHeader_t hdr;
+  memcpy(&hdr, out.data.data(), sizeof(hdr));
+  std::vector<ScopeSample_t> x(hdr.n);
+  memcpy(x.data(), out.data.data() + hdr.hdr_size, hdr.n * sizeof(ScopeSample_t));
+  r.scope_n    = hdr.n;
+  r.scope_pre  = hdr.pre;
+  r.scope_from = hdr.duty_from;
+  r.scope_to   = hdr.duty_to;
+  if (hdr.pre == 0 || hdr.n < hdr.pre + 10) return;
+
+  // Before the step, and the last tenth as the final value
+  double v0 = 0.0, v1 = 0.0;
+  const uint16_t tail = (uint16_t)((hdr.n - hdr.pre) / 10);
+  for (uint16_t k = 0; k < hdr.pre; ++k) v0 += x[k].v_in;
+  for (uint16_t k = hdr.n - tail; k < hdr.n; ++k) v1 += x[k].v_in;
+  v0 /= hdr.pre;
+  v1 /= tail;
+  r.scope_dv = (float)(v1 - v0);
+
+  // First crossing of 63 %, interpolated between the two samples around it
+  const double target = v0 + 0.632 * (v1 - v0);
+  double prev_t = 0.0, prev_v = v0;
+  for (uint16_t k = hdr.pre; k < hdr.n; ++k)
+  {
+    const double v = x[k].v_in;
+    if ((v - target) * (v1 - v0) >= 0.0)
+    {
+      const double f = (v != prev_v) ? (target - prev_v) / (v - prev_v) : 1.0;
+      r.scope_t63_ms = (float)((prev_t + f * (x[k].t_us - prev_t)) / 1000.0);
+      break;
+    }
+    prev_t = x[k].t_us;
+    prev_v = v;
+  }
+}
+
+/** --charge: hand-over and overshoot of the limited quantity `x` (true
+ *  V_out or I_out of this pass); `duty` is the one before ch.service(),
+ *  `quiet` false within BENCH_CHARGE_GRACE_MS of a step of the environment */
+static void _chargeService(const edugrid_channel& ch, ChargeState_t was, float duty, bool quiet,
+                           float x, uint32_t t, BenchResult_t& r)
+{
+  // The pass that hands over shows the tracker's last step across the
+  // limit; regulating starts with the ceiling it sets
+  const float over = (x / r.charge_limit - 1.0f) * 100.0f;
+  if (over > r.charge_over_step_pct) r.charge_over_step_pct = over;
+  quiet = quiet && (t - r.charge_handover_ms) >= BENCH_CHARGE_GRACE_MS;
+  if (quiet && was != CHARGE_MPPT && over > r.charge_over_pct) r.charge_over_pct = over;
+
+  if (ch.charge.state() == CHARGE_MPPT) return;
+  r.charge_passes++;
+  if (was != CHARGE_MPPT) return;
+  r.charge_handovers++;
+  r.charge_handover_ms = t;
+  if (isnan(r.charge_engage_ms)) r.charge_engage_ms = (float)t;
+  // Near the limit in a settled stretch the ceiling takes over at the duty
+  // the tracker had; after a step it may have to cut at once
+  const float jump = fabsf(bench_channel_duty(ch) - duty) * 100.0f;
+  if (quiet && jump > r.charge_jump_pct) r.charge_jump_pct = jump;
+}
+
+/** Settled-window bookkeeping for the duty ripple */
+struct RippleWindow_t
+{
+  std::vector<std::pair<uint32_t, float>> samples;   // (t_ms, duty %)
+
+  void close(BenchResult_t& r)
+  {
+    if (samples.empty()) return;
+    const uint32_t t_end = samples.back().first;
+    float lo = 1e9f, hi = -1e9f;
+    for (const auto& s : samples)
+    {
+      if (t_end - s.first > BENCH_RIPPLE_WINDOW_MS) continue;
+      if (s.second < lo) lo = s.second;
+      if (s.second > hi) hi = s.second;
+    }
+    const float pp = hi - lo;
+    r.ripple_windows++;
+    r.ripple_sum_pct += pp;
+    if (pp > r.ripple_max_pct) r.ripple_max_pct = pp;
+    samples.clear();
+  }
+};
+
+/*************************************************************************
+ * Run
+ ************************************************************************/
+static BenchResult_t _run(const bench_profile& profile, const BenchTracker_t& tracker,
+                          const BenchOptions_t& opt, FILE* trace)
+{
+  BenchResult_t r = {};
+  r.scope_result = -1;
+  r.scope_t63_ms = NAN;
+  r.profile    = profile.name();
+  r.tracker    = tracker.name;
+  r.duration_s = profile.duration_s();
+
+  sim_pv_array   pv;
+  sim_buck_plant plant(pv);
+  plant.setNoise(opt.noise ? BENCH_NOISE_SIGMA_V : 0.0f,
+                 opt.noise ? BENCH_NOISE_SIGMA_I : 0.0f, opt.seed);
+  plant.setLoadNoise(opt.noise ? opt.load_noise * BENCH_NOISE_SIGMA_V : 0.0f,
+                     opt.noise ? opt.load_noise * BENCH_NOISE_SIGMA_I : 0.0f);
+  plant.setLosses(opt.losses ? &kSimLabLosses : nullptr);
+  bool changing = false;
+  pv.setEnvironment(profile.at(0.0f, changing));
+  plant.setLoad(profile.loadAt(0.0f));
+  bench_hal::setMillis(0);
+
+  edugrid_channel ch;
+  bench_channel_begin(ch, plant);
+  tracker.setup(ch);
+  ch.pwm.setDither(opt.dither);
+  r.charge_engage_ms = NAN;
+  if (!opt.charge.empty())
+  {
+    // Into a resistive load V and I both follow P_out; limit the one asked for
+    float d_out, p_out_max;
+    plant.maxOutput(d_out, p_out_max);
+    const bool cv = (opt.charge == "cv");
+    r.charge_limit = BENCH_CHARGE_FRAC * (cv ? sqrtf(p_out_max * plant.load()) : sqrtf(p_out_max / plant.load()));
+    ch.charge.setLimits(cv ? r.charge_limit : 0.0f, cv ? 0.0f : r.charge_limit);
+  }
+  if (opt.track_eff)
+  {
+    ch.mppt.set_iv_bg_interval_s(BENCH_TEFF_BG_S);
+    ch.mppt.request_iv_bg_sweep();
+  }
+
+  const uint32_t dt_ms  = TASK_CONTROL_INTERVAL_MS;
+  const uint32_t end_ms = (uint32_t)(profile.duration_s() * 1000.0f);
+  const double   dt_s   = dt_ms / 1000.0;
+
+  EnergyTotals_t energy0;          // the totals are per process, not per channel object
+  edugrid_energy::totals(0, energy0);
+  EnergyPeriod_t energy_seen = energy0.lifetime;
+  double energy_run[4] = {};
+
+  SimEnv_t prev_env     = pv.environment();
+  float    prev_load    = plant.load();
+  bool     settled      = true;    // inside a constant-environment stretch
+  uint32_t settled_ms   = 0;       // ... which started here
+  bool     conv_pending = true;    // t = 0 counts as an event
+  RippleWindow_t ripple;
+  BenchScope_t   scope;
+  uint32_t       changed_ms   = 0;     // last step or ramp pass of the environment
+
+  for (uint32_t t = 0; t < end_ms; t += dt_ms)
+  {
+    bench_hal::advanceToMillis(BENCH_BOOT_MS + t);
+
+    const SimEnv_t env  = profile.at(t / 1000.0f, changing);
+    const float    load = profile.loadAt(t / 1000.0f);
+    if (env != prev_env || load != prev_load || changing)
+    {
+      // Environment or load moved: a pending event is missed, the settled window ends
+      if (settled)
+      {
+        if (conv_pending) r.conv_missed++;
+        ripple.close(r);
+        settled = false;
+      }
+      conv_pending = false;
+      changed_ms   = t;
+    }
+    else if (!settled)
+    {
+      // First pass after a step or at the end of a ramp: new event
+      settled      = true;
+      settled_ms   = t;
+      conv_pending = true;
+    }
+    prev_env  = env;
+    prev_load = load;
+    pv.setEnvironment(env);
+    plant.setLoad(load);
+
+    const float duty = bench_channel_duty(ch);
+    const SimPoint_t& pt = plant.solve(duty);
+    if (opt.energy) bench_hal::inaConvert();
+
+    float v_mpp, i_mpp, p_mpp;
+    pv.mpp(v_mpp, i_mpp, p_mpp);
+
+    const float teff_avail_j = ch.teff.availableJ();
+    const ChargeState_t charge_was = ch.charge.state();
+    ch.service();
+    if (opt.scope) _scopeService(ch, t, scope, r);
+    if (r.charge_limit > 0.0f)
+    {
+      const bool quiet = (t - changed_ms) >= BENCH_CHARGE_GRACE_MS;
+      _chargeService(ch, charge_was, duty, quiet, (opt.charge == "cv") ? pt.v_out : pt.i_out, t, r);
+    }
+
+    /* ---- metrics ---- */
+    if (opt.energy)
+    {
+      energy_run[0] += pt.p_in  * dt_s / 3600.0;
+      energy_run[1] += pt.i_in  * dt_s / 3600.0;
+      energy_run[2] += pt.p_out * dt_s / 3600.0;
+      energy_run[3] += pt.i_out * dt_s / 3600.0;
+      EnergyTotals_t e;
+      edugrid_energy::totals(0, e);
+      if (memcmp(&e.lifetime, &energy_seen, sizeof(energy_seen)) != 0)
+      {
+        energy_seen    = e.lifetime;
+        r.energy_fw[0] = e.lifetime.pv.wh   - energy0.lifetime.pv.wh;
+        r.energy_fw[1] = e.lifetime.pv.ah   - energy0.lifetime.pv.ah;
+        r.energy_fw[2] = e.lifetime.load.wh - energy0.lifetime.load.wh;
+        r.energy_fw[3] = e.lifetime.load.ah - energy0.lifetime.load.ah;
+        memcpy(r.energy_true, energy_run, sizeof(energy_run));
+      }
+    }
+    if (ch.teff.availableJ() != teff_avail_j)
+    {
+      r.teff_mpp_j += p_mpp   * dt_s;
+      r.teff_pv_j  += pt.p_in * dt_s;
+    }
+    // Static = steady state: settled long enough and converged since the
+    // last change, so start-up and slow recoveries count as dynamic
+    const bool is_static = settled && !conv_pending && (t - settled_ms >= BENCH_STATIC_SETTLE_MS);
+    r.e_mpp_j += p_mpp   * dt_s;
+    r.e_pv_j  += pt.p_in * dt_s;
+    r.e_out_j += pt.p_out * dt_s;
+    if (opt.losses)
+    {
+      float d_out, p_out_max;
+      plant.maxOutput(d_out, p_out_max);
+      r.e_out_max_j += p_out_max * dt_s;
+    }
+    if (is_static)
+    {
+      r.e_static_mpp_j += p_mpp   * dt_s;
+      r.e_static_pv_j  += pt.p_in * dt_s;
+      ripple.samples.push_back({ t, duty * 100.0f });
+    }
+    if (settled && conv_pending && p_mpp > 0.0f && pt.p_in >= BENCH_CONV_THRESHOLD * p_mpp)
+    {
+      const uint32_t conv = t - settled_ms;
+      r.conv_events++;
+      r.conv_sum_ms += conv;
+      if (conv > r.conv_max_ms) r.conv_max_ms = conv;
+      conv_pending = false;
+    }
+
+    if (trace)
+    {
+      fprintf(trace, "%s,%s,%lu,%.1f,%.2f,%.2f,%.3f,%.3f,%.3f,%d\n",
+              r.profile.c_str(), r.tracker.c_str(), (unsigned long)t, env.g_wm2, env.t_c,
+              duty * 100.0f, pt.v_in, pt.p_in, p_mpp, is_static ? 1 : 0);
+    }
+  }
+  if (conv_pending) r.conv_missed++;
+  ripple.close(r);
+  r.teff_est = ch.teff.etaTotal();
+
+  bench_hal::setInaSource(nullptr);
+  return r;
+}
+
+/*************************************************************************
+ * Report / baseline
+ ************************************************************************/
+static const char* kColumns =
+  "profile,tracker,duration_s,e_mpp_j,e_pv_j,eta_total,eta_static,eta_dynamic,"
+  "conv_events,conv_missed,conv_mean_ms,conv_max_ms,ripple_mean_pct,ripple_max_pct,e_out_j,eta_out";
+
+static std::string _fmt(float v, int digits)
+{
+  if (isnan(v)) return "";
+  char buf[32];
+  snprintf(buf, sizeof(buf), "%.*f", digits, v);
+  return buf;
+}
+
+static std::string _row(const BenchResult_t& r)
+{
+  const float eta_total   = _ratio(r.e_pv_j, r.e_mpp_j);
+  const float eta_static  = _ratio(r.e_static_pv_j, r.e_static_mpp_j);
+  const float eta_dynamic = _ratio(r.e_pv_j - r.e_static_pv_j, r.e_mpp_j - r.e_static_mpp_j);
+  const float conv_mean   = r.conv_events ? (float)(r.conv_sum_ms / r.conv_events) : NAN;
+  const float rip_mean    = r.ripple_windows ? (float)(r.ripple_sum_pct / r.ripple_windows) : NAN;
+  const float eta_out     = _ratio(r.e_out_j, r.e_out_max_j);
+
+  std::ostringstream os;
+  os << r.profile << ',' << r.tracker << ',' << _fmt(r.duration_s, 1) << ','
+     << _fmt((float)r.e_mpp_j, 1) << ',' << _fmt((float)r.e_pv_j, 1) << ','
+     << _fmt(eta_total, 4) << ',' << _fmt(eta_static, 4) << ',' << _fmt(eta_dynamic, 4) << ','
+     << r.conv_events << ',' << r.conv_missed << ','
+     << _fmt(conv_mean, 0) << ',' << (r.conv_events ? std::to_string(r.conv_max_ms) : std::string()) << ','
+     << _fmt(rip_mean, 2) << ',' << (r.ripple_windows ? _fmt(r.ripple_max_pct, 2) : std::string()) << ','
+     << _fmt((float)r.e_out_j, 1) << ',' << _fmt(eta_out, 4);
+  return os.str();
+}
+
+/** Delivered energy of every tracker against the first one, per profile */
+static void _report(const std::vector<BenchResult_t>& results)
+{
+  fprintf(stderr, "delivered energy (lossy stage), against the first tracker:\n");
+  const BenchResult_t* ref = nullptr;
+  for (const BenchResult_t& r : results)
+  {
+    if (!ref || ref->profile != r.profile) ref = &r;
+    const float d = (ref->e_out_j > 0.0) ? (float)((r.e_out_j / ref->e_out_j - 1.0) * 100.0) : NAN;
+    fprintf(stderr, "  %-16s %-14s e_out %9.1f J  eta_out %.4f  P_in/P_mpp %.4f  %+.2f %%\n",
+            r.profile.c_str(), r.tracker.c_str(), r.e_out_j, _ratio(r.e_out_j, r.e_out_max_j),
+            _ratio(r.e_pv_j, r.e_mpp_j), d);
+  }
+}
+
+/** Firmware tracking efficiency against the bench's own over the same passes */
+static void _reportTrackEff(const std::vector<BenchResult_t>& results)
+{
+  fprintf(stderr, "tracking efficiency, firmware estimate against P_pv/P_mpp:\n");
+  for (const BenchResult_t& r : results)
+  {
+    const float truth = _ratio(r.teff_pv_j, r.teff_mpp_j);
+    fprintf(stderr, "  %-16s %-14s est %.4f  true %.4f  error %+.4f  (%.0f%% of the run)\n",
+            r.profile.c_str(), r.tracker.c_str(), r.teff_est, truth, r.teff_est - truth,
+            100.0 * _ratio(r.teff_mpp_j, r.e_mpp_j));
+  }
+}
+
+/** Firmware energy totals against the plant's */
+static void _reportEnergy(const std::vector<BenchResult_t>& results)
+{
+  static const char* kNames[] = { "pv_wh", "pv_ah", "load_wh", "load_ah" };
+  fprintf(stderr, "energy totals, firmware (INA228 accumulators) against the plant:\n");
+  for (const BenchResult_t& r : results)
+  {
+    fprintf(stderr, "  %-16s %-14s", r.profile.c_str(), r.tracker.c_str());
+    for (uint8_t k = 0; k < 4; ++k)
+    {
+      const float err = (r.energy_true[k] > 0.0) ? (float)((r.energy_fw[k] / r.energy_true[k] - 1.0) * 100.0) : NAN;
+      fprintf(stderr, "  %s %.3f/%.3f %+.2f %%", kNames[k], r.energy_fw[k], r.energy_true[k], err);
+    }
+    fprintf(stderr, "\n");
+  }
+}
+
+/** Step captures against the plant's time constant */
+static void _reportScope(const std::vector<BenchResult_t>& results)
+{
+  fprintf(stderr, "scope step captures, V_in 63 %% rise against the plant (tau %.1f ms):\n", SIM_BUCK_TAU_MS);
+  for (const BenchResult_t& r : results)
+  {
+    fprintf(stderr, "  %-16s %-14s", r.profile.c_str(), r.tracker.c_str());
+    if (r.scope_result < 0) { fprintf(stderr, "  no capture finished\n"); continue; }
+    fprintf(stderr, "  %s, %u samples (%u before), duty %u%% -> %u%%, dV %+.3f V, t63 %.2f ms, INA setting %s\n",
+            edugrid_scope::resultToStr((ScopeResult_t)r.scope_result), (unsigned)r.scope_n, (unsigned)r.scope_pre,
+            (unsigned)r.scope_from, (unsigned)r.scope_to, r.scope_dv, r.scope_t63_ms,
+            r.scope_restored ? "restored" : "NOT restored");
+  }
+}
+
+/** Hand-over and overshoot under the --charge limit, returns the failures */
+static int _reportCharge(const std::vector<BenchResult_t>& results, const std::string& which)
+{
+  const bool cv = (which == "cv");
+  fprintf(stderr, "%s limit at %.0f %% of the start output, overshoot of the true %s:\n",
+          cv ? "CV" : "CC", BENCH_CHARGE_FRAC * 100.0f, cv ? "V_out" : "I_out");
+  int failures = 0;
+  for (const BenchResult_t& r : results)
+  {
+    const uint32_t passes = (uint32_t)(r.duration_s * 1000.0f / TASK_CONTROL_INTERVAL_MS);
+    const bool ok = !isnan(r.charge_engage_ms) && r.charge_jump_pct <= BENCH_CHARGE_JUMP_PCT &&
+                    r.charge_over_pct <= BENCH_CHARGE_OVER_PCT;
+    fprintf(stderr, "  %s %-16s %-14s %.2f %s: ", ok ? "| OK |" : "|FAIL|", r.profile.c_str(), r.tracker.c_str(),
+            r.charge_limit, cv ? "V" : "A");
+    if (isnan(r.charge_engage_ms))
+    {
+      fprintf(stderr, "never handed over\n");
+    }
+    else
+    {
+      fprintf(stderr, "hand-over at %.2f s (%u in all, duty jump %.2f %%), limited %.0f %% of the run, "
+              "overshoot %.2f %% (%.2f %% with hand-overs and steps)\n", r.charge_engage_ms / 1000.0f, (unsigned)r.charge_handovers,
+              r.charge_jump_pct, 100.0f * r.charge_passes / (passes ? passes : 1), r.charge_over_pct,
+              r.charge_over_step_pct);
+    }
+    if (!ok) failures++;
+  }
+  return failures;
+}
+
+static std::vector<std::string> _split(const std::string& line)
+{
+  std::vector<std::string> out;
+  std::stringstream ss(line);
+  std::string cell;
+  while (std::getline(ss, cell, ',')) out.push_back(cell);
+  if (!line.empty() && line.back() == ',') out.push_back("");
+  return out;
+}
+
+typedef std::map<std::string, std::map<std::string, std::string>> BenchTable_t;
+
+static bool _load(std::istream& in, BenchTable_t& table)
+{
+  std::string line;
+  if (!std::getline(in, line)) return false;
+  const std::vector<std::string> head = _split(line);
+  while (std::getline(in, line))
+  {
+    if (line.empty()) continue;
+    const std::vector<std::string> cells = _split(line);
+    std::map<std::string, std::string> row;
+    for (size_t n = 0; n < head.size() && n < cells.size(); ++n) row[head[n]] = cells[n];
+    table[row["profile"] + "/" + row["tracker"]] = row;
+  }
+  return true;
+}
+
+/** Compare against the baseline, returns the number of regressions */
+static int _check(const std::vector<std::string>& rows, const std::string& path, float tolerance)
+{
+  std::ifstream f(path);
+  BenchTable_t base, now;
+  if (!f || !_load(f, base))
+  {
+    fprintf(stderr, "|FAIL| cannot read baseline %s\n", path.c_str());
+    return 1;
+  }
+  std::stringstream cur;
+  cur << kColumns << '\n';
+  for (const std::string& r : rows) cur << r << '\n';
+  _load(cur, now);
+
+  int failures = 0;
+  for (auto& kv : now)
+  {
+    auto it = base.find(kv.first);
+    if (it == base.end())
+    {
+      fprintf(stderr, "|WARN| %s not in baseline\n", kv.first.c_str());
+      continue;
+    }
+    for (const char* col : { "eta_total", "eta_static", "eta_dynamic" })
+    {
+      const std::string& b = it->second[col];
+      const std::string& c = kv.second[col];
+      if (b.empty() || c.empty()) continue;
+      if (atof(c.c_str()) < atof(b.c_str()) - tolerance)
+      {
+        fprintf(stderr, "|FAIL| %s %s %s < baseline %s\n", kv.first.c_str(), col, c.c_str(), b.c_str());
+        failures++;
+      }
+    }
+    if (atoi(kv.second["conv_missed"].c_str()) > atoi(it->second["conv_missed"].c_str()))
+    {
+      fprintf(stderr, "|FAIL| %s conv_missed %s > baseline %s\n", kv.first.c_str(),
+              kv.second["conv_missed"].c_str(), it->second["conv_missed"].c_str());
+      failures++;
+    }
+  }
+  if (failures == 0) fprintf(stderr, "| OK | no regression against %s\n", path.c_str());
+  return failures;
+}
+
+/*************************************************************************
+ * Main
+ ************************************************************************/
+int main(int argc, char** argv)
+{
+  size_t n_trackers = 0;
+  const BenchTracker_t* trackers = bench_trackers(n_trackers);
+
+  BenchOptions_t opt;
+  for (int n = 1; n < argc; ++n)
+  {
+    const std::string a = argv[n];
+    const bool has_val = (n + 1 < argc);
+    if      (a == "--profile"   && has_val) opt.profiles.push_back(argv[++n]);
+    else if (a == "--tracker"   && has_val) opt.trackers.push_back(argv[++n]);
+    else if (a == "--seed"      && has_val) opt.seed = (uint32_t)strtoul(argv[++n], nullptr, 0);
+    else if (a == "--trace"     && has_val) opt.trace_path = argv[++n];
+    else if (a == "--baseline"  && has_val) opt.baseline_path = argv[++n];
+    else if (a == "--tolerance" && has_val) opt.tolerance = (float)atof(argv[++n]);
+    else if (a == "--load-noise" && has_val) opt.load_noise = (float)atof(argv[++n]);
+    else if (a == "--charge"    && has_val) opt.charge = argv[++n];
+    else if (a == "--no-noise")  opt.noise = false;
+    else if (a == "--losses")    opt.losses = true;
+    else if (a == "--dither")    opt.dither = true;
+    else if (a == "--track-eff") opt.track_eff = true;
+    else if (a == "--energy")    opt.energy = true;
+    else if (a == "--scope")     opt.scope = true;
+    else if (a == "--verbose")   opt.verbose = true;
+    else if (a == "--list")
+    {
+      for (const bench_profile& p : bench_profiles()) printf("profile %s (%.0f s)\n", p.name(), p.duration_s());
+      for (size_t k = 0; k < n_trackers; ++k)         printf("tracker %s\n", trackers[k].name);
+      return 0;
+    }
+    else
+    {
+      fprintf(stderr, "unknown argument: %s\n", a.c_str());
+      return 2;
+    }
+  }
+  if (!opt.charge.empty() && opt.charge != "cv" && opt.charge != "cc")
+  {
+    fprintf(stderr, "--charge takes cv or cc\n");
+    return 2;
+  }
+  bench_hal::setSerialEcho(opt.verbose);
+
+  FILE* trace = nullptr;
+  if (!opt.trace_path.empty())
+  {
+    trace = fopen(opt.trace_path.c_str(), "w");
+    if (!trace) { fprintf(stderr, "|FAIL| cannot open %s\n", opt.trace_path.c_str()); return 2; }
+    fprintf(trace, "profile,tracker,t_ms,g_wm2,t_c,duty_pct,v_pv,p_pv,p_mpp,static\n");
+  }
+
+  std::vector<std::string>   rows;
+  std::vector<BenchResult_t> results;
+  printf("%s\n", kColumns);
+  for (const bench_profile& p : bench_profiles())
+  {
+    if (!_selected(opt.profiles, p.name())) continue;
+    for (size_t k = 0; k < n_trackers; ++k)
+    {
+      if (!_selected(opt.trackers, trackers[k].name)) continue;
+      results.push_back(_run(p, trackers[k], opt, trace));
+      rows.push_back(_row(results.back()));
+      printf("%s\n", rows.back().c_str());
+      fflush(stdout);
+    }
+  }
+  if (trace) fclose(trace);
+  if (opt.losses) _report(results);
+  if (opt.track_eff) _reportTrackEff(results);
+  if (opt.energy) _reportEnergy(results);
+  if (opt.scope) _reportScope(results);
+  int failures = opt.charge.empty() ? 0 : _reportCharge(results, opt.charge);
+
+  if (!opt.baseline_path.empty())
+  {
+    failures += _check(rows, opt.baseline_path, opt.tolerance);
+  }
+  return (failures == 0) ? 0 : 1;
+}
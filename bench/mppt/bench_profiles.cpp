@@ -0,0 +1,146 @@
+/*************************************************************************
+ * @file bench_profiles.cpp
+ * @date 2026/10/18
+ *
+ ************************************************************************/
+
+/*************************************************************************
+ * Include
+ ************************************************************************/
+#include <bench_profiles.h>
+
+/*************************************************************************
+ * Function Definition
+ ************************************************************************/
+bench_profile::bench_profile(const char* name, float g_wm2, float t_c)
+  : _name(name)
+{
+  SimEnv_t env = {};
+  env.g_wm2 = g_wm2;
+  env.t_c   = t_c;
+  _kf.push_back({ 0.0f, env, SIM_LOAD_OHM });
+}
+
+bench_profile& bench_profile::_append(float ramp_s, const SimEnv_t& env)
+{
+  _kf.push_back({ _kf.back().t_s + ((ramp_s > 0.0f) ? ramp_s : 0.0f), env, _kf.back().r_load });
+  return *this;
+}
+
+bench_profile& bench_profile::hold(float s)
+{
+  return _append(s, _kf.back().env);
+}
+
+bench_profile& bench_profile::irradiance(float g_wm2, float ramp_s)
+{
+  SimEnv_t env = _kf.back().env;
+  env.g_wm2 = g_wm2;
+  return _append(ramp_s, env);
+}
+
+bench_profile& bench_profile::temperature(float t_c, float ramp_s)
+{
+  SimEnv_t env = _kf.back().env;
+  env.t_c = t_c;
+  return _append(ramp_s, env);
+}
+
+bench_profile& bench_profile::shade(uint8_t substring, float fraction, float ramp_s)
+{
+  SimEnv_t env = _kf.back().env;
+  if (substring < SIM_MAX_SUBSTRINGS) env.shade[substring] = fraction;
+  return _append(ramp_s, env);
+}
+
+bench_profile& bench_profile::load(float r_ohm)
+{
+  _append(0.0f, _kf.back().env);
+  _kf.back().r_load = r_ohm;
+  return *this;
+}
+
+float bench_profile::loadAt(float t_s) const
+{
+  size_t n = 0;
+  while (n + 1 < _kf.size() && _kf[n + 1].t_s <= t_s) ++n;
+  return _kf[n].r_load;
+}
+
+SimEnv_t bench_profile::at(float t_s, bool& changing) const
+{
+  changing = false;
+  size_t n = 0;
+  while (n + 1 < _kf.size() && _kf[n + 1].t_s <= t_s) ++n;
+  if (n + 1 >= _kf.size()) return _kf.back().env;
+
+  const Keyframe_t& a = _kf[n];
+  const Keyframe_t& b = _kf[n + 1];
+  if (a.env == b.env) return a.env;
+
+  changing = true;
+  const float x = (t_s - a.t_s) / (b.t_s - a.t_s);
+  SimEnv_t env;
+  env.g_wm2 = a.env.g_wm2 + x * (b.env.g_wm2 - a.env.g_wm2);
+  env.t_c   = a.env.t_c   + x * (b.env.t_c   - a.env.t_c);
+  for (uint8_t k = 0; k < SIM_MAX_SUBSTRINGS; ++k)
+  {
+    env.shade[k] = a.env.shade[k] + x * (b.env.shade[k] - a.env.shade[k]);
+  }
+  return env;
+}
+
+const std::vector<bench_profile>& bench_profiles(void)
+{
+  static std::vector<bench_profile> s_profiles;
+  if (!s_profiles.empty()) return s_profiles;
+
+  // Every profile starts with a 40 s hold: the firmware boots at
+  // PWM_ABS_INIT duty, so start-up convergence is the first event.
+
+  // Irradiance steps, e.g. a cloud edge passing
+  s_profiles.push_back(bench_profile("step", 1000.0f)
+    .hold(40).irradiance(300).hold(30).irradiance(800).hold(30)
+    .irradiance(200).hold(30).irradiance(1000).hold(40));
+
+  // Slow morning/evening ramps, ~7 W/m^2/s
+  s_profiles.push_back(bench_profile("slow_ramp", 200.0f)
+    .hold(40).irradiance(1000, 120).hold(20).irradiance(200, 120).hold(20));
+
+  // EN 50530 style dynamic sequence: trapezoids 30..100 % and 10..50 % of
+  // STC irradiance at rising slopes with a dwell at each plateau
+  {
+    bench_profile p("en50530_fast", 300.0f);
+    p.hold(40);
+    const float high_slopes[] = { 10.0f, 20.0f, 50.0f, 100.0f };
+    for (float slope : high_slopes)
+    {
+      p.irradiance(1000, 700.0f / slope).hold(10).irradiance(300, 700.0f / slope).hold(10);
+    }
+    p.irradiance(100).hold(20);
+    const float low_slopes[] = { 5.0f, 10.0f, 20.0f, 50.0f };
+    for (float slope : low_slopes)
+    {
+      p.irradiance(500, 400.0f / slope).hold(10).irradiance(100, 400.0f / slope).hold(10);
+    }
+    s_profiles.push_back(p);
+  }
+
+  // Partial shading: a multi-peak P-V curve where P&O can lock onto a
+  // local maximum.  Shade steps, then a slow shadow sweep that clears.
+  s_profiles.push_back(bench_profile("partial_shading", 1000.0f)
+    .hold(40).shade(2, 0.6f).hold(30).shade(1, 0.3f).hold(30)
+    .shade(2, 0.0f, 15).hold(20).shade(1, 0.0f, 15).hold(30));
+
+  // Panel warming up under constant sun, then cooling after a cloud
+  s_profiles.push_back(bench_profile("temp_drift", 800.0f, 15.0f)
+    .hold(40).temperature(60, 180).hold(20).irradiance(400).temperature(30, 90).hold(20));
+
+  // Load steps on the output side (battery/heater switching): with a fixed
+  // duty the panel sees R_load / D^2 move, the MPP itself does not
+  s_profiles.push_back(bench_profile("load_step", 1000.0f)
+    .hold(40).load(1.6f).hold(30).load(2.5f).hold(30)
+    .irradiance(400).hold(30).load(1.6f).hold(30).load(2.5f).hold(30));
+
+  return s_profiles;
+}
@@ -0,0 +1,61 @@
+/*************************************************************************
+ * @file bench_profiles.h
+ * @date 2026/10/18
+ * @brief Irradiance / temperature / shading profiles for the MPPT bench
+ ************************************************************************/
+
+#ifndef EDUGRID_BENCH_PROFILES_H_
+#define EDUGRID_BENCH_PROFILES_H_
+
+/*************************************************************************
+ * Include
+ ************************************************************************/
+#include <sim_pv.h>
+#include <vector>
+
+/*************************************************************************
+ * Class
+ ************************************************************************/
+
+/**
+ * Piecewise linear environment over time.  Built from the starting point
+ * with hold() and the setters below; a setter with ramp_s = 0 is a step.
+ * The load resistance of the buck stage only steps.
+ */
+class bench_profile
+{
+public:
+  bench_profile(const char* name, float g_wm2, float t_c = SIM_T_STC_C);
+
+  bench_profile& hold(float s);
+  bench_profile& irradiance(float g_wm2, float ramp_s = 0.0f);
+  bench_profile& temperature(float t_c, float ramp_s = 0.0f);
+  bench_profile& shade(uint8_t substring, float fraction, float ramp_s = 0.0f);
+  bench_profile& load(float r_ohm);
+
+  const char* name(void) const      { return _name; }
+  float       duration_s(void) const { return _kf.back().t_s; }
+
+  /** Environment at time t; `changing` is true inside a ramp */
+  SimEnv_t    at(float t_s, bool& changing) const;
+  /** Load resistance at time t [ohm] */
+  float       loadAt(float t_s) const;
+
+private:
+  struct Keyframe_t
+  {
+    float    t_s;
+    SimEnv_t env;
+    float    r_load;
+  };
+
+  bench_profile& _append(float ramp_s, const SimEnv_t& env);
+
+  const char*             _name;
+  std::vector<Keyframe_t> _kf;
+};
+
+/** The standard set, in report order */
+const std::vector<bench_profile>& bench_profiles(void);
+
+#endif /* EDUGRID_BENCH_PROFILES_H_ */
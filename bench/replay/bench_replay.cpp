@@ -0,0 +1,338 @@
+/*************************************************************************
+ * @file bench_replay.cpp
+ * @date 2026/10/18
+ * @brief Replay recorded field sessions through the trackers (pio run -e bench_replay)
+ *
+ * Reads a log.csv session and optional IV sweeps of the same panel, then
+ *  1. estimates the power stage: load resistance and converter efficiency
+ *     from the logged output side,
+ *  2. fits the panel model (bench/sim) to each sweep; a sweep applies from
+ *     its time stamp on, the first one also before it,
+ *  3. splits the session into windows and reconstructs the irradiance of
+ *     each window from the logged PV operating points (median of the
+ *     per-row fits, temperature held at --temp),
+ *  4. runs every tracker of bench_trackers.cpp through the reconstructed
+ *     session in simulated time (irradiance interpolated between window
+ *     centres, TASK_CONTROL_INTERVAL_MS passes).
+ *
+ * One CSV row per tracker on stdout: the energy the tracker harvests in
+ * the replay against the logged PV energy and the available MPP energy.
+ * Replaying the tracker that produced the log ("po_fixed" for current
+ * firmware) shows how well the reconstruction matches the site.
+ *
+ * Usage:
+ *   program --log log.csv [--iv sweep.json[@t_s]]... [--window S]
+ *           [--temp C] [--r-load OHM] [--eta X] [--tracker NAME]...
+ *           [--windows FILE] [--verbose]
+ ************************************************************************/
+
+/*************************************************************************
+ * Include
+ ************************************************************************/
+#include <Arduino.h>
+#include <bench_hal.h>
+#include <sim_pv.h>
+#include <bench_trackers.h>
+#include <replay_data.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+/*************************************************************************
+ * Define
+ ************************************************************************/
+#define REPLAY_BOOT_MS              (1000UL)
+#define REPLAY_DEFAULT_WINDOW_S     (60.0f)
+#define REPLAY_DEFAULT_TEMP_C       (SIM_T_STC_C)
+#define REPLAY_MIN_LOAD_CURRENT_A   (0.05f)   /* rows used for the load estimate */
+#define REPLAY_MIN_EFF_POWER_W      (1.0f)    /* rows used for the efficiency estimate */
+
+/*************************************************************************
+ * Types
+ ************************************************************************/
+struct ReplayWindow_t
+{
+  float  t0_s, t1_s;
+  size_t sweep;               // index into the sweeps, or SIZE_MAX for the default spec
+  size_t samples;             // rows with PV present
+  float  g_wm2;
+  float  fit_rms_a;           // [A] residual of the logged points
+  double e_logged_j;
+  double e_mpp_j;
+  std::vector<double> e_tracker_j;
+};
+
+struct ReplayOptions_t
+{
+  std::string              log_path;
+  std::vector<std::string> sweeps;
+  std::vector<std::string> trackers;
+  std::string              windows_path;
+  float                    window_s = REPLAY_DEFAULT_WINDOW_S;
+  float                    temp_c   = REPLAY_DEFAULT_TEMP_C;
+  float                    r_load   = NAN;
+  float                    eta      = NAN;
+  bool                     verbose  = false;
+};
+
+/*************************************************************************
+ * Helpers
+ ************************************************************************/
+static float _median(std::vector<float> v)
+{
+  if (v.empty()) return NAN;
+  std::nth_element(v.begin(), v.begin() + v.size() / 2, v.end());
+  return v[v.size() / 2];
+}
+
+static bool _selected(const std::vector<std::string>& filter, const char* name)
+{
+  if (filter.empty()) return true;
+  return std::find(filter.begin(), filter.end(), name) != filter.end();
+}
+
+/** Irradiance at t, linear between window centres */
+static float _irradianceAt(const std::vector<ReplayWindow_t>& w, float t_s)
+{
+  const auto centre = [&](size_t k) { return 0.5f * (w[k].t0_s + w[k].t1_s); };
+  if (t_s <= centre(0)) return w.front().g_wm2;
+  for (size_t k = 0; k + 1 < w.size(); ++k)
+  {
+    if (t_s < centre(k + 1))
+    {
+      const float x = (t_s - centre(k)) / (centre(k + 1) - centre(k));
+      return w[k].g_wm2 + x * (w[k + 1].g_wm2 - w[k].g_wm2);
+    }
+  }
+  return w.back().g_wm2;
+}
+
+static const SimPvSpec_t& _specOf(const ReplayWindow_t& w, const std::vector<ReplaySweep_t>& sweeps)
+{
+  return (w.sweep < sweeps.size()) ? sweeps[w.sweep].spec : kSimDefaultPanel;
+}
+
+/*************************************************************************
+ * Replay
+ ************************************************************************/
+static void _replay(const BenchTracker_t& tracker, size_t slot, bool count_mpp,
+                    std::vector<ReplayWindow_t>& windows, const std::vector<ReplaySweep_t>& sweeps,
+                    const ReplayOptions_t& opt, float r_load, float eta)
+{
+  sim_pv_array   pv(_specOf(windows.front(), sweeps));
+  sim_buck_plant plant(pv, r_load, eta);
+  SimEnv_t env = {};
+  env.t_c   = opt.temp_c;
+  env.g_wm2 = windows.front().g_wm2;
+  pv.setEnvironment(env);
+  bench_hal::setMillis(REPLAY_BOOT_MS);
+
+  edugrid_channel ch;
+  bench_channel_begin(ch, plant);
+  tracker.setup(ch);
+
+  const uint32_t dt_ms = TASK_CONTROL_INTERVAL_MS;
+  const double   dt_s  = dt_ms / 1000.0;
+  const float    t0    = windows.front().t0_s;
+  size_t w = 0;
+  for (float t = t0; t < windows.back().t1_s; t += dt_ms / 1000.0f)
+  {
+    bench_hal::advanceToMillis(REPLAY_BOOT_MS + (uint32_t)((t - t0) * 1000.0f + 0.5f));
+    while (w + 1 < windows.size() && t >= windows[w].t1_s)
+    {
+      ++w;
+      if (windows[w].sweep != windows[w - 1].sweep) pv.setSpec(_specOf(windows[w], sweeps));
+    }
+
+    env.g_wm2 = _irradianceAt(windows, t);
+    pv.setEnvironment(env);
+    const SimPoint_t& pt = plant.solve(bench_channel_duty(ch));
+    float v_mpp, i_mpp, p_mpp;
+    pv.mpp(v_mpp, i_mpp, p_mpp);
+
+    ch.service();
+
+    windows[w].e_tracker_j[slot] += pt.p_in * dt_s;
+    if (count_mpp) windows[w].e_mpp_j += p_mpp * dt_s;
+  }
+  bench_hal::setInaSource(nullptr);
+}
+
+/*************************************************************************
+ * Main
+ ************************************************************************/
+int main(int argc, char** argv)
+{
+  ReplayOptions_t opt;
+  for (int n = 1; n < argc; ++n)
+  {
+    const std::string a = argv[n];
+    const bool has_val = (n + 1 < argc);
+    if      (a == "--log"     && has_val) opt.log_path = argv[++n];
+    else if (a == "--iv"      && has_val) opt.sweeps.push_back(argv[++n]);
+    else if (a == "--tracker" && has_val) opt.trackers.push_back(argv[++n]);
+    else if (a == "--windows" && has_val) opt.windows_path = argv[++n];
+    else if (a == "--window"  && has_val) opt.window_s = (float)atof(argv[++n]);
+    else if (a == "--temp"    && has_val) opt.temp_c   = (float)atof(argv[++n]);
+    else if (a == "--r-load"  && has_val) opt.r_load   = (float)atof(argv[++n]);
+    else if (a == "--eta"     && has_val) opt.eta      = (float)atof(argv[++n]);
+    else if (a == "--verbose") opt.verbose = true;
+    else
+    {
+      fprintf(stderr, "unknown argument: %s\n", a.c_str());
+      return 2;
+    }
+  }
+  if (opt.log_path.empty() || opt.window_s <= 0.0f)
+  {
+    fprintf(stderr, "usage: program --log log.csv [--iv sweep.json[@t_s]]... [--window S] [--temp C]\n"
+                    "               [--r-load OHM] [--eta X] [--tracker NAME]... [--windows FILE]\n");
+    return 2;
+  }
+  bench_hal::setSerialEcho(opt.verbose);
+
+  /* ---- session ---- */
+  std::string err;
+  std::vector<ReplaySample_t> rows;
+  if (!replay_load_log(opt.log_path, rows, err)) { fprintf(stderr, "|FAIL| %s\n", err.c_str()); return 1; }
+  const float row_dt_s = TASK_LOOP_INTERVAL_MS / 1000.0f;
+
+  // Power stage from the output side unless given
+  std::vector<float> loads, effs;
+  for (const ReplaySample_t& r : rows)
+  {
+    if (r.iout >= REPLAY_MIN_LOAD_CURRENT_A) loads.push_back(r.vout / r.iout);
+    if (r.vin * r.iin >= REPLAY_MIN_EFF_POWER_W) effs.push_back((r.vout * r.iout) / (r.vin * r.iin));
+  }
+  float r_load = isnan(opt.r_load) ? _median(loads) : opt.r_load;
+  float eta    = isnan(opt.eta)    ? _median(effs)  : opt.eta;
+  if (isnan(r_load) || r_load <= 0.0f)
+  {
+    fprintf(stderr, "|FAIL| no load current in the log, pass --r-load\n");
+    return 1;
+  }
+  if (isnan(eta) || eta <= 0.0f) eta = 0.95f;
+  if (eta > 1.0f) eta = 1.0f;
+
+  /* ---- IV sweeps -> panel model ---- */
+  std::vector<ReplaySweep_t> sweeps;
+  for (const std::string& arg : opt.sweeps)
+  {
+    ReplaySweep_t s;
+    const size_t at = arg.rfind('@');
+    const std::string path = (at == std::string::npos) ? arg : arg.substr(0, at);
+    if (!replay_load_sweep(path, s, err)) { fprintf(stderr, "|FAIL| %s\n", err.c_str()); return 1; }
+    s.t_s = (at == std::string::npos) ? 0.0f : (float)atof(arg.c_str() + at + 1);
+    s.fit_rms_v = replay_fit_spec(s, kSimDefaultPanel, opt.temp_c, s.spec);
+    fprintf(stderr, "| OK | %s @ %.0f s: Isc=%.2f A Voc=%.2f V (rms %.3f V)\n",
+            path.c_str(), s.t_s, s.spec.isc_a, s.spec.voc_v, s.fit_rms_v);
+    sweeps.push_back(s);
+  }
+  std::sort(sweeps.begin(), sweeps.end(),
+            [](const ReplaySweep_t& a, const ReplaySweep_t& b) { return a.t_s < b.t_s; });
+  if (sweeps.empty()) fprintf(stderr, "|WARN| no IV sweep given, using the default panel model\n");
+
+  /* ---- windows: irradiance per window from the logged operating points ---- */
+  size_t n_trackers = 0;
+  const BenchTracker_t* trackers = bench_trackers(n_trackers);
+
+  std::vector<ReplayWindow_t> windows;
+  const float t_begin = rows.front().t_s;
+  const float t_end   = rows.back().t_s + row_dt_s;
+  size_t r = 0;
+  for (float t0 = t_begin; t0 < t_end; t0 += opt.window_s)
+  {
+    ReplayWindow_t w = {};
+    w.t0_s  = t0;
+    w.t1_s  = std::min(t0 + opt.window_s, t_end);
+    w.sweep = sweeps.empty() ? SIZE_MAX : 0;
+    for (size_t k = 0; k < sweeps.size(); ++k) { if (sweeps[k].t_s <= t0) w.sweep = k; }
+    w.e_tracker_j.assign(n_trackers, 0.0);
+
+    sim_pv_array pv(_specOf(w, sweeps));
+    std::vector<float> g;
+    std::vector<size_t> in_window;
+    for (; r < rows.size() && rows[r].t_s < w.t1_s; ++r)
+    {
+      w.e_logged_j += rows[r].vin * rows[r].iin * row_dt_s;
+      if (rows[r].vin < PV_PRESENT_V) continue;
+      g.push_back(replay_fit_irradiance(pv, opt.temp_c, rows[r].vin, rows[r].iin));
+      in_window.push_back(r);
+    }
+    w.samples = g.size();
+    w.g_wm2   = g.empty() ? 0.0f : _median(g);
+
+    // How well one irradiance explains the window's logged points.  The
+    // residual is taken in current: near Isc the curve is too steep for a
+    // voltage residual to mean anything.
+    SimEnv_t env = {};
+    env.g_wm2 = w.g_wm2;
+    env.t_c   = opt.temp_c;
+    pv.setEnvironment(env);
+    double sum = 0.0;
+    for (size_t k : in_window) { const float d = pv.currentAt(rows[k].vin) - rows[k].iin; sum += d * d; }
+    w.fit_rms_a = in_window.empty() ? NAN : (float)sqrt(sum / in_window.size());
+    windows.push_back(w);
+  }
+
+  /* ---- replay every tracker ---- */
+  bool first = true;   // the available MPP energy is the same for every run
+  for (size_t k = 0; k < n_trackers; ++k)
+  {
+    if (!_selected(opt.trackers, trackers[k].name)) continue;
+    _replay(trackers[k], k, first, windows, sweeps, opt, r_load, eta);
+    first = false;
+  }
+
+  /* ---- report ---- */
+  double e_logged = 0.0, e_mpp = 0.0, fit_sum = 0.0;
+  size_t fit_n = 0;
+  for (const ReplayWindow_t& w : windows)
+  {
+    e_logged += w.e_logged_j;
+    e_mpp    += w.e_mpp_j;
+    if (!isnan(w.fit_rms_a)) { fit_sum += w.fit_rms_a * w.fit_rms_a * w.samples; fit_n += w.samples; }
+  }
+  const float fit_rms = fit_n ? (float)sqrt(fit_sum / fit_n) : NAN;
+
+  printf("log,tracker,duration_s,windows,r_load_ohm,eta_conv,fit_rms_a,e_logged_j,e_mpp_j,e_replay_j,"
+         "eta_logged,eta_replay,gain_pct\n");
+  for (size_t k = 0; k < n_trackers; ++k)
+  {
+    if (!_selected(opt.trackers, trackers[k].name)) continue;
+    double e = 0.0;
+    for (const ReplayWindow_t& w : windows) e += w.e_tracker_j[k];
+    printf("%s,%s,%.0f,%u,%.3f,%.3f,%.3f,%.1f,%.1f,%.1f,%.4f,%.4f,%.2f\n",
+           opt.log_path.c_str(), trackers[k].name, t_end - t_begin, (unsigned)windows.size(),
+           r_load, eta, fit_rms, e_logged, e_mpp, e,
+           (e_mpp > 0.0) ? e_logged / e_mpp : 0.0, (e_mpp > 0.0) ? e / e_mpp : 0.0,
+           (e_logged > 0.0) ? 100.0 * (e - e_logged) / e_logged : 0.0);
+  }
+
+  if (!opt.windows_path.empty())
+  {
+    FILE* f = fopen(opt.windows_path.c_str(), "w");
+    if (!f) { fprintf(stderr, "|FAIL| cannot open %s\n", opt.windows_path.c_str()); return 1; }
+    fprintf(f, "window,t0_s,t1_s,samples,g_wm2,t_c,fit_rms_a,e_logged_j,e_mpp_j");
+    for (size_t k = 0; k < n_trackers; ++k)
+    {
+      if (_selected(opt.trackers, trackers[k].name)) fprintf(f, ",e_%s_j", trackers[k].name);
+    }
+    fprintf(f, "\n");
+    for (size_t w = 0; w < windows.size(); ++w)
+    {
+      const ReplayWindow_t& x = windows[w];
+      fprintf(f, "%u,%.0f,%.0f,%u,%.1f,%.1f,%.3f,%.1f,%.1f", (unsigned)w, x.t0_s, x.t1_s,
+              (unsigned)x.samples, x.g_wm2, opt.temp_c, isnan(x.fit_rms_a) ? 0.0f : x.fit_rms_a,
+              x.e_logged_j, x.e_mpp_j);
+      for (size_t k = 0; k < n_trackers; ++k)
+      {
+        if (_selected(opt.trackers, trackers[k].name)) fprintf(f, ",%.1f", x.e_tracker_j[k]);
+      }
+      fprintf(f, "\n");
+    }
+    fclose(f);
+  }
+  return 0;
+}
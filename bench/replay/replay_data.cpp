@@ -0,0 +1,213 @@
+/*************************************************************************
+ * @file replay_data.cpp
+ * @date 2026/10/18
+ *
+ ************************************************************************/
+
+/*************************************************************************
+ * Include
+ ************************************************************************/
+#include <replay_data.h>
+#include <edugrid_states.h>
+#include <math.h>
+#include <fstream>
+#include <sstream>
+
+/*************************************************************************
+ * Define
+ ************************************************************************/
+#define REPLAY_G_MAX_WM2        (2000.0f)  /* search bound for the fits */
+#define REPLAY_FIT_ITERATIONS   (40)
+#define REPLAY_SPEC_GRID        (24)       /* coarse grid per axis before refining */
+
+/*************************************************************************
+ * Helpers
+ ************************************************************************/
+static bool _readFile(const std::string& path, std::string& out)
+{
+  std::ifstream f(path, std::ios::binary);
+  if (!f) return false;
+  std::stringstream ss;
+  ss << f.rdbuf();
+  out = ss.str();
+  return true;
+}
+
+/** Numbers of the JSON array that follows "key" */
+static bool _jsonArray(const std::string& text, const char* key, std::vector<float>& out)
+{
+  const std::string quoted = std::string("\"") + key + "\"";
+  size_t p = text.find(quoted);
+  if (p == std::string::npos) return false;
+  p = text.find('[', p + quoted.size());
+  if (p == std::string::npos) return false;
+  const char* s = text.c_str() + p + 1;
+  while (*s && *s != ']')
+  {
+    char* end = nullptr;
+    const float v = strtof(s, &end);
+    if (end == s) { ++s; continue; }   // separators / whitespace
+    out.push_back(v);
+    s = end;
+  }
+  return *s == ']';
+}
+
+static float _rmsResidual(sim_pv_array& pv, const std::vector<float>& v, const std::vector<float>& i)
+{
+  double sum = 0.0;
+  size_t n = 0;
+  for (size_t k = 0; k < v.size(); ++k)
+  {
+    if (v[k] < PV_PRESENT_V) continue;
+    const float r = pv.voltageAt(i[k]) - v[k];
+    sum += (double)r * r;
+    ++n;
+  }
+  return n ? (float)sqrt(sum / n) : NAN;
+}
+
+/*************************************************************************
+ * Function Definition
+ ************************************************************************/
+bool replay_load_log(const std::string& path, std::vector<ReplaySample_t>& out, std::string& err)
+{
+  std::ifstream f(path);
+  if (!f) { err = "cannot open " + path; return false; }
+
+  std::string line;
+  while (std::getline(f, line))
+  {
+    if (!line.empty() && line.back() == '\r') line.pop_back();
+    if (line.empty() || line[0] == '#') continue;   // header and block trailers
+
+    unsigned long idx = 0;
+    float vin, vout, iin, iout;
+    if (sscanf(line.c_str(), "%lu;%f;%f;%f;%f", &idx, &vin, &vout, &iin, &iout) != 5) continue;
+    out.push_back({ idx * (TASK_LOOP_INTERVAL_MS / 1000.0f), vin, vout, iin, iout });
+  }
+  if (out.empty()) { err = "no rows in " + path; return false; }
+  return true;
+}
+
+bool replay_load_sweep(const std::string& path, ReplaySweep_t& out, std::string& err)
+{
+  std::string text;
+  if (!_readFile(path, text)) { err = "cannot open " + path; return false; }
+  out.path = path;
+  out.v.clear();
+  out.i.clear();
+
+  if (path.size() > 5 && path.compare(path.size() - 5, 5, ".json") == 0)
+  {
+    if (!_jsonArray(text, "v", out.v) || !_jsonArray(text, "i", out.i))
+    {
+      err = "no v/i arrays in " + path;
+      return false;
+    }
+    // Fit the up pass only; a down pass reads the charged input capacitor
+    const size_t key = text.find("\"n_up\"");
+    const size_t colon = (key != std::string::npos) ? text.find(':', key) : std::string::npos;
+    if (colon != std::string::npos)
+    {
+      const size_t n_up = strtoul(text.c_str() + colon + 1, nullptr, 10);
+      if (n_up >= 3 && n_up < out.v.size()) { out.v.resize(n_up); out.i.resize(n_up); }
+    }
+  }
+  else
+  {
+    std::istringstream in(text);
+    std::string line;
+    while (std::getline(in, line))
+    {
+      float v, i;
+      if (sscanf(line.c_str(), "%f%*[;, \t]%f", &v, &i) == 2) { out.v.push_back(v); out.i.push_back(i); }
+    }
+  }
+  if (out.v.size() != out.i.size() || out.v.size() < 3)
+  {
+    err = "need at least 3 (v, i) points in " + path;
+    return false;
+  }
+  return true;
+}
+
+float replay_fit_spec(const ReplaySweep_t& sweep, const SimPvSpec_t& base, float t_c, SimPvSpec_t& out)
+{
+  float v_max = 0.0f, i_max = 0.0f;
+  for (size_t k = 0; k < sweep.v.size(); ++k)
+  {
+    if (sweep.v[k] > v_max) v_max = sweep.v[k];
+    if (sweep.i[k] > i_max) i_max = sweep.i[k];
+  }
+
+  SimEnv_t env = {};
+  env.g_wm2 = SIM_G_STC_WM2;
+  env.t_c   = t_c;
+  sim_pv_array pv(base);
+  pv.setEnvironment(env);
+
+  // Isc beyond the largest swept current, Voc beyond the highest voltage:
+  // a buck sweep never reaches either end of the curve.
+  const float isc_lo = i_max * 1.001f, isc_hi = i_max * 2.5f + 0.1f;
+  const float voc_lo = v_max * 1.001f, voc_hi = v_max * 1.6f + 1.0f;
+  SimPvSpec_t s = base;
+  const auto cost = [&](float isc, float voc) {
+    s.isc_a = isc;
+    s.voc_v = voc;
+    pv.setSpec(s);
+    const float r = _rmsResidual(pv, sweep.v, sweep.i);
+    return isnan(r) ? 1e9f : r;
+  };
+
+  float best_isc = isc_lo, best_voc = voc_lo, best = 1e30f;
+  for (int a = 0; a <= REPLAY_SPEC_GRID; ++a)
+  {
+    for (int b = 0; b <= REPLAY_SPEC_GRID; ++b)
+    {
+      const float isc = isc_lo + (isc_hi - isc_lo) * a / REPLAY_SPEC_GRID;
+      const float voc = voc_lo + (voc_hi - voc_lo) * b / REPLAY_SPEC_GRID;
+      const float c = cost(isc, voc);
+      if (c < best) { best = c; best_isc = isc; best_voc = voc; }
+    }
+  }
+
+  // Coordinate refinement around the best grid cell, halving the step
+  float d_isc = (isc_hi - isc_lo) / REPLAY_SPEC_GRID;
+  float d_voc = (voc_hi - voc_lo) / REPLAY_SPEC_GRID;
+  for (int n = 0; n < REPLAY_FIT_ITERATIONS; ++n)
+  {
+    const float cand[4][2] = { { best_isc + d_isc, best_voc }, { best_isc - d_isc, best_voc },
+                               { best_isc, best_voc + d_voc }, { best_isc, best_voc - d_voc } };
+    bool moved = false;
+    for (const auto& c : cand)
+    {
+      if (c[0] < isc_lo || c[1] < voc_lo) continue;
+      const float k = cost(c[0], c[1]);
+      if (k < best) { best = k; best_isc = c[0]; best_voc = c[1]; moved = true; }
+    }
+    if (!moved) { d_isc *= 0.5f; d_voc *= 0.5f; }
+  }
+
+  out = base;
+  out.isc_a = best_isc;
+  out.voc_v = best_voc;
+  return best;
+}
+
+float replay_fit_irradiance(sim_pv_array& pv, float t_c, float v, float i)
+{
+  if (v < PV_PRESENT_V) return 0.0f;
+
+  // V(i) at a fixed current rises monotonically with irradiance
+  SimEnv_t env = {};
+  env.t_c = t_c;
+  float lo = 0.0f, hi = REPLAY_G_MAX_WM2;
+  for (uint8_t n = 0; n < REPLAY_FIT_ITERATIONS; ++n)
+  {
+    env.g_wm2 = 0.5f * (lo + hi);
+    pv.setEnvironment(env);
+    if (pv.voltageAt(i) < v) lo = env.g_wm2; else hi = env.g_wm2;
+  }
+  return 0.5f * (lo + hi);
+}
@@ -0,0 +1,59 @@
+/*************************************************************************
+ * @file replay_data.h
+ * @date 2026/10/18
+ * @brief Field data for the replay bench: log.csv, IV sweeps, model fits
+ ************************************************************************/
+
+#ifndef EDUGRID_REPLAY_DATA_H_
+#define EDUGRID_REPLAY_DATA_H_
+
+/*************************************************************************
+ * Include
+ ************************************************************************/
+#include <sim_pv.h>
+#include <string>
+#include <vector>
+
+/*************************************************************************
+ * Types
+ ************************************************************************/
+
+/** One row of log.csv (edugrid_logging::formatRow) */
+struct ReplaySample_t
+{
+  float t_s;                    ///< row index * logging tick
+  float vin, vout, iin, iout;
+};
+
+/** One IV sweep, as saved from GET /ivsweep/data or as "v;i" CSV */
+struct ReplaySweep_t
+{
+  std::string        path;
+  float              t_s;       ///< session time the sweep was taken at
+  std::vector<float> v, i;
+  SimPvSpec_t        spec;      ///< fitted by replay_fit_spec()
+  float              fit_rms_v;
+};
+
+/*************************************************************************
+ * Function Definition
+ ************************************************************************/
+
+/** Parse a framed or legacy log file; comment/trailer lines are skipped */
+bool  replay_load_log(const std::string& path, std::vector<ReplaySample_t>& out, std::string& err);
+
+/** Parse a sweep file (.json from /ivsweep/data, anything else as CSV) */
+bool  replay_load_sweep(const std::string& path, ReplaySweep_t& out, std::string& err);
+
+/**
+ * Fit Isc / Voc of `base` so the model at t_c passes through the sweep.
+ * The sweep's conditions become the 1000 W/m^2 reference, so irradiance
+ * reconstructed with this spec is relative to the day of the sweep.
+ * @return RMS voltage residual [V]
+ */
+float replay_fit_spec(const ReplaySweep_t& sweep, const SimPvSpec_t& base, float t_c, SimPvSpec_t& out);
+
+/** Irradiance that puts the logged point (v, i) on the model curve */
+float replay_fit_irradiance(sim_pv_array& pv, float t_c, float v, float i);
+
+#endif /* EDUGRID_REPLAY_DATA_H_ */
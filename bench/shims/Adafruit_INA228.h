@@ -0,0 +1,59 @@
+/*************************************************************************
+ * @file Adafruit_INA228.h
+ * @date 2026/10/18
+ * @brief Host shim of the Adafruit INA228 driver
+ *
+ * Readings come from the bench's sensor source (bench_hal::setInaSource),
+ * looked up by the I2C address given to begin().  begin() fails while no
+ * source is installed, like a missing device.
+ ************************************************************************/
+
+#ifndef EDUGRID_BENCH_ADAFRUIT_INA228_H_
+#define EDUGRID_BENCH_ADAFRUIT_INA228_H_
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <bench_hal.h>
+
+typedef enum
+{
+  INA228_COUNT_1, INA228_COUNT_4, INA228_COUNT_16, INA228_COUNT_64,
+  INA228_COUNT_128, INA228_COUNT_256, INA228_COUNT_512, INA228_COUNT_1024
+} INA228_AveragingCount;
+
+typedef enum
+{
+  INA228_TIME_50_us, INA228_TIME_84_us, INA228_TIME_150_us, INA228_TIME_280_us,
+  INA228_TIME_540_us, INA228_TIME_1052_us, INA228_TIME_2074_us, INA228_TIME_4120_us
+} INA228_ConversionTime;
+
+typedef enum
+{
+  INA228_MODE_SHUTDOWN       = 0x00,
+  INA228_MODE_CONT_BUS_SHUNT = 0x07,
+  INA228_MODE_CONTINUOUS     = 0x0F
+} INA228_MeasurementMode;
+
+class Adafruit_INA228
+{
+public:
+  bool  begin(uint8_t addr = 0x40, TwoWire* wire = &Wire, bool skipReset = false)
+  {
+    (void)wire; (void)skipReset;
+    _addr = addr;
+    return bench_hal::inaSource() != nullptr;
+  }
+  void  setShunt(float ohms, float max_a)                 { (void)ohms; (void)max_a; }
+  void  setAveragingCount(INA228_AveragingCount c)        { (void)c; }
+  void  setVoltageConversionTime(INA228_ConversionTime t) { (void)t; }
+  void  setCurrentConversionTime(INA228_ConversionTime t) { (void)t; }
+  void  setMode(INA228_MeasurementMode m)                 { (void)m; }
+
+  float getBusVoltage_V(void) { return bench_hal::inaSource() ? bench_hal::inaSource()->busVoltage(_addr) : 0.0f; }
+  float getCurrent_mA(void)   { return bench_hal::inaSource() ? bench_hal::inaSource()->current_mA(_addr) : 0.0f; }
+
+private:
+  uint8_t _addr = 0x40;
+};
+
+#endif /* EDUGRID_BENCH_ADAFRUIT_INA228_H_ */
@@ -0,0 +1,163 @@
+/*************************************************************************
+ * @file Arduino.h
+ * @date 2026/10/18
+ * @brief Host shim of the Arduino-ESP32 core for the native bench builds
+ *
+ * Only what the firmware code uses: a simulated millis() clock, LEDC duty
+ * capture, GPIO levels with edge interrupts, String (WString.h),
+ * Print/Stream and a Serial that is silent unless echo is enabled
+ * (bench_hal.h).
+ ************************************************************************/
+
+#ifndef EDUGRID_BENCH_ARDUINO_H_
+#define EDUGRID_BENCH_ARDUINO_H_
+
+/*************************************************************************
+ * Include
+ ************************************************************************/
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <WString.h>
+
+/*************************************************************************
+ * Define
+ ************************************************************************/
+#define F(x)            (x)
+#define IRAM_ATTR
+#define RTC_NOINIT_ATTR
+#define RTC_DATA_ATTR
+
+#define HIGH            (1)
+#define LOW             (0)
+#define INPUT           (0x01)
+#define OUTPUT          (0x03)
+#define INPUT_PULLUP    (0x05)
+
+#define RISING          (0x01)
+#define FALLING         (0x02)
+#define CHANGE          (0x03)
+
+#define DEC             (10)
+#define HEX             (16)
+
+typedef uint8_t byte;
+
+/*************************************************************************
+ * Print / Serial
+ ************************************************************************/
+class Print
+{
+public:
+  virtual ~Print(void) {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t* buf, size_t len)
+  {
+    size_t n = 0;
+    while (len--) n += write(*buf++);
+    return n;
+  }
+  size_t write(const char* str) { return write(reinterpret_cast<const uint8_t*>(str), strlen(str)); }
+
+  size_t printf(const char* fmt, ...) __attribute__((format(printf, 2, 3)))
+  {
+    char buf[256];
+    va_list ap;
+    va_start(ap, fmt);
+    const int n = vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+    if (n <= 0) return 0;
+    return write(reinterpret_cast<const uint8_t*>(buf), ((size_t)n < sizeof(buf)) ? (size_t)n : sizeof(buf) - 1);
+  }
+
+  size_t print(const char* s)                     { return write(s); }
+  size_t print(const String& s)                   { return write(reinterpret_cast<const uint8_t*>(s.c_str()), s.length()); }
+  size_t print(char c)                            { return write((uint8_t)c); }
+  size_t print(int v, int base = DEC)             { return printf(base == HEX ? "%x" : "%d", v); }
+  size_t print(unsigned int v, int base = DEC)    { return printf(base == HEX ? "%x" : "%u", v); }
+  size_t print(long v, int base = DEC)            { return printf(base == HEX ? "%lx" : "%ld", v); }
+  size_t print(unsigned long v, int base = DEC)   { return printf(base == HEX ? "%lx" : "%lu", v); }
+  size_t print(double v, int digits = 2)          { return printf("%.*f", digits, v); }
+
+  size_t println(void)                            { return write("\r\n"); }
+  template <typename T> size_t println(T v)         { size_t n = print(v);    return n + println(); }
+  template <typename T> size_t println(T v, int f)  { size_t n = print(v, f); return n + println(); }
+};
+
+class Stream : public Print
+{
+public:
+  virtual int available(void) = 0;
+  virtual int read(void) = 0;
+  virtual int peek(void) { return -1; }
+
+  size_t readBytes(uint8_t* buf, size_t len)
+  {
+    size_t n = 0;
+    int c;
+    while (n < len && (c = read()) >= 0) buf[n++] = (uint8_t)c;
+    return n;
+  }
+  size_t readBytes(char* buf, size_t len) { return readBytes(reinterpret_cast<uint8_t*>(buf), len); }
+
+  /* Char by char like the core (no timeout: host reads never stall) */
+  String readString(void)
+  {
+    String ret;
+    int c;
+    while ((c = read()) >= 0) ret += (char)c;
+    return ret;
+  }
+};
+
+class HardwareSerial : public Stream
+{
+public:
+  void   begin(unsigned long) {}
+  size_t write(uint8_t c) override;
+  using Print::write;
+  int    available(void) override { return 0; }
+  int    read(void) override      { return -1; }
+  operator bool() const  { return true; }
+};
+
+extern HardwareSerial Serial;
+
+/*************************************************************************
+ * Timing / GPIO / LEDC (simulated, see bench_hal.cpp)
+ ************************************************************************/
+unsigned long millis(void);
+unsigned long micros(void);
+void          delay(unsigned long ms);
+void          delayMicroseconds(uint32_t us);
+void          yield(void);
+
+void          pinMode(uint8_t pin, uint8_t mode);
+void          digitalWrite(uint8_t pin, uint8_t val);
+int           digitalRead(uint8_t pin);
+
+/* The handler runs synchronously on the edge (bench_hal::setPinLevel()) */
+#define digitalPinToInterrupt(p)  (p)
+void          attachInterruptArg(uint8_t pin, void (*handler)(void*), void* arg, int mode);
+void          detachInterrupt(uint8_t pin);
+
+double        ledcSetup(uint8_t chan, double freq, uint8_t bit_num);
+void          ledcAttachPin(uint8_t pin, uint8_t chan);
+void          ledcWrite(uint8_t chan, uint32_t duty);
+
+/* Single core as far as the shared control code is concerned */
+#ifndef CONFIG_FREERTOS_UNICORE
+#define CONFIG_FREERTOS_UNICORE 1
+#endif
+
+/* The benches are single threaded, critical sections compile to nothing */
+typedef int portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED    (0)
+#define portENTER_CRITICAL(mux)         ((void)(mux))
+#define portEXIT_CRITICAL(mux)          ((void)(mux))
+
+#endif /* EDUGRID_BENCH_ARDUINO_H_ */
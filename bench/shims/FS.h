@@ -0,0 +1,91 @@
+/*************************************************************************
+ * @file FS.h
+ * @date 2026/10/18
+ * @brief Host shim of the Arduino-ESP32 FS/File API (in-memory, see bench_fs.cpp)
+ ************************************************************************/
+
+#ifndef EDUGRID_BENCH_FS_H_
+#define EDUGRID_BENCH_FS_H_
+
+/*************************************************************************
+ * Include
+ ************************************************************************/
+#include <Arduino.h>
+#include <memory>
+
+/*************************************************************************
+ * Define
+ ************************************************************************/
+#define FILE_READ       "r"
+#define FILE_WRITE      "w"
+#define FILE_APPEND     "a"
+
+/*************************************************************************
+ * Class
+ ************************************************************************/
+namespace fs
+{
+
+enum SeekMode { SeekSet = 0, SeekCur = 1, SeekEnd = 2 };
+
+class FileImpl;
+typedef std::shared_ptr<FileImpl> FileImplPtr;
+
+class File : public Stream
+{
+public:
+  File(FileImplPtr p = FileImplPtr()) : _p(p) {}
+
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t* buf, size_t size) override;
+  using Print::write;
+  int    available(void) override;
+  int    read(void) override;
+  int    peek(void) override;
+  size_t read(uint8_t* buf, size_t size);
+  void   flush(void) {}
+  bool   seek(uint32_t pos, SeekMode mode = SeekSet);
+  size_t position(void) const;
+  size_t size(void) const;
+  void   close(void);
+  operator bool() const;
+  const char* path(void) const;
+  const char* name(void) const;
+
+  bool isDirectory(void) const;
+  File openNextFile(const char* mode = FILE_READ);
+  void rewindDirectory(void);
+
+private:
+  FileImplPtr _p;
+};
+
+class FS
+{
+public:
+  File open(const char* path, const char* mode = FILE_READ, const bool create = false);
+  File open(const String& path, const char* mode = FILE_READ, const bool create = false)
+  { return open(path.c_str(), mode, create); }
+
+  bool exists(const char* path);
+  bool exists(const String& path)                     { return exists(path.c_str()); }
+  bool remove(const char* path);
+  bool remove(const String& path)                     { return remove(path.c_str()); }
+  bool rename(const char* from, const char* to);
+  bool rename(const String& from, const String& to)   { return rename(from.c_str(), to.c_str()); }
+  bool mkdir(const char* path);
+  bool mkdir(const String& path)                      { return mkdir(path.c_str()); }
+  bool rmdir(const char* path);
+  bool rmdir(const String& path)                      { return rmdir(path.c_str()); }
+};
+
+} // namespace fs
+
+using fs::FS;
+using fs::File;
+using fs::SeekMode;
+using fs::SeekSet;
+using fs::SeekCur;
+using fs::SeekEnd;
+
+#endif /* EDUGRID_BENCH_FS_H_ */
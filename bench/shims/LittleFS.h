@@ -0,0 +1,30 @@
+/*************************************************************************
+ * @file LittleFS.h
+ * @date 2026/10/18
+ * @brief Host shim of the LittleFS mount (in-memory, see bench_fs.cpp)
+ ************************************************************************/
+
+#ifndef EDUGRID_BENCH_LITTLEFS_H_
+#define EDUGRID_BENCH_LITTLEFS_H_
+
+#include <FS.h>
+
+namespace fs
+{
+
+class LittleFSFS : public FS
+{
+public:
+  bool   begin(bool formatOnFail = false, const char* basePath = "/littlefs",
+               uint8_t maxOpenFiles = 10, const char* partitionLabel = "spiffs");
+  bool   format(void);
+  void   end(void) {}
+  size_t totalBytes(void);
+  size_t usedBytes(void);
+};
+
+} // namespace fs
+
+extern fs::LittleFSFS LittleFS;
+
+#endif /* EDUGRID_BENCH_LITTLEFS_H_ */
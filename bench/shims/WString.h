@@ -0,0 +1,278 @@
+/*************************************************************************
+ * @file WString.h
+ * @date 2026/10/18
+ * @brief Host shim of the Arduino-ESP32 String class
+ *
+ * Follows the allocation behaviour of the ESP32 core so the micro bench
+ * counts what the target would allocate: strings up to 11 chars live in the
+ * object (SSO on a 32-bit target), longer ones get a heap buffer rounded up
+ * to 16 bytes, and growth is by exactly what is needed (no doubling).
+ * Buffers go through operator new[] so bench/micro can count them.
+ ************************************************************************/
+
+#ifndef EDUGRID_BENCH_WSTRING_H_
+#define EDUGRID_BENCH_WSTRING_H_
+
+/*************************************************************************
+ * Include
+ ************************************************************************/
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*************************************************************************
+ * Class
+ ************************************************************************/
+class StringSumHelper;
+
+class String
+{
+public:
+  static const unsigned int kSsoCapacity = 11;
+
+  String(void) { _init(); }
+  String(const char* cstr) { _init(); if (cstr) copy(cstr, (unsigned int)strlen(cstr)); }
+  String(const String& str) { _init(); copy(str.c_str(), str.length()); }
+  String(String&& rval) { _init(); _move(rval); }
+  explicit String(char c) { _init(); copy(&c, 1); }
+  explicit String(unsigned char v, unsigned char base = 10)  { _init(); _fmtUnsigned(v, base); }
+  explicit String(int v, unsigned char base = 10)            { _init(); _fmtSigned(v, base); }
+  explicit String(unsigned int v, unsigned char base = 10)   { _init(); _fmtUnsigned(v, base); }
+  explicit String(long v, unsigned char base = 10)           { _init(); _fmtSigned(v, base); }
+  explicit String(unsigned long v, unsigned char base = 10)  { _init(); _fmtUnsigned(v, base); }
+  explicit String(float v, unsigned int decimals = 2)        { _init(); _fmtFloat(v, decimals); }
+  explicit String(double v, unsigned int decimals = 2)       { _init(); _fmtFloat(v, decimals); }
+  ~String(void) { _free(); }
+
+  String& operator=(const String& rhs) { if (this != &rhs) copy(rhs.c_str(), rhs.length()); return *this; }
+  String& operator=(const char* cstr)  { if (cstr) copy(cstr, (unsigned int)strlen(cstr)); else _setLen(0); return *this; }
+  String& operator=(String&& rval)     { if (this != &rval) { _free(); _init(); _move(rval); } return *this; }
+
+  /* Memory */
+  bool reserve(unsigned int size)
+  {
+    if (size <= capacity()) return true;
+    return _changeBuffer(size);
+  }
+  unsigned int length(void) const   { return _len; }
+  unsigned int capacity(void) const { return _heap ? _cap : kSsoCapacity; }
+  bool isEmpty(void) const          { return _len == 0; }
+  void clear(void)                  { _setLen(0); }
+  const char* c_str(void) const     { return _heap ? _heap : _sso; }
+
+  /* Concatenation */
+  bool concat(const char* cstr, unsigned int n)
+  {
+    if (!cstr) return false;
+    if (n == 0) return true;
+    const unsigned int newlen = _len + n;
+    // Appending a piece of ourselves survives the reallocation
+    const uintptr_t self = (uintptr_t)c_str();
+    if ((uintptr_t)cstr >= self && (uintptr_t)cstr < self + _len)
+    {
+      const size_t off = (size_t)((uintptr_t)cstr - self);
+      if (!reserve(newlen)) return false;
+      memmove(_buf() + _len, c_str() + off, n);
+    }
+    else
+    {
+      if (!reserve(newlen)) return false;
+      memcpy(_buf() + _len, cstr, n);
+    }
+    _setLen(newlen);
+    return true;
+  }
+  bool concat(const String& s)        { return concat(s.c_str(), s.length()); }
+  bool concat(const char* cstr)       { return cstr ? concat(cstr, (unsigned int)strlen(cstr)) : false; }
+  bool concat(char c)                 { return concat(&c, 1); }
+  bool concat(unsigned char v)        { return concat(String(v)); }
+  bool concat(int v)                  { return concat(String(v)); }
+  bool concat(unsigned int v)         { return concat(String(v)); }
+  bool concat(long v)                 { return concat(String(v)); }
+  bool concat(unsigned long v)        { return concat(String(v)); }
+  bool concat(float v)                { return concat(String(v)); }
+  bool concat(double v)               { return concat(String(v)); }
+
+  template <typename T> String& operator+=(const T& rhs) { concat(rhs); return *this; }
+
+  friend StringSumHelper& operator+(const StringSumHelper& lhs, const String& rhs);
+  friend StringSumHelper& operator+(const StringSumHelper& lhs, const char* cstr);
+  friend StringSumHelper& operator+(const StringSumHelper& lhs, char c);
+
+  /* Comparison */
+  int  compareTo(const String& s) const     { return strcmp(c_str(), s.c_str()); }
+  bool equals(const String& s) const        { return _len == s._len && compareTo(s) == 0; }
+  bool equals(const char* cstr) const       { return strcmp(c_str(), cstr ? cstr : "") == 0; }
+  bool equalsIgnoreCase(const String& s) const
+  {
+    if (_len != s._len) return false;
+    for (unsigned int i = 0; i < _len; ++i)
+    {
+      const char a = c_str()[i], b = s.c_str()[i];
+      if (((a >= 'A' && a <= 'Z') ? a + 32 : a) != ((b >= 'A' && b <= 'Z') ? b + 32 : b)) return false;
+    }
+    return true;
+  }
+  bool operator==(const String& rhs) const  { return equals(rhs); }
+  bool operator==(const char* cstr) const   { return equals(cstr); }
+  bool operator!=(const String& rhs) const  { return !equals(rhs); }
+  bool operator!=(const char* cstr) const   { return !equals(cstr); }
+  bool operator<(const String& rhs) const   { return compareTo(rhs) < 0; }
+  bool startsWith(const String& p) const    { return p._len <= _len && strncmp(c_str(), p.c_str(), p._len) == 0; }
+  bool endsWith(const String& s) const      { return s._len <= _len && strcmp(c_str() + _len - s._len, s.c_str()) == 0; }
+
+  /* Character access */
+  char charAt(unsigned int i) const         { return (i < _len) ? c_str()[i] : 0; }
+  char operator[](unsigned int i) const     { return charAt(i); }
+  char& operator[](unsigned int i)          { static char dummy; return (i < _len) ? _buf()[i] : (dummy = 0); }
+
+  /* Search */
+  int indexOf(char c, unsigned int from = 0) const
+  {
+    if (from >= _len) return -1;
+    const char* p = strchr(c_str() + from, c);
+    return p ? (int)(p - c_str()) : -1;
+  }
+  int indexOf(const String& s, unsigned int from = 0) const
+  {
+    if (from > _len) return -1;
+    const char* p = strstr(c_str() + from, s.c_str());
+    return p ? (int)(p - c_str()) : -1;
+  }
+  int lastIndexOf(char c) const
+  {
+    const char* p = strrchr(c_str(), c);
+    return p ? (int)(p - c_str()) : -1;
+  }
+  String substring(unsigned int left) const { return substring(left, _len); }
+  String substring(unsigned int left, unsigned int right) const
+  {
+    if (left > right) { const unsigned int t = left; left = right; right = t; }
+    String out;
+    if (left >= _len) return out;
+    if (right > _len) right = _len;
+    out.copy(c_str() + left, right - left);
+    return out;
+  }
+
+  /* Modification */
+  void remove(unsigned int index)           { remove(index, (unsigned int)-1); }
+  void remove(unsigned int index, unsigned int count)
+  {
+    if (index >= _len) return;
+    if (count > _len - index) count = _len - index;
+    memmove(_buf() + index, c_str() + index + count, _len - index - count);
+    _setLen(_len - count);
+  }
+  void trim(void)
+  {
+    unsigned int b = 0, e = _len;
+    while (b < e && (c_str()[b] == ' ' || (c_str()[b] >= '\t' && c_str()[b] <= '\r'))) ++b;
+    while (e > b && (c_str()[e - 1] == ' ' || (c_str()[e - 1] >= '\t' && c_str()[e - 1] <= '\r'))) --e;
+    if (b) memmove(_buf(), c_str() + b, e - b);
+    _setLen(e - b);
+  }
+  void toLowerCase(void) { for (unsigned int i = 0; i < _len; ++i) { char& c = _buf()[i]; if (c >= 'A' && c <= 'Z') c += 32; } }
+  void toUpperCase(void) { for (unsigned int i = 0; i < _len; ++i) { char& c = _buf()[i]; if (c >= 'a' && c <= 'z') c -= 32; } }
+
+  /* Conversion */
+  long   toInt(void) const    { return atol(c_str()); }
+  float  toFloat(void) const  { return (float)atof(c_str()); }
+  double toDouble(void) const { return atof(c_str()); }
+
+protected:
+  String& copy(const char* cstr, unsigned int n)
+  {
+    if (!reserve(n)) { _free(); _init(); return *this; }
+    memmove(_buf(), cstr, n);
+    _setLen(n);
+    return *this;
+  }
+
+private:
+  void  _init(void) { _heap = nullptr; _cap = 0; _len = 0; _sso[0] = '\0'; }
+  void  _free(void) { delete[] _heap; }
+  char* _buf(void)  { return _heap ? _heap : _sso; }
+  void  _setLen(unsigned int n) { _len = n; _buf()[n] = '\0'; }
+  void  _move(String& rhs)
+  {
+    if (rhs._heap) { _heap = rhs._heap; _cap = rhs._cap; _len = rhs._len; rhs._init(); }
+    else           { memcpy(_sso, rhs._sso, sizeof(_sso)); _len = rhs._len; rhs._setLen(0); }
+  }
+  bool _changeBuffer(unsigned int maxStrLen)
+  {
+    // Same rounding as the ESP32 core: room for the NUL, multiple of 16
+    const unsigned int newSize = (maxStrLen + 16) & ~0xFu;
+    char* buf = new char[newSize];
+    memcpy(buf, c_str(), _len + 1);
+    delete[] _heap;
+    _heap = buf;
+    _cap  = newSize - 1;
+    return true;
+  }
+  void _fmtSigned(long v, unsigned char base)
+  {
+    if (base == 10) { char b[24]; snprintf(b, sizeof(b), "%ld", v); copy(b, (unsigned int)strlen(b)); }
+    else            { _fmtUnsigned((unsigned long)v, base); }
+  }
+  void _fmtUnsigned(unsigned long v, unsigned char base)
+  {
+    char b[66];
+    char* p = b + sizeof(b) - 1;
+    *p = '\0';
+    if (base < 2) base = 10;
+    do { const unsigned d = (unsigned)(v % base); *--p = (char)(d < 10 ? '0' + d : 'a' + d - 10); v /= base; } while (v);
+    copy(p, (unsigned int)(b + sizeof(b) - 1 - p));
+  }
+  void _fmtFloat(double v, unsigned int decimals)
+  {
+    char b[64];
+    const int n = snprintf(b, sizeof(b), "%.*f", (int)decimals, v);
+    copy(b, (n > 0) ? (unsigned int)n : 0);
+  }
+
+  char*        _heap;
+  unsigned int _cap;
+  unsigned int _len;
+  char         _sso[kSsoCapacity + 1];
+};
+
+/** Temporary of `a + b`, appended to in place like the ESP32 core does */
+class StringSumHelper : public String
+{
+public:
+  StringSumHelper(const String& s) : String(s) {}
+  StringSumHelper(const char* p) : String(p) {}
+  StringSumHelper(char c) : String(c) {}
+  StringSumHelper(int v) : String(v) {}
+  StringSumHelper(unsigned int v) : String(v) {}
+  StringSumHelper(long v) : String(v) {}
+  StringSumHelper(unsigned long v) : String(v) {}
+  StringSumHelper(float v) : String(v) {}
+  StringSumHelper(double v) : String(v) {}
+};
+
+inline StringSumHelper& operator+(const StringSumHelper& lhs, const String& rhs)
+{
+  StringSumHelper& a = const_cast<StringSumHelper&>(lhs);
+  a.concat(rhs);
+  return a;
+}
+
+inline StringSumHelper& operator+(const StringSumHelper& lhs, const char* cstr)
+{
+  StringSumHelper& a = const_cast<StringSumHelper&>(lhs);
+  a.concat(cstr);
+  return a;
+}
+
+inline StringSumHelper& operator+(const StringSumHelper& lhs, char c)
+{
+  StringSumHelper& a = const_cast<StringSumHelper&>(lhs);
+  a.concat(c);
+  return a;
+}
+
+#endif /* EDUGRID_BENCH_WSTRING_H_ */
@@ -0,0 +1,43 @@
+/*************************************************************************
+ * @file Wire.h
+ * @date 2026/10/18
+ * @brief Host shim: I2C bus with the INA228 register file of bench_hal
+ *
+ * The driver shim reads its values without the bus; only the registers
+ * the firmware accesses directly (alert limits, DIAG_ALRT, the ENERGY /
+ * CHARGE accumulators) go through here.
+ ************************************************************************/
+
+#ifndef EDUGRID_BENCH_WIRE_H_
+#define EDUGRID_BENCH_WIRE_H_
+
+#include <Arduino.h>
+
+class TwoWire
+{
+public:
+  bool    begin(void)                   { return true; }
+  bool    begin(int sda, int scl)       { (void)sda; (void)scl; return true; }
+  void    setClock(uint32_t hz)         { (void)hz; }
+  void    setTimeOut(uint16_t ms)       { (void)ms; }
+
+  /* Register access as the INA228 sees it (bench_hal.cpp) */
+  void    beginTransmission(uint8_t a);
+  size_t  write(uint8_t b);
+  uint8_t endTransmission(bool stop = true);
+  uint8_t requestFrom(uint8_t address, uint8_t size);
+  int     available(void);
+  int     read(void);
+
+private:
+  uint8_t _addr = 0;
+  uint8_t _tx[4] = {};
+  uint8_t _tx_len = 0;
+  uint8_t _rx[5] = {};
+  uint8_t _rx_len = 0;
+  uint8_t _rx_pos = 0;
+};
+
+extern TwoWire Wire;
+
+#endif /* EDUGRID_BENCH_WIRE_H_ */
@@ -0,0 +1,299 @@
+/*************************************************************************
+ * @file bench_fs.cpp
+ * @date 2026/10/18
+ *
+ * In-memory LittleFS for the host benches.  Paths, modes and listing order
+ * follow the ESP32 LittleFS driver closely enough for the firmware's file
+ * code (config blob, framed log, file manager list); there is no wear, no
+ * power loss and no open-file limit.
+ ************************************************************************/
+
+/*************************************************************************
+ * Include
+ ************************************************************************/
+#include <LittleFS.h>
+#include <bench_hal.h>
+#include <map>
+#include <string>
+#include <vector>
+
+/*************************************************************************
+ * Define
+ ************************************************************************/
+#define BENCH_FS_TOTAL_BYTES  (0x160000)    /* default "spiffs" partition */
+#define BENCH_FS_BLOCK_SIZE   (4096)
+
+/*************************************************************************
+ * Types
+ ************************************************************************/
+typedef std::shared_ptr<std::vector<uint8_t>> BenchFsData_t;
+
+/** One entry of the tree; a null `data` marks a directory */
+struct BenchFsNode_t
+{
+  BenchFsData_t data;
+};
+
+namespace fs
+{
+
+class FileImpl
+{
+public:
+  std::string              path;
+  BenchFsData_t            data;        ///< null for directories
+  size_t                   pos      = 0;
+  bool                     readable = false;
+  bool                     writable = false;
+  bool                     append   = false;
+  bool                     open     = true;
+  std::vector<std::string> children;    ///< directory snapshot
+  size_t                   next     = 0;
+};
+
+} // namespace fs
+
+/*************************************************************************
+ * Variable Definition
+ ************************************************************************/
+fs::LittleFSFS LittleFS;
+
+static std::map<std::string, BenchFsNode_t> s_nodes;
+
+/*************************************************************************
+ * Helpers
+ ************************************************************************/
+static std::string _normalize(const char* path)
+{
+  std::string p = (path && path[0] == '/') ? path : std::string("/") + (path ? path : "");
+  while (p.size() > 1 && p.back() == '/') p.pop_back();
+  return p;
+}
+
+static std::string _parent(const std::string& p)
+{
+  const size_t slash = p.find_last_of('/');
+  return (slash == 0) ? std::string("/") : p.substr(0, slash);
+}
+
+static bool _isDir(const std::string& p)
+{
+  if (p == "/") return true;
+  auto it = s_nodes.find(p);
+  return (it != s_nodes.end()) && !it->second.data;
+}
+
+static void _makeParents(const std::string& p)
+{
+  for (std::string d = _parent(p); d != "/" && !s_nodes.count(d); d = _parent(d))
+  {
+    s_nodes[d] = BenchFsNode_t();
+  }
+}
+
+/*************************************************************************
+ * Function Definition
+ ************************************************************************/
+void bench_hal::fsFormat(void) { s_nodes.clear(); }
+
+namespace fs
+{
+
+/* ===== File ===== */
+size_t File::write(uint8_t c) { return write(&c, 1); }
+
+size_t File::write(const uint8_t* buf, size_t size)
+{
+  if (!_p || !_p->open || !_p->writable || !_p->data) return 0;
+  std::vector<uint8_t>& d = *_p->data;
+  if (_p->append) _p->pos = d.size();
+  if (_p->pos + size > d.size()) d.resize(_p->pos + size);
+  memcpy(d.data() + _p->pos, buf, size);
+  _p->pos += size;
+  return size;
+}
+
+int File::available(void)
+{
+  if (!_p || !_p->open || !_p->readable || !_p->data) return 0;
+  return (int)(_p->data->size() - _p->pos);
+}
+
+int File::read(void)
+{
+  uint8_t c;
+  return (read(&c, 1) == 1) ? c : -1;
+}
+
+int File::peek(void)
+{
+  if (available() <= 0) return -1;
+  return (*_p->data)[_p->pos];
+}
+
+size_t File::read(uint8_t* buf, size_t size)
+{
+  const int avail = available();
+  if (avail <= 0) return 0;
+  const size_t n = (size < (size_t)avail) ? size : (size_t)avail;
+  memcpy(buf, _p->data->data() + _p->pos, n);
+  _p->pos += n;
+  return n;
+}
+
+bool File::seek(uint32_t pos, SeekMode mode)
+{
+  if (!_p || !_p->open || !_p->data) return false;
+  const size_t base = (mode == SeekSet) ? 0 : (mode == SeekCur) ? _p->pos : _p->data->size();
+  if (base + pos > _p->data->size()) return false;
+  _p->pos = base + pos;
+  return true;
+}
+
+size_t File::position(void) const { return (_p && _p->open) ? _p->pos : 0; }
+size_t File::size(void) const     { return (_p && _p->open && _p->data) ? _p->data->size() : 0; }
+void   File::close(void)          { if (_p) _p->open = false; }
+File::operator bool() const       { return _p && _p->open; }
+bool   File::isDirectory(void) const { return _p && _p->open && !_p->data; }
+
+const char* File::path(void) const { return _p ? _p->path.c_str() : nullptr; }
+
+const char* File::name(void) const
+{
+  if (!_p) return nullptr;
+  const size_t slash = _p->path.find_last_of('/');
+  return _p->path.c_str() + ((slash == std::string::npos) ? 0 : slash + 1);
+}
+
+File File::openNextFile(const char* mode)
+{
+  if (!isDirectory()) return File();
+  while (_p->next < _p->children.size())
+  {
+    const std::string& child = _p->children[_p->next++];
+    if (s_nodes.count(child)) return LittleFS.open(child.c_str(), mode);
+  }
+  return File();
+}
+
+void File::rewindDirectory(void) { if (_p) _p->next = 0; }
+
+/* ===== FS ===== */
+File FS::open(const char* path, const char* mode, const bool create)
+{
+  (void)create;
+  const std::string p = _normalize(path);
+  const char m = (mode && mode[0]) ? mode[0] : 'r';
+  const bool plus = mode && strchr(mode, '+');
+
+  FileImplPtr impl = std::make_shared<FileImpl>();
+  impl->path = p;
+
+  if (_isDir(p))
+  {
+    if (m != 'r') return File();
+    for (auto it = s_nodes.begin(); it != s_nodes.end(); ++it)
+    {
+      if (it->first != p && _parent(it->first) == p) impl->children.push_back(it->first);
+    }
+    impl->readable = true;
+    return File(impl);
+  }
+
+  auto it = s_nodes.find(p);
+  if (m == 'r')
+  {
+    if (it == s_nodes.end()) return File();
+    impl->data     = it->second.data;
+    impl->readable = true;
+    impl->writable = plus;
+    return File(impl);
+  }
+
+  _makeParents(p);
+  BenchFsNode_t& node = s_nodes[p];
+  if (!node.data || m == 'w') node.data = std::make_shared<std::vector<uint8_t>>();
+  impl->data     = node.data;
+  impl->writable = true;
+  impl->readable = plus;
+  impl->append   = (m == 'a');
+  impl->pos      = impl->append ? impl->data->size() : 0;
+  return File(impl);
+}
+
+bool FS::exists(const char* path)
+{
+  const std::string p = _normalize(path);
+  return (p == "/") || s_nodes.count(p);
+}
+
+bool FS::remove(const char* path)
+{
+  auto it = s_nodes.find(_normalize(path));
+  if (it == s_nodes.end() || !it->second.data) return false;
+  s_nodes.erase(it);
+  return true;
+}
+
+bool FS::rename(const char* from, const char* to)
+{
+  const std::string src = _normalize(from);
+  const std::string dst = _normalize(to);
+  auto it = s_nodes.find(src);
+  if (it == s_nodes.end() || !it->second.data || _isDir(dst)) return false;
+  _makeParents(dst);
+  // Replaces an existing target in one step, as LittleFS does
+  s_nodes[dst] = it->second;
+  s_nodes.erase(src);
+  return true;
+}
+
+bool FS::mkdir(const char* path)
+{
+  const std::string p = _normalize(path);
+  if (p == "/" || s_nodes.count(p)) return _isDir(p);
+  _makeParents(p);
+  s_nodes[p] = BenchFsNode_t();
+  return true;
+}
+
+bool FS::rmdir(const char* path)
+{
+  const std::string p = _normalize(path);
+  if (p == "/" || !_isDir(p)) return false;
+  for (auto it = s_nodes.begin(); it != s_nodes.end(); ++it)
+  {
+    if (_parent(it->first) == p) return false;
+  }
+  s_nodes.erase(p);
+  return true;
+}
+
+/* ===== LittleFS mount ===== */
+bool LittleFSFS::begin(bool formatOnFail, const char* basePath, uint8_t maxOpenFiles, const char* partitionLabel)
+{
+  (void)formatOnFail; (void)basePath; (void)maxOpenFiles; (void)partitionLabel;
+  return true;
+}
+
+bool LittleFSFS::format(void)
+{
+  bench_hal::fsFormat();
+  return true;
+}
+
+size_t LittleFSFS::totalBytes(void) { return BENCH_FS_TOTAL_BYTES; }
+
+size_t LittleFSFS::usedBytes(void)
+{
+  // Two superblocks plus one block per directory and whole blocks per file
+  size_t blocks = 2;
+  for (auto it = s_nodes.begin(); it != s_nodes.end(); ++it)
+  {
+    const size_t n = it->second.data ? it->second.data->size() : 0;
+    blocks += (n == 0) ? 1 : (n + BENCH_FS_BLOCK_SIZE - 1) / BENCH_FS_BLOCK_SIZE;
+  }
+  return blocks * BENCH_FS_BLOCK_SIZE;
+}
+
+} // namespace fs
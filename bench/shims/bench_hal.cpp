@@ -0,0 +1,315 @@
+/*************************************************************************
+ * @file bench_hal.cpp
+ * @date 2026/10/18
+ *
+ ************************************************************************/
+
+/*************************************************************************
+ * Include
+ ************************************************************************/
+#include <Arduino.h>
+#include <Wire.h>
+#include <esp_rom_crc.h>
+#include <hal/gpio_ll.h>
+#include <soc/ledc_struct.h>
+#include <bench_hal.h>
+#include <edugrid_states.h>
+#include <edugrid_meas_channel.h>
+
+/*************************************************************************
+ * Define
+ ************************************************************************/
+#define BENCH_LEDC_CHANNELS   (16)
+#define BENCH_LEDC_FRAC_BITS  (4)         /* fractional duty bits of the register */
+#define BENCH_GPIO_PINS       (40)
+#define BENCH_INA_DEVICES     (8)
+#define BENCH_INA_REGS        (0x40)
+#define BENCH_INA_DIAG_FLAGS  (INA_DIAG_SHNTOL | INA_DIAG_BUSOL)
+
+/*************************************************************************
+ * Types
+ ************************************************************************/
+struct BenchPin_t
+{
+  uint8_t level;
+  int     irq_mode;                 // 0 = no handler
+  void  (*handler)(void*);
+  void*   arg;
+};
+
+struct BenchIna_t
+{
+  uint8_t  addr;                    // 0 = free slot
+  int8_t   alert_pin;
+  uint8_t  pointer;                 // register pointer of the last write
+  uint16_t regs[BENCH_INA_REGS];
+  double   energy_j;                // ENERGY / CHARGE, integrated by inaConvert()
+  double   charge_c;
+  uint64_t conv_us;                 // last conversion, 0 = none yet
+};
+
+/*************************************************************************
+ * Variable Definition
+ ************************************************************************/
+HardwareSerial Serial;
+TwoWire        Wire;
+gpio_dev_t     GPIO;
+ledc_dev_t     LEDC;
+
+static uint64_t          s_now_us      = 0;
+static uint8_t           s_ledc_bits[BENCH_LEDC_CHANNELS];
+static double            s_ledc_freq[BENCH_LEDC_CHANNELS];
+static bench_ina_source* s_ina_source  = nullptr;
+static bool              s_serial_echo = false;
+static BenchPin_t        s_pins[BENCH_GPIO_PINS];
+static BenchIna_t        s_ina[BENCH_INA_DEVICES];
+
+/*************************************************************************
+ * Helpers
+ ************************************************************************/
+static uint32_t _ledcReg(uint8_t chan)
+{
+  return (chan < BENCH_LEDC_CHANNELS) ? LEDC.channel_group[chan / 8].channel[chan % 8].duty.duty : 0;
+}
+
+static BenchIna_t* _ina(uint8_t addr)
+{
+  for (BenchIna_t& d : s_ina) if (d.addr == addr) return &d;
+  for (BenchIna_t& d : s_ina)
+  {
+    if (d.addr != 0) continue;
+    // Reset values: limits that never trip, MEMSTAT set
+    d = BenchIna_t{};
+    d.addr      = addr;
+    d.alert_pin = -1;
+    d.regs[INA_REG_DIAG_ALRT] = 0x0001;
+    d.regs[INA_REG_SOVL]      = 0x7FFF;
+    d.regs[INA_REG_BOVL]      = 0x7FFF;
+    return &d;
+  }
+  return nullptr;
+}
+
+/* Open drain, wired-OR: a pin is low while any device on it alerts */
+static void _driveAlerts(void)
+{
+  for (const BenchIna_t& d : s_ina)
+  {
+    if (d.addr == 0 || d.alert_pin < 0) continue;
+    bool low = false;
+    for (const BenchIna_t& o : s_ina)
+    {
+      if (o.addr != 0 && o.alert_pin == d.alert_pin && (o.regs[INA_REG_DIAG_ALRT] & BENCH_INA_DIAG_FLAGS)) low = true;
+    }
+    bench_hal::setPinLevel((uint8_t)d.alert_pin, low ? 0 : 1);
+  }
+}
+
+/*************************************************************************
+ * Function Definition
+ ************************************************************************/
+size_t HardwareSerial::write(uint8_t c)
+{
+  if (s_serial_echo) fputc(c, stderr);
+  return 1;
+}
+
+unsigned long millis(void)  { return (unsigned long)(s_now_us / 1000ULL); }
+unsigned long micros(void)  { return (unsigned long)s_now_us; }
+void delay(unsigned long ms) { s_now_us += (uint64_t)ms * 1000ULL; }
+void delayMicroseconds(uint32_t us) { s_now_us += us; }
+void yield(void) {}
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+  if (mode == INPUT_PULLUP) bench_hal::setPinLevel(pin, 1);
+}
+void digitalWrite(uint8_t pin, uint8_t val) { bench_hal::setPinLevel(pin, val ? 1 : 0); }
+int  digitalRead(uint8_t pin)               { return bench_hal::pinLevel(pin); }
+
+void attachInterruptArg(uint8_t pin, void (*handler)(void*), void* arg, int mode)
+{
+  if (pin >= BENCH_GPIO_PINS) return;
+  s_pins[pin].handler  = handler;
+  s_pins[pin].arg      = arg;
+  s_pins[pin].irq_mode = mode;
+}
+
+void detachInterrupt(uint8_t pin)
+{
+  if (pin < BENCH_GPIO_PINS) s_pins[pin].irq_mode = 0;
+}
+
+void TwoWire::beginTransmission(uint8_t a) { _addr = a; _tx_len = 0; }
+
+size_t TwoWire::write(uint8_t b)
+{
+  if (_tx_len >= sizeof(_tx)) return 0;
+  _tx[_tx_len++] = b;
+  return 1;
+}
+
+uint8_t TwoWire::endTransmission(bool stop)
+{
+  (void)stop;
+  BenchIna_t* d = (bench_hal::inaSource() != nullptr) ? _ina(_addr) : nullptr;
+  if (d == nullptr) return 2;                       // address NACK
+  if (_tx_len >= 1) d->pointer = _tx[0] % BENCH_INA_REGS;
+  if (_tx_len == 3)
+  {
+    uint16_t v = (uint16_t)((_tx[1] << 8) | _tx[2]);
+    // DIAG_ALRT: only the configuration bits are writable
+    if (d->pointer == INA_REG_DIAG_ALRT) v = (v & 0xF000) | (d->regs[INA_REG_DIAG_ALRT] & 0x0FFF);
+    // CONFIG: RSTACC zeroes the accumulators and reads back as 0
+    if (d->pointer == INA_REG_CONFIG && (v & INA_CONFIG_RSTACC))
+    {
+      d->energy_j = d->charge_c = 0.0;
+      v &= (uint16_t)~INA_CONFIG_RSTACC;
+    }
+    d->regs[d->pointer] = v;
+  }
+  return 0;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t size)
+{
+  _rx_len = _rx_pos = 0;
+  BenchIna_t* d = (bench_hal::inaSource() != nullptr) ? _ina(address) : nullptr;
+  if (d == nullptr) return 0;
+  if (d->pointer == INA_REG_ENERGY || d->pointer == INA_REG_CHARGE)
+  {
+    // 40 bit, big endian; counts wrap like the device's
+    if (size != 5) return 0;
+    const uint64_t counts = (d->pointer == INA_REG_ENERGY)
+        ? (uint64_t)(d->energy_j / INA_ENERGY_LSB_J)
+        : (uint64_t)(int64_t)llround(d->charge_c / INA_CHARGE_LSB_C);
+    for (uint8_t k = 0; k < 5; ++k) _rx[k] = (uint8_t)(counts >> (8 * (4 - k)));
+    _rx_len = 5;
+    return _rx_len;
+  }
+  if (size != 2) return 0;
+  const uint16_t v = d->regs[d->pointer];
+  _rx[0] = (uint8_t)(v >> 8);
+  _rx[1] = (uint8_t)(v & 0xFF);
+  _rx_len = 2;
+  if (d->pointer == INA_REG_DIAG_ALRT)
+  {
+    // Reading clears the latched flags and releases ALERT
+    d->regs[INA_REG_DIAG_ALRT] &= (uint16_t)~BENCH_INA_DIAG_FLAGS;
+    _driveAlerts();
+  }
+  return _rx_len;
+}
+
+int TwoWire::available(void) { return _rx_len - _rx_pos; }
+int TwoWire::read(void)      { return (_rx_pos < _rx_len) ? _rx[_rx_pos++] : -1; }
+
+double ledcSetup(uint8_t chan, double freq, uint8_t bit_num)
+{
+  if (chan < BENCH_LEDC_CHANNELS) { s_ledc_bits[chan] = bit_num; s_ledc_freq[chan] = freq; }
+  return freq;
+}
+
+void ledcAttachPin(uint8_t pin, uint8_t chan) { (void)pin; (void)chan; }
+
+void ledcWrite(uint8_t chan, uint32_t duty)
+{
+  // Whole ticks, fraction cleared (what ledc_set_duty() does)
+  if (chan < BENCH_LEDC_CHANNELS) LEDC.channel_group[chan / 8].channel[chan % 8].duty.duty = duty << BENCH_LEDC_FRAC_BITS;
+}
+
+void     bench_hal::setMillis(uint32_t ms)     { s_now_us = (uint64_t)ms * 1000ULL; }
+void     bench_hal::advanceMillis(uint32_t ms) { s_now_us += (uint64_t)ms * 1000ULL; }
+void     bench_hal::advanceToMillis(uint32_t ms)
+{
+  if ((uint64_t)ms * 1000ULL > s_now_us) s_now_us = (uint64_t)ms * 1000ULL;
+}
+uint32_t bench_hal::now(void)                  { return (uint32_t)(s_now_us / 1000ULL); }
+
+uint32_t bench_hal::ledcDuty(uint8_t chan) { return _ledcReg(chan) >> BENCH_LEDC_FRAC_BITS; }
+double   bench_hal::ledcDutyAvg(uint8_t chan) { return _ledcReg(chan) / (double)(1u << BENCH_LEDC_FRAC_BITS); }
+uint8_t  bench_hal::ledcBits(uint8_t chan) { return (chan < BENCH_LEDC_CHANNELS) ? s_ledc_bits[chan] : 0; }
+double   bench_hal::ledcFreq(uint8_t chan) { return (chan < BENCH_LEDC_CHANNELS) ? s_ledc_freq[chan] : 0.0; }
+
+void bench_hal::setPinLevel(uint8_t pin, uint8_t level)
+{
+  if (pin >= BENCH_GPIO_PINS) return;
+  BenchPin_t& p = s_pins[pin];
+  const uint8_t old = p.level;
+  p.level = level;
+  if (p.irq_mode == 0 || p.handler == nullptr || old == level) return;
+  if (p.irq_mode == CHANGE || (p.irq_mode == FALLING && level == 0) || (p.irq_mode == RISING && level != 0))
+  {
+    p.handler(p.arg);
+  }
+}
+
+uint8_t bench_hal::pinLevel(uint8_t pin) { return (pin < BENCH_GPIO_PINS) ? s_pins[pin].level : 0; }
+
+void              bench_hal::setInaSource(bench_ina_source* src) { s_ina_source = src; }
+bench_ina_source* bench_hal::inaSource(void)                     { return s_ina_source; }
+
+uint16_t bench_hal::inaRegister(uint8_t addr, uint8_t reg)
+{
+  const BenchIna_t* d = _ina(addr);
+  return (d != nullptr) ? d->regs[reg % BENCH_INA_REGS] : 0;
+}
+
+void bench_hal::setInaAlertPin(uint8_t addr, int8_t pin)
+{
+  BenchIna_t* d = _ina(addr);
+  if (d != nullptr) d->alert_pin = pin;
+  _driveAlerts();
+}
+
+void bench_hal::inaConvert(void)
+{
+  if (s_ina_source == nullptr) return;
+  for (BenchIna_t& d : s_ina)
+  {
+    if (d.addr == 0) continue;
+    const float i_a   = s_ina_source->current_mA(d.addr) / 1000.0f;
+    const float v_bus = s_ina_source->busVoltage(d.addr);
+    // The accumulators add every conversion: |P| and I over the time since the last one
+    if (d.conv_us != 0)
+    {
+      const double dt_s = (s_now_us - d.conv_us) / 1e6;
+      d.energy_j += fabs((double)v_bus * i_a) * dt_s;
+      d.charge_c += (double)i_a * dt_s;
+    }
+    d.conv_us = s_now_us;
+    if (d.alert_pin < 0) continue;
+
+    // Same scaling as the device: SOVL in 5 uV (ADCRANGE 0), BOVL in 3.125 mV
+    const float v_shunt = i_a * INA_SHUNT_OHMS;
+    uint16_t flags = 0;
+    if (v_shunt > (int16_t)d.regs[INA_REG_SOVL] * INA_SOVL_LSB_V) flags |= INA_DIAG_SHNTOL;
+    if (v_bus   > (d.regs[INA_REG_BOVL] & 0x7FFF) * INA_BOVL_LSB_V) flags |= INA_DIAG_BUSOL;
+    uint16_t& diag = d.regs[INA_REG_DIAG_ALRT];
+    if (diag & INA_DIAG_ALATCH) diag |= flags;
+    else                        diag = (uint16_t)((diag & ~BENCH_INA_DIAG_FLAGS) | flags);
+  }
+  _driveAlerts();
+}
+
+void bench_hal::setSerialEcho(bool on) { s_serial_echo = on; }
+bool bench_hal::serialEcho(void)       { return s_serial_echo; }
+
+uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t* buf, uint32_t len)
+{
+  static uint32_t table[256];
+  static bool     ready = false;
+  if (!ready)
+  {
+    for (uint32_t n = 0; n < 256; ++n)
+    {
+      uint32_t c = n;
+      for (int k = 0; k < 8; ++k) c = (c & 1) ? (0xEDB88320UL ^ (c >> 1)) : (c >> 1);
+      table[n] = c;
+    }
+    ready = true;
+  }
+  crc = ~crc;
+  while (len--) crc = table[(crc ^ *buf++) & 0xFF] ^ (crc >> 8);
+  return ~crc;
+}
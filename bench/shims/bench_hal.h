@@ -0,0 +1,68 @@
+/*************************************************************************
+ * @file bench_hal.h
+ * @date 2026/10/18
+ * @brief Control surface of the host shims (clock, LEDC, GPIO, INA228, FS)
+ ************************************************************************/
+
+#ifndef EDUGRID_BENCH_HAL_H_
+#define EDUGRID_BENCH_HAL_H_
+
+#include <stdint.h>
+
+/** What the INA228 shim reads; implemented by the plant simulation */
+class bench_ina_source
+{
+public:
+  virtual ~bench_ina_source(void) {}
+  virtual float busVoltage(uint8_t addr) = 0;   ///< [V]
+  virtual float current_mA(uint8_t addr) = 0;   ///< [mA]
+};
+
+/**
+ * Class with static members driving the shims.  The bench owns time: it
+ * sets millis() before every control pass and reads back the LEDC duty the
+ * firmware code wrote.
+ */
+class bench_hal
+{
+public:
+  static void              setMillis(uint32_t ms);
+  static void              advanceMillis(uint32_t ms);
+  /** setMillis() that never goes back: a blocking call in the previous
+   *  pass (settle calibration burst) may already be past this tick */
+  static void              advanceToMillis(uint32_t ms);
+  static uint32_t          now(void);
+
+  static uint32_t          ledcDuty(uint8_t chan);      ///< raw ticks last written
+  /** Ticks averaged over the 16 periods the fractional duty bits dither */
+  static double            ledcDutyAvg(uint8_t chan);
+  static uint8_t           ledcBits(uint8_t chan);      ///< resolution from ledcSetup()
+  static double            ledcFreq(uint8_t chan);      ///< [Hz] from ledcSetup()
+
+  /** GPIO level, from digitalWrite() or driven by the bench; an edge runs
+   *  the handler of attachInterruptArg() right away, like an ISR */
+  static void              setPinLevel(uint8_t pin, uint8_t level);
+  static uint8_t           pinLevel(uint8_t pin);
+
+  static void              setInaSource(bench_ina_source* src);
+  static bench_ina_source* inaSource(void);
+
+  /** INA228 register as last written over Wire (or its reset value) */
+  static uint16_t          inaRegister(uint8_t addr, uint8_t reg);
+  /** Connect the open-drain ALERT of the device at `addr` to `pin`
+   *  (wired-OR with every other device on that pin), -1 = none */
+  static void              setInaAlertPin(uint8_t addr, int8_t pin);
+  /** One conversion of every device: add the source's power and current
+   *  since the previous one to ENERGY / CHARGE, and on devices with an
+   *  ALERT pin compare against SOVL/BOVL, set DIAG_ALRT and drive ALERT */
+  static void              inaConvert(void);
+
+  /** Echo Serial output to stderr (off by default, the tables go to stdout) */
+  static void              setSerialEcho(bool on);
+  static bool              serialEcho(void);
+
+  /** Wipe the in-memory LittleFS (bench_fs.cpp) */
+  static void              fsFormat(void);
+};
+
+#endif /* EDUGRID_BENCH_HAL_H_ */
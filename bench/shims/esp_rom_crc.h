@@ -0,0 +1,15 @@
+/*************************************************************************
+ * @file esp_rom_crc.h
+ * @date 2026/10/18
+ * @brief Host shim of the ROM CRC helpers (bench_hal.cpp)
+ ************************************************************************/
+
+#ifndef EDUGRID_BENCH_ESP_ROM_CRC_H_
+#define EDUGRID_BENCH_ESP_ROM_CRC_H_
+
+#include <stdint.h>
+
+/* Same contract as the ROM: pass 0 to start, the previous result to chain */
+uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t* buf, uint32_t len);
+
+#endif /* EDUGRID_BENCH_ESP_ROM_CRC_H_ */
@@ -0,0 +1,28 @@
+/*************************************************************************
+ * @file gpio_ll.h
+ * @date 2026/10/18
+ * @brief Host shim of the ESP-IDF GPIO low-level layer (ISR-safe writes)
+ ************************************************************************/
+
+#ifndef EDUGRID_BENCH_GPIO_LL_H_
+#define EDUGRID_BENCH_GPIO_LL_H_
+
+#include <stdint.h>
+#include <bench_hal.h>
+
+typedef int gpio_num_t;
+
+struct gpio_dev_t
+{
+  uint32_t unused;
+};
+
+extern gpio_dev_t GPIO;
+
+static inline void gpio_ll_set_level(gpio_dev_t* hw, gpio_num_t gpio_num, uint32_t level)
+{
+  (void)hw;
+  bench_hal::setPinLevel((uint8_t)gpio_num, level ? 1 : 0);
+}
+
+#endif /* EDUGRID_BENCH_GPIO_LL_H_ */
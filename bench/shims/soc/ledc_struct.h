@@ -0,0 +1,29 @@
+/*************************************************************************
+ * @file ledc_struct.h
+ * @date 2026/10/18
+ * @brief Host shim of the ESP32 LEDC register block (the fields the firmware writes)
+ ************************************************************************/
+
+#ifndef EDUGRID_BENCH_LEDC_STRUCT_H_
+#define EDUGRID_BENCH_LEDC_STRUCT_H_
+
+#include <stdint.h>
+
+/* Two groups (high / low speed) of 8 channels; the duty register holds
+   ticks << 4 plus 4 fractional bits, as on the chip */
+struct ledc_dev_t
+{
+  struct
+  {
+    struct
+    {
+      union { struct { uint32_t timer_sel:2, sig_out_en:1, idle_lv:1, low_speed_update:1, reserved:27; }; uint32_t val; } conf0;
+      union { struct { uint32_t duty:25, reserved:7; }; uint32_t val; } duty;
+      union { struct { uint32_t duty_scale:10, duty_cycle:10, duty_num:10, duty_inc:1, duty_start:1; }; uint32_t val; } conf1;
+    } channel[8];
+  } channel_group[2];
+};
+
+extern ledc_dev_t LEDC;
+
+#endif /* EDUGRID_BENCH_LEDC_STRUCT_H_ */
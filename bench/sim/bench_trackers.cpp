@@ -0,0 +1,85 @@
+/*************************************************************************
+ * @file bench_trackers.cpp
+ * @date 2026/10/18
+ *
+ ************************************************************************/
+
+/*************************************************************************
+ * Include
+ ************************************************************************/
+#include <bench_trackers.h>
+#include <edugrid_measurement.h>
+
+/*************************************************************************
+ * Variable Definition
+ * One entry per tracker under test; new algorithms are added here and
+ * show up in every bench runner.
+ ************************************************************************/
+static const BenchTracker_t kTrackers[] = {
+  { "po_fixed", [](edugrid_channel& ch) {
+      ch.mppt.set_freeze_enabled(false);
+      ch.mppt.set_mode_state(AUTO);
+    } },
+  // P&O with the step period from the measured plant settle time
+  { "po_autosettle", [](edugrid_channel& ch) {
+      ch.mppt.set_freeze_enabled(false);
+      ch.settle.setInterval_s(SETTLE_CAL_INTERVAL_S);
+      ch.mppt.set_mode_state(AUTO);
+    } },
+  // ... holding the duty once it only dithers around the MPP (the default)
+  { "po_freeze", [](edugrid_channel& ch) {
+      ch.mppt.set_freeze_enabled(true);
+      ch.settle.setInterval_s(SETTLE_CAL_INTERVAL_S);
+      ch.mppt.set_mode_state(AUTO);
+    } },
+  // P&O on a V_in reference, held by the inner PI loop every control pass
+  { "po_vref", [](edugrid_channel& ch) {
+      ch.mppt.set_vref_enabled(true);
+      ch.settle.setInterval_s(SETTLE_CAL_INTERVAL_S);
+      ch.mppt.set_mode_state(AUTO);
+    } },
+  // po_freeze maximising the power delivered to the load instead of P_in
+  { "po_pout", [](edugrid_channel& ch) {
+      ch.mppt.set_freeze_enabled(true);
+      ch.mppt.set_pout_weight(1.0f);
+      ch.settle.setInterval_s(SETTLE_CAL_INTERVAL_S);
+      ch.mppt.set_mode_state(AUTO);
+    } },
+  // po_freeze with the environment's drift taken out of dP (dP-P&O)
+  { "po_drift", [](edugrid_channel& ch) {
+      ch.mppt.set_freeze_enabled(true);
+      ch.mppt.set_drift_enabled(true);
+      ch.settle.setInterval_s(SETTLE_CAL_INTERVAL_S);
+      ch.mppt.set_mode_state(AUTO);
+    } },
+};
+
+/*************************************************************************
+ * Function Definition
+ ************************************************************************/
+const BenchTracker_t* bench_trackers(size_t& count)
+{
+  count = sizeof(kTrackers) / sizeof(kTrackers[0]);
+  return kTrackers;
+}
+
+void bench_channel_begin(edugrid_channel& ch, sim_buck_plant& plant)
+{
+  const ChannelConfig_t& cfg = edugrid_channel::config(0);
+  bench_hal::setInaSource(&plant);
+  plant.setDynamics(cfg.ledc_channel, SIM_BUCK_TAU_MS);
+  ch.pwm.begin(0, cfg.ledc_channel, CONVERTER_FREQUENCY, cfg.pwm_pin);
+  ch.meas.begin(0, cfg.ina_pv_addr, cfg.ina_load_addr);
+  ch.mppt.set_step_period_ms(edugrid_measurement::stepPeriodFor(INA_AVG_SAMPLES, INA_CONV_US,
+                                                                INA_EXTRA_SETTLE_MS));
+  plant.solve(bench_channel_duty(ch));
+  ch.meas.update();
+}
+
+float bench_channel_duty(const edugrid_channel& ch)
+{
+  (void)ch;   // bench channels always drive the LEDC channel of table row 0
+  const uint8_t  ledc = edugrid_channel::config(0).ledc_channel;
+  const uint32_t full = (1u << bench_hal::ledcBits(ledc)) - 1u;
+  return (float)(bench_hal::ledcDutyAvg(ledc) / full);
+}
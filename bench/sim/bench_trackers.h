@@ -0,0 +1,45 @@
+/*************************************************************************
+ * @file bench_trackers.h
+ * @date 2026/10/18
+ * @brief Trackers under test and the channel bring-up shared by the benches
+ ************************************************************************/
+
+#ifndef EDUGRID_BENCH_TRACKERS_H_
+#define EDUGRID_BENCH_TRACKERS_H_
+
+/*************************************************************************
+ * Include
+ ************************************************************************/
+#include <edugrid_channel.h>
+#include <sim_pv.h>
+
+/*************************************************************************
+ * Types
+ ************************************************************************/
+
+/** One tracker: setup() puts a freshly brought-up channel into its mode */
+struct BenchTracker_t
+{
+  const char* name;
+  void (*setup)(edugrid_channel& ch);
+};
+
+/*************************************************************************
+ * Function Definition
+ ************************************************************************/
+
+/** Registered trackers (bench_trackers.cpp), `count` receives the length */
+const BenchTracker_t* bench_trackers(size_t& count);
+
+/**
+ * Same bring-up as setup() for a bench-owned channel: PWM at its init duty,
+ * sensors probed on `plant` (with SIM_BUCK_TAU_MS dynamics), step period of
+ * the default acquisition setting, plant settled at the init duty and one
+ * measurement taken.
+ */
+void  bench_channel_begin(edugrid_channel& ch, sim_buck_plant& plant);
+
+/** Duty (0..1) the channel's LEDC output currently has */
+float bench_channel_duty(const edugrid_channel& ch);
+
+#endif /* EDUGRID_BENCH_TRACKERS_H_ */
@@ -0,0 +1,357 @@
+/*************************************************************************
+ * @file sim_pv.cpp
+ * @date 2026/10/18
+ *
+ ************************************************************************/
+
+/*************************************************************************
+ * Include
+ ************************************************************************/
+#include <sim_pv.h>
+#include <Arduino.h>
+#include <edugrid_states.h>
+#include <math.h>
+
+/*************************************************************************
+ * Define
+ ************************************************************************/
+#define SIM_BOLTZMANN_OVER_Q   (8.617333e-5f)   /* [V/K] */
+#define SIM_NEWTON_ITERATIONS  (6)
+#define SIM_SOLVE_ITERATIONS   (48)             /* bisection on the string current */
+#define SIM_MPP_SCAN_POINTS    (200)
+#define SIM_MPP_REFINE_STEPS   (30)
+#define SIM_OUT_SCAN_POINTS    (100)            /* duty grid of maxOutput() */
+
+/*************************************************************************
+ * Function Definition
+ ************************************************************************/
+bool SimEnv_t::operator==(const SimEnv_t& o) const
+{
+  if (g_wm2 != o.g_wm2 || t_c != o.t_c) return false;
+  for (uint8_t k = 0; k < SIM_MAX_SUBSTRINGS; ++k)
+  {
+    if (shade[k] != o.shade[k]) return false;
+  }
+  return true;
+}
+
+/* ===== sim_pv_array ===== */
+sim_pv_array::sim_pv_array(const SimPvSpec_t& spec)
+  : _spec(spec), _env{}, _iph{}, _i0(0.0f), _a(1.0f), _rs(0.0f), _rsh(1.0f), _i_max(0.0f),
+    _mpp_valid(false), _mpp_v(0.0f), _mpp_i(0.0f), _mpp_p(0.0f)
+{
+  _env.g_wm2 = SIM_G_STC_WM2;
+  _env.t_c   = SIM_T_STC_C;
+  setSpec(spec);
+}
+
+void sim_pv_array::setSpec(const SimPvSpec_t& spec)
+{
+  _spec = spec;
+  if (_spec.substrings > SIM_MAX_SUBSTRINGS) _spec.substrings = SIM_MAX_SUBSTRINGS;
+  if (_spec.substrings == 0) _spec.substrings = 1;
+  _update();
+}
+
+void sim_pv_array::setEnvironment(const SimEnv_t& env)
+{
+  if (env == _env) return;
+  _env = env;
+  _update();
+}
+
+void sim_pv_array::_update(void)
+{
+  const SimEnv_t& env = _env;
+  _mpp_valid = false;
+
+  const float dT   = env.t_c - SIM_T_STC_C;
+  const float t_k  = env.t_c + 273.15f;
+  const float ncel = (float)_spec.cells_per_substring;
+  const float isc  = _spec.isc_a * (1.0f + _spec.alpha_isc * dT);
+  const float voc  = _spec.voc_v * (1.0f + _spec.beta_voc * dT) / (float)_spec.substrings;
+
+  _a   = _spec.ideality * ncel * SIM_BOLTZMANN_OVER_Q * t_k;
+  _rs  = _spec.rs_cell_ohm  * ncel;
+  _rsh = _spec.rsh_cell_ohm * ncel;
+  // Saturation current from the open-circuit condition at full sun
+  _i0  = isc / (expf(voc / _a) - 1.0f);
+
+  _i_max = 0.0f;
+  for (uint8_t k = 0; k < _spec.substrings; ++k)
+  {
+    float shade = env.shade[k];
+    if (shade < 0.0f) shade = 0.0f;
+    if (shade > 1.0f) shade = 1.0f;
+    _iph[k] = isc * (env.g_wm2 / SIM_G_STC_WM2) * (1.0f - shade);
+    if (_iph[k] > _i_max) _i_max = _iph[k];
+  }
+}
+
+float sim_pv_array::_substringVoltage(uint8_t k, float i) const
+{
+  const float iph = _iph[k];
+  if (i >= iph) return -_spec.v_bypass;   // bypass diode carries the excess
+
+  // Start from the Rsh = inf closed form, then Newton on
+  //   g(V) = Iph - I - I0 (exp((V + I Rs)/a) - 1) - (V + I Rs)/Rsh
+  float v = _a * logf((iph - i) / _i0 + 1.0f) - i * _rs;
+  for (uint8_t n = 0; n < SIM_NEWTON_ITERATIONS; ++n)
+  {
+    const float vd = v + i * _rs;
+    const float e  = expf(vd / _a);
+    const float g  = iph - i - _i0 * (e - 1.0f) - vd / _rsh;
+    const float dg = -_i0 * e / _a - 1.0f / _rsh;
+    v -= g / dg;
+  }
+  return (v > -_spec.v_bypass) ? v : -_spec.v_bypass;
+}
+
+float sim_pv_array::voltageAt(float i) const
+{
+  float v = 0.0f;
+  for (uint8_t k = 0; k < _spec.substrings; ++k) v += _substringVoltage(k, i);
+  return v;
+}
+
+float sim_pv_array::currentAt(float v) const
+{
+  float lo = 0.0f, hi = _i_max;
+  if (voltageAt(0.0f) <= v) return 0.0f;
+  for (uint8_t n = 0; n < SIM_SOLVE_ITERATIONS; ++n)
+  {
+    const float mid = 0.5f * (lo + hi);
+    if (voltageAt(mid) > v) lo = mid; else hi = mid;
+  }
+  return 0.5f * (lo + hi);
+}
+
+void sim_pv_array::mpp(float& v, float& i, float& p)
+{
+  if (!_mpp_valid)
+  {
+    // Dense scan finds the global peak among the shading maxima, a golden
+    // section search then refines inside the neighbouring scan cells.
+    const float di = _i_max / SIM_MPP_SCAN_POINTS;
+    int   best   = 0;
+    float best_p = 0.0f;
+    for (int n = 1; n < SIM_MPP_SCAN_POINTS; ++n)
+    {
+      const float pn = voltageAt(n * di) * n * di;
+      if (pn > best_p) { best_p = pn; best = n; }
+    }
+
+    float lo = (best > 0) ? (best - 1) * di : 0.0f;
+    float hi = (best + 1) * di;
+    const float gr = 0.6180340f;
+    for (uint8_t n = 0; n < SIM_MPP_REFINE_STEPS; ++n)
+    {
+      const float x1 = hi - gr * (hi - lo);
+      const float x2 = lo + gr * (hi - lo);
+      if (voltageAt(x1) * x1 > voltageAt(x2) * x2) hi = x2; else lo = x1;
+    }
+    _mpp_i = 0.5f * (lo + hi);
+    _mpp_v = voltageAt(_mpp_i);
+    _mpp_p = _mpp_v * _mpp_i;
+    if (_mpp_p < best_p)
+    {
+      _mpp_i = best * di;
+      _mpp_v = voltageAt(_mpp_i);
+      _mpp_p = best_p;
+    }
+    if (_mpp_p < 0.0f) { _mpp_v = _mpp_i = _mpp_p = 0.0f; }
+    _mpp_valid = true;
+  }
+  v = _mpp_v; i = _mpp_i; p = _mpp_p;
+}
+
+/* ===== sim_buck_plant ===== */
+sim_buck_plant::sim_buck_plant(sim_pv_array& pv, float r_load_ohm, float eta)
+  : _pv(pv), _r_load(r_load_ohm), _eta(eta), _pt{},
+    _ledc(0), _tau_ms(0.0f), _dyn_valid(false), _dyn_us(0), _gate_pin(-1),
+    _lossy(false), _loss{}, _mo_valid(false), _mo_env{}, _mo_load(0.0f), _mo_duty(0.0f), _mo_p(0.0f),
+    _sigma_v(0.0f), _sigma_i(0.0f), _sigma_v_out(0.0f), _sigma_i_out(0.0f),
+    _rng(1), _gauss(0.0f, 1.0f)
+{
+}
+
+void sim_buck_plant::setNoise(float sigma_v, float sigma_i, uint32_t seed)
+{
+  _sigma_v = _sigma_v_out = sigma_v;
+  _sigma_i = _sigma_i_out = sigma_i;
+  _rng.seed(seed);
+  _gauss.reset();
+}
+
+void sim_buck_plant::setLosses(const SimLoss_t* losses)
+{
+  _lossy    = (losses != nullptr);
+  _loss     = _lossy ? *losses : SimLoss_t{};
+  _mo_valid = false;
+}
+
+void sim_buck_plant::maxOutput(float& duty, float& p_out)
+{
+  if (!_mo_valid || _mo_env != _pv.environment() || _mo_load != _r_load)
+  {
+    // Same scheme as the MPP: dense duty scan for the global peak under
+    // shading, golden section inside the neighbouring cells
+    SimPoint_t pt;
+    const float dd = 1.0f / SIM_OUT_SCAN_POINTS;
+    int   best   = SIM_OUT_SCAN_POINTS;
+    float best_p = 0.0f;
+    for (int n = 1; n <= SIM_OUT_SCAN_POINTS; ++n)
+    {
+      _steady(n * dd, pt);
+      if (pt.p_out > best_p) { best_p = pt.p_out; best = n; }
+    }
+    float lo = (best - 1) * dd;
+    float hi = (best < SIM_OUT_SCAN_POINTS) ? (best + 1) * dd : 1.0f;
+    const float gr = 0.6180340f;
+    for (uint8_t n = 0; n < SIM_MPP_REFINE_STEPS; ++n)
+    {
+      const float x1 = hi - gr * (hi - lo);
+      const float x2 = lo + gr * (hi - lo);
+      SimPoint_t p1, p2;
+      _steady(x1, p1);
+      _steady(x2, p2);
+      if (p1.p_out > p2.p_out) hi = x2; else lo = x1;
+    }
+    _steady(0.5f * (lo + hi), pt);
+    _mo_duty = 0.5f * (lo + hi);
+    _mo_p    = pt.p_out;
+    if (_mo_p < best_p) { _mo_duty = best * dd; _mo_p = best_p; }
+    _mo_env   = _pv.environment();
+    _mo_load  = _r_load;
+    _mo_valid = true;
+  }
+  duty  = _mo_duty;
+  p_out = _mo_p;
+}
+
+void sim_buck_plant::setDynamics(uint8_t ledc_chan, float tau_ms)
+{
+  _ledc      = ledc_chan;
+  _tau_ms    = (tau_ms > 0.0f) ? tau_ms : 0.0f;
+  _dyn_valid = false;
+}
+
+const SimPoint_t& sim_buck_plant::solve(float duty)
+{
+  if (_gateOff()) duty = 0.0f;
+  if (_tau_ms > 0.0f) _advance(duty);
+  else                _steady(duty, _pt);
+  return _pt;
+}
+
+void sim_buck_plant::_advance(float duty)
+{
+  const uint32_t now = micros();
+  const int32_t  dt  = (int32_t)(now - _dyn_us);
+  if (_dyn_valid && dt == 0) return;
+
+  SimPoint_t target;
+  _steady(duty, target);
+  // First call or the bench reset the clock: start settled
+  const float a = (_dyn_valid && dt > 0) ? 1.0f - expf(-(dt / 1000.0f) / _tau_ms) : 1.0f;
+  _pt.v_in  += a * (target.v_in  - _pt.v_in);
+  _pt.i_in  += a * (target.i_in  - _pt.i_in);
+  _pt.p_in   = _pt.v_in * _pt.i_in;
+  _pt.v_out += a * (target.v_out - _pt.v_out);
+  _pt.i_out += a * (target.i_out - _pt.i_out);
+  _pt.p_out  = _pt.v_out * _pt.i_out;
+  _dyn_us    = now;
+  _dyn_valid = true;
+}
+
+void sim_buck_plant::_steady(float duty, SimPoint_t& pt) const
+{
+  pt = SimPoint_t{};
+  if (duty <= 0.0f || _pv.maxCurrent() <= 0.0f)
+  {
+    pt.v_in = _pv.voltageAt(0.0f);   // open circuit
+    if (pt.v_in < 0.0f) pt.v_in = 0.0f;
+    return;
+  }
+  if (duty > 1.0f) duty = 1.0f;
+
+  if (_lossy)
+  {
+    // Averaged lossy stage (SimLoss_t): I_out from the output mesh, the
+    // switch draws (D + k_sw) * I_out.  Same crossing as below, with a
+    // load line that still rises monotonically with V_in.
+    const float r_tot = _r_load + _loss.r_series_ohm + duty * (1.0f - duty) * _loss.r_cin_ohm;
+    const auto  i_out = [&](float v) {
+      const float io = (duty * v - _loss.v_dead) / r_tot;
+      return (io > 0.0f) ? io : 0.0f;
+    };
+    float lo = 0.0f, hi = _pv.maxCurrent();
+    for (uint8_t n = 0; n < SIM_SOLVE_ITERATIONS; ++n)
+    {
+      const float mid = 0.5f * (lo + hi);
+      if ((duty + _loss.k_sw) * i_out(_pv.voltageAt(mid)) > mid) lo = mid; else hi = mid;
+    }
+    const float i = 0.5f * (lo + hi);
+    float v = _pv.voltageAt(i);
+    if (v < 0.0f) v = 0.0f;
+    pt.v_in  = v;
+    pt.i_in  = i;
+    pt.p_in  = v * i;
+    pt.i_out = i_out(v);
+    pt.v_out = pt.i_out * _r_load;
+    pt.p_out = pt.v_out * pt.i_out;
+    return;
+  }
+
+  // Operating point where the I-V curve crosses the reflected load line
+  // V = I * R_load / D^2.  V(I) falls monotonically, so bisection is safe.
+  const float r_in = _r_load / (duty * duty);
+  float lo = 0.0f, hi = _pv.maxCurrent();
+  for (uint8_t n = 0; n < SIM_SOLVE_ITERATIONS; ++n)
+  {
+    const float mid = 0.5f * (lo + hi);
+    if (_pv.voltageAt(mid) > mid * r_in) lo = mid; else hi = mid;
+  }
+  const float i = 0.5f * (lo + hi);
+  float v = _pv.voltageAt(i);
+  if (v < 0.0f) v = 0.0f;
+
+  pt.v_in  = v;
+  pt.i_in  = i;
+  pt.p_in  = v * i;
+  pt.p_out = _eta * pt.p_in;
+  pt.v_out = sqrtf(pt.p_out * _r_load);
+  pt.i_out = (_r_load > 0.0f) ? pt.v_out / _r_load : 0.0f;
+}
+
+float sim_buck_plant::_noise(float sigma)
+{
+  return (sigma > 0.0f) ? sigma * _gauss(_rng) : 0.0f;
+}
+
+bool sim_buck_plant::_gateOff(void) const
+{
+  return (_gate_pin >= 0) && (bench_hal::pinLevel((uint8_t)_gate_pin) == 0);
+}
+
+float sim_buck_plant::_liveDuty(void) const
+{
+  if (_gateOff()) return 0.0f;
+  const uint32_t full = (1u << bench_hal::ledcBits(_ledc)) - 1u;
+  // The stage averages a dithered duty over its 16 periods (0.4 ms)
+  return (full > 0) ? (float)(bench_hal::ledcDutyAvg(_ledc) / full) : 0.0f;
+}
+
+float sim_buck_plant::busVoltage(uint8_t addr)
+{
+  if (_tau_ms > 0.0f) _advance(_liveDuty());
+  if (addr == INA_LOAD_ADDR) return _pt.v_out + _noise(_sigma_v_out);
+  return _pt.v_in + _noise(_sigma_v);
+}
+
+float sim_buck_plant::current_mA(uint8_t addr)
+{
+  if (_tau_ms > 0.0f) _advance(_liveDuty());
+  if (addr == INA_LOAD_ADDR) return 1000.0f * (_pt.i_out + _noise(_sigma_i_out));
+  return 1000.0f * (_pt.i_in + _noise(_sigma_i));
+}
@@ -0,0 +1,208 @@
+/*************************************************************************
+ * @file sim_pv.h
+ * @date 2026/10/18
+ * @brief PV array + buck converter plant for the host benches
+ ************************************************************************/
+
+#ifndef EDUGRID_SIM_PV_H_
+#define EDUGRID_SIM_PV_H_
+
+/*************************************************************************
+ * Include
+ ************************************************************************/
+#include <stdint.h>
+#include <random>
+#include <bench_hal.h>
+
+/*************************************************************************
+ * Define
+ ************************************************************************/
+#define SIM_MAX_SUBSTRINGS     (4)
+#define SIM_T_STC_C            (25.0f)
+#define SIM_G_STC_WM2          (1000.0f)
+#define SIM_BUCK_TAU_MS        (2.0f)    /* input capacitor vs. panel, lab stage */
+#define SIM_LOAD_OHM           (2.5f)    /* resistive load of the lab stage */
+
+/*************************************************************************
+ * Types
+ ************************************************************************/
+
+/** Module data sheet values plus single-diode parameters per cell */
+struct SimPvSpec_t
+{
+  uint8_t substrings;           ///< each with its own bypass diode
+  uint8_t cells_per_substring;
+  float   isc_a;                ///< at STC
+  float   voc_v;                ///< at STC, whole module
+  float   alpha_isc;            ///< [1/K] relative Isc coefficient
+  float   beta_voc;             ///< [1/K] relative Voc coefficient
+  float   ideality;             ///< diode ideality factor n
+  float   rs_cell_ohm;
+  float   rsh_cell_ohm;
+  float   v_bypass;             ///< bypass diode forward voltage
+};
+
+/** 36-cell ~100 W module in three bypassed substrings (lab panel) */
+static constexpr SimPvSpec_t kSimDefaultPanel = {
+  3, 12, 6.0f, 22.0f, 0.0005f, -0.0032f, 1.3f, 0.008f, 12.0f, 0.6f
+};
+
+/** Operating conditions; shade is the blocked fraction per substring */
+struct SimEnv_t
+{
+  float g_wm2;
+  float t_c;
+  float shade[SIM_MAX_SUBSTRINGS];
+
+  bool operator==(const SimEnv_t& o) const;
+  bool operator!=(const SimEnv_t& o) const { return !(*this == o); }
+};
+
+/** Losses of the synchronous buck (IR2104 half bridge) behind the PV-side
+ *  INA, in the averaged model:
+ *    V_out = D * V_in - I_out * (r_series + D * (1 - D) * r_cin) - v_dead
+ *    I_in  = (D + k_sw) * I_out
+ *  Only the duty-dependent parts move the P_out maximum away from the MPP;
+ *  into a resistive load r_series alone is just a constant share. */
+struct SimLoss_t
+{
+  float r_series_ohm;           ///< switch (one conducts at a time) + inductor DCR + load shunt
+  float r_cin_ohm;              ///< input capacitor ESR, RMS ripple I_out^2 * D * (1 - D)
+  float v_dead;                 ///< body diode in the dead time: 2 * t_dead * f_sw * V_f
+  float k_sw;                   ///< switching: (t_rise + t_fall) / 2 * f_sw
+};
+
+/** Lab stage at 39 kHz: 20 mOhm switches, 60 mOhm DCR, 20 mOhm shunt and
+ *  traces, 50 mOhm electrolytics, 2 x 520 ns IR2104 dead time at 0.8 V,
+ *  ~150 ns edges */
+static constexpr SimLoss_t kSimLabLosses = { 0.1f, 0.05f, 0.032f, 0.006f };
+
+struct SimPoint_t
+{
+  float v_in, i_in, p_in;       ///< PV side
+  float v_out, i_out, p_out;    ///< load side
+};
+
+/*************************************************************************
+ * Class
+ ************************************************************************/
+
+/**
+ * Single-diode model per substring, bypass diode clamps a substring at
+ * -v_bypass once the string current exceeds its photo current, so partial
+ * shading gives the usual multi-peak P-V curve.
+ */
+class sim_pv_array
+{
+public:
+  explicit sim_pv_array(const SimPvSpec_t& spec = kSimDefaultPanel);
+
+  void  setSpec(const SimPvSpec_t& spec);
+  const SimPvSpec_t& spec(void) const { return _spec; }
+
+  void  setEnvironment(const SimEnv_t& env);
+  const SimEnv_t& environment(void) const { return _env; }
+
+  /** Terminal voltage at string current i [A] */
+  float voltageAt(float i) const;
+
+  /** String current at terminal voltage v [V] (0 above Voc) */
+  float currentAt(float v) const;
+
+  /** Upper bound of the string current (largest photo current) */
+  float maxCurrent(void) const { return _i_max; }
+
+  /** Global maximum power point of the current environment */
+  void  mpp(float& v, float& i, float& p);
+
+private:
+  void  _update(void);
+  float _substringVoltage(uint8_t k, float i) const;
+
+  SimPvSpec_t _spec;
+  SimEnv_t    _env;
+  float       _iph[SIM_MAX_SUBSTRINGS];
+  float       _i0;
+  float       _a;                 // n * Ncells * Vt
+  float       _rs, _rsh;          // per substring
+  float       _i_max;
+
+  bool        _mpp_valid;
+  float       _mpp_v, _mpp_i, _mpp_p;
+};
+
+/**
+ * Buck stage with a resistive load in CCM: the array sees R_load / D^2,
+ * the load gets eta * P_in.  With setLosses() the averaged lossy stage of
+ * SimLoss_t replaces the constant eta, so the efficiency moves with the
+ * duty and the maximum of P_out no longer sits at the MPP.  Also the
+ * INA228 source for both sides, with optional seeded Gaussian measurement
+ * noise.
+ *
+ * Static by default (solve() jumps to the operating point).  With
+ * setDynamics() the point follows a first-order lag on the simulated clock
+ * and the sensors track the live LEDC duty, so a duty step inside one
+ * control pass shows up as a step response.
+ */
+class sim_buck_plant : public bench_ina_source
+{
+public:
+  sim_buck_plant(sim_pv_array& pv, float r_load_ohm = SIM_LOAD_OHM, float eta = 0.95f);
+
+  /** Settle the plant at duty d (0..1) and latch it for the sensors */
+  const SimPoint_t& solve(float duty);
+  const SimPoint_t& point(void) const { return _pt; }
+
+  void  setNoise(float sigma_v, float sigma_i, uint32_t seed);
+  /** Noise of the load-side INA only (setNoise() sets both sides) */
+  void  setLoadNoise(float sigma_v, float sigma_i) { _sigma_v_out = sigma_v; _sigma_i_out = sigma_i; }
+  /** Lossy stage instead of the constant eta; nullptr = constant eta again */
+  void  setLosses(const SimLoss_t* losses);
+  void  setDynamics(uint8_t ledc_chan, float tau_ms);
+  /** Gate driver SD pin: while it reads low the switch stays open
+   *  (duty 0) whatever the LEDC or solve() say; -1 = always enabled */
+  void  setGatePin(int8_t pin)     { _gate_pin = pin; }
+  void  setLoad(float r_load_ohm)  { _r_load = r_load_ohm; }
+  float load(void) const           { return _r_load; }
+
+  /** Largest P_out any duty (0..1) gives in the present environment and
+   *  load, and that duty; cached until either changes */
+  void  maxOutput(float& duty, float& p_out);
+
+  /* bench_ina_source */
+  float busVoltage(uint8_t addr) override;
+  float current_mA(uint8_t addr) override;
+
+private:
+  void  _steady(float duty, SimPoint_t& pt) const;
+  void  _advance(float duty);
+  float _liveDuty(void) const;
+  bool  _gateOff(void) const;
+  float _noise(float sigma);
+
+  sim_pv_array&   _pv;
+  float           _r_load;
+  float           _eta;
+  SimPoint_t      _pt;
+
+  uint8_t         _ledc;
+  float           _tau_ms;         // 0 = static
+  bool            _dyn_valid;
+  uint32_t        _dyn_us;         // micros() of the last advance
+  int8_t          _gate_pin;
+
+  bool            _lossy;
+  SimLoss_t       _loss;
+
+  bool            _mo_valid;
+  SimEnv_t        _mo_env;
+  float           _mo_load;
+  float           _mo_duty, _mo_p;
+
+  float           _sigma_v, _sigma_i;
+  float           _sigma_v_out, _sigma_i_out;
+  std::mt19937    _rng;
+  std::normal_distribution<float> _gauss;
+};
+
+#endif /* EDUGRID_SIM_PV_H_ */
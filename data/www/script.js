@@ -105,7 +105,18 @@ function connectWS() {
         if (typeof j.mode === "string") {
           // Normalize MANUALLY -> MANUAL just in case
           const m = j.mode.toUpperCase().replace("MANUALLY", "MANUAL");
-          modeLabel.textContent = m;
+          // AUTO holding the duty at steady state instead of dithering
+          // ... or the V_in reference of the cascade, unless a charge
+          // limit holds the output or a fast trip switched the stage off
+          const tripped = j.prot === "tripped" || j.prot === "latched";
+          modeLabel.textContent = tripped ? `${m} (${j.prot.toUpperCase()})`
+            : (typeof j.charge === "string") ? `${m} (${j.charge.toUpperCase()})`
+            : j.frozen ? m + " (hold)"
+            : Number.isFinite(j.vref) ? `${m} (V_ref ${j.vref.toFixed(2)} V)` : m;
+          modeLabel.title = tripped
+            ? `${j.trips} trip(s); details and reset: /api/protect`
+            : Number.isFinite(j.frozen_s)
+            ? `held ${j.frozen_s} s, ~${Number(j.freeze_gain_j).toFixed(1)} J dither loss avoided` : "";
         } else if (j.mode === 1) {
           modeLabel.textContent = "AUTO";
         } else if (j.mode === 0) {
@@ -128,6 +139,13 @@ function connectWS() {
       setText("power_in_label",    fmtW(pin));
       setText("power_out_label",   fmtW(pout));
       setText("efficiency_label",  fmtPct(eff));
+      // MPPT tracking efficiency against the last IV sweep (null before one)
+      const effLabel = el("efficiency_label");
+      if (effLabel) {
+        effLabel.title = Number.isFinite(j.teff)
+          ? `MPPT tracking ${fmtPct(j.teff * 100)} now, ${fmtPct(j.teff_cum * 100)} since boot`
+          : "MPPT tracking: no IV sweep yet";
+      }
 
       updateLiveOperatingPoints(vin, iin);
 
@@ -166,7 +184,16 @@ function attachInstantModeToggle() {
   });
 }
 
+/* The access point has no NTP: hand the device the browser's clock so its
+   energy totals roll over at local midnight */
+function sendClock() {
+  const unix = Math.floor(Date.now() / 1000);
+  const tz = -new Date().getTimezoneOffset();
+  fetch(`/api/time?unix=${unix}&tz=${tz}`, { cache: 'no-cache' }).catch(() => {});
+}
+
 window.addEventListener('load', function() {
+  sendClock();
   attachDragGuards();
   attachInstantModeToggle();
   connectWS();
@@ -275,9 +302,11 @@ async function pollIvData() {
     const res = await fetch('/ivsweep/data', { cache: 'no-cache' });
     const j = await res.json();
 
-    const v = Array.isArray(j.v) ? j.v : [];
-    const i = Array.isArray(j.i) ? j.i : [];
-    const p = Array.isArray(j.p) ? j.p : [];
+    // The curve is the up pass; points of the optional down pass follow it
+    const nUp = Number.isFinite(j.n_up) ? j.n_up : undefined;
+    const v = Array.isArray(j.v) ? j.v.slice(0, nUp) : [];
+    const i = Array.isArray(j.i) ? j.i.slice(0, nUp) : [];
+    const p = Array.isArray(j.p) ? j.p.slice(0, nUp) : [];
 
     // Build raw point arrays
     const rawIV = [];
@@ -320,6 +349,16 @@ async function pollIvData() {
         const ii = Number(i[mppIdx]) || 0;
         const pp = Number(p[mppIdx]) || 0;
         info.textContent = `MPP ~ ${vv.toFixed(2)} V, ${ii.toFixed(2)} A  ->  ${pp.toFixed(2)} W`;
+        if (j.done && Number.isFinite(j.duration_ms)) {
+          info.textContent += `  (${j.v.length} points in ${(j.duration_ms / 1000).toFixed(1)} s`
+                            + (j.v.length > v.length ? `, hysteresis ${Number(j.hyst_pct).toFixed(1)} %` : '')
+                            + (j.background ? ', background' : '')
+                            + ')';
+        }
+        if (j.bg_count > 0) {
+          info.textContent += `  | background sweeps: ${j.bg_count}, ${Number(j.bg_time_s).toFixed(0)} s off MPP,`
+                            + ` ${Number(j.bg_loss_j).toFixed(1)} J (${Number(j.bg_cost_pct).toFixed(2)} %)`;
+        }
       } else {
         info.textContent = '';
       }
@@ -347,3 +386,110 @@ window.addEventListener('load', () => {
   const b = document.getElementById('ivStartBtn');
   if (b) b.addEventListener('click', startIvSweep);
 });
+
+/* === SCOPE (step response) === */
+let scopeChart = null;
+let scopeSeq = 0;
+
+const SCOPE_MAGIC = 0x43534745;   // ScopeHeader_t, see edugrid_scope.h
+const SCOPE_SAMPLE_BYTES = 20;
+
+function initScopeChart() {
+  const el = document.getElementById('scopeChart');
+  if (!el) return;
+  const line = (label, axis) => ({ label, data: [], yAxisID: axis, showLine: true, pointRadius: 0, borderWidth: 1 });
+  scopeChart = new Chart(el.getContext('2d'), {
+    type: 'scatter',
+    data: { datasets: [line('V_in', 'yV'), line('V_out', 'yV'), line('I_in', 'yI'), line('I_out', 'yI')] },
+    options: {
+      animation: false,
+      parsing: false,
+      normalized: true,
+      scales: {
+        x:  { title: { display: true, text: 'Time from trigger [ms]' } },
+        yV: { type: 'linear', position: 'left',  title: { display: true, text: 'Voltage [V]' } },
+        yI: { type: 'linear', position: 'right', title: { display: true, text: 'Current [A]' }, grid: { drawOnChartArea: false } }
+      },
+      plugins: { legend: { display: true } }
+    }
+  });
+}
+
+// Raw capture -> header fields + one {x,y} array per signal
+function parseScope(buf) {
+  const dv = new DataView(buf);
+  if (buf.byteLength < 40 || dv.getUint32(0, true) !== SCOPE_MAGIC) return null;
+  const hdrSize = dv.getUint16(6, true);
+  const n = dv.getUint16(8, true);
+  const cap = {
+    pre: dv.getUint16(10, true), periodUs: dv.getUint16(12, true),
+    trigger: dv.getUint8(19), dutyFrom: dv.getUint8(22), dutyTo: dv.getUint8(23),
+    seq: dv.getUint32(28, true), vIn: [], iIn: [], vOut: [], iOut: []
+  };
+  for (let k = 0; k < n; k++) {
+    const off = hdrSize + k * SCOPE_SAMPLE_BYTES;
+    if (off + SCOPE_SAMPLE_BYTES > buf.byteLength) break;
+    const t = dv.getInt32(off, true) / 1000;
+    cap.vIn.push({ x: t, y: dv.getFloat32(off + 4, true) });
+    cap.iIn.push({ x: t, y: dv.getFloat32(off + 8, true) });
+    cap.vOut.push({ x: t, y: dv.getFloat32(off + 12, true) });
+    cap.iOut.push({ x: t, y: dv.getFloat32(off + 16, true) });
+  }
+  return cap;
+}
+
+async function loadScope() {
+  const info = document.getElementById('scopeInfo');
+  try {
+    const res = await fetch('/api/scope?raw=1', { cache: 'no-cache' });
+    const cap = res.ok ? parseScope(await res.arrayBuffer()) : null;
+    if (!cap) { if (info) info.textContent = 'No capture'; return; }
+    scopeSeq = cap.seq;
+    if (scopeChart) {
+      scopeChart.data.datasets[0].data = cap.vIn;
+      scopeChart.data.datasets[1].data = cap.vOut;
+      scopeChart.data.datasets[2].data = cap.iIn;
+      scopeChart.data.datasets[3].data = cap.iOut;
+      scopeChart.update();
+    }
+    if (info) {
+      info.textContent = `#${cap.seq}: ${cap.vIn.length} samples every ${cap.periodUs} us, ${cap.pre} before the trigger`
+                       + (cap.trigger === 0 ? `, duty ${cap.dutyFrom} % -> ${cap.dutyTo} %` : '');
+    }
+  } catch (e) {
+    if (info) info.textContent = 'Download failed';
+  }
+}
+
+async function pollScope() {
+  try {
+    const res = await fetch('/api/scope', { cache: 'no-cache' });
+    const j = await res.json();
+    if (j.running) { setTimeout(pollScope, 250); return; }
+    const seq = j.capture ? j.capture.seq : 0;
+    if (seq > scopeSeq) {
+      loadScope();
+    } else {
+      const info = document.getElementById('scopeInfo');
+      if (info) info.textContent = `No capture (${j.result})`;
+    }
+  } catch (e) {
+    setTimeout(pollScope, 500);
+  }
+}
+
+async function startScope() {
+  try {
+    await fetch('/api/scope?run=step', { cache: 'no-cache' });
+    // The control task picks the request up within a pass
+    setTimeout(pollScope, 250);
+  } catch (e) {
+    alert('Failed to start the capture');
+  }
+}
+
+window.addEventListener('load', () => {
+  initScopeChart();
+  const b = document.getElementById('scopeStartBtn');
+  if (b) b.addEventListener('click', startScope);
+});
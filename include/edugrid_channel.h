@@ -0,0 +1,186 @@
+/*************************************************************************
+ * @file edugrid_channel.h
+ * @date 2026/10/18
+ * @brief Converter channels: measurement + PWM + tracker per buck stage
+ ************************************************************************/
+
+#ifndef EDUGRID_CHANNEL_H_
+#define EDUGRID_CHANNEL_H_
+
+/*************************************************************************
+ * Include
+ ************************************************************************/
+#include <Arduino.h>
+#include <edugrid_states.h>
+#include <edugrid_meas_channel.h>
+#include <edugrid_pwm_channel.h>
+#include <edugrid_mpp_tracker.h>
+#include <edugrid_settle_cal.h>
+#include <edugrid_charger.h>
+#include <edugrid_protection.h>
+#include <edugrid_freq_map.h>
+#include <edugrid_track_eff.h>
+#include <edugrid_energy.h>
+#include <edugrid_scope.h>
+#include <edugrid_measurement.h>
+
+/*************************************************************************
+ * Define
+ ************************************************************************/
+#define EDUGRID_NOISE_HISTORY     (4)      /* readings kept to find a same-duty partner */
+#define EDUGRID_NOISE_MAX_N       (4096)   /* then halve: old samples fade out */
+
+/*************************************************************************
+ * Types
+ ************************************************************************/
+
+/** Hardware of one converter (see EDUGRID_CHANNEL_TABLE) */
+struct ChannelConfig_t
+{
+    uint8_t ina_pv_addr;
+    uint8_t ina_load_addr;
+    uint8_t ledc_channel;
+    int8_t  pwm_pin;
+    int8_t  sd_pin;          ///< IR2104 shutdown/enable, -1 if not wired
+    int8_t  alert_pin;       ///< ALERT of the INA228 pair, -1 if not wired
+};
+
+/** Measured noise of one acquisition profile on one channel.  Each entry is
+ *  a variance estimate from fresh readings: half the squared difference of
+ *  two at the same settled duty, or a sixth of the squared second difference
+ *  of neighbouring IV sweep points. */
+struct AcqNoiseStats_t
+{
+    uint32_t n;
+    float    sum_var_v;      ///< [V^2]
+    float    sum_var_i;      ///< [A^2]
+};
+
+/** Tunable knobs of the configuration; every channel takes the same values */
+struct ChannelKnobs_t
+{
+    uint8_t  pwm_min_pct;
+    uint8_t  pwm_max_pct;
+    uint8_t  manual_slew_step_pct;
+    uint16_t manual_slew_interval_ms;
+    uint8_t  mppt_step_pct;
+    float    mpp_power_eps_w;
+    uint16_t settle_cal_interval_s;
+    uint8_t  iv_sweep_points;
+    bool     iv_sweep_bidir;
+    uint16_t iv_bg_interval_s;
+    uint8_t  iv_bg_points;
+    bool     mppt_freeze;
+    float    vref_kp;
+    float    vref_ki;
+    float    vref_step_v;
+    bool     mppt_vref;
+    float    charge_v_max;
+    float    charge_i_max;
+    float    mppt_pout_weight;
+    bool     pwm_dither;
+    bool     mppt_drift;
+};
+
+/*************************************************************************
+ * Class
+ ************************************************************************/
+
+/**
+ * One buck converter with its own sensors, PWM output and tracker.
+ *
+ * The instances are created once from EDUGRID_CHANNEL_TABLE and reached via
+ * the static accessors; the control task calls serviceAll() every tick,
+ * which services every channel in turn with a rotating start so no channel
+ * is always the last one in a pass.
+ *
+ * Knobs requested from another task (requestKnobs()) are only copied into
+ * the modules by the control task, at the start of a channel's pass, so
+ * the tracker, charger and PWM state is never written from two cores.
+ */
+class edugrid_channel
+{
+public:
+    edugrid_channel(void);
+
+    edugrid_meas_channel meas;
+    edugrid_pwm_channel  pwm;
+    edugrid_mpp_tracker  mppt;      // refers to meas + pwm above
+    edugrid_settle_cal   settle;    // pauses mppt while it steps the duty
+    edugrid_charger      charge;    // CC/CV duty ceiling under which mppt tracks
+    edugrid_protection   protect;   // INA228 ALERT -> SD fast trip
+    edugrid_freq_map     fmap;      // efficiency map; picks the switching frequency
+    edugrid_track_eff    teff;      // harvested vs. available energy in AUTO
+    edugrid_energy       energy;    // INA228 accumulators -> day/week/lifetime totals
+    edugrid_scope        scope;     // triggered fast V/I capture; pauses mppt
+
+    uint8_t index(void) const { return _index; }
+
+    /** One control pass of this converter: sense, trip, clamp, calibrate, ramp, limit, track, rate, count */
+    void service(void);
+
+    /* ===== Acquisition ===== */
+    /** Program the INAs for the profile of the current mode and push the
+     *  matching step period (mode change, or a profile setting changed) */
+    void                   applyAcquisition(void);
+    AcqProfile_t           profile(void) const { return _profile; }
+
+    /** Settle in the step period: measured (settle) or configured */
+    uint16_t               settleMs(void) const;
+
+    const AcqNoiseStats_t& noiseStats(AcqProfile_t p) const;
+
+    /* ===== Channel set ===== */
+    static uint8_t                count(void) { return EDUGRID_NUM_CHANNELS; }
+    static edugrid_channel&       at(uint8_t index);     // out of range -> channel 0
+    static const ChannelConfig_t& config(uint8_t index);
+
+    /** PWM outputs of every channel, gate drivers held off (setup()) */
+    static void beginPowerStages(void);
+
+    /** New knobs for every channel (any task); taken over between passes,
+     *  or by beginPowerStages() during setup() */
+    static void requestKnobs(const ChannelKnobs_t& knobs);
+
+    /** Alert limits + ISR, then gate drivers on (setup(), INAs probed) */
+    static void armProtection(void);
+
+    /** Control task: one round-robin pass over all channels */
+    static void serviceAll(void);
+
+private:
+    AcqProfile_t    _wantProfile(void) const;
+    void            _applyKnobs(const ChannelKnobs_t& k);
+    void            _trackNoise(void);
+    void            _noiseSample(uint8_t duty);
+    void            _noiseFromSweep(void);
+    void            _addNoise(AcqProfile_t p, float var_v, float var_i);
+
+    uint8_t         _index;
+    AcqProfile_t    _profile;
+    OperatingModes_t _mode;               // of the previous pass
+    uint32_t        _knobs_seen;          // _knobs_seq this channel applied
+
+    /* Noise sampling: one fresh, settled reading per duty dwell / window */
+    AcqNoiseStats_t _noise[ACQ_PROFILE_COUNT];
+    uint8_t         _noise_duty;          // duty of the current dwell
+    uint32_t        _noise_duty_ms;       // dwell start
+    uint32_t        _noise_last_ms;       // last reading taken in this dwell
+    uint8_t         _noise_hist_duty[EDUGRID_NOISE_HISTORY];
+    float           _noise_hist_v[EDUGRID_NOISE_HISTORY];
+    float           _noise_hist_i[EDUGRID_NOISE_HISTORY];
+    uint8_t         _noise_hist_len;
+
+    static uint8_t  _rr_start;
+
+    // Knobs requested by requestKnobs() (_req_knobs), taken over as a whole
+    // by the control task; every take-over bumps _knobs_seq.
+    static volatile bool  _knobs_pending;
+    static ChannelKnobs_t _knobs;
+    static ChannelKnobs_t _req_knobs;
+    static uint32_t       _knobs_seq;
+
+    static void _takeKnobs(void);
+};
+
+#endif /* EDUGRID_CHANNEL_H_ */
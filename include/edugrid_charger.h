@@ -0,0 +1,89 @@
+/*************************************************************************
+ * @file edugrid_charger.h
+ * @date 2026/10/18
+ * @brief CC/CV output limits on top of the MPPT (battery charging)
+ ************************************************************************/
+
+#ifndef EDUGRID_CHARGER_H_
+#define EDUGRID_CHARGER_H_
+
+/*************************************************************************
+ * Include
+ ************************************************************************/
+#include <Arduino.h>
+#include <edugrid_states.h>
+#include <edugrid_meas_channel.h>
+#include <edugrid_pwm_channel.h>
+#include <edugrid_mpp_tracker.h>
+
+/*************************************************************************
+ * Types
+ ************************************************************************/
+/** Which output limit holds the duty (event trace, UI) */
+enum ChargeState_t : uint8_t
+{
+    CHARGE_MPPT = 0,     ///< no limit reached, the tracker decides
+    CHARGE_CC,           ///< I_out at charge_i_max
+    CHARGE_CV            ///< V_out at charge_v_max
+};
+
+/*************************************************************************
+ * Class
+ ************************************************************************/
+
+/**
+ * Output regulation of one converter channel while it tracks (AUTO).
+ *
+ * A lower duty moves the panel towards Voc and cuts the power, so both
+ * limits act as a duty ceiling on edugrid_pwm_channel: the tracker keeps
+ * running underneath and every duty source is clamped to it.  The ceiling
+ * engages at the present duty once V_out or I_out comes within
+ * CHARGE_ENGAGE_PCT of its limit, then integrates the headroom of the
+ * tighter limit by CHARGE_GAIN per fresh load reading.  It only climbs while
+ * the duty sits at it (anti-windup) and releases once it is back at the
+ * configured PWM border or the headroom reaches CHARGE_RELEASE_PCT.  While
+ * a limit holds, the channel runs the sweep acquisition profile
+ * (edugrid_measurement::profileFor()), so every control pass brings a new
+ * reading and is one step; the ceiling goes to the PWM in fine duty, not
+ * whole percent.
+ */
+class edugrid_charger
+{
+public:
+    edugrid_charger(edugrid_meas_channel& meas, edugrid_pwm_channel& pwm, const edugrid_mpp_tracker& mppt);
+
+    void          setIndex(uint8_t index) { _index = index; }
+
+    /** Limits on the load side, 0 = off (see edugrid_config) */
+    void          setLimits(float v_max, float i_max);
+    float         vMax(void) const { return _v_max; }
+    float         iMax(void) const { return _i_max; }
+    bool          enabled(void) const { return _v_max > 0.0f || _i_max > 0.0f; }
+
+    /** One control pass, after the measurement and before the tracker */
+    void          service(void);
+
+    ChargeState_t state(void) const { return _state; }
+    /** Duty ceiling in force [%], the PWM border while CHARGE_MPPT */
+    float         ceiling(void) const { return _ceiling; }
+
+    static const char* stateToStr(ChargeState_t state);
+
+private:
+    bool          _tracking(void) const;
+    void          _release(void);
+
+    edugrid_meas_channel&      _meas;
+    edugrid_pwm_channel&       _pwm;
+    const edugrid_mpp_tracker& _mppt;
+    uint8_t       _index;
+
+    float         _v_max;
+    float         _i_max;
+
+    ChargeState_t _state;
+    float         _ceiling;         // [%], integrates the headroom
+    uint32_t      _last_ms;         // last step (one per fresh reading)
+};
+
+#endif /* EDUGRID_CHARGER_H_ */
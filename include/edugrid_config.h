@@ -0,0 +1,189 @@
+/*************************************************************************
+ * @file edugrid_config.h
+ * @date 2026/10/18
+ * @brief Versioned configuration blob, cached in RAM, CRC-checked on flash
+ ************************************************************************/
+
+#ifndef EDUGRID_CONFIG_H_
+#define EDUGRID_CONFIG_H_
+
+/*************************************************************************
+ * Include
+ ************************************************************************/
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <edugrid_states.h>
+
+/*************************************************************************
+ * Define
+ ************************************************************************/
+#define CONFIG_FILEPATH_BLOB        ("/config/edugrid.cfg")
+#define CONFIG_FILEPATH_BLOB_TMP    ("/config/edugrid.cfg.tmp")
+
+#define EDUGRID_CONFIG_MAGIC        (0x47434445UL)  /* "EDCG" (little endian) */
+#define EDUGRID_CONFIG_VERSION      (11)  /* v2: settle_cal_interval_s, v3: sweep/display INA profiles,
+                                             v4: adaptive IV sweep, v5: background IV sweep,
+                                             v6: steady-state hold, v7: V_ref cascade,
+                                             v8: CC/CV charge limits, v9: P_out objective,
+                                             v10: duty dithering, v11: dP-P&O */
+
+#define EDUGRID_CONFIG_SSID_LEN     (33)    /* 32 chars + NUL (802.11 limit) */
+#define EDUGRID_CONFIG_PW_LEN       (65)    /* 64 chars + NUL (WPA2 limit) */
+#define EDUGRID_CONFIG_PATH_LEN     (48)
+
+/* Defaults used when neither the blob nor the legacy text files exist */
+#define EDUGRID_CONFIG_DEFAULT_SSID     ("edugrid")
+#define EDUGRID_CONFIG_DEFAULT_PW       ("123456789")
+#define EDUGRID_CONFIG_DEFAULT_LOGNAME  ("/log/log.csv")
+
+/* Runtime limits for the tunable knobs (PUT /api/config is validated
+   against these before anything is applied or written) */
+#define CONFIG_MPPT_STEP_MAX_PCT        (10)
+#define CONFIG_MPP_EPS_MAX_W            (5.0f)
+#define CONFIG_SETTLE_MAX_MS            (2000)
+#define CONFIG_SETTLE_CAL_MIN_S         (60)    /* 0 = automatic runs off */
+#define CONFIG_IV_BG_MIN_S              (60)    /* 0 = background sweeps off */
+#define CONFIG_VREF_KP_MAX              (20.0f)  /* [%/V] */
+#define CONFIG_VREF_KI_MAX              (500.0f) /* [%/(V*s)] */
+#define CONFIG_VREF_STEP_MIN_V          (0.01f)
+#define CONFIG_VREF_STEP_MAX_V          (2.0f)
+#define CONFIG_CHARGE_V_MAX             (85.0f)  /* [V] INA228 bus input range */
+#define CONFIG_WS_PUSH_MIN_MS           (20)
+#define CONFIG_WS_PUSH_MAX_MS           (5000)
+#define CONFIG_SLEW_INTERVAL_MAX_MS     (1000)
+
+/* Every dwell waits one step period (window + settle) whatever its duty
+   step, so the P&O step needs no relation to the IV sweep spacing; only
+   its default has to pass _validate() */
+#if (MPPT_DUTY_STEP_PCT < 1) || (MPPT_DUTY_STEP_PCT > CONFIG_MPPT_STEP_MAX_PCT)
+#error "MPPT_DUTY_STEP_PCT must lie within 1..CONFIG_MPPT_STEP_MAX_PCT"
+#endif
+
+/*************************************************************************
+ * Types
+ ************************************************************************/
+
+/** On-flash header in front of the payload. `size` is the payload size the
+ *  blob was written with, so older (shorter) payloads can be upgraded. */
+struct EdugridConfigHeader_t
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t size;
+    uint32_t crc;       ///< CRC-32 over the payload bytes
+};
+
+/** Configuration payload.
+ *  Only ever APPEND fields and bump EDUGRID_CONFIG_VERSION; an older blob
+ *  keeps the compiled defaults for every field beyond its stored size.
+ */
+struct EdugridConfig_t
+{
+    /* ----- Network / storage ----- */
+    char     wlan_ssid[EDUGRID_CONFIG_SSID_LEN];
+    char     wlan_pw[EDUGRID_CONFIG_PW_LEN];
+    char     log_name[EDUGRID_CONFIG_PATH_LEN];
+
+    /* ----- MPPT ----- */
+    uint8_t  mppt_step_pct;             ///< P&O duty step [%]
+    float    mpp_power_eps_w;           ///< dP below this keeps direction [W]
+
+    /* ----- INA228 acquisition ----- */
+    uint16_t ina_avg_samples;           ///< 1,4,16,64,128,256,512,1024
+    uint16_t ina_conv_us;               ///< 50,84,150,280,540,1052,2074,4120
+    uint16_t ina_extra_settle_ms;       ///< dwell after a duty change [ms]
+
+    /* ----- PWM / UI ----- */
+    uint8_t  pwm_min_pct;               ///< lower duty border [%]
+    uint8_t  pwm_max_pct;               ///< upper duty border [%]
+    uint8_t  manual_slew_step_pct;      ///< manual ramp step [%]
+    uint16_t manual_slew_interval_ms;   ///< manual ramp interval [ms]
+    uint16_t ws_push_interval_ms;       ///< WebSocket broadcast cadence [ms]
+
+    /* ----- v2 ----- */
+    uint16_t settle_cal_interval_s;     ///< automatic settle calibration in AUTO [s], 0 = off
+
+    /* ----- v3: INA228 profiles of IV_SWEEP and MANUAL (ina_* above is AUTO) ----- */
+    uint16_t sweep_avg_samples;
+    uint16_t sweep_conv_us;
+    uint16_t display_avg_samples;
+    uint16_t display_conv_us;
+
+    /* ----- v4: adaptive IV sweep ----- */
+    uint8_t  iv_sweep_points;           ///< point budget, IV_SWEEP_COARSE_POINTS..IV_SWEEP_POINTS
+    uint8_t  iv_sweep_bidir;            ///< 1 = coarse down pass for capacitive hysteresis
+
+    /* ----- v5: background IV sweep from AUTO ----- */
+    uint16_t iv_bg_interval_s;          ///< [s], 0 = off
+    uint8_t  iv_bg_points;              ///< point budget, IV_SWEEP_COARSE_POINTS..IV_SWEEP_POINTS
+
+    /* ----- v6 ----- */
+    uint8_t  mppt_freeze;               ///< 1 = hold the duty when P&O only dithers
+
+    /* ----- v7: voltage-reference cascade in AUTO ----- */
+    uint8_t  mppt_vref;                 ///< 1 = P&O on a V_in reference held by a PI loop
+    float    vref_kp;                   ///< [%/V]
+    float    vref_ki;                   ///< [%/(V*s)]
+    float    vref_step_v;               ///< P&O step of the reference [V]
+
+    /* ----- v8: battery charging ----- */
+    float    charge_v_max;              ///< CV limit on V_out [V], 0 = off
+    float    charge_i_max;              ///< CC limit on I_out [A], 0 = off
+
+    /* ----- v9 ----- */
+    float    mppt_pout_weight;          ///< P&O objective, 0 = P_in .. 1 = P_out
+
+    /* ----- v10 ----- */
+    uint8_t  pwm_dither;                ///< 1 = fractional LEDC duty (sub-tick)
+
+    /* ----- v11 ----- */
+    uint8_t  mppt_drift;                ///< 1 = take the environment's drift out of dP
+};
+
+/*************************************************************************
+ * Class
+ ************************************************************************/
+
+/**
+ * Class with static members holding the one and only configuration copy.
+ *
+ * The blob is read once during setup(); every later read comes from RAM.
+ * Writes go to a temporary file first and are renamed over the live blob,
+ * so a power cut leaves either the old or the new configuration on flash.
+ */
+class edugrid_config
+{
+public:
+    static void load(void);
+
+    // The running configuration, unguarded: only for setup() and the web
+    // task, the one task that commits.  Every other task takes a snapshot().
+    static const EdugridConfig_t& get(void);
+    static void snapshot(EdugridConfig_t& out);
+
+    // Validate, persist and apply a complete configuration.  Returns false
+    // (and leaves the running config untouched) if validation fails.
+    static bool commit(const EdugridConfig_t& cfg, String* err = nullptr);
+
+    // Hand the tunable knobs to the running modules (no reboot needed); the
+    // control task takes them over between passes.
+    static void apply(void);
+
+    // JSON mapping used by GET/PUT /api/config.  PUT bodies may be partial;
+    // keys that are absent keep their current value.
+    static void toJson(JsonObject obj);
+    static bool patchFromJson(JsonVariantConst json, EdugridConfig_t& cfg, String* err);
+
+    static void setWiFiCredentials(const String& ssid, const String& pw);
+
+private:
+    static void _setDefaults(EdugridConfig_t& cfg);
+    static void _importLegacyFiles(EdugridConfig_t& cfg);
+    static bool _readBlob(const char* path, EdugridConfig_t& cfg);
+    static bool _writeBlob(const EdugridConfig_t& cfg);
+    static bool _validate(const EdugridConfig_t& cfg, String* err);
+
+    static EdugridConfig_t _cfg;
+};
+
+#endif /* EDUGRID_CONFIG_H_ */
@@ -0,0 +1,138 @@
+/*************************************************************************
+ * @file edugrid_energy.h
+ * @date 2026/10/18
+ * @brief Energy / charge totals from the INA228 accumulators, kept in flash
+ ************************************************************************/
+
+#ifndef EDUGRID_ENERGY_H_
+#define EDUGRID_ENERGY_H_
+
+/*************************************************************************
+ * Include
+ ************************************************************************/
+#include <Arduino.h>
+#include <edugrid_states.h>
+#include <edugrid_meas_channel.h>
+
+/*************************************************************************
+ * Define
+ ************************************************************************/
+#define ENERGY_READ_MS            (1000UL)   /* accumulator read interval */
+#define ENERGY_RESET_COUNTS       (1ULL << (INA_ACC_BITS - 2))  /* zero the device past a quarter turn */
+#define ENERGY_SAVE_MS            (15UL * 60UL * 1000UL)         /* flash write at most this often */
+#define ENERGY_UNIX_VALID_S       (1600000000UL)   /* anything earlier: clock never set */
+#define ENERGY_UTC_OFFSET_MAX_MIN (14 * 60)
+
+/* File layout (/config/energy.bin): EnergyFileHeader_t, then one
+ * EnergyTotals_t per channel, little endian, CRC-32 over everything with
+ * crc = 0.  A file for another channel count is ignored. */
+#define ENERGY_FILEPATH           ("/config/energy.bin")
+#define ENERGY_FILEPATH_TMP       ("/config/energy.bin.tmp")
+#define ENERGY_MAGIC              (0x4E454745UL)  /* "EGEN" (little endian) */
+#define ENERGY_VERSION            (1)
+
+/*************************************************************************
+ * Types
+ ************************************************************************/
+/** Through one INA228 */
+struct EnergyCount_t
+{
+    double wh;
+    double ah;
+};
+
+struct EnergyPeriod_t
+{
+    EnergyCount_t pv;
+    EnergyCount_t load;
+};
+
+struct EnergyTotals_t
+{
+    uint32_t       day;         ///< local day number of `today` (days since 1970), 0 = clock never set
+    uint32_t       week;        ///< local week number of `this_week` (Monday based)
+    EnergyPeriod_t today;
+    EnergyPeriod_t yesterday;   ///< zero unless today directly follows it
+    EnergyPeriod_t this_week;
+    EnergyPeriod_t last_week;   ///< zero unless this week directly follows it
+    EnergyPeriod_t lifetime;
+};
+
+struct EnergyFileHeader_t
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t size;              ///< header + totals [bytes]
+    uint8_t  channels;
+    uint8_t  reserved;
+    int16_t  utc_offset_min;    ///< local time against UTC, from /api/time
+    uint32_t crc;
+};
+
+/*************************************************************************
+ * Class
+ ************************************************************************/
+
+/**
+ * Energy and charge of one converter channel, PV and load side.
+ *
+ * Both INA228s integrate every conversion in hardware (ENERGY, CHARGE).
+ * Every ENERGY_READ_MS the control task reads them and adds the difference
+ * to the last read, modulo the 40 bit range, to the totals; the software
+ * zero-current offset is taken off over the same interval.  A device past
+ * ENERGY_RESET_COUNTS is zeroed right after its read, so even a long run of
+ * failed reads never hides a full turn (the counts of the few us between
+ * read and reset are lost).
+ *
+ * The days and weeks follow the wall clock the UI sets through /api/time
+ * (local time via the browser's UTC offset).  Until the clock is set
+ * everything counts into the stored day; the first valid clock either
+ * continues that day or rolls it over.  The totals go to flash from
+ * loop() at most every ENERGY_SAVE_MS and right after a day rolled over, so
+ * a power cut loses at most that much.
+ */
+class edugrid_energy
+{
+public:
+    explicit edugrid_energy(edugrid_meas_channel& meas);
+
+    void              setIndex(uint8_t index) { _index = index; }
+
+    /** Read the accumulators when due and add to the totals (control task) */
+    void              service(void);
+
+    /** Both devices answered the last read */
+    bool              hardwareOk(void) const { return _hw_ok; }
+
+    /** Copy of one channel's totals */
+    static void       totals(uint8_t ch, EnergyTotals_t& out);
+
+    /** Set the wall clock; utc_offset_min is local time minus UTC */
+    static void       setClock(uint32_t unix_s, int16_t utc_offset_min);
+    static bool       clockValid(void);
+    static int16_t    utcOffsetMin(void);
+
+    /** Read ENERGY_FILEPATH into the totals (setup(), after the FS) */
+    static void       loadAll(void);
+    /** Write the totals when due (loop()) */
+    static void       saveAll(void);
+
+private:
+    struct Side_t
+    {
+        bool              valid;      // `last` holds a reading
+        InaAccumulators_t last;
+        uint32_t          ms;         // of `last`
+    };
+
+    bool              _readSide(bool load, uint32_t now, EnergyCount_t& add);
+
+    edugrid_meas_channel& _meas;
+    uint8_t           _index;
+    bool              _started;
+    uint32_t          _read_ms;
+    bool              _hw_ok;
+    Side_t            _side[2];       // PV, load
+};
+
+#endif /* EDUGRID_ENERGY_H_ */
@@ -18,7 +18,8 @@
  * Define
  ************************************************************************/
 
-/* Paths according to the LittleFS filesystem */
+/* Legacy per-setting text files; only read once to seed the config blob
+ * (see edugrid_config.h) */
 #define CONFIG_FILEPATH_SSID                        ("/config/ssid.config")
 #define CONFIG_FILEPATH_PW                          ("/config/password.config")
 #define CONFIG_FILEPATH_LOGNAME                     ("/config/logname.config")
@@ -40,19 +41,14 @@ public:
     static int get_filesystem_state();
     static String getContent_str(String path);
     static int getContent_int(String path);
-    static void loadConfig();
     static void writeContent_str(String path, String content, bool appending=false);
-    static void setWiFiCredentials(String ssid, String pw);
-    static String config_wlan_ssid;
-    static String config_wlan_pw;
-    static String config_log_name;
+    static bool truncateFile(const char* path, size_t new_size);
 
 protected:
     static File open_file;
     static String file_content;
     static int state_filesystem;
     static bool filesystem_mounted;
-    static String json_config_str;
 };
 
 #endif /* EDUGRID_FILE_SYSTEM_H_ */
\ No newline at end of file
@@ -0,0 +1,176 @@
+/*************************************************************************
+ * @file edugrid_freq_map.h
+ * @date 2026/10/18
+ * @brief Converter efficiency over duty x switching frequency, frequency pick
+ ************************************************************************/
+
+#ifndef EDUGRID_FREQ_MAP_H_
+#define EDUGRID_FREQ_MAP_H_
+
+/*************************************************************************
+ * Include
+ ************************************************************************/
+#include <Arduino.h>
+#include <edugrid_states.h>
+#include <edugrid_meas_channel.h>
+#include <edugrid_pwm_channel.h>
+#include <edugrid_mpp_tracker.h>
+
+/*************************************************************************
+ * Define
+ ************************************************************************/
+#define FREQ_MAP_FREQS_HZ         { 20000, 30000, CONVERTER_FREQUENCY, 50000, 65000 }
+#define FREQ_MAP_NUM_FREQS        (5)
+#define FREQ_MAP_NUM_DUTIES       (8)       /* evenly over the duty window of the run */
+#define FREQ_MAP_READINGS         (3)       /* fresh readings averaged per point */
+#define FREQ_MAP_MIN_P_W          (1.0f)    /* [W] P_in below this gives no efficiency */
+#define FREQ_MAP_SELECT_MS        (5000UL)  /* re-pick the frequency at most this often */
+#define FREQ_MAP_HYST             (0.005f)  /* switch only for this much more efficiency */
+
+/* File layout (/config/effmap.bin): FreqMapHeader_t, then one
+ * FreqMapTable_t per channel, little endian, CRC-32 over everything with
+ * crc = 0.  A file of other dimensions or frequencies is ignored. */
+#define FREQ_MAP_FILEPATH         ("/config/effmap.bin")
+#define FREQ_MAP_FILEPATH_TMP     ("/config/effmap.bin.tmp")
+#define FREQ_MAP_MAGIC            (0x4D464745UL)  /* "EGFM" (little endian) */
+#define FREQ_MAP_VERSION          (1)
+
+/*************************************************************************
+ * Types
+ ************************************************************************/
+enum FreqMapResult_t : uint8_t
+{
+    FREQ_MAP_OK = 0,
+    FREQ_MAP_NO_POWER,       ///< too few points above FREQ_MAP_MIN_P_W
+    FREQ_MAP_ABORTED,        ///< mode / duty changed or sensor lost during the run
+    FREQ_MAP_NEVER           ///< no run finished since boot
+};
+
+/** Trace events (a8 of TRACE_EV_FREQ_MAP) */
+enum FreqMapEvent_t : uint8_t
+{
+    FREQ_MAP_EV_RUN = 0,     ///< run finished: a16 = FreqMapResult_t, a32 = duration [ms]
+    FREQ_MAP_EV_SELECT       ///< frequency picked: a16 = new [100 Hz], a32 = old [Hz]
+};
+
+/** One point of the map; eff = 0 means not measured */
+struct FreqMapCell_t
+{
+    float eff;              ///< P_out / P_in
+    float p_in;             ///< [W] when it was measured
+};
+
+struct FreqMapTable_t
+{
+    uint32_t      unix_s;   ///< wall clock of the run, 0 if it was not set
+    uint8_t       valid;
+    uint8_t       reserved[3];
+    uint8_t       duty[FREQ_MAP_NUM_DUTIES];                        ///< [%] rising
+    FreqMapCell_t cell[FREQ_MAP_NUM_DUTIES][FREQ_MAP_NUM_FREQS];
+};
+
+struct FreqMapHeader_t
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t size;          ///< header + tables [bytes]
+    uint8_t  channels;
+    uint8_t  n_duty;
+    uint8_t  n_freq;
+    uint8_t  reserved;
+    uint32_t freq_hz[FREQ_MAP_NUM_FREQS];
+    uint32_t crc;
+};
+
+/*************************************************************************
+ * Class
+ ************************************************************************/
+
+/**
+ * Efficiency map and frequency selection of one converter channel.
+ *
+ * A run (on request only) pauses the tracker and visits FREQ_MAP_NUM_DUTIES
+ * duties across the duty window; at each duty it steps through every
+ * frequency of FREQ_MAP_FREQS_HZ back to back, so a slow change of the
+ * irradiance hardly shows between the frequencies being compared.  Every
+ * point waits one step period, then averages P_out / P_in over
+ * FREQ_MAP_READINGS fresh readings of both INAs.  The finished map goes to
+ * a RAM copy at once and to flash from loop() via saveAll().
+ *
+ * While no run is active and the mode is not IV_SWEEP, service() looks up
+ * the efficiency of every frequency at the present P_in (interpolated along
+ * the measured P_in of each column) and switches to the best one, with
+ * FREQ_MAP_HYST against toggling.  Without a valid map the frequency stays
+ * at CONVERTER_FREQUENCY.
+ */
+class edugrid_freq_map
+{
+public:
+    edugrid_freq_map(edugrid_meas_channel& meas, edugrid_pwm_channel& pwm, edugrid_mpp_tracker& mppt);
+
+    void              setIndex(uint8_t index) { _index = index; }
+
+    /** Measure a new map as soon as the channel allows it */
+    void              request(void) { _requested = true; }
+
+    /** Pick the frequency from the map in normal operation */
+    void              setSelect(bool enabled) { _select = enabled; }
+    bool              getSelect(void) const   { return _select; }
+
+    /** Advance a run or re-pick the frequency (control task, before the tracker) */
+    void              service(void);
+
+    /** True while a run owns duty and frequency; the tracker must not step then */
+    bool              active(void) const { return _phase != Phase::Idle; }
+    /** Points done in the running run, of FREQ_MAP_NUM_DUTIES * FREQ_MAP_NUM_FREQS */
+    uint8_t           progress(void) const { return _point; }
+
+    FreqMapResult_t   lastResult(void) const { return _result; }
+    /** Map efficiency of the frequency in use at the present P_in, NAN without one */
+    float             expectedEff(void) const;
+
+    /** Copy of this channel's map (false: never measured or loaded) */
+    bool              table(FreqMapTable_t& out) const;
+
+    static uint32_t   frequencyHz(uint8_t k);
+    static const char* resultToStr(FreqMapResult_t result);
+
+    /** Read FREQ_MAP_FILEPATH into the RAM copies (setup(), after the FS) */
+    static void       loadAll(void);
+    /** Write the RAM copies once a run changed them (loop()) */
+    static void       saveAll(void);
+
+private:
+    enum class Phase : uint8_t { Idle = 0, Settle, Measure, Release };
+
+    bool              _shouldStart(void) const;
+    void              _start(uint32_t now);
+    void              _applyPoint(uint32_t now);
+    void              _finish(FreqMapResult_t result);
+    void              _selectFrequency(void);
+    float             _effAt(const FreqMapTable_t& t, uint8_t f, float p_in) const;
+
+    edugrid_meas_channel& _meas;
+    edugrid_pwm_channel&  _pwm;
+    edugrid_mpp_tracker&  _mppt;
+    uint8_t           _index;
+
+    volatile bool     _requested;
+    bool              _select;
+
+    Phase             _phase;
+    uint32_t          _phase_ms;
+    uint32_t          _start_ms;
+    uint8_t           _point;          // duty index * FREQ_MAP_NUM_FREQS + freq index
+    uint8_t           _readings;
+    float             _sum_in, _sum_out;
+    uint8_t           _saved_duty;
+    float             _saved_freq;
+    OperatingModes_t  _saved_mode;
+    FreqMapTable_t    _run;            // being measured
+
+    FreqMapResult_t   _result;
+    uint32_t          _select_ms;
+};
+
+#endif /* EDUGRID_FREQ_MAP_H_ */
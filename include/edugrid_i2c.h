@@ -0,0 +1,136 @@
+/*************************************************************************
+ * @file edugrid_i2c.h
+ * @date 2026/10/18
+ * @brief Shared I2C bus: polled INA228 reads off the control task, bus lock and recovery
+ ************************************************************************/
+
+#ifndef EDUGRID_I2C_H_
+#define EDUGRID_I2C_H_
+
+/*************************************************************************
+ * Include
+ ************************************************************************/
+#include <Arduino.h>
+#include <edugrid_states.h>
+
+/*************************************************************************
+ * Define
+ ************************************************************************/
+#define I2C_CLOCK_HZ              (400000UL)
+#define I2C_TIMEOUT_MS            (10)      /* per transaction; the Wire default is 50 ms */
+#define I2C_POLL_MS               (2)       /* a channel is read this often while its next conversion is due */
+#define I2C_POLL_LEAD_PCT         (10)      /* ... starting this share of the window early (device time base) */
+#define I2C_RECOVER_ERRORS        (3)       /* failed reads in a row of one device before a bus recovery */
+#define I2C_RECOVER_HOLDOFF_MS    (1000UL)  /* at most one recovery this often (a device that is gone) */
+#define I2C_RECOVER_CLOCKS        (9)       /* SCL pulses: enough to finish any byte a device still sends */
+#define I2C_TASK_STACK            (3072)
+#define I2C_TASK_PRIORITY         (2)       /* above the control task; it waits on the bus, not the CPU */
+#define I2C_TASK_CORE             (1)
+
+/* The polled reads run in a task of their own where the firmware has a
+ * second core.  The single threaded benches read synchronously in
+ * edugrid_meas_channel::update() instead, so their timing stays exact. */
+#if CONFIG_FREERTOS_UNICORE == 0
+#define EDUGRID_I2C_ASYNC         (1)
+/* Oldest a polled reading can be when the control task takes it: one poll
+ * period plus the reads of every channel (well below 1 ms per INA pair),
+ * as long as the worker keeps in step with the conversions */
+#define I2C_SAMPLE_AGE_MS         (I2C_POLL_MS + EDUGRID_NUM_CHANNELS)
+#else
+#define EDUGRID_I2C_ASYNC         (0)
+#define I2C_SAMPLE_AGE_MS         (0)
+#endif
+
+/*************************************************************************
+ * Types
+ ************************************************************************/
+/** Polled reads of one INA228 (written by the worker only) */
+struct I2cDeviceStats_t
+{
+    uint32_t reads;          ///< VBUS + CURRENT pairs attempted
+    uint32_t errors;         ///< NACK, short read or timeout
+    uint32_t timeouts;       ///< of `errors`: ran into I2C_TIMEOUT_MS
+    uint16_t consecutive;    ///< errors since the last good read
+    uint16_t us_max;         ///< slowest good read [us]
+    uint32_t last_ok_ms;     ///< millis() of the last good read
+};
+
+struct I2cBusStats_t
+{
+    bool     async;          ///< the worker runs (false: reads inside the control task)
+    uint32_t cycles;         ///< worker passes with a channel due
+    uint32_t skipped;        ///< channel reads left out while a burst held the bus
+    uint32_t unchanged;      ///< channel reads that found no new conversion yet
+    uint32_t cycle_us;       ///< last pass
+    uint32_t cycle_us_max;
+    uint32_t recoveries;
+    uint32_t recover_ms;     ///< millis() of the last recovery
+};
+
+/*************************************************************************
+ * Class
+ ************************************************************************/
+
+/**
+ * Class with static members for the I2C bus all INA228s share.
+ *
+ * Once start()ed, a worker task reads VBUS and CURRENT of both devices of
+ * a channel back to back and publishes the completed pair
+ * (edugrid_meas_channel::poll()); the control task only takes the newest
+ * one and never waits on the bus for its readings.  The results change
+ * once per averaging window, so the worker keeps in step with them: a read
+ * that finds a new conversion puts the channel to sleep until
+ * I2C_POLL_LEAD_PCT of its window before the next one, then it reads every
+ * I2C_POLL_MS until that one is in.  Results that stay put as long past
+ * the expected conversion (inputs at a standstill) start the wait over
+ * from that read, and a reconfiguration (edugrid_meas_channel::configure())
+ * wakes the worker to find the conversions again.
+ *
+ * A device whose reads fail I2C_RECOVER_ERRORS times in a row gets the bus
+ * recovered: the driver stops, SCL clocks out whatever a device still
+ * holds SDA low for, a STOP follows and the driver starts again.  The
+ * devices keep their configuration through that.
+ *
+ * Every other bus access (configuration, alert flags, accumulators,
+ * calibration and the settle / scope bursts) holds edugrid_i2c_lock, so it
+ * never interleaves with a polled read; the lock is recursive.
+ */
+class edugrid_i2c
+{
+public:
+    /** Start Wire on PIN_I2C_SDA / PIN_I2C_SCL (setup(), before the devices) */
+    static void begin(void);
+
+    /** Start the worker (setup(), once the devices are configured) */
+    static void start(void);
+
+    /** The worker publishes the readings */
+    static bool running(void);
+
+    /** The conversions of a channel restarted (new averaging setting): read
+     *  every channel again until it is back in step */
+    static void wake(void);
+
+    static void lock(void);
+    static void unlock(void);
+
+    static void stats(I2cBusStats_t& out);
+
+private:
+    static void _pollTask(void* arg);
+    static void _serviceRecovery(uint32_t now);
+    static bool _recoverBus(void);
+};
+
+/** Holds the bus for the scope of the object */
+class edugrid_i2c_lock
+{
+public:
+    edugrid_i2c_lock(void)  { edugrid_i2c::lock(); }
+    ~edugrid_i2c_lock(void) { edugrid_i2c::unlock(); }
+
+    edugrid_i2c_lock(const edugrid_i2c_lock&) = delete;
+    edugrid_i2c_lock& operator=(const edugrid_i2c_lock&) = delete;
+};
+
+#endif /* EDUGRID_I2C_H_ */
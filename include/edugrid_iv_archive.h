@@ -0,0 +1,139 @@
+/*************************************************************************
+ * @file edugrid_iv_archive.h
+ * @date 2026/10/18
+ * @brief History of finished IV sweeps (RAM ring + LittleFS /ivs)
+ ************************************************************************/
+
+#ifndef EDUGRID_IV_ARCHIVE_H_
+#define EDUGRID_IV_ARCHIVE_H_
+
+/*************************************************************************
+ * Include
+ ************************************************************************/
+#include <Arduino.h>
+#include <edugrid_states.h>
+#include <edugrid_mpp_tracker.h>
+
+/*************************************************************************
+ * Define
+ ************************************************************************/
+#define IV_ARCHIVE_DIR           ("/ivs")
+#define IV_ARCHIVE_RAM_SLOTS     (8)       /* newest sweeps kept in RAM (~600 B each) */
+#define IV_ARCHIVE_MAX_FILES     (64)      /* oldest file removed beyond this (~40 KB) */
+#define IV_ARCHIVE_FULL_SCALE    (32000)   /* counts of the largest V / I of a sweep */
+#define IV_ARCHIVE_DIFF_POINTS   (16)      /* voltage grid of a diff */
+
+/* File layout (one file per sweep, /ivs/<seq, 8 digits>.ivb):
+ *   IvArchiveHeader_t, then `n` IvArchivePoint_t, little endian.
+ * GET /api/ivs?seq=N&raw=1 returns these bytes unchanged. */
+#define IV_ARCHIVE_MAGIC         (0x56494745UL)  /* "EGIV" (little endian) */
+#define IV_ARCHIVE_VERSION       (1)
+#define IV_ARCHIVE_TEMP_UNKNOWN  (INT16_MIN)     /* no module temperature sensor */
+#define IV_ARCHIVE_PT_DOWN       (0x01)          /* point flag: down pass */
+
+/*************************************************************************
+ * Types
+ ************************************************************************/
+
+/** One stored point: V and I in counts of the sweep's LSB */
+struct IvArchivePoint_t
+{
+    int16_t v;
+    int16_t i;
+    uint8_t duty;           ///< [%]
+    uint8_t flags;          ///< IV_ARCHIVE_PT_*
+};
+
+struct IvArchiveHeader_t
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t size;          ///< header + points [bytes]
+    uint32_t seq;           ///< unique across reboots, increasing
+    uint32_t uptime_ms;     ///< millis() when the sweep finished
+    uint32_t unix_s;        ///< wall clock, 0 if it was not set
+    uint8_t  ch;
+    uint8_t  n;             ///< points stored
+    uint8_t  n_up;          ///< of which up pass, sorted by duty
+    uint8_t  reserved0;
+    int16_t  temp_c10;      ///< module temperature [0.1 degC] or IV_ARCHIVE_TEMP_UNKNOWN
+    uint16_t reserved1;
+    uint32_t duration_ms;
+    float    v_lsb;         ///< [V] per count
+    float    i_lsb;         ///< [A] per count
+    float    voc;           ///< [V]  extracted from the full-resolution points
+    float    isc;           ///< [A]
+    float    vmp;           ///< [V]
+    float    imp;           ///< [A]
+    uint32_t crc;           ///< CRC-32 over header (crc = 0) and points
+};
+
+struct IvArchiveRecord_t
+{
+    IvArchiveHeader_t hdr;
+    IvArchivePoint_t  pts[IV_SWEEP_POINTS];
+};
+
+static_assert(sizeof(IvArchivePoint_t) == 6, "archive point layout is part of the file format");
+static_assert(sizeof(IvArchiveHeader_t) == 60, "archive header layout is part of the file format");
+
+/** Two sweeps compared: b minus a */
+struct IvArchiveDiff_t
+{
+    float d_voc, d_isc, d_vmp, d_imp, d_pmp, d_ff;      ///< absolute
+    float r_isc, r_pmp;                                 ///< b / a (soiling shows in both)
+    float rs_a, rs_b;                                   ///< -dV/dI near Voc [ohm] (series resistance)
+    float v[IV_ARCHIVE_DIFF_POINTS];                    ///< common voltage grid
+    float di[IV_ARCHIVE_DIFF_POINTS];                   ///< I_b - I_a on it, NAN outside either sweep
+    uint8_t n;                                          ///< grid points used
+};
+
+/*************************************************************************
+ * Class
+ ************************************************************************/
+
+/**
+ * Class with static members keeping finished IV sweeps.
+ *
+ * capture() runs in the control task when a sweep completes: it extracts
+ * Voc/Isc/Vmp/Imp, scales the points to int16 and puts the record into a
+ * RAM ring (a few microseconds, no flash).  service() in loop() writes new
+ * records to IV_ARCHIVE_DIR and removes the oldest files beyond
+ * IV_ARCHIVE_MAX_FILES.  Lookups check the ring before the files.
+ */
+class edugrid_iv_archive
+{
+public:
+    // Scan IV_ARCHIVE_DIR for the next sequence number (setup(), after the FS).
+    static void     init(void);
+
+    static void     capture(uint8_t ch, const edugrid_mpp_tracker& mppt);
+    static void     service(void);
+
+    // Record by sequence number from the ring or flash (CRC checked).
+    static bool     load(uint32_t seq, IvArchiveRecord_t& out);
+
+    // Headers oldest -> newest, files and not yet written ring entries; the
+    // callback returns false to stop.
+    static void     forEach(bool (*fn)(const IvArchiveHeader_t& hdr, bool in_flash, void* ctx), void* ctx);
+
+    static bool     diff(const IvArchiveRecord_t& a, const IvArchiveRecord_t& b, IvArchiveDiff_t& out);
+
+    // Point k of a record in physical units.
+    static void     point(const IvArchiveRecord_t& rec, uint8_t k, float& v, float& i);
+    static float    fillFactor(const IvArchiveHeader_t& hdr);
+    static float    seriesResistance(const IvArchiveRecord_t& rec);
+
+    static uint32_t nextSeq(void) { return _next_seq; }
+
+private:
+    static void     _path(uint32_t seq, char* out, size_t len);
+    static bool     _readFile(uint32_t seq, IvArchiveRecord_t& out);
+    static uint32_t _crc(const IvArchiveRecord_t& rec);
+
+    static uint32_t _next_seq;
+    static uint32_t _oldest_file_seq;
+    static uint16_t _file_count;
+};
+
+#endif /* EDUGRID_IV_ARCHIVE_H_ */
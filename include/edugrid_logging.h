@@ -21,9 +21,56 @@
 #define EDUGRID_LOGGING_CSV_DELIMITER (";")
 #define EDUGRID_LOGGING_MAX_MESSAGES_IN_BUFFER (100) // write every 100 messages to flash
 #define EDUGRID_LOGGING_MAX_TIME_MS (15 * 60 * 1000) // 15 min = 900 s = 900,000 ms
-/* Log size for 15 min = 18.57 KB
+/* Log size for 15 min = 18.57 KB (+ one ~24 B trailer per 100 rows,
+ * + 14 B per row once the tracking efficiency columns are filled)
  */
 
+/* Crash-safe framing
+ * The file starts with EDUGRID_LOGGING_FILE_HEADER.  Every flushed block of
+ * rows is followed by a trailer line "#B;<seq>;<rows>;<crc32 hex>" where the
+ * CRC-32 covers the block's row bytes (including '\n').  At boot,
+ * recoverLogFile() truncates the file after the last block whose trailer
+ * matches, so a half-written block never leaves a corrupt tail.
+ * A file without the header (older firmware) is moved to
+ * <name>EDUGRID_LOGGING_LEGACY_SUFFIX and a framed file is started.
+ */
+#define EDUGRID_LOGGING_FILE_HEADER   ("#EDUGRID-LOG;v1")
+#define EDUGRID_LOGGING_TRAILER_TAG   ("#B;")
+#define EDUGRID_LOGGING_LEGACY_SUFFIX (".old")  /* an unframed log is moved here */
+#define EDUGRID_LOGGING_MAX_LINE_LEN  (96)
+
+/* Keep the unflushed rows in RTC slow memory so a soft reset (panic, WDT,
+ * ESP.restart()) does not lose them; they are written as a recovered block
+ * on the next boot.  Comment out to stage in normal RAM instead. */
+#define EDUGRID_LOGGING_RTC_STAGING
+#define EDUGRID_LOGGING_STAGING_MAGIC (0x32475247UL)  /* "GRG2": LogRow_t with teff */
+
+/*************************************************************************
+ * Types
+ ************************************************************************/
+
+/** One logged sample, kept binary until its block is flushed */
+struct LogRow_t
+{
+    uint32_t idx;
+    float    vin;
+    float    vout;
+    float    iin;
+    float    iout;
+    float    teff;      ///< tracking efficiency, averaged (NAN: no IV sweep yet)
+    float    teff_cum;  ///< ... since boot
+};
+
+/** Staging area for the block that is currently being filled */
+struct LogStaging_t
+{
+    uint32_t magic;
+    uint32_t seq;       ///< sequence number the block will be written with
+    uint32_t count;     ///< rows staged
+    uint32_t crc;       ///< CRC-32 over rows[0..count)
+    LogRow_t rows[EDUGRID_LOGGING_MAX_MESSAGES_IN_BUFFER];
+};
+
 /*************************************************************************
  * Class
  ************************************************************************/
@@ -37,18 +84,31 @@ public:
     static void deactivateLogging();
     static void toggleLogging();
 
-    // Append a single CSV row (Vin, Vout, Iin, Iout).  The helper takes care of
-    // buffering and flashing the data in blocks so the main loop only needs to
-    // call it once per second.
-    static void appendLog(float vin, float vout, float iin, float iout);
+    // Append a single CSV row (Vin, Vout, Iin, Iout, tracking efficiency now
+    // and since boot; both empty before the first IV sweep).  The helper takes
+    // care of buffering and flashing the data in blocks so the main loop only
+    // needs to call it once per second.
+    static void appendLog(float vin, float vout, float iin, float iout, float teff, float teff_cum);
+
+    // Boot-time check of the log file: drop a corrupt/partial tail and write
+    // rows that survived a soft reset in the staging area.  Call once from
+    // setup() after edugrid_config::load().
+    static void recoverLogFile();
+
+    // Format one row exactly as it is stored in the CSV file.
+    static size_t formatRow(char* out, size_t len, const LogRow_t& row);
 
 private:
+    static void _stageRow(const LogRow_t& row);
+    static bool _flushBlock();
+    static void _dropBlock(const char* why);
+
     static bool log_active;
     static bool safe_request;
-    static String log_message_buffer;
-    static uint8_t log_message_counter;
     static unsigned long all_messages;
     static unsigned long log_start_time;
+    static uint32_t log_block_seq;
+    static uint32_t dropped_rows;     // since boot: blocks that never reached flash
 
 protected:
 };
@@ -0,0 +1,187 @@
+/*************************************************************************
+ * @file edugrid_meas_channel.h
+ * @date 2026/10/18
+ * @brief One converter's INA228 pair (PV side + load side)
+ ************************************************************************/
+
+#ifndef EDUGRID_MEAS_CHANNEL_H_
+#define EDUGRID_MEAS_CHANNEL_H_
+
+/*************************************************************************
+ * Include
+ ************************************************************************/
+#include <Arduino.h>
+#include <Wire.h>
+#include <edugrid_states.h>
+#include <edugrid_i2c.h>
+#include <Adafruit_INA228.h>
+
+/*************************************************************************
+ * Define
+ ************************************************************************/
+/* INA228 registers written directly (the driver has no alert-limit API) */
+#define INA_REG_DIAG_ALRT         (0x0B)
+#define INA_REG_SOVL              (0x0C)     /* shunt over-limit */
+#define INA_REG_BOVL              (0x0E)     /* bus over-limit */
+#define INA_DIAG_ALATCH           (1u << 15) /* ALERT held until DIAG_ALRT is read */
+#define INA_DIAG_SHNTOL           (1u << 6)
+#define INA_DIAG_BUSOL            (1u << 4)
+#define INA_SOVL_LSB_V            (5.0e-6f)  /* ADCRANGE 0 (driver default) */
+#define INA_BOVL_LSB_V            (3.125e-3f)
+
+/* Hardware accumulators: every conversion adds to ENERGY (40 bit, unsigned)
+ * and CHARGE (40 bit, two's complement); both wrap, RSTACC zeroes them */
+#define INA_REG_CONFIG            (0x00)
+#define INA_REG_ENERGY            (0x09)
+#define INA_REG_CHARGE            (0x0A)
+#define INA_CONFIG_RSTACC         (1u << 14) /* self-clearing */
+#define INA_ACC_BITS              (40)
+#define INA_CURRENT_LSB_A         (INA_MAX_CURRENT_A / 524288.0f)   /* setShunt(): I_max / 2^19 */
+#define INA_CHARGE_LSB_C          (INA_CURRENT_LSB_A)
+#define INA_ENERGY_LSB_J          (16.0f * 3.2f * INA_CURRENT_LSB_A)
+
+/* Result registers the polled reads decode themselves (24 bit, value in
+ * bits 23..4, CURRENT signed) so a failed read is seen as one */
+#define INA_REG_VBUS              (0x05)
+#define INA_REG_CURRENT           (0x07)
+#define INA_VBUS_LSB_V            (195.3125e-6f)
+
+/*************************************************************************
+ * Types
+ ************************************************************************/
+/** Which over-limit pulled ALERT (bit set) */
+enum InaAlertCause_t : uint8_t
+{
+  INA_ALERT_I_IN  = 1u << 0,
+  INA_ALERT_V_IN  = 1u << 1,
+  INA_ALERT_I_OUT = 1u << 2,
+  INA_ALERT_V_OUT = 1u << 3
+};
+
+/** Raw accumulator counts of one INA228 */
+struct InaAccumulators_t
+{
+  uint64_t energy;        ///< INA_ENERGY_LSB_J per count
+  int64_t  charge;        ///< INA_CHARGE_LSB_C per count, sign-extended
+};
+
+/*************************************************************************
+ * Class
+ ************************************************************************/
+
+/** edugrid_meas_channel
+ * Owns the two INA228s of one converter and the cached readings derived
+ * from them.  The control task calls update() once per pass; every other
+ * task only reads the cached values.  Once the I2C worker runs
+ * (edugrid_i2c), it reads the devices through poll() and update() only
+ * takes the newest completed pair.
+ */
+class edugrid_meas_channel
+{
+public:
+  edugrid_meas_channel(void);
+
+  /** Probe both devices.  Wire must already be running. */
+  void begin(uint8_t index, uint8_t pv_addr, uint8_t load_addr);
+
+  /** Program averaging / conversion time (values validated by the caller) */
+  void configure(uint16_t avg_samples, uint16_t conv_us);
+  uint16_t avgSamples(void) const { return _avg; }
+  uint16_t convUs(void) const     { return _conv_us; }
+
+  /** Average N readings per device into the zero-current offsets */
+  void calibrateZeroOffsets(size_t samples);
+
+  /** Take the newest readings of both devices (polled, or read here while
+   *  the I2C worker does not run), then compute powers and efficiency */
+  void update(void);
+
+  /** Read VBUS and CURRENT of both devices back to back and publish the
+   *  pair for update() (I2C worker, bus held); true if a new conversion
+   *  came in (any of the results moved) */
+  bool poll(void);
+  /** Polled reads of the PV (load = false) or load device */
+  const I2cDeviceStats_t& deviceStats(bool load) const { return _stats[load ? 1 : 0]; }
+  /** Age of the readings update() took last [ms]; 0 while read in update() */
+  uint32_t sampleAgeMs(void) const;
+
+  /** Program the over-limits of both devices (0 = off), latched and
+   *  compared on every conversion, not the average; true if both took it */
+  bool armAlerts(float i_in_max, float v_in_max, float i_out_max, float v_out_max);
+
+  /** Read the alert flags of both devices, which releases a latched ALERT;
+   *  InaAlertCause_t bits */
+  uint8_t takeAlertCause(void);
+
+  /** One direct PV read (offset applied, no clamping, cache untouched);
+   *  used by the settle calibration bursts */
+  bool samplePV(float& v, float& i);
+  /** The same for the load device (scope captures) */
+  bool sampleLoad(float& v, float& i);
+
+  /** ENERGY and CHARGE of the PV (load = false) or load device; raw, so
+   *  the zero-current offset is still in them */
+  bool readAccumulators(bool load, InaAccumulators_t& acc);
+  /** Zero ENERGY and CHARGE of one device */
+  bool resetAccumulators(bool load);
+
+  /* =============== Cached values ==================== */
+  inline float getVoltagePV(void)   const { return _v_in;  }
+  inline float getCurrentPV(void)   const { return _i_in;  }
+  inline float getPowerPV(void)     const { return _p_in;  }
+  inline float getVoltageLoad(void) const { return _v_out; }
+  inline float getCurrentLoad(void) const { return _i_out; }
+  inline float getPowerLoad(void)   const { return _p_out; }
+  inline float getEfficiency(void)  const { return _eff;   }   ///< 0..1
+
+  inline float currentOffsetPV(void)   const { return _i_in_off;  }   ///< [A]
+  inline float currentOffsetLoad(void) const { return _i_out_off; }
+
+  inline bool  sensorPvOk(void)     const { return _ok_pv;   }
+  inline bool  sensorLoadOk(void)   const { return _ok_load; }
+
+private:
+  /** Completed poll() pair, raw (no offsets) */
+  struct Polled_t
+  {
+    uint32_t seq;
+    uint32_t ms;          // millis() of the newest device read
+    float    v_in, i_in;
+    float    v_out, i_out;
+  };
+
+  void _readINA(void);
+  void _takePolled(void);
+  void _apply(float vin_raw, float iin_raw, float vout_raw, float iout_raw);
+  static bool _pollDevice(uint8_t addr, I2cDeviceStats_t& st, float& v, float& i);
+  static bool _armDevice(uint8_t addr, float i_max, float v_max);
+  static bool _writeReg(uint8_t addr, uint8_t reg, uint16_t value);
+  static bool _readReg(uint8_t addr, uint8_t reg, uint16_t& value);
+  static bool _readReg40(uint8_t addr, uint8_t reg, uint64_t& value);
+  static bool _readReg24(uint8_t addr, uint8_t reg, uint32_t& value);
+
+  uint8_t _index;
+  uint8_t _pv_addr;
+  uint8_t _load_addr;
+  uint16_t _avg;          // as last configured
+  uint16_t _conv_us;
+
+  Adafruit_INA228 _ina_pv;
+  Adafruit_INA228 _ina_load;
+  bool  _ok_pv;
+  bool  _ok_load;
+
+  float _i_in_off;        // current offset (PV)
+  float _i_out_off;       // current offset (LOAD)
+  float _vin_raw_last;    // raw PV bus (before clamping), for presence detect
+
+  Polled_t         _polled;     // written by the I2C worker (s_polledMux)
+  uint32_t         _taken_ms;   // Polled_t::ms of the pair update() took
+  I2cDeviceStats_t _stats[2];   // PV, load; written by the I2C worker
+
+  float _v_in, _i_in, _p_in;
+  float _v_out, _i_out, _p_out;
+  float _eff;
+};
+
+#endif /* EDUGRID_MEAS_CHANNEL_H_ */
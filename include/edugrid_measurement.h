@@ -14,19 +14,46 @@
 #include <Wire.h>
 #include <edugrid_states.h>
 #include <Adafruit_INA228.h>
+#include <edugrid_meas_channel.h>
+#include <edugrid_mpp_tracker.h>
+
+/*************************************************************************
+ * Types
+ ************************************************************************/
+
+/** Named INA228 acquisition profiles; each channel runs the one of its mode */
+enum AcqProfile_t : uint8_t
+{
+  ACQ_PROFILE_SWEEP = 0,    ///< IV_SWEEP, and AUTO with the V_ref cascade or a CC/CV limit: one window per pass
+  ACQ_PROFILE_TRACK,        ///< AUTO: the P&O step (ina_avg_samples / ina_conv_us)
+  ACQ_PROFILE_DISPLAY,      ///< MANUALLY: heavy averaging for the UI and the log
+  ACQ_PROFILE_COUNT,
+  ACQ_PROFILE_NONE = 0xFF   ///< channel not configured yet
+};
+
+struct AcqSetting_t
+{
+  uint16_t avg_samples;
+  uint16_t conv_us;
+};
 
 /*************************************************************************
  * Class
  ************************************************************************/
 
 /** edugrid_measurement
- * Class with static members for all measurement tasks
+ * Class with static members for all measurement tasks.
+ *
+ * The INA228 pairs live in the converter channels (edugrid_meas_channel);
+ * this class owns what they share (I2C bus, acquisition setting) and keeps
+ * the original getters, which read converter channel 0.
  */
 class edugrid_measurement{
 public:
   /**
    * @brief Initialize measurement subsystem (I2C + INA228 calibration)
-   * Call once from setup(), after Wire.begin() if you use custom pins.
+   * Call once from setup(); starts the bus (edugrid_i2c::begin()), then
+   * probes and configures the INA228 pair of every converter channel.
    */
   static void init(void);
 
@@ -38,58 +65,75 @@ public:
    * zero the readings so that the displayed current is exactly 0 A when no
    * power flows.
    *
-   * @param samples Number of readings per channel to average over.  Higher
+   * @param samples Number of readings per device to average over.  Higher
    *                values give a more stable offset at the expense of time.
+   * @param channel Converter channel, or EDUGRID_ALL_CHANNELS.
    */
-  static void calibrateZeroOffsets(size_t samples = 300);
+  static void calibrateZeroOffsets(size_t samples = 300, uint8_t channel = EDUGRID_ALL_CHANNELS);
 
   /**
-   * @brief Update all cached measurements once.
-   * Call once per MPPT loop cycle (Task 3).
-   * Reads both INA228 devices.
-   * Also computes P_in, P_out, and efficiency.
+   * @brief Apply pending acquisition settings to every channel.
+   * Called by the control task at the start of each pass, so the devices
+   * are never reconfigured in the middle of a read.
    */
-  static void getSensors(void);
+  static void serviceAcquisition(void);
 
-  /* ================= Public cached values =================
-   * These mirror the original project’s style so other modules
-   * (telemetry, logging, MPPT) can read them directly.
+  /**
+   * @brief Request a new tracking-profile setting and the configured settle.
+   *
+   * Safe to call from any task: the devices are reconfigured by the control
+   * task at the start of its next pass, which then also pushes the matching
+   * step period to every tracker.
    */
-  // Latest PV-side readings.  The variables are intentionally public so that
-  // legacy code (telemetry, logging, UI handlers) can read them without getter
-  // boilerplate.  Treat them as read-only outside this class.
-  static float V_in;    ///< PV bus voltage [V]
-  static float I_in;    ///< PV current [A]
-  static float P_in;    ///< PV power [W]
-
-  // Latest load-side readings.
-  static float V_out;   ///< Load/output voltage [V]
-  static float I_out;   ///< Load/output current [A]
-  static float P_out;   ///< Output power [W]
-
-  static float eff;     ///< Efficiency [0..1], computed as P_out / P_in
-
-  /* =============== Convenience getters ==================== */
-  static inline float getVoltagePV(void)   { return V_in;  }
-  static inline float getCurrentPV(void)   { return I_in;  }
-  static inline float getVoltageLoad(void) { return V_out; }
-  static inline float getCurrentLoad(void) { return I_out; }
+  static void requestAcquisition(uint16_t avg_samples, uint16_t conv_us, uint16_t settle_ms);
 
-private:
-  /* ================= INA228 handles & state =============== */
-  static Adafruit_INA228 _ina_pv;    ///< INA228 at INA_PV_ADDR
-  static Adafruit_INA228 _ina_load;  ///< INA228 at INA_LOAD_ADDR
+  /** Same for any profile (sweep / display settings from edugrid_config) */
+  static void requestProfile(AcqProfile_t profile, uint16_t avg_samples, uint16_t conv_us);
 
-  // Flags indicate if each INA device responded during init().  They gate the
-  // low-level reads so that one bad sensor does not crash the whole system.
-  static bool _ok_pv;
-  static bool _ok_load;
+  /* ===== Profiles ===== */
+  /** `vref`: the tracker runs the V_ref cascade, whose inner loop wants a
+   *  fresh reading every control pass; `limited`: a CC/CV ceiling holds
+   *  the duty (edugrid_charger), which regulates every pass as well */
+  static AcqProfile_t profileFor(OperatingModes_t mode, bool vref = false, bool limited = false);
+  static AcqSetting_t profileSetting(AcqProfile_t profile);
+  static const char*  profileName(AcqProfile_t profile);
 
-  /**
-   * @brief Low-level read of both INA228s into V_in/I_in and V_out/I_out.
-   * Assumes _ok_pv/_ok_load reflect successful begin().
-   */
-  static void _readINA(void);
+  /** Settle from the config, used until a channel has measured its own */
+  static uint16_t configuredSettleMs(void) { return _acq_settle_ms; }
+
+  /** Conversion window of one setting: 2 conversions (shunt+bus) * AVG [ms] */
+  static uint32_t windowMsFor(uint16_t avg_samples, uint16_t conv_us);
+
+  /** Shared MPPT/IV step period: conversion window + settle + the age a
+   *  polled reading can have (I2C_SAMPLE_AGE_MS) */
+  static uint32_t stepPeriodFor(uint16_t avg_samples, uint16_t conv_us, uint16_t settle_ms);
+
+  static bool isValidAveraging(uint16_t avg_samples);
+  static bool isValidConversionTime(uint16_t conv_us);
+
+  /** Program one device: shunt, averaging, conversion time, continuous mode */
+  static void configureInaDevice(Adafruit_INA228& ina, uint16_t avg_samples, uint16_t conv_us);
+
+  /* =============== Convenience getters (channel 0) ==================== */
+  static float getVoltagePV(void);
+  static float getCurrentPV(void);
+  static float getPowerPV(void);
+  static float getVoltageLoad(void);
+  static float getCurrentLoad(void);
+  static float getPowerLoad(void);
+  static float getEfficiency(void);    ///< 0..1, P_out / P_in
+
+private:
+  // Profile settings requested by requestAcquisition()/requestProfile()
+  // (_req_*), taken over by the control task so I2C reconfiguration never
+  // races a read; the live copies are only written there.
+  static volatile bool _acq_pending;
+  static AcqSetting_t  _profiles[ACQ_PROFILE_COUNT];
+  static AcqSetting_t  _req_profiles[ACQ_PROFILE_COUNT];
+  static uint16_t      _acq_settle_ms;
+  static uint16_t      _req_settle_ms;
+
+  static void _applyAcquisition(void);
 };
 
 #endif /* EDUGRID_MEASUREMENTS_H_ */
\ No newline at end of file
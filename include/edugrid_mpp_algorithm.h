@@ -14,36 +14,30 @@
 #include <edugrid_states.h>
 #include <edugrid_measurement.h>
 #include <edugrid_pwm_control.h>
-
-/*************************************************************************
- * Operating modes
- ************************************************************************/
-enum OperatingModes_t
-{
-    MANUALLY = 0,  ///< UI-driven duty cycle (no automatic tracking)
-    AUTO,          ///< Perturb & Observe MPPT loop
-    IV_SWEEP,      ///< Deterministic sweep of duty for IV curve capture
-    _NUM_VALUES
-};
-
-static constexpr uint32_t kDefaultStepPeriodMs = INA_STEP_PERIOD_MS;
+#include <edugrid_mpp_tracker.h>
 
 /*************************************************************************
  * Class
  ************************************************************************/
+
+/**
+ * Static front end for the tracker of converter channel 0.
+ *
+ * The P&O and IV sweep logic lives in edugrid_mpp_tracker (one instance per
+ * channel, see edugrid_channel); these wrappers keep the single-converter
+ * API for existing callers.
+ */
 class edugrid_mpp_algorithm
 {
 public:
     /* ===== MPPT (Perturb & Observe) ===== */
-    /**
-     * @brief Perturb & Observe MPPT worker.
-     *
-     * The function is designed to be called very frequently.  It only acts
-     * when the shared timer (set via set_step_period_ms()) has elapsed and
-     * otherwise returns immediately.
-     */
     static int              find_mpp(void);
     static void             set_step_period_ms(uint32_t ms);
+    static uint32_t         get_step_period_ms(void);
+
+    /* Runtime-tunable P&O knobs (see edugrid_config) */
+    static void             set_step_size_pct(uint8_t pct);
+    static void             set_power_eps_w(float eps_w);
 
     /* ===== IV Sweep ===== */
     static void             request_iv_sweep();   // arm a new sweep
@@ -62,37 +56,6 @@ public:
 
     /* ===== Debug ===== */
     static void             serial_debug(void);
-
-private:
-    /* ---------- P&O state ---------- */
-    static float            _lastPin;
-    static int8_t           _dir;
-
-    // Non-blocking cadence shared by AUTO & IV
-    static uint32_t         _mppt_update_period_ms;
-    static uint32_t         _last_mppt_update_ms;
-
-    /* ---------- IV sweep state machine ---------- */
-    // Must match the .cpp usage: Idle -> Arm -> Sample -> Done
-    enum class IVPhase : uint8_t { Idle = 0, Arm, Sample, Done };
-    static IVPhase          _iv_phase;
-    static uint16_t         _iv_idx;        // current point index
-    static uint16_t         _iv_count;      // number of points captured
-    static uint32_t         _iv_last_ms;    // timing gate (~ INA_STEP_PERIOD_MS)
-    static bool             _iv_finalize_applied;
-
-    /* ---------- IV sweep buffers (Vin, Iin) ---------- */
-    static float            _iv_v[IV_SWEEP_POINTS];
-    static float            _iv_i[IV_SWEEP_POINTS];
-
-    /* ---------- Mode ---------- */
-    static OperatingModes_t _mode_state;
-
-    /* ---------- Helpers (optional) ---------- */
-    static inline uint8_t   duty_from_index(uint16_t idx)
-    {
-        return (uint8_t)(IV_SWEEP_D_MIN_PCT + (idx * IV_SWEEP_STEP_PCT));
-    }
 };
 
 #endif /* EDUGRID_MPP_ALGORITHM_H_ */
@@ -0,0 +1,303 @@
+/*************************************************************************
+ * @file    edugrid_mpp_tracker.h
+ * @date    2026/10/18
+ * @brief   MPPT (P&O on duty or on a V_in reference) + IV sweep for one converter channel
+ ************************************************************************/
+
+#ifndef EDUGRID_MPP_TRACKER_H_
+#define EDUGRID_MPP_TRACKER_H_
+
+/*************************************************************************
+ * Includes
+ ************************************************************************/
+#include <Arduino.h>
+#include <edugrid_states.h>
+#include <edugrid_meas_channel.h>
+#include <edugrid_pwm_channel.h>
+
+/*************************************************************************
+ * Operating modes
+ ************************************************************************/
+enum OperatingModes_t
+{
+    MANUALLY = 0,  ///< UI-driven duty cycle (no automatic tracking)
+    AUTO,          ///< Perturb & Observe MPPT loop
+    IV_SWEEP,      ///< Deterministic sweep of duty for IV curve capture
+    _NUM_VALUES
+};
+
+static constexpr uint32_t kDefaultStepPeriodMs = INA_STEP_PERIOD_MS;
+
+/** Steady-state hold transitions (event trace) */
+enum MpptFreezeEvent_t : uint8_t
+{
+    MPPT_FREEZE_HOLD = 0,     ///< limit cycle found, duty held
+    MPPT_FREEZE_RESUME_DP,    ///< objective (P_in) moved
+    MPPT_FREEZE_RESUME_DV,    ///< V_in moved
+    MPPT_FREEZE_RESUME_TIME   ///< MPPT_FREEZE_MAX_S passed
+};
+
+/** One captured IV point */
+struct IvPoint_t
+{
+    float    v;          ///< V_in [V]
+    float    i;          ///< I_in [A]
+    uint32_t t_ms;       ///< since the sweep started
+    uint8_t  duty;       ///< [%]
+    int8_t   dir;        ///< +1 up pass, -1 down pass
+};
+
+/*************************************************************************
+ * Class
+ ************************************************************************/
+
+/**
+ * Tracker of one converter channel: operating mode, P&O state and the IV
+ * sweep state machine with its buffers.  It reads the channel's cached
+ * measurements and drives the channel's PWM; nothing is shared between
+ * channels, so N trackers run independently.
+ */
+class edugrid_mpp_tracker
+{
+public:
+    edugrid_mpp_tracker(edugrid_meas_channel& meas, edugrid_pwm_channel& pwm);
+
+    void             setIndex(uint8_t index) { _index = index; }
+
+    /** Run the current mode once (called every control pass) */
+    void             service(void);
+
+    /* ===== MPPT (Perturb & Observe) ===== */
+    /**
+     * @brief Perturb & Observe MPPT worker.
+     *
+     * The function is designed to be called very frequently.  It only acts
+     * when the shared timer (set via set_step_period_ms()) has elapsed and
+     * otherwise returns immediately.
+     */
+    int              find_mpp(void);
+    void             set_step_period_ms(uint32_t ms) { _mppt_update_period_ms = ms; }
+    uint32_t         get_step_period_ms(void) const  { return _mppt_update_period_ms; }
+
+    /* Runtime-tunable P&O knobs (see edugrid_config) */
+    void             set_step_size_pct(uint8_t pct);
+    void             set_power_eps_w(float eps_w);
+
+    /* Steady-state hold instead of the +-1 step dither (see MPPT_FREEZE_*) */
+    void             set_freeze_enabled(bool enabled);
+    bool             get_freeze_enabled(void) const { return _freeze_enabled; }
+    bool             is_frozen(void) const          { return _frozen; }
+    uint16_t         freeze_count(void) const       { return _freeze_count; }
+    /** Time spent holding since boot, including a hold in progress [ms] */
+    uint32_t         frozen_time_ms(void) const;
+    /** Dither loss avoided while holding, estimated from the cycle [J] */
+    float            freeze_gain_j(void) const      { return _freeze_gain_j; }
+
+    /* dP-P&O: take the environment's drift out of dP (see MPPT_DRIFT) */
+    void             set_drift_enabled(bool enabled);
+    bool             get_drift_enabled(void) const  { return _drift_enabled; }
+    /** Last drift between the two readings of a step [W], objective units */
+    float            drift_w(void) const            { return _drift_w; }
+
+    /* Voltage-reference cascade instead of duty P&O (see MPPT_VREF_*) */
+    void             set_vref_enabled(bool enabled);
+    bool             get_vref_enabled(void) const   { return _vref_enabled; }
+    void             set_vref_gains(float kp, float ki);
+    void             set_vref_step_v(float step_v);
+    float            get_vref_kp(void) const        { return _vref_kp; }
+    float            get_vref_ki(void) const        { return _vref_ki; }
+    float            get_vref_step_v(void) const    { return _vref_step_v; }
+    /** Reference the inner loop holds V_in at [V] (valid in AUTO) */
+    float            vref_v(void) const             { return _vref_v; }
+    /** The inner loop sits at a duty border (-1 lower, +1 upper, 0 free) */
+    int8_t           vref_saturated(void) const     { return _vref_sat; }
+
+    /* Objective: (1 - w) * P_in + w * P_out (see MPPT_POUT_*) */
+    void             set_pout_weight(float w);
+    float            get_pout_weight(void) const    { return _pout_w; }
+    /** Value P&O compares, from the present readings [W] */
+    float            objective_w(void) const;
+    /** Estimated noise of one P_out reading [W] */
+    float            pout_sigma_w(void) const       { return sqrtf(_pout_var); }
+
+    /* ===== IV Sweep ===== */
+    void             request_iv_sweep(void);              // arm a new sweep
+    void             request_iv_sweep(bool bidir);        // ... overriding the down pass once
+    void             iv_sweep_step(void);                 // non-blocking state machine
+
+    /* Point budget (coarse + refined + down pass) and down pass (see edugrid_config) */
+    void             set_iv_sweep_points(uint8_t points);
+    uint8_t          get_iv_sweep_points(void) const { return _iv_budget; }
+    void             set_iv_sweep_bidir(bool bidir)  { _iv_bidir = bidir; }
+    bool             get_iv_sweep_bidir(void) const  { return _iv_bidir; }
+
+    /* ===== Background IV sweep (from AUTO, see IV_BG_*) ===== */
+    /** Interval between background sweeps while in AUTO [s], 0 = off */
+    void             set_iv_bg_interval_s(uint16_t interval_s);
+    uint16_t         get_iv_bg_interval_s(void) const { return _iv_bg_interval_s; }
+    void             set_iv_bg_points(uint8_t points);
+    uint8_t          get_iv_bg_points(void) const { return _iv_bg_points; }
+    /** Run a background sweep at the next AUTO step (ignores the interval) */
+    void             request_iv_bg_sweep(void) { _iv_bg_requested = true; }
+    /** The running or last sweep was a background one */
+    bool             iv_sweep_background(void) const { return _iv_bg_last; }
+
+    /* Cost of the background sweeps since boot */
+    uint16_t         iv_bg_count(void) const    { return _iv_bg_count; }
+    uint32_t         iv_bg_time_ms(void) const  { return _iv_bg_time_ms; }   ///< off the tracked duty
+    float            iv_bg_loss_j(void) const   { return _iv_bg_loss_j; }
+    float            auto_energy_j(void) const  { return _auto_energy_j; }   ///< harvested by P&O
+    /** Time until the next background sweep may start [ms]; 0 = due */
+    uint32_t         iv_bg_wait_ms(void) const;
+
+    /* ===== IV Sweep data accessors ===== */
+    bool             iv_sweep_in_progress(void) const;
+    bool             iv_sweep_done(void) const;
+    /** Up-pass points come first, sorted by duty; down-pass points follow
+     *  in capture order (falling duty) */
+    uint16_t         iv_point_count(void) const { return _iv_count; }
+    uint16_t         iv_up_count(void) const    { return _iv_up; }
+    void             iv_get_point(uint16_t idx, float& v, float& i) const;
+    const IvPoint_t& iv_point(uint16_t idx) const;
+    /** Time from the start duty to the last point */
+    uint32_t         iv_duration_ms(void) const { return _iv_duration_ms; }
+    /** Energy the sweep cost against staying at the MPP it found [J] */
+    float            iv_loss_j(void) const      { return _iv_loss_j; }
+    /** Largest down-minus-up power at one duty, share of P_max; 0 without a down pass */
+    float            iv_hysteresis(void) const  { return _iv_hysteresis; }
+
+    /* ===== Mode control ===== */
+    OperatingModes_t get_mode_state(void) const { return _mode_state; }
+    void             set_mode_state(OperatingModes_t mode);
+    void             toggle_mode_state(void);
+
+    /* ===== Debug ===== */
+    void             serial_debug(void) const;
+
+private:
+    // Idle -> Arm -> Sample (coarse up) -> Refine -> [Down] -> Done; the
+    // values are in the event trace, so new phases only go at the end
+    enum class IVPhase : uint8_t { Idle = 0, Arm, Sample, Done, Refine, Down };
+    void             _set_iv_phase(IVPhase phase);
+    void             _iv_record(int8_t dir, uint32_t now);
+    int16_t          _iv_next_refine(void) const;
+    void             _iv_after_up(void);
+    void             _freeze_reset(void);
+    bool             _freeze_detect(float obj);
+    uint16_t         _freeze_vertex(uint8_t duty, float p) const;
+    bool             _freeze_hold(uint32_t now, uint32_t dt_ms, float obj, float Vin);
+    void             _vref_reset(float duty);
+    void             _vref_track(uint32_t now);
+    void             _vref_pi(uint32_t now, float Vin);
+    uint32_t         _auto_period_ms(void) const;
+    void             _pout_noise(int16_t point, float p_out, float p_in);
+    float            _obj_eps_w(void) const;
+
+    void             _iv_arm(bool bidir, uint8_t budget);
+    void             _iv_finish(void);
+    bool             _iv_bg_due(uint32_t now) const;
+    void             _iv_bg_start(void);
+    void             _iv_bg_restore(float p_max);
+
+    edugrid_meas_channel& _meas;
+    edugrid_pwm_channel&  _pwm;
+    uint8_t          _index;
+
+    /* ---------- P&O state ---------- */
+    float            _lastObj;       // objective of the previous step [W]
+    int8_t           _dir;
+    uint8_t          _step_pct;      // P&O duty step [%]
+    float            _power_eps_w;   // dP dead band [W]
+
+    /* ---------- dP-P&O ---------- */
+    bool             _drift_enabled;
+    bool             _drift_mid;            // P_x taken, the step's second reading is next
+    float            _drift_px;             // objective once the perturbation settled
+    float            _drift_w;
+    uint8_t          _drift_steps;
+    bool             _drift_due;
+
+    /* ---------- Objective ---------- */
+    float            _pout_w;
+    float            _pout_var;             // P_out noise EWMA [W^2]
+    int16_t          _pout_pt[2];           // operating point of the last two steps ...
+    float            _pout_eff[2];          // ... and P_out / P_in read there
+
+    /* ---------- Steady-state hold ---------- */
+    bool             _freeze_enabled;
+    bool             _frozen;
+    bool             _freeze_ref_pending;   // first reading at the held duty
+    uint8_t          _hist_duty[MPPT_FREEZE_HISTORY];
+    float            _hist_p[MPPT_FREEZE_HISTORY];
+    uint8_t          _hist_n;
+    uint8_t          _hist_pos;
+    uint16_t         _hist_rev;             // bit k: reversal k steps ago
+    int8_t           _hist_sign;            // last non-zero duty move
+    float            _freeze_p_ref;         // objective at the held duty
+    float            _freeze_v_ref;
+    float            _freeze_gain_w;        // cycle mean below the held point
+    uint32_t         _freeze_start_ms;
+    uint32_t         _frozen_ms;            // finished holds
+    float            _freeze_gain_j;
+    uint16_t         _freeze_count;
+
+    /* ---------- Voltage-reference cascade ---------- */
+    bool             _vref_enabled;
+    float            _vref_kp;              // [%/V]
+    float            _vref_ki;              // [%/(V*s)]
+    float            _vref_step_v;
+    float            _vref_v;               // reference [V]
+    float            _vref_i;               // integrator = duty without the P term [%]
+    int8_t           _vref_sat;
+    uint32_t         _vref_pi_ms;           // last inner pass
+    float            _vref_p_sum;           // P_in over the second half of an outer step
+    float            _vref_obj_sum;         // ... the objective
+    float            _vref_pout_sum;        // ... P_out
+    uint16_t         _vref_p_n;
+
+    // Non-blocking cadence shared by AUTO & IV
+    uint32_t         _mppt_update_period_ms;
+    uint32_t         _last_mppt_update_ms;
+
+    /* ---------- IV sweep state machine ---------- */
+    IVPhase          _iv_phase;
+    uint16_t         _iv_count;      // number of points captured
+    uint16_t         _iv_up;         // of which up pass (sorted by duty)
+    uint32_t         _iv_last_ms;    // timing gate (~ INA_STEP_PERIOD_MS)
+    uint32_t         _iv_start_ms;
+    bool             _iv_finalize_applied;
+    uint8_t          _iv_budget;
+    bool             _iv_bidir;
+    bool             _iv_sweep_bidir;   // latched for the running sweep
+    uint8_t          _iv_sweep_budget;  // latched for the running sweep
+
+    /* ---------- Background sweep ---------- */
+    uint16_t         _iv_bg_interval_s;
+    uint8_t          _iv_bg_points;
+    volatile bool    _iv_bg_requested;
+    bool             _iv_bg_active;     // running sweep returns to AUTO
+    bool             _iv_bg_last;
+    uint32_t         _iv_bg_due_ms;     // earliest start of the next one
+    uint16_t         _iv_bg_saved_duty; // [1/PWM_FINE_PER_PCT %]
+    int8_t           _iv_bg_saved_dir;
+    float            _iv_bg_saved_obj;
+    float            _iv_bg_saved_vref;
+    uint16_t         _iv_bg_count;
+    uint32_t         _iv_bg_time_ms;
+    float            _iv_bg_loss_j;
+    float            _auto_energy_j;
+
+    /* ---------- IV sweep result ---------- */
+    uint32_t         _iv_duration_ms;
+    float            _iv_harvest_j;  // energy drawn while sweeping
+    float            _iv_loss_j;
+    float            _iv_hysteresis;
+
+    /* ---------- IV sweep buffer ---------- */
+    IvPoint_t        _iv_pts[IV_SWEEP_POINTS];
+
+    /* ---------- Mode ---------- */
+    OperatingModes_t _mode_state;
+};
+
+#endif /* EDUGRID_MPP_TRACKER_H_ */
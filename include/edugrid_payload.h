@@ -0,0 +1,117 @@
+/*************************************************************************
+ * @file edugrid_payload.h
+ * @date 2026/10/18
+ * @brief Builders for the web payloads (WebSocket push, IV sweep, file list)
+ ************************************************************************/
+
+#ifndef EDUGRID_PAYLOAD_H_
+#define EDUGRID_PAYLOAD_H_
+
+/*************************************************************************
+ * Include
+ ************************************************************************/
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <edugrid_states.h>
+#include <edugrid_mpp_tracker.h>
+#include <edugrid_iv_archive.h>
+#include <edugrid_freq_map.h>
+#include <edugrid_energy.h>
+#include <edugrid_scope.h>
+
+/*************************************************************************
+ * Define
+ ************************************************************************/
+
+/* JSON document sizes */
+#define K_CONFIG_JSON_CAPACITY  ( JSON_OBJECT_SIZE(40) )
+/* Per-converter summaries appended when EDUGRID_NUM_CHANNELS > 1 */
+#define K_CHANNELS_JSON_CAPACITY ( (EDUGRID_NUM_CHANNELS > 1) ? \
+        (JSON_ARRAY_SIZE(EDUGRID_NUM_CHANNELS) + EDUGRID_NUM_CHANNELS * JSON_OBJECT_SIZE(10)) : 0 )
+#define K_NOW_JSON_CAPACITY     ( JSON_OBJECT_SIZE(14) + K_CHANNELS_JSON_CAPACITY )
+#define K_WS_JSON_CAPACITY      ( JSON_OBJECT_SIZE(28) + K_CHANNELS_JSON_CAPACITY )
+#define K_SETTLE_JSON_CAPACITY  ( JSON_OBJECT_SIZE(10) )
+#define K_PROTECT_JSON_CAPACITY ( JSON_OBJECT_SIZE(8) + JSON_ARRAY_SIZE(4) + JSON_OBJECT_SIZE(4) )
+/* /api/effmap: summary, frequency and duty axes, eff and p_in as rows per duty */
+#define K_EFFMAP_JSON_CAPACITY  ( JSON_OBJECT_SIZE(14) + JSON_ARRAY_SIZE(FREQ_MAP_NUM_FREQS) + \
+        3 * JSON_ARRAY_SIZE(FREQ_MAP_NUM_DUTIES) + 2 * FREQ_MAP_NUM_DUTIES * JSON_ARRAY_SIZE(FREQ_MAP_NUM_FREQS) )
+/* /ivsweep/data: v, i, p, d, t arrays of n points plus the sweep summary
+   and the background sweep cost */
+#define K_IV_JSON_CAPACITY(n)   ( JSON_OBJECT_SIZE(17) + 5 * JSON_ARRAY_SIZE(n) )
+#define K_ACQ_JSON_CAPACITY     ( JSON_OBJECT_SIZE(3) + JSON_ARRAY_SIZE(ACQ_PROFILE_COUNT) \
+                                  + ACQ_PROFILE_COUNT * JSON_OBJECT_SIZE(9) )
+/* /api/ivs: one entry of the list, streamed one after another */
+#define K_IVS_ENTRY_JSON_CAPACITY ( JSON_OBJECT_SIZE(14) )
+/* /api/ivs?seq=N: summary plus v, i, d arrays of n points */
+#define K_IVS_SWEEP_JSON_CAPACITY(n) ( JSON_OBJECT_SIZE(17) + 3 * JSON_ARRAY_SIZE(n) )
+#define K_IVS_DIFF_JSON_CAPACITY  ( JSON_OBJECT_SIZE(14) + 2 * JSON_ARRAY_SIZE(IV_ARCHIVE_DIFF_POINTS) )
+/* /api/energy: summary plus five periods of PV / load Wh and Ah */
+#define K_ENERGY_JSON_CAPACITY  ( JSON_OBJECT_SIZE(12) + 5 * JSON_OBJECT_SIZE(4) )
+/* /api/scope: run state plus the header of the newest capture */
+#define K_SCOPE_JSON_CAPACITY   ( JSON_OBJECT_SIZE(5) + JSON_OBJECT_SIZE(14) )
+#define K_I2C_JSON_CAPACITY     ( JSON_OBJECT_SIZE(14) + 2 * JSON_OBJECT_SIZE(8) )
+
+/*************************************************************************
+ * Class
+ ************************************************************************/
+
+/**
+ * Class with static members that turn the live state into the strings the
+ * web UI consumes.  Kept apart from edugrid_webserver so the builders do not
+ * depend on the network stack and can be timed on the host (bench/micro).
+ */
+class edugrid_payload
+{
+public:
+    // WebSocket push: channel 0 at the top level plus the per-channel array.
+    static void liveJson(String& out);
+
+    // GET /ivsweep/data: v/i/p (rounded to mV/mA/mW), duty and time of each
+    // point of the last sweep, plus its duration, loss and hysteresis, and
+    // what the background sweeps have cost so far.
+    static void ivSweepJson(const edugrid_mpp_tracker& mppt, String& out);
+
+    // GET /api/settle: state and last result of one channel's settle calibration.
+    static void settleJson(uint8_t ch, String& out);
+
+    // GET /api/protect: fast-trip state, statistics and limits of one channel.
+    static void protectJson(uint8_t ch, String& out);
+
+    // GET /api/effmap: efficiency map run state and the duty x frequency table.
+    static void effmapJson(uint8_t ch, String& out);
+
+    // GET /api/acq: INA profiles of one channel with their speed and measured noise.
+    static void acquisitionJson(uint8_t ch, String& out);
+
+    // GET /api/energy: day / week / lifetime Wh and Ah of one channel.
+    static void energyJson(uint8_t ch, String& out);
+
+    // GET /api/scope: capture state of one channel and what the newest
+    // capture (of any channel) holds; the samples go out as binary.
+    static void scopeJson(uint8_t ch, String& out);
+
+    // GET /api/i2c: bus worker statistics and the read counters of one
+    // channel's two INA228s.
+    static void i2cJson(uint8_t ch, String& out);
+
+    // GET /api/ivs: headers of all archived sweeps, oldest first, streamed
+    // so the list length does not depend on the heap.
+    static void ivArchiveListJson(Print& out);
+
+    // GET /api/ivs?seq=N: one archived sweep with its points in V/A.
+    static void ivArchiveSweepJson(const IvArchiveRecord_t& rec, String& out);
+
+    // GET /api/ivs/diff?a=&b=: parameter changes and I_b - I_a over V.
+    static void ivArchiveDiffJson(const IvArchiveRecord_t& a, const IvArchiveRecord_t& b, String& out);
+
+    // Per-channel summary (/api/now and the WebSocket push).
+    static void channelsToJson(JsonDocument& doc);
+
+    // HTML table rows of /log/, /www/, /config/ and / for the file manager.
+    static String fileListHtml(void);
+
+    static String humanReadableSize(const size_t bytes);
+    static const char* modeToStr(OperatingModes_t mode);
+};
+
+#endif /* EDUGRID_PAYLOAD_H_ */
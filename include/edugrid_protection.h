@@ -0,0 +1,112 @@
+/*************************************************************************
+ * @file edugrid_protection.h
+ * @date 2026/10/18
+ * @brief Fast over-current/over-voltage trip (INA228 ALERT -> IR2104 SD)
+ ************************************************************************/
+
+#ifndef EDUGRID_PROTECTION_H_
+#define EDUGRID_PROTECTION_H_
+
+/*************************************************************************
+ * Include
+ ************************************************************************/
+#include <Arduino.h>
+#include <edugrid_states.h>
+#include <edugrid_meas_channel.h>
+#include <edugrid_pwm_channel.h>
+#include <edugrid_mpp_tracker.h>
+
+/*************************************************************************
+ * Types
+ ************************************************************************/
+/** Gate driver state (event trace, UI) */
+enum ProtState_t : uint8_t
+{
+    PROT_OK = 0,       ///< SD high, converter running
+    PROT_TRIPPED,      ///< SD low, retry after PROT_RETRY_MS
+    PROT_LATCHED,      ///< SD low until reset()
+    PROT_UNARMED       ///< before arm(), or no ALERT pin / sensors: no fast trip
+};
+
+/*************************************************************************
+ * Class
+ ************************************************************************/
+
+/**
+ * Hardware trip of one converter channel.
+ *
+ * Both INA228s compare every conversion against the PROT_* limits and pull
+ * their shared open-drain ALERT low; the falling edge runs an IRAM ISR
+ * that drops the IR2104 SD pin with a direct register write.  The trip
+ * therefore takes one conversion plus a few microseconds, independent of
+ * the control task.  service() then reads the cause (which releases the
+ * latched ALERT), parks the duty at the lower border and, after
+ * PROT_RETRY_MS, re-enables the gate driver if ALERT stays high.  More
+ * than PROT_MAX_RETRIES trips inside PROT_RETRY_WINDOW_S latch it off.
+ */
+class edugrid_protection
+{
+public:
+    edugrid_protection(edugrid_meas_channel& meas, edugrid_pwm_channel& pwm, edugrid_mpp_tracker& mppt);
+
+    /** SD as output (low) and ALERT as input; -1 = not wired (setup()) */
+    void          begin(uint8_t index, int8_t sd_pin, int8_t alert_pin);
+
+    /** Program the limits, attach the ISR and enable the gate driver;
+     *  needs the INAs probed (after edugrid_measurement::init()) */
+    void          arm(void);
+
+    /** Limits for the next arm() [A]/[V], 0 = off */
+    void          setLimits(float i_in_max, float v_in_max, float i_out_max, float v_out_max);
+
+    /** Control task, right after the measurement: handle trips and retries */
+    void          service(void);
+
+    /** Clear a latch (or cut a retry wait short) */
+    void          reset(void) { _reset_requested = true; }
+
+    /** The converter may switch; the tracker must not step otherwise */
+    bool          running(void) const { return _state == PROT_OK || _state == PROT_UNARMED; }
+
+    /* ===== Statistics ===== */
+    ProtState_t   state(void) const        { return _state; }
+    uint16_t      tripCount(void) const    { return _isr_trips; }
+    uint8_t       lastCause(void) const    { return _last_cause; }          ///< InaAlertCause_t bits
+    uint32_t      lastTripMs(void) const   { return _last_trip_ms; }
+    uint32_t      lastDetectUs(void) const { return _last_detect_us; }      ///< ISR -> service()
+    uint8_t       retries(void) const      { return _burst; }               ///< trips in this window
+    float         limit(uint8_t cause_bit) const;
+
+    static const char* stateToStr(ProtState_t state);
+
+private:
+    static void IRAM_ATTR _isr(void* arg);
+    void          _trip(uint32_t now);
+    void          _enable(void);
+    void          _setState(ProtState_t state, uint8_t cause, uint32_t detect_us);
+
+    edugrid_meas_channel& _meas;
+    edugrid_pwm_channel&  _pwm;
+    edugrid_mpp_tracker&  _mppt;
+    uint8_t       _index;
+    int8_t        _sd_pin;
+    int8_t        _alert_pin;
+
+    float         _i_in_max, _v_in_max, _i_out_max, _v_out_max;
+
+    /* Shared with the ISR */
+    volatile bool     _gate_on;         // SD high; the ISR counts a trip only then
+    volatile uint16_t _isr_trips;
+    volatile uint32_t _isr_us;
+
+    ProtState_t   _state;
+    volatile bool _reset_requested;
+    uint16_t      _seen_trips;          // ISR trips already handled
+    uint8_t       _last_cause;
+    uint32_t      _last_trip_ms;
+    uint32_t      _last_detect_us;
+    uint8_t       _burst;               // trips since _burst_ms
+    uint32_t      _burst_ms;
+};
+
+#endif /* EDUGRID_PROTECTION_H_ */
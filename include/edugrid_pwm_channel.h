@@ -0,0 +1,141 @@
+/*************************************************************************
+ * @file edugrid_pwm_channel.h
+ * @date 2026/10/18
+ * @brief One buck converter PWM output (LEDC channel, percent-based API)
+ ************************************************************************/
+
+#ifndef EDUGRID_PWM_CHANNEL_H_
+#define EDUGRID_PWM_CHANNEL_H_
+
+/*************************************************************************
+ * Includes
+ ************************************************************************/
+#include <Arduino.h>
+#include <edugrid_states.h>
+#if CONFIG_FREERTOS_UNICORE == 0
+  #include "freertos/FreeRTOS.h"
+  #include "freertos/portmacro.h"
+#endif
+
+/*************************************************************************
+ * Defines
+ ************************************************************************/
+#define PWM_RESOLUTION_BITS       (8)
+#define PWM_RESOLUTION_STEPS      (255)   // 8-bit LEDC resolution (0..255)
+#define PWM_DITHER_FRAC_BITS      (4)     // fractional bits of the LEDC duty register
+#define PWM_FINE_PER_PCT          (100)   // fine duty unit: 0.01 %
+
+// Absolute borders for MPPT / manual (percent, 0..100)
+#define PWM_ABS_MIN_MPPT  (5)    // [%]
+#define PWM_ABS_MAX_MPPT  (95)   // [%]
+#define PWM_ABS_INIT      (10)   // [%] (start at safe low duty)
+#define PWM_DUTY_NO_CEILING (100 * PWM_FINE_PER_PCT) // setDutyCeiling() value that lifts it
+
+/* Who asked for a duty change (recorded by the event trace) */
+enum PwmSource_t : uint8_t
+{
+    PWM_SRC_UNKNOWN = 0,
+    PWM_SRC_INIT,           ///< boot / converter init
+    PWM_SRC_MANUAL_RAMP,    ///< slew limiter towards the UI target
+    PWM_SRC_UI_STEP,        ///< +/- buttons in the UI
+    PWM_SRC_MPPT,           ///< P&O step
+    PWM_SRC_IV_SWEEP,       ///< IV sweep state machine
+    PWM_SRC_BORDER,         ///< clamped into the (new) duty window
+    PWM_SRC_SETTLE_CAL,     ///< settle-time calibration step
+    PWM_SRC_VREF_PI,        ///< inner voltage loop of the V_ref cascade
+    PWM_SRC_CHARGE,         ///< CC/CV duty ceiling (edugrid_charger)
+    PWM_SRC_TRIP,           ///< parked at the lower border by a fast trip
+    PWM_SRC_FREQ_MAP,       ///< efficiency map run (edugrid_freq_map)
+    PWM_SRC_SCOPE           ///< step capture (edugrid_scope)
+};
+
+/*************************************************************************
+ * Class
+ ************************************************************************/
+
+/**
+ * One converter's PWM output.  Every instance owns its LEDC channel, pin,
+ * duty borders and manual slew limiter.  Arduino-ESP32 derives the LEDC
+ * timer from the channel number (channels 2k and 2k+1 share a timer), so
+ * converters that may run at different frequencies must use even channels.
+ */
+class edugrid_pwm_channel
+{
+public:
+    edugrid_pwm_channel(void);
+
+    void     begin(uint8_t index, uint8_t ledc_channel, int freq_hz, int pin);
+
+    /* Percent-based API (0..100 %); getPWM() rounds a fine duty */
+    void     setPWM(uint8_t pwm_in, PwmSource_t src = PWM_SRC_UNKNOWN);
+    uint8_t  getPWM(void) const { return _duty; }
+    float    getPWM_normalized(void) const { return _duty_fine / (100.0f * PWM_FINE_PER_PCT); }
+
+    // Fractional duty in PWM_FINE_PER_PCT units.  Without dithering the
+    // output rounds it to whole LEDC ticks; the trace only records changes
+    // of the whole percent.
+    void     setPWMFine(uint16_t fine_in, PwmSource_t src = PWM_SRC_UNKNOWN);
+    uint16_t getPWMFine(void) const { return _duty_fine; }
+
+    // Sub-tick duty: the fractional bits of the LEDC duty register make the
+    // peripheral alternate between two adjacent ticks across PWM periods
+    void     setDither(bool enabled);
+    bool     getDither(void) const { return _dither; }
+
+    // Manual mode: the UI requests a target and serviceManualRamp() slews
+    // towards it.  While the tracker drives the duty (manual_active false)
+    // the ramp just follows the live value so switching back never jumps.
+    void     requestManualTarget(uint8_t target);
+    void     serviceManualRamp(bool manual_active);
+
+    /* Frequency API */
+    void     setFrequency(float freq_hz);
+    float    getFrequency(void) const { return (float)_freq_hz; }
+    uint8_t  getFrequency_kHz(void) const { return (uint8_t)((_freq_hz + 500) / 1000); }
+
+    void     setPin(int pin);
+
+    /* Adjust duty in steps (signed) */
+    void     pwmIncrementDecrement(int step, PwmSource_t src = PWM_SRC_UNKNOWN);
+
+    /* Borders; the upper limit includes the duty ceiling (rounded to whole
+     * percent like getPWM(), the fine one as set) */
+    uint8_t  getPwmLowerLimit(void) const { return _abs_min; }
+    uint8_t  getPwmUpperLimit(void) const { return (uint8_t)((_upperFine() + PWM_FINE_PER_PCT / 2) / PWM_FINE_PER_PCT); }
+    uint16_t getPwmUpperLimitFine(void) const { return _upperFine(); }
+    uint8_t  getPwmBorderUpper(void) const { return _abs_max; }
+    void     setPwmLimits(uint8_t min_pct, uint8_t max_pct);
+    void     checkAndSetPwmBorders(void);
+
+    // Output limits (CC/CV) pull the upper limit below the border for every
+    // duty source; the live duty is clamped at once.  PWM_FINE_PER_PCT units
+    void     setDutyCeiling(uint16_t fine, PwmSource_t src);
+    uint16_t getDutyCeiling(void) const { return _ceiling; }
+
+    /* Manual ramp tuning (see edugrid_config) */
+    void     setManualSlew(uint8_t step_pct, uint16_t interval_ms);
+
+private:
+    void     _applyToHardware(uint16_t fine);
+    uint16_t _upperFine(void) const;
+
+    uint8_t  _index;                 // converter channel (trace / UI)
+    uint8_t  _ledc_channel;
+    int      _pin;                   // GPIO, -1 until begin()
+    int      _freq_hz;               // [Hz]
+    uint8_t  _duty;                  // [%], _duty_fine rounded
+    uint16_t _duty_fine;             // [1/PWM_FINE_PER_PCT %]
+    bool     _dither;
+    uint8_t  _abs_min;               // [%]
+    uint8_t  _abs_max;               // [%]
+    uint16_t _ceiling;               // [1/PWM_FINE_PER_PCT %], PWM_DUTY_NO_CEILING = none
+    uint8_t  _manual_target;         // [%]
+    uint32_t _manual_last_step_ms;   // [ms]
+    uint8_t  _manual_slew_step;      // [%]
+    uint16_t _manual_slew_interval;  // [ms]
+#if CONFIG_FREERTOS_UNICORE == 0
+    portMUX_TYPE _mux;
+#endif
+};
+
+#endif /* EDUGRID_PWM_CHANNEL_H_ */
@@ -12,28 +12,30 @@
  ************************************************************************/
 #include <Arduino.h>
 #include <edugrid_states.h>
+#include <edugrid_pwm_channel.h>
 
 /*************************************************************************
  * Defines
  ************************************************************************/
 #define TIMER_PWM_POWER_CONVERTER (0)
-#define PWM_RESOLUTION_STEPS      (255)   // 8-bit LEDC resolution (0..255)
-
-// Absolute borders for MPPT / manual (percent, 0..100)
-#define PWM_ABS_MIN_MPPT  (5)    // [%]
-#define PWM_ABS_MAX_MPPT  (95)   // [%]
-#define PWM_ABS_INIT      (10)   // [%] (start at safe low duty)
 
 /*************************************************************************
  * Class
  ************************************************************************/
+
+/**
+ * Static front end for the PWM of converter channel 0.
+ *
+ * Kept so single-converter code and the UI handlers do not need to know
+ * about channels; multi-channel code uses edugrid_channel::at(i).pwm.
+ */
 class edugrid_pwm_control
 {
 public:
     /* Percent-based API (0..100 %) */
     // Percent-based API; the class stores the current duty internally and also
     // mirrors the value to the hardware PWM peripheral.
-    static void     setPWM(uint8_t pwm_in);
+    static void     setPWM(uint8_t pwm_in, PwmSource_t src = PWM_SRC_UNKNOWN);
     static uint8_t  getPWM();                  // 0..100 [%]
     static float    getPWM_normalized();       // 0.0..1.0
 
@@ -53,28 +55,16 @@ public:
     static void     initPwmPowerConverter(int freq_hz, int pin);
 
     /* Adjust duty in steps (signed) */
-    static void     pwmIncrementDecrement(int step = 5);
+    static void     pwmIncrementDecrement(int step = 5, PwmSource_t src = PWM_SRC_UNKNOWN);
 
     /* Borders */
     static uint8_t  getPwmLowerLimit();
     static uint8_t  getPwmUpperLimit();
+    static void     setPwmLimits(uint8_t min_pct, uint8_t max_pct);
     static void     checkAndSetPwmBorders();
 
-private:
-    static void     _applyToHardware(uint8_t pwm_percent);
-
-    /* cached state */
-    static uint8_t  pwm_power_converter;      // [%]
-    static int      frequency_power_converter; // [Hz]
-    static int      power_converter_pin;      // GPIO
-    static uint8_t  pwm_abs_min;              // [%]
-    static uint8_t  pwm_abs_max;              // [%]
-    static uint8_t  manual_target;            // [%]
-    static uint32_t manual_last_step_ms;      // [ms]
-
-    /* LEDC config */
-    static const int _ledc_channel;           // LEDC channel used
-    static const int _ledc_timer;             // LEDC timer used
+    /* Manual ramp tuning (see edugrid_config) */
+    static void     setManualSlew(uint8_t step_pct, uint16_t interval_ms);
 };
 
 #endif /* EDUGRID_PWM_CONTROL_H_ */
@@ -0,0 +1,210 @@
+/*************************************************************************
+ * @file edugrid_scope.h
+ * @date 2026/10/18
+ * @brief Triggered high-rate V/I capture ("scope") of one converter channel
+ ************************************************************************/
+
+#ifndef EDUGRID_SCOPE_H_
+#define EDUGRID_SCOPE_H_
+
+/*************************************************************************
+ * Include
+ ************************************************************************/
+#include <Arduino.h>
+#include <edugrid_states.h>
+#include <edugrid_meas_channel.h>
+#include <edugrid_pwm_channel.h>
+#include <edugrid_mpp_tracker.h>
+
+/*************************************************************************
+ * Define
+ ************************************************************************/
+#define SCOPE_SAMPLES             (512)     /* capture length, one buffer for all channels */
+#define SCOPE_AVG                 (1)       /* fastest INA setting while capturing: */
+#define SCOPE_CONV_US             (50)      /* no averaging, 0.1 ms per bus+shunt result */
+#define SCOPE_SAMPLE_US           (1000)    /* [us] default spacing of the samples */
+#define SCOPE_SAMPLE_US_MIN       (1000)    /* four register reads at 400 kHz I2C */
+#define SCOPE_SAMPLE_US_MAX       (20000)   /* one control pass */
+#define SCOPE_PRE_PCT             (25)      /* [%] default share of samples before the trigger */
+#define SCOPE_STEP_PCT            (3)       /* [%] default duty step of a step capture */
+#define SCOPE_STEP_PCT_MAX        (20)
+#define SCOPE_ARM_TIMEOUT_MS      (10000UL) /* a level trigger gives up after this */
+#define SCOPE_ARM_SLICE_US        (10000UL) /* sampling per control pass while armed */
+#define SCOPE_UNIX_VALID_S        (1600000000UL)  /* anything earlier: clock never set */
+
+/* Download layout (GET /api/scope?raw=1): ScopeHeader_t, then n
+ * ScopeSample_t, little endian; script/host/edugrid_scope_render.py reads it. */
+#define SCOPE_MAGIC               (0x43534745UL)  /* "EGSC" (little endian) */
+#define SCOPE_VERSION             (1)
+
+/*************************************************************************
+ * Types
+ ************************************************************************/
+enum ScopeTrigger_t : uint8_t
+{
+    SCOPE_TRIG_STEP = 0,     ///< the scope steps the duty itself; t = 0 at the step
+    SCOPE_TRIG_LEVEL         ///< a signal crosses a level; t = 0 at the first sample past it
+};
+
+enum ScopeSignal_t : uint8_t
+{
+    SCOPE_SIG_V_IN = 0,
+    SCOPE_SIG_I_IN,
+    SCOPE_SIG_V_OUT,
+    SCOPE_SIG_I_OUT,
+    SCOPE_SIG_COUNT
+};
+
+enum ScopeResult_t : uint8_t
+{
+    SCOPE_OK = 0,
+    SCOPE_TIMEOUT,           ///< level trigger never crossed within SCOPE_ARM_TIMEOUT_MS
+    SCOPE_ABORTED,           ///< mode changed / sensor lost while armed or holding
+    SCOPE_NEVER              ///< no capture finished since boot
+};
+
+/** What to capture; set through request() */
+struct ScopeRequest_t
+{
+    ScopeTrigger_t trigger;
+    ScopeSignal_t  signal;     ///< LEVEL: watched signal
+    bool           rising;     ///< LEVEL: edge
+    float          level;      ///< LEVEL: [V] / [A]
+    int8_t         step_pct;   ///< STEP: duty step [%], the sign picks the direction
+    uint16_t       period_us;  ///< sample spacing
+    uint8_t        pre_pct;    ///< share of the buffer before the trigger
+};
+
+/** One sample: both INA228s, read back to back */
+struct ScopeSample_t
+{
+    int32_t t_us;            ///< relative to the trigger
+    float   v_in;            ///< [V]
+    float   i_in;            ///< [A] zero offset taken off
+    float   v_out;
+    float   i_out;
+};
+
+struct ScopeHeader_t
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t hdr_size;       ///< [bytes]
+    uint16_t n;              ///< samples that follow
+    uint16_t pre;            ///< index of the trigger sample
+    uint16_t period_us;
+    uint16_t conv_us;        ///< INA setting of the capture
+    uint16_t avg;
+    uint8_t  ch;
+    uint8_t  trigger;        ///< ScopeTrigger_t
+    uint8_t  signal;         ///< ScopeSignal_t (LEVEL)
+    uint8_t  rising;         ///< (LEVEL)
+    uint8_t  duty_from;      ///< [%] before / after the step (both the
+    uint8_t  duty_to;        ///<     duty in use for LEVEL)
+    float    level;          ///< (LEVEL)
+    uint32_t seq;            ///< capture number since boot
+    uint32_t unix_s;         ///< wall clock of the trigger, 0 if it was not set
+    uint32_t uptime_ms;      ///< millis() of the trigger
+};
+
+static_assert(sizeof(ScopeSample_t) == 20, "scope sample layout is part of the download format");
+static_assert(sizeof(ScopeHeader_t) == 40, "scope header layout is part of the download format");
+
+/*************************************************************************
+ * Class
+ ************************************************************************/
+
+/**
+ * Triggered waveform capture of one converter channel.
+ *
+ * A capture pauses the tracker, switches both INA228s to SCOPE_AVG x
+ * SCOPE_CONV_US and reads V_in, I_in, V_out and I_out into a preallocated
+ * buffer of SCOPE_SAMPLES, each sample with its own micros() timestamp,
+ * then restores the acquisition setting and, after one step period for
+ * the averaging window to fill again, hands the channel back.
+ *
+ * STEP: after one step period at the present duty the scope records the
+ * pre-trigger share, steps the duty by step_pct and records the rest, all
+ * in one blocking burst inside a control pass (SCOPE_SAMPLES * period_us),
+ * then returns to the old duty.  LEVEL: the channel stays armed for up to
+ * SCOPE_ARM_TIMEOUT_MS, sampling SCOPE_ARM_SLICE_US of every control pass
+ * into a ring; the first crossing fills the rest of the buffer in one
+ * burst.  The pre-trigger part of a LEVEL capture may span the short gaps
+ * between control passes; the timestamps show them.
+ *
+ * All channels share the one buffer: a channel that asks while another
+ * captures (or while the web task copies the last capture out) waits for
+ * the next pass.
+ */
+class edugrid_scope
+{
+public:
+    edugrid_scope(edugrid_meas_channel& meas, edugrid_pwm_channel& pwm, edugrid_mpp_tracker& mppt);
+
+    void              setIndex(uint8_t index) { _index = index; }
+
+    /** Capture as soon as the channel allows it (values clamped here) */
+    void              request(const ScopeRequest_t& req);
+
+    /** Advance the state machine (control task, before the tracker) */
+    void              service(void);
+
+    /** True while a capture owns the channel; the tracker must not step then */
+    bool              active(void) const { return _phase != Phase::Idle; }
+    bool              armed(void) const  { return _phase == Phase::Armed; }
+
+    ScopeResult_t     lastResult(void) const { return _result; }
+
+    static ScopeRequest_t defaultRequest(void);
+    static const char*    resultToStr(ScopeResult_t result);
+    static const char*    signalToStr(ScopeSignal_t signal);
+    /** false: unknown name, `signal` untouched */
+    static bool           signalFromStr(const char* name, ScopeSignal_t& signal);
+
+    /** Header of the newest capture (false: none yet, or one in progress) */
+    static bool       lastHeader(ScopeHeader_t& hdr);
+    /** Write the newest capture, header and samples (web task) */
+    static bool       dump(Print& out);
+
+private:
+    enum class Phase : uint8_t { Idle = 0, Hold, Armed, Release };
+
+    bool              _claim(void);
+    void              _start(uint32_t now);
+    void              _captureStep(void);
+    void              _serviceArmed(void);
+    void              _fast(void);
+    void              _restore(void);
+    void              _publish(uint16_t pre, uint16_t n, uint32_t t0_us);
+    void              _finish(ScopeResult_t result);
+    bool              _lost(void) const;
+
+    edugrid_meas_channel& _meas;
+    edugrid_pwm_channel&  _pwm;
+    edugrid_mpp_tracker&  _mppt;
+    uint8_t           _index;
+
+    volatile bool     _requested;
+    ScopeRequest_t    _pending;        // written by the web task before _requested
+    ScopeRequest_t    _req;            // of the running capture
+
+    Phase             _phase;
+    uint32_t          _phase_ms;
+    uint16_t          _saved_fine;     // duty before the capture
+    uint8_t           _step_to;        // [%]
+    OperatingModes_t  _saved_mode;
+    uint16_t          _saved_avg;
+    uint16_t          _saved_conv;
+    bool              _fast_on;
+
+    /* ---------- Armed: ring over the shared buffer ---------- */
+    uint16_t          _ring_pos;       // next slot
+    uint16_t          _ring_fill;
+    float             _prev;           // watched signal of the last sample
+    uint32_t          _next_us;        // pacing
+
+    ScopeResult_t     _run_result;     // handed out after Release
+    ScopeResult_t     _result;
+};
+
+#endif /* EDUGRID_SCOPE_H_ */
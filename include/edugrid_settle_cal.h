@@ -0,0 +1,131 @@
+/*************************************************************************
+ * @file edugrid_settle_cal.h
+ * @date 2026/10/18
+ * @brief Step-response measurement of the converter settling time
+ ************************************************************************/
+
+#ifndef EDUGRID_SETTLE_CAL_H_
+#define EDUGRID_SETTLE_CAL_H_
+
+/*************************************************************************
+ * Include
+ ************************************************************************/
+#include <Arduino.h>
+#include <edugrid_states.h>
+#include <edugrid_meas_channel.h>
+#include <edugrid_pwm_channel.h>
+#include <edugrid_mpp_tracker.h>
+
+/*************************************************************************
+ * Define
+ ************************************************************************/
+#define SETTLE_CAL_PROBES         (4)       /* duty steps per run, alternating up/down */
+#define SETTLE_CAL_STEP_PCT       (3)       /* [%] size of one duty step */
+#define SETTLE_CAL_AVG            (4)       /* fast INA setting during a probe ... */
+#define SETTLE_CAL_CONV_US        (50)      /* ... 0.4 ms per bus+shunt result */
+#define SETTLE_CAL_SAMPLE_US      (500)     /* [us] spacing of the burst samples */
+#define SETTLE_CAL_PRE_SAMPLES    (16)      /* before the step: baseline + noise */
+#define SETTLE_CAL_POST_SAMPLES   (120)     /* after the step: 60 ms window */
+#define SETTLE_CAL_TAIL_SAMPLES   (16)      /* final value = mean of the last N */
+#define SETTLE_CAL_SMOOTH         (4)       /* band test on a running mean of N samples */
+#define SETTLE_CAL_BAND_FRAC      (0.05f)   /* settled = within 5 % of the step ... */
+#define SETTLE_CAL_NOISE_K        (3.0f)    /* ... or 3 sigma of the noise, if wider */
+#define SETTLE_CAL_MARGIN         (1.5f)    /* applied settle = measured * margin */
+#define SETTLE_CAL_MIN_MS         (2)       /* [ms] floor of the applied settle */
+
+/*************************************************************************
+ * Types
+ ************************************************************************/
+enum SettleCalResult_t : uint8_t
+{
+    SETTLE_CAL_OK = 0,
+    SETTLE_CAL_NO_RESPONSE,  ///< step not visible above the noise (no PV?)
+    SETTLE_CAL_NOT_SETTLED,  ///< still moving at the end of the window
+    SETTLE_CAL_ABORTED,      ///< mode changed / sensor lost during the run
+    SETTLE_CAL_NEVER         ///< no run finished yet
+};
+
+/*************************************************************************
+ * Class
+ ************************************************************************/
+
+/**
+ * Settling-time calibration of one converter channel.
+ *
+ * A run pauses the tracker, applies SETTLE_CAL_PROBES small duty steps and
+ * records V_in/I_in of each step at the fastest INA228 setting.  The time
+ * after which both stay inside a band around their final value, times
+ * SETTLE_CAL_MARGIN, replaces the configured ina_extra_settle_ms of this
+ * channel, so the step period of every acquisition profile shrinks to what
+ * the panel and load actually need.
+ *
+ * service() is non-blocking between probes; one probe is a burst of
+ * (PRE + POST) samples, about 70 ms, inside a single control pass.
+ * Runs start on request() or, every interval_s, while the channel is in
+ * AUTO; a failed run keeps the previous value.
+ */
+class edugrid_settle_cal
+{
+public:
+    edugrid_settle_cal(edugrid_meas_channel& meas, edugrid_pwm_channel& pwm, edugrid_mpp_tracker& mppt);
+
+    void              setIndex(uint8_t index) { _index = index; }
+
+    /** Run one calibration as soon as the channel allows it */
+    void              request(void) { _requested = true; }
+
+    /** Automatic re-runs while in AUTO; 0 disables them (see edugrid_config) */
+    void              setInterval_s(uint16_t interval_s) { _interval_s = interval_s; }
+    uint16_t          getInterval_s(void) const { return _interval_s; }
+
+    /** Advance the state machine (control task, before the tracker) */
+    void              service(void);
+
+    /** True while a run owns the duty; the tracker must not step then */
+    bool              active(void) const { return _phase != Phase::Idle; }
+
+    /* ===== Result of the last finished run ===== */
+    SettleCalResult_t lastResult(void) const   { return _result; }
+    uint16_t          settleMs(void) const     { return _settle_ms; }     ///< applied, 0 = never calibrated
+    uint32_t          measuredUs(void) const   { return _measured_us; }   ///< slowest probe
+    uint32_t          tauUs(void) const        { return _tau_us; }        ///< 63 % rise of that probe
+    uint32_t          lastRunMs(void) const    { return _last_run_ms; }
+
+    static const char* resultToStr(SettleCalResult_t result);
+
+private:
+    enum class Phase : uint8_t { Idle = 0, Hold, Release };
+
+    bool              _shouldStart(uint32_t now) const;
+    void              _start(uint32_t now);
+    SettleCalResult_t _probe(int8_t dir, uint32_t& settle_us, uint32_t& tau_us);
+    void              _finish(SettleCalResult_t result);
+
+    edugrid_meas_channel& _meas;
+    edugrid_pwm_channel&  _pwm;
+    edugrid_mpp_tracker&  _mppt;
+    uint8_t           _index;
+
+    volatile bool     _requested;
+    uint16_t          _interval_s;
+
+    Phase             _phase;
+    uint32_t          _phase_ms;       // start of the current wait
+    uint8_t           _probe_idx;
+    uint8_t           _probes_ok;
+    uint8_t           _saved_duty;
+    int8_t            _first_dir;      // +1 up first, -1 at the upper border
+    OperatingModes_t  _saved_mode;
+    SettleCalResult_t _run_result;     // last failure seen in this run
+    uint32_t          _run_worst_us;
+    uint32_t          _run_tau_us;
+
+    SettleCalResult_t _result;
+    uint16_t          _settle_ms;
+    uint32_t          _measured_us;
+    uint32_t          _tau_us;
+    uint32_t          _last_run_ms;
+    bool              _ran_once;
+};
+
+#endif /* EDUGRID_SETTLE_CAL_H_ */
@@ -10,7 +10,14 @@
  ************************************************************************/
 // #define MISSING_VOLTAGE_DRIVER_WORKAROUND
 // #define EDUGRID_TELEMETRY_ON
+// #define EDUGRID_TELEMETRY_BINARY   /* COBS+CRC frames instead of text dump */
 #define OTA_UPDATES_ENABLE
+#define EDUGRID_TRACE_ON             /* event flight recorder (edugrid_trace.h) */
+
+/*************************************************************************
+ * NOTE: values marked [cfg] are only the factory defaults; the live values
+ * come from the config blob (edugrid_config.h, GET/PUT /api/config).
+ ************************************************************************/
 
 /*************************************************************************
  * Core runtime cadence & serial link
@@ -19,25 +26,35 @@
 #define TASK_LOOP_INTERVAL_MS        (1000UL)   /* loop() logging tick */
 #define TASK_WEBSOCKET_INTERVAL_MS   (100UL)    /* WebSocket pump task */
 #define TASK_CONTROL_INTERVAL_MS     (20UL)     /* MPPT + sensing task */
-#define WS_PUSH_INTERVAL_MS          (100UL)    /* WebSocket broadcast cadence */
+#define WS_PUSH_INTERVAL_MS          (100UL)    /* [cfg] WebSocket broadcast cadence */
 
 /*************************************************************************
- * INA228 configuration (shared by AUTO & IV)
+ * INA228 configuration
+ * One acquisition profile per mode (edugrid_measurement.h): IV sweep,
+ * tracking (AUTO) and display/logging (MANUALLY).
  ************************************************************************/
 #define INA_PV_ADDR               (0x40)
 #define INA_LOAD_ADDR             (0x44)
 #define INA_SHUNT_OHMS            (0.01f)
 #define INA_MAX_CURRENT_A         (16.0f)   /* set to your HW limit */
+#define PIN_I2C_SDA               (21)      /* bus of all INA228s (ESP32 default pins) */
+#define PIN_I2C_SCL               (22)
 
 #define PV_PRESENT_V              (1.0f)
 #define ZERO_V_CLAMP              (0.02f)
 #define ZERO_I_CLAMP              (0.01f)
 
-#define INA_AVG_SAMPLES           (128UL)    /* AVG = 128 */
-#define INA_CONV_US               (1052UL)   /* 1.052 ms per shunt/bus conversion */
-#define INA_EXTRA_SETTLE_MS       (120UL)    /* extra dwell after duty change */
+#define INA_AVG_SAMPLES           (128UL)    /* [cfg] tracking: AVG = 128 */
+#define INA_CONV_US               (1052UL)   /* [cfg] tracking: 1.052 ms per shunt/bus conversion */
+#define INA_SWEEP_AVG_SAMPLES     (16UL)     /* [cfg] IV sweep: 17 ms window */
+#define INA_SWEEP_CONV_US         (540UL)    /* [cfg] */
+#define INA_DISPLAY_AVG_SAMPLES   (256UL)    /* [cfg] manual/display: 539 ms window */
+#define INA_DISPLAY_CONV_US       (1052UL)   /* [cfg] */
+#define INA_EXTRA_SETTLE_MS       (120UL)    /* [cfg] extra dwell after duty change */
+#define SETTLE_CAL_INTERVAL_S     (600)      /* [cfg] re-measure the settle in AUTO (0 = off) */
 
-/* One shared step period for AUTO (P&O) and IV Sweep (ms). 
+/* Default step period of the tracking profile (ms); the running value is
+   recomputed per channel from its active profile.
    2 conversions (shunt+bus) * AVG + settle */
 /* Round conversion window up to the next millisecond so we never sample early */
 #define INA_STEP_PERIOD_MS  ((uint32_t)(((2ULL * INA_CONV_US * INA_AVG_SAMPLES) + 999ULL) / 1000ULL) + INA_EXTRA_SETTLE_MS)
@@ -48,32 +65,149 @@
 #define CONVERTER_FREQUENCY       (39000)    /* Hz */
 #define PIN_POWER_CONVERTER_PWM   (33)
 #define PIN_SD_ENABLE             (32)
+#define PIN_INA_ALERT             (27)       /* ALERT of both INA228s (open drain, wired-OR) */
 
-/* Hard PWM bounds enforced by control code; keep consistent with IV sweep. */
+/* Hard PWM bounds enforced by control code; keep consistent with IV sweep.
+   [cfg] pwm_min_pct/pwm_max_pct may narrow this window at runtime. */
 #define PWM_MIN_DUTY_PCT          (5)
 #define PWM_MAX_DUTY_PCT          (95)       /* << Max duty is 95% as requested */
 
+/* Sub-tick duty: the LEDC duty register has 4 fractional bits, and the
+   peripheral widens the pulse by one tick in that many of every 16 PWM
+   periods (0.4 ms at 39 kHz, far inside one INA reading).  The averaged
+   duty then resolves 1/16 tick (0.025 %) instead of 0.4 %; the V_ref loop
+   and the steady-state hold set fractional duties with it. */
+#define PWM_DITHER                (0)        /* [cfg] 1 = fractional LEDC duty */
+
+/* Fast trip: the INA228s compare every conversion against these limits
+   and pull ALERT low; its ISR drops SD at once.  The control task then
+   reads the cause, waits RETRY_MS and re-enables the gate driver; more
+   than MAX_RETRIES trips within RETRY_WINDOW_S latch it off until reset. */
+#define PROT_I_IN_MAX_A           (10.0f)    /* [A] shunt over-limit, PV side */
+#define PROT_V_IN_MAX_V           (50.0f)    /* [V] bus over-limit, PV side */
+#define PROT_I_OUT_MAX_A          (15.0f)    /* [A] shunt over-limit, load side */
+#define PROT_V_OUT_MAX_V          (30.0f)    /* [V] bus over-limit, load side */
+#define PROT_RETRY_MS             (1000UL)   /* gate off before a retry */
+#define PROT_MAX_RETRIES          (3)
+#define PROT_RETRY_WINDOW_S       (60)
+
+/*************************************************************************
+ * Converter channels
+ * One row per buck converter: INA228 pair, LEDC channel, PWM, SD and
+ * INA228 ALERT pin.
+ * All channels share the I2C bus (distinct INA228 addresses) and the [cfg]
+ * knobs; each one runs its own tracker.  Use even LEDC channels only, two
+ * neighbouring channels share one LEDC timer.
+ ************************************************************************/
+#define EDUGRID_NUM_CHANNELS      (1)
+#define EDUGRID_ALL_CHANNELS      (0xFF)     /* "every channel" argument */
+
+#define EDUGRID_CHANNEL_TABLE { \
+  /* INA PV       INA LOAD       LEDC  PWM pin                  SD pin         ALERT pin     */ \
+  {  INA_PV_ADDR, INA_LOAD_ADDR, 0,    PIN_POWER_CONVERTER_PWM, PIN_SD_ENABLE, PIN_INA_ALERT }, \
+}
+/* Second converter, e.g. INA228 straps 0x41/0x45:
+  {  0x41,        0x45,          2,    25,                      26,            14            }, */
+
 /*************************************************************************
  * AUTO (P&O MPPT)
  ************************************************************************/
-#define MPPT_DUTY_STEP_PCT        (1)        /* ±1% fixed step */
-#define MPP_POWER_EPS_W           (0.02f)    /* tiny power delta = ignore flip */
+#define MPPT_DUTY_STEP_PCT        (1)        /* [cfg] default P&O step (mppt_step_pct) */
+#define MPP_POWER_EPS_W           (0.02f)    /* [cfg] tiny power delta = ignore flip */
+
+/* Steady state: when the last HISTORY steps span at most SPAN_STEPS steps
+   and reverse at least REVERSALS times, P&O is in its limit cycle (three
+   points on a sharp MPP, four or five where the curve is flat and the plant
+   lags); the duty is held at the best point of the cycle until P_in or V_in
+   moves away from the value read there, or MAX_S has passed. */
+#define MPPT_FREEZE               (1)        /* [cfg] 0 = always dither */
+#define MPPT_FREEZE_HISTORY       (16)       /* steps examined (power of 2, <= 16) */
+#define MPPT_FREEZE_SPAN_STEPS    (4)        /* widest cycle, in P&O steps */
+#define MPPT_FREEZE_REVERSALS     (3)        /* direction changes among them */
+#define MPPT_FREEZE_DP_PCT        (0.5f)     /* [%] of P_in at the hold point ... */
+#define MPPT_FREEZE_DV_PCT        (1.0f)     /* [%] ... or of V_in resumes tracking */
+#define MPPT_FREEZE_MAX_S         (60)       /* [s] re-probe after this even if steady */
+
+/* dP-P&O: classic P&O blames every dP on its own step, so a rising
+   irradiance ramp pushes it the wrong way for several steps.  A probe reads
+   a step twice, one step period apart at the same duty; the change between
+   the two readings is the environment alone (the drift).  It is taken out
+   of that step's dP and, extrapolated, out of the following ones.  A probe
+   costs a step period, so one is only taken PROBE_STEPS steps after the
+   last and while |dP| stays below PROBE_K * (|drift| + dead band), i.e.
+   near the MPP where the drift can flip the decision. */
+#define MPPT_DRIFT                (0)        /* [cfg] 1 = drift-compensated duty P&O */
+#define MPPT_DRIFT_PROBE_STEPS    (2)        /* steps between two probes, at least */
+#define MPPT_DRIFT_PROBE_K        (4.0f)
+
+/* Voltage-reference cascade: P&O steps a V_in reference by STEP_V every
+   OUTER_MS (never faster than one settled reading) and a PI loop turns the
+   error into duty on every control pass, so a load change is corrected
+   before P&O sees it.  The INAs run the sweep profile meanwhile, whose
+   window must fit into TASK_CONTROL_INTERVAL_MS.  Gains act on duty [%]:
+   duty = KP * e + KI * integral(e dt), e = V_in - V_ref (higher duty pulls
+   V_in down).  KI * TASK_CONTROL_INTERVAL_MS times the steepest dV/dduty
+   near the MPP (about 0.5 V/% on the lab panel) must stay well below 1.
+   The steady-state hold above only applies to duty P&O. */
+#define MPPT_VREF                 (0)        /* [cfg] 1 = cascade instead of duty P&O */
+#define MPPT_VREF_KP              (1.0f)     /* [cfg] [%/V] */
+#define MPPT_VREF_KI              (50.0f)    /* [cfg] [%/(V*s)] */
+#define MPPT_VREF_STEP_V          (0.2f)     /* [cfg] P&O step of the reference */
+#define MPPT_VREF_OUTER_MS        (100UL)    /* outer P&O period */
+#define MPPT_VREF_DEADBAND_V      (0.05f)    /* |e| below this holds the duty */
+
+/* Objective: P&O (duty or V_ref, and the steady-state hold) maximises
+   (1 - W) * P_in + W * P_out.  Converter losses depend on the duty, so the
+   maximum of P_in is not the maximum of the power delivered to the load.
+   P_out comes from the load-side INA, whose power differences between two
+   steps are smaller against its noise: the dP dead band grows to
+   NOISE_K * W * sigma(P_out), sigma from pairs of P_out / P_in readings at
+   the same operating point (EWMA with NOISE_ALPHA, a pair clipped at
+   NOISE_CLIP sigma).  Without a load sensor the objective is P_in. */
+#define MPPT_POUT_WEIGHT          (0.0f)     /* [cfg] 0 = P_in (classic), 1 = P_out */
+#define MPPT_POUT_NOISE_K         (2.0f)     /* dead band in sigma(P_out) */
+#define MPPT_POUT_NOISE_ALPHA     (0.1f)     /* EWMA weight of a new pair */
+#define MPPT_POUT_NOISE_CLIP      (3.0f)     /* pair difference capped at this many sigma */
+#define MPPT_POUT_NOISE_MIN_W     (1.0f)     /* [W] no pairs below this P_in */
+
+/* Battery charging: while tracking, V_out (CV) and I_out (CC) are held at
+   their limits by a duty ceiling the tracker runs under.  Less duty moves
+   the panel towards Voc, so the ceiling always cuts power.  It engages when
+   a limit comes within ENGAGE_PCT and then moves by GAIN * headroom [% of
+   the limit] per fresh load reading; it only climbs while the duty sits at
+   it and is lifted at the border or once the headroom reaches RELEASE_PCT. */
+#define CHARGE_V_MAX              (0.0f)     /* [cfg] [V] CV limit on V_out, 0 = off */
+#define CHARGE_I_MAX              (0.0f)     /* [cfg] [A] CC limit on I_out, 0 = off */
+#define CHARGE_GAIN               (0.3f)     /* [% duty per % headroom] */
+#define CHARGE_ENGAGE_PCT         (1.0f)     /* [%] of the limit */
+#define CHARGE_RELEASE_PCT        (5.0f)     /* [%] of the limit */
 
 /*************************************************************************
  * IV Sweep settings
- * We sweep integer duty percent values MIN..MAX inclusive in STEP increments.
+ * Duties are integer percent values MIN..MAX.  The sweep first steps the
+ * whole range in COARSE increments, then bisects the segments around the
+ * MPP (down to STEP) and where the curve bends, until the point budget is
+ * spent.
  ************************************************************************/
 #define IV_SWEEP_D_MIN_PCT        (5)        /* [%] */
 #define IV_SWEEP_D_MAX_PCT        (95)       /* [%] keep aligned with PWM_MAX */
-#define IV_SWEEP_STEP_PCT         (1)        /* [%] */
+#define IV_SWEEP_STEP_PCT         (1)        /* [%] finest spacing */
+#define IV_SWEEP_COARSE_PCT       (6)        /* [%] spacing of the first pass */
+#define IV_SWEEP_BUDGET           (32)       /* [cfg] points per sweep, both passes */
+#define IV_SWEEP_LIN_TOL          (0.01f)    /* refine while a point is off its neighbours' chord by more
+                                                than this share of Voc/Isc */
+#define IV_SWEEP_BIDIR            (0)        /* [cfg] 1 = coarse down pass after the up pass */
 
-/* Derived: number of points, e.g., 5..95 step 1 => 91 points */
-#define IV_SWEEP_POINTS  (((IV_SWEEP_D_MAX_PCT - IV_SWEEP_D_MIN_PCT) / IV_SWEEP_STEP_PCT) + 1)
+/* Background characterisation: a short sweep from AUTO that returns to the
+   tracked duty.  The next one waits at least until the energy it cost is at
+   most IV_BG_MAX_COST_PCT of what the MPP delivers in between. */
+#define IV_BG_INTERVAL_S          (900)      /* [cfg] between background sweeps (0 = off) */
+#define IV_BG_POINTS              (20)       /* [cfg] point budget of a background sweep */
+#define IV_BG_MAX_COST_PCT        (1.0f)     /* [%] loss cap, stretches the interval */
 
-// Size for /ivsweep/data JSON payload: {v:[], i:[], p:[], in_progress:bool, done:bool}
-#ifndef K_IV_JSON_CAPACITY
-#define K_IV_JSON_CAPACITY  ( JSON_OBJECT_SIZE(5) + 3 * JSON_ARRAY_SIZE(IV_SWEEP_POINTS) )
-#endif
+/* Derived: e.g., 5..95 step 1 => 91 points (buffer size), step 6 => 16 */
+#define IV_SWEEP_POINTS         (((IV_SWEEP_D_MAX_PCT - IV_SWEEP_D_MIN_PCT) / IV_SWEEP_STEP_PCT) + 1)
+#define IV_SWEEP_COARSE_POINTS  (((IV_SWEEP_D_MAX_PCT - IV_SWEEP_D_MIN_PCT) / IV_SWEEP_COARSE_PCT) + 1)
 
 /* Old software settle/averaging knobs are now unused because we rely on the INA’s
    built-in averaging + INA_STEP_PERIOD_MS cadence. Keep for compatibility = 0. */
@@ -90,15 +224,24 @@
 #if ((IV_SWEEP_D_MAX_PCT - IV_SWEEP_D_MIN_PCT) % IV_SWEEP_STEP_PCT) != 0
 #error "Sweep range must be divisible by IV_SWEEP_STEP_PCT"
 #endif
-#if (MPPT_DUTY_STEP_PCT != IV_SWEEP_STEP_PCT)
-#error "Keep MPPT and IV sweep duty steps identical so dwell timing matches"
+#if ((IV_SWEEP_D_MAX_PCT - IV_SWEEP_D_MIN_PCT) % IV_SWEEP_COARSE_PCT) != 0
+#error "Sweep range must be divisible by IV_SWEEP_COARSE_PCT"
+#endif
+#if (IV_SWEEP_BUDGET < IV_SWEEP_COARSE_POINTS) || (IV_SWEEP_BUDGET > IV_SWEEP_POINTS)
+#error "IV_SWEEP_BUDGET must lie within IV_SWEEP_COARSE_POINTS..IV_SWEEP_POINTS"
+#endif
+#if (IV_BG_POINTS < IV_SWEEP_COARSE_POINTS) || (IV_BG_POINTS > IV_SWEEP_POINTS)
+#error "IV_BG_POINTS must lie within IV_SWEEP_COARSE_POINTS..IV_SWEEP_POINTS"
+#endif
+#if (MPPT_FREEZE_HISTORY & (MPPT_FREEZE_HISTORY - 1)) || (MPPT_FREEZE_HISTORY > 16)
+#error "MPPT_FREEZE_HISTORY must be a power of 2 and at most 16"
 #endif
 
 /*************************************************************************
  * Manual mode slew limiting (UI slider)
  ************************************************************************/
-#define MANUAL_SLEW_STEP_PCT      (1)        /* 1% per ramp step */
-#define MANUAL_SLEW_INTERVAL_MS   (20)       /* 20 ms between steps */
+#define MANUAL_SLEW_STEP_PCT      (1)        /* [cfg] 1% per ramp step */
+#define MANUAL_SLEW_INTERVAL_MS   (20)       /* [cfg] 20 ms between steps */
 
 /*************************************************************************
  * Filesystem states (unchanged)
@@ -7,16 +7,85 @@
 
 #include <Arduino.h>
 #include <edugrid_states.h>
-#include <edugrid_pwm_control.h>
-#include <edugrid_mpp_algorithm.h>
-#include <edugrid_measurement.h>
+#include <edugrid_channel.h>
 
+/*************************************************************************
+ * Define
+ ************************************************************************/
+#define TELEMETRY_RING_SIZE          (64)     /* records, power of two */
+#define TELEMETRY_PUSH_DECIMATION    (1)      /* push every Nth control tick (per channel) */
+#define TELEMETRY_STATS_EVERY        (50)     /* stats frame/line every N records */
+#define TELEMETRY_DRAIN_IDLE_MS      (10)     /* drain task sleep when ring empty */
+#define TELEMETRY_TASK_STACK         (4096)
+#define TELEMETRY_TASK_PRIORITY      (0)      /* below the WebSocket pump */
+#define TELEMETRY_TASK_CORE          (0)      /* keep UART work off the control core */
+
+/* Binary stream framing: COBS(type | payload | crc16) followed by 0x00.
+ * CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF) over type + payload.
+ * Decoder: script/host/edugrid_telemetry_decode.py */
+#define TELEMETRY_FRAME_RECORD       (0x01)
+#define TELEMETRY_FRAME_STATS        (0x02)
+
+#if (TELEMETRY_RING_SIZE & (TELEMETRY_RING_SIZE - 1)) != 0
+#error "TELEMETRY_RING_SIZE must be a power of two"
+#endif
+
+/*************************************************************************
+ * Types
+ ************************************************************************/
+enum TelemetryFormat_t : uint8_t
+{
+    TELEMETRY_FORMAT_HUMAN = 0,  ///< multi-line dump (bring-up)
+    TELEMETRY_FORMAT_BINARY      ///< COBS + CRC framed records
+};
+
+/** One control-loop snapshot (little endian, packed on the wire) */
+struct __attribute__((packed)) TelemetryRecord_t
+{
+    uint32_t t_ms;
+    uint16_t seq;        ///< per stream, gaps = dropped records
+    uint8_t  ch;         ///< converter channel
+    uint8_t  mode;       ///< OperatingModes_t
+    uint8_t  pwm_pct;
+    uint32_t freq_hz;
+    float    vin;
+    float    iin;
+    float    vout;
+    float    iout;
+};
+
+struct __attribute__((packed)) TelemetryStats_t
+{
+    uint32_t pushed;
+    uint32_t dropped;    ///< ring full when the control task pushed
+};
+
+/*************************************************************************
+ * Class
+ ************************************************************************/
 class edugrid_telemetry
 {
 public:
-    // Optional helper that prints a detailed status dump to the serial console
-    // when EDUGRID_TELEMETRY_ON is defined.  Useful during bring-up.
-    static void telemetryPrint(void);
+    // Start the low-priority drain task.  Call once from setup() when
+    // EDUGRID_TELEMETRY_ON is defined.
+    static void begin(TelemetryFormat_t format);
+
+    // Control task side: snapshot the cached values of one converter channel
+    // into the ring.  Never blocks and never touches the UART; a full ring
+    // counts a drop.
+    static void push(uint8_t ch);
+
+    static void getStats(uint32_t& pushed, uint32_t& dropped);
+
+    // Kept for bring-up sketches: immediately prints the human dump.  Do not
+    // call from the control task, use push() there.
+    static void telemetryPrint(uint8_t ch = 0);
+
+private:
+    static void _drainTask(void* pvParameters);
+    static void _emitHuman(const TelemetryRecord_t& rec);
+    static void _fill(TelemetryRecord_t& rec, uint8_t ch);
+    static void _emitFrame(uint8_t type, const void* payload, size_t len);
 };
 
 #endif /* EDUGRID_TELEMETRY_H_ */
@@ -0,0 +1,130 @@
+/*************************************************************************
+ * @file edugrid_trace.h
+ * @date 2026/10/18
+ * @brief Event flight recorder (fixed-size binary ring in RAM)
+ ************************************************************************/
+
+#ifndef EDUGRID_TRACE_H_
+#define EDUGRID_TRACE_H_
+
+/*************************************************************************
+ * Include
+ ************************************************************************/
+#include <Arduino.h>
+#include <edugrid_states.h>
+
+/*************************************************************************
+ * Define
+ ************************************************************************/
+#define TRACE_RING_SIZE         (256)    /* events, power of two (4 KB) */
+
+/* Dump layout (GET /api/trace, serial 't'):
+ *   TraceDumpHeader_t, then the events oldest -> newest.
+ * Serial dumps carry the same bytes hex encoded, one record per line,
+ * between TRACE_SERIAL_BEGIN and TRACE_SERIAL_END.
+ * Renderer: script/host/edugrid_trace_render.py */
+#define TRACE_DUMP_MAGIC        (0x52544745UL)  /* "EGTR" (little endian) */
+#define TRACE_DUMP_VERSION      (3)     /* v2: 16-byte events with channel, v3: dropped count */
+#define TRACE_CH_NONE           (0xFF)  /* event not tied to a converter channel */
+#define TRACE_SERIAL_BEGIN      ("#TRACE-BEGIN")
+#define TRACE_SERIAL_END        ("#TRACE-END")
+
+#if (TRACE_RING_SIZE & (TRACE_RING_SIZE - 1)) != 0
+#error "TRACE_RING_SIZE must be a power of two"
+#endif
+
+/*************************************************************************
+ * Types
+ ************************************************************************/
+enum TraceEventType_t : uint8_t
+{
+    TRACE_EV_BOOT = 1,       ///< a8 = esp_reset_reason()
+    TRACE_EV_MODE,           ///< a8 = new mode, a16 = old mode
+    TRACE_EV_PWM,            ///< a8 = PwmSource_t, a16 = new duty, a32 = old duty [whole %]
+    TRACE_EV_IV_PHASE,       ///< a8 = phase, a16 = point index, a32 = duty [%]
+    TRACE_EV_CALIBRATION,    ///< a8 = sensor (0 PV, 1 LOAD), a32 = offset [A] as float bits
+    TRACE_EV_WS_CONNECT,     ///< a8 = client number, a32 = IPv4 address
+    TRACE_EV_WS_DISCONNECT,  ///< a8 = client number
+    TRACE_EV_LOOP_OVERRUN,   ///< a8 = TraceTask_t, a16 = budget [ms], a32 = elapsed [us]
+    TRACE_EV_SETTLE_CAL,     ///< a8 = SettleCalResult_t, a16 = applied settle [ms], a32 = measured [us]
+    TRACE_EV_ACQ_PROFILE,    ///< a8 = AcqProfile_t, a16 = step period [ms], a32 = avg << 16 | conv [us]
+    TRACE_EV_MPPT_FREEZE,    ///< a8 = MpptFreezeEvent_t, a16 = duty [%], a32 = P&O objective [mW]
+    TRACE_EV_CHARGE,         ///< a8 = ChargeState_t, a16 = duty ceiling [%], a32 = P_out [mW]
+    TRACE_EV_PROTECT,        ///< a8 = ProtState_t, a16 = InaAlertCause_t bits, a32 = ISR -> service [us]
+    TRACE_EV_FREQ_MAP,       ///< a8 = FreqMapEvent_t, a16 = result / new freq [100 Hz], a32 = run [ms] / old freq [Hz]
+    TRACE_EV_SCOPE,          ///< a8 = ScopeResult_t, a16 = samples, a32 = sample spacing [us]
+    TRACE_EV_I2C_RECOVER     ///< a8 = failing device (0 PV, 1 LOAD), a16 = its failed reads in a row, a32 = recoveries
+};
+
+enum TraceTask_t : uint8_t
+{
+    TRACE_TASK_CONTROL = 0,
+    TRACE_TASK_WEBSOCKET
+};
+
+/** One recorded event, 16 bytes, little endian on the wire */
+struct TraceEvent_t
+{
+    uint32_t t_ms;
+    uint8_t  type;          ///< TraceEventType_t
+    uint8_t  ch;            ///< converter channel or TRACE_CH_NONE
+    uint8_t  a8;
+    uint8_t  reserved0;
+    uint16_t a16;
+    uint16_t reserved1;
+    uint32_t a32;
+};
+
+struct TraceDumpHeader_t
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t event_size;
+    uint32_t total;         ///< events recorded since boot (seq of newest + 1)
+    uint32_t now_ms;        ///< millis() when the dump was taken
+    uint32_t dropped;       ///< events rejected while a dump or clear() held the ring (v3)
+};
+
+static_assert(sizeof(TraceEvent_t) == 16, "trace event layout is part of the dump format");
+static_assert(sizeof(TraceDumpHeader_t) == 20, "trace header layout is part of the dump format");
+
+/*************************************************************************
+ * Class
+ ************************************************************************/
+
+/**
+ * Class with static members for the flight recorder.
+ *
+ * record() claims a slot with one atomic increment and fills it in place, so
+ * it is safe from every task and costs a handful of instructions.  The ring
+ * silently overwrites the oldest events.  dump() freezes recording only for
+ * the copy into a snapshot, after the writers already past the check are
+ * done, and writes the output from that copy; events that arrive during the
+ * freeze are counted in the header's `dropped`.
+ */
+class edugrid_trace
+{
+public:
+    static inline void record(TraceEventType_t type, uint8_t a8 = 0, uint16_t a16 = 0, uint32_t a32 = 0,
+                              uint8_t ch = TRACE_CH_NONE)
+    {
+#ifdef EDUGRID_TRACE_ON
+        _record(type, a8, a16, a32, ch);
+#else
+        (void)type; (void)a8; (void)a16; (void)a32; (void)ch;
+#endif
+    }
+
+    static void recordFloat(TraceEventType_t type, uint8_t a8, float value, uint8_t ch = TRACE_CH_NONE);
+
+    // Write the ring (header + events) to `out`: raw bytes for HTTP, hex
+    // lines framed by TRACE_SERIAL_BEGIN/END for the serial console.
+    static void dump(Print& out, bool hex);
+
+    static void clear(void);
+
+private:
+    static void _record(TraceEventType_t type, uint8_t a8, uint16_t a16, uint32_t a32, uint8_t ch);
+};
+
+#endif /* EDUGRID_TRACE_H_ */
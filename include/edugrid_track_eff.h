@@ -0,0 +1,105 @@
+/*************************************************************************
+ * @file edugrid_track_eff.h
+ * @date 2026/10/18
+ * @brief Tracking efficiency: harvested against available power in AUTO
+ ************************************************************************/
+
+#ifndef EDUGRID_TRACK_EFF_H_
+#define EDUGRID_TRACK_EFF_H_
+
+/*************************************************************************
+ * Include
+ ************************************************************************/
+#include <Arduino.h>
+#include <edugrid_states.h>
+#include <edugrid_meas_channel.h>
+#include <edugrid_mpp_tracker.h>
+#include <edugrid_charger.h>
+
+/*************************************************************************
+ * Define
+ ************************************************************************/
+#define TRACK_EFF_MIN_P_W         (1.0f)     /* [W] a sweep below this is no reference */
+#define TRACK_EFF_TAU_MS          (10000UL)  /* smoothing of the instantaneous efficiency */
+
+/*************************************************************************
+ * Class
+ ************************************************************************/
+
+/**
+ * MPPT tracking efficiency of one converter channel.
+ *
+ * Every finished IV sweep (manual or background) becomes the reference:
+ * its up-pass I-V points, plus a diode fit ln(I_ph - I) = ln(a) + V / b of
+ * the points between the MPP and Voc that continues the curve past its
+ * highest voltage.  More light adds photocurrent at every voltage alike, so
+ * between sweeps the present current minus the reference current at the
+ * present voltage shifts the whole reference curve, and the largest V * I
+ * on the shifted curve is the available power (never below P_in).  This
+ * works from wherever on the curve the tracker sits.
+ *
+ * Every control pass in AUTO, background sweeps included, adds P_in and
+ * the available power to two energy counters; their ratio is the
+ * cumulative tracking efficiency, the ratio of their TRACK_EFF_TAU_MS
+ * averages the instantaneous one.  While a background sweep runs the shift
+ * is held, so its cost counts against the tracker.  Passes in which the
+ * charger holds the duty below the MPP on purpose are left out.
+ *
+ * The shift follows irradiance, not panel temperature or a shading pattern
+ * that changed since the sweep; both read a little low until the next
+ * background sweep.
+ */
+class edugrid_track_eff
+{
+public:
+    edugrid_track_eff(const edugrid_meas_channel& meas, const edugrid_mpp_tracker& mppt,
+                      const edugrid_charger& charge);
+
+    /** Take the tracker's finished sweep as the new reference */
+    void              capture(void);
+
+    /** One control pass (after the tracker, gate driver on) */
+    void              service(void);
+
+    /** A reference sweep exists; without one every value below is NAN */
+    bool              valid(void) const      { return _ref_n > 0; }
+    /** Available power at the present irradiance [W] */
+    float             availableW(void) const;
+    /** P_in / available power, averaged over TRACK_EFF_TAU_MS */
+    float             etaNow(void) const;
+    /** Harvested / available energy since boot */
+    float             etaTotal(void) const;
+    float             harvestJ(void) const   { return (float)_e_harvest_j; }
+    float             availableJ(void) const { return (float)_e_avail_j; }
+    /** Time since the reference sweep [ms], 0 without one */
+    uint32_t          refAgeMs(void) const;
+
+private:
+    float             _refCurrentAt(float v) const;
+    float             _refPowerMax(float di) const;
+
+    const edugrid_meas_channel& _meas;
+    const edugrid_mpp_tracker&  _mppt;
+    const edugrid_charger&      _charge;
+
+    /* ---------- Reference sweep (up pass, falling V_in) ---------- */
+    float             _ref_v[IV_SWEEP_POINTS];
+    float             _ref_i[IV_SWEEP_POINTS];
+    uint16_t          _ref_n;
+    uint32_t          _ref_ms;
+    bool              _diode_ok;      // I = I_ph - exp(ln_a + V / b) past _ref_v[0]
+    float             _diode_i_ph;
+    float             _diode_ln_a;
+    float             _diode_inv_b;   // [1/V]
+
+    /* ---------- Estimate ---------- */
+    float             _p_avail;       // MPP of the shifted reference [W]
+    float             _p_in_avg;      // [W] TRACK_EFF_TAU_MS averages ...
+    float             _p_avail_avg;   // ... of both powers
+    bool              _avg_valid;
+    double            _e_harvest_j;   // double: a float stops adding ~4 J
+    double            _e_avail_j;     // passes after a day at full power
+    uint32_t          _last_ms;
+};
+
+#endif /* EDUGRID_TRACK_EFF_H_ */
@@ -21,6 +21,7 @@
 #include <edugrid_filesystem.h>
 #include <edugrid_mpp_algorithm.h>
 #include <edugrid_logging.h>
+#include <edugrid_payload.h>
 
 /*************************************************************************
  * Defines
@@ -36,6 +37,7 @@
 #define WEBSERVER_ID_MODE_LABEL       ("mode_label")
 #define WEBSERVER_ID_LOGGING_LABEL    ("logging_label")
 #define WEBSERVER_ID_PWM_FREQ_LABEL   ("freq_label")
+#define WEBSERVER_ID_WIFI_SAVE        ("safe_button")   /* admin.html */
 
 /* Filesystem paths */
 #define WEBSERVER_HOME_PATH   ("/www/index.html")
@@ -59,6 +61,7 @@ private:
     static void handleUpload(AsyncWebServerRequest* request, String filename,
                          size_t index, uint8_t* data, size_t len, bool final);
     static String listFiles(bool ishtml);
+    static void webSocketEvent(uint8_t num, WStype_t type, uint8_t* payload, size_t length);
     static String _id;
     static String _state;
 };
@@ -0,0 +1,96 @@
+#!/usr/bin/env python3
+"""Convert an EduGrid scope capture into CSV, with the step response figures.
+
+Reads the binary from GET /api/scope?raw=1 (layout: ScopeHeader_t, then n
+ScopeSample_t, see include/edugrid_scope.h) and writes one row per sample.
+For a step capture it also reports, per signal, the step size and the time
+after which the signal stays inside a band around its final value: compare
+it with the settle time /api/settle applied.
+
+Usage:
+    curl -o scope.bin "http://192.168.1.1/api/scope?raw=1"
+    edugrid_scope_render.py scope.bin > scope.csv
+    edugrid_scope_render.py scope.bin --band 0.05 --summary
+"""
+
+import argparse
+import csv
+import struct
+import sys
+
+MAGIC = 0x43534745
+HEADER = struct.Struct("<IHHHHHHHBBBBBBfIII")  # ScopeHeader_t
+SAMPLE = struct.Struct("<iffff")               # ScopeSample_t
+TRIGGERS = {0: "step", 1: "level"}
+SIGNALS = ["v_in", "i_in", "v_out", "i_out"]
+
+
+def load(path):
+    with open(path, "rb") as f:
+        data = f.read()
+    if len(data) < HEADER.size or struct.unpack_from("<I", data)[0] != MAGIC:
+        raise SystemExit("no scope capture in " + path)
+    (magic, version, hdr_size, n, pre, period_us, conv_us, avg, ch, trigger, signal,
+     rising, duty_from, duty_to, level, seq, unix_s, uptime_ms) = HEADER.unpack_from(data)
+    if version != 1:
+        raise SystemExit(f"unsupported capture (version {version})")
+    hdr = dict(n=n, pre=pre, period_us=period_us, conv_us=conv_us, avg=avg, ch=ch,
+               trigger=TRIGGERS.get(trigger, trigger), signal=SIGNALS[signal % 4],
+               edge="rise" if rising else "fall", duty_from=duty_from, duty_to=duty_to,
+               level=level, seq=seq, unix_s=unix_s, uptime_ms=uptime_ms)
+    n = min(n, (len(data) - hdr_size) // SAMPLE.size)
+    rows = [SAMPLE.unpack_from(data, hdr_size + k * SAMPLE.size) for k in range(n)]
+    return hdr, rows
+
+
+def settle(rows, pre, col, band_frac):
+    """(step, settle time [ms]) of one signal; None if it did not move."""
+    before = [r[col] for r in rows[:pre]]
+    after = rows[pre:]
+    if not before or len(after) < 10:
+        return None
+    tail = [r[col] for r in after[-max(len(after) // 10, 1):]]
+    x0 = sum(before) / len(before)
+    x1 = sum(tail) / len(tail)
+    step = x1 - x0
+    if step == 0.0:
+        return None
+    band = abs(step) * band_frac
+    t_settle = after[0][0]
+    for r in after:
+        if abs(r[col] - x1) > band:
+            t_settle = r[0]
+    return step, t_settle / 1000.0
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("file", help="binary capture")
+    ap.add_argument("--band", type=float, default=0.05, help="settled band, fraction of the step")
+    ap.add_argument("--summary", action="store_true", help="only the header and the step figures")
+    args = ap.parse_args()
+
+    hdr, rows = load(args.file)
+    out = sys.stderr if not args.summary else sys.stdout
+    print(f"# capture #{hdr['seq']} CH{hdr['ch']}: {len(rows)} samples every {hdr['period_us']} us "
+          f"(avg {hdr['avg']} x {hdr['conv_us']} us), trigger {hdr['trigger']} at sample {hdr['pre']}", file=out)
+    if hdr["trigger"] == "step":
+        print(f"# duty {hdr['duty_from']}% -> {hdr['duty_to']}%", file=out)
+        for k, name in enumerate(SIGNALS):
+            res = settle(rows, hdr["pre"], k + 1, args.band)
+            if res is not None:
+                print(f"# {name:5s} step {res[0]:+8.4f}, inside {args.band * 100:.0f} % after {res[1]:7.2f} ms",
+                      file=out)
+    else:
+        print(f"# {hdr['signal']} {hdr['edge']} past {hdr['level']:.4f}", file=out)
+    if args.summary:
+        return
+
+    w = csv.writer(sys.stdout)
+    w.writerow(["t_ms"] + SIGNALS)
+    for t_us, v_in, i_in, v_out, i_out in rows:
+        w.writerow([f"{t_us / 1000.0:.3f}", f"{v_in:.4f}", f"{i_in:.4f}", f"{v_out:.4f}", f"{i_out:.4f}"])
+
+
+if __name__ == "__main__":
+    main()
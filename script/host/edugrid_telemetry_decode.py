@@ -0,0 +1,125 @@
+#!/usr/bin/env python3
+"""Decode the EduGrid binary telemetry stream into CSV.
+
+The firmware (EDUGRID_TELEMETRY_ON + EDUGRID_TELEMETRY_BINARY) writes frames
+COBS(type | payload | crc16_le) followed by 0x00, see edugrid_telemetry.h.
+
+Usage:
+    edugrid_telemetry_decode.py capture.bin > telemetry.csv
+    edugrid_telemetry_decode.py --port /dev/ttyUSB0 > telemetry.csv   (needs pyserial)
+"""
+
+import argparse
+import binascii
+import csv
+import struct
+import sys
+
+FRAME_RECORD = 0x01
+FRAME_STATS = 0x02
+
+RECORD = struct.Struct("<IHBBBIffff")  # TelemetryRecord_t
+STATS = struct.Struct("<II")           # TelemetryStats_t
+
+MODES = {0: "MANUALLY", 1: "AUTO", 2: "IV_SWEEP"}
+
+COLUMNS = ["t_ms", "seq", "ch", "mode", "pwm_pct", "freq_hz",
+           "vin", "iin", "pin", "vout", "iout", "pout", "eff"]
+
+
+def cobs_decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        if code == 0 or i + code > len(data):
+            raise ValueError("bad COBS code")
+        out += data[i + 1:i + code]
+        i += code
+        if code < 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def frames(stream):
+    """Yield raw (still COBS encoded) frames split at 0x00."""
+    buf = bytearray()
+    while True:
+        chunk = stream.read(4096)
+        if not chunk:
+            break
+        buf += chunk
+        while True:
+            end = buf.find(b"\x00")
+            if end < 0:
+                break
+            if end > 0:
+                yield bytes(buf[:end])
+            del buf[:end + 1]
+
+
+def decode(stream, out, err):
+    writer = csv.writer(out)
+    writer.writerow(COLUMNS)
+    bad = 0
+    lost = 0
+    last_seq = None
+    for raw in frames(stream):
+        try:
+            frame = cobs_decode(raw)
+        except ValueError:
+            bad += 1
+            continue
+        if len(frame) < 3:
+            bad += 1
+            continue
+        body, crc = frame[:-2], struct.unpack("<H", frame[-2:])[0]
+        if binascii.crc_hqx(body, 0xFFFF) != crc:
+            bad += 1
+            continue
+
+        ftype, payload = body[0], body[1:]
+        if ftype == FRAME_RECORD and len(payload) == RECORD.size:
+            t_ms, seq, ch, mode, pwm, freq, vin, iin, vout, iout = RECORD.unpack(payload)
+            if last_seq is not None:
+                lost += (seq - last_seq - 1) & 0xFFFF
+            last_seq = seq
+            pin = vin * iin
+            pout = vout * iout
+            eff = pout / pin if pin > 1e-3 else 0.0
+            writer.writerow([t_ms, seq, ch, MODES.get(mode, mode), pwm, freq,
+                             f"{vin:.4f}", f"{iin:.4f}", f"{pin:.3f}",
+                             f"{vout:.4f}", f"{iout:.4f}", f"{pout:.3f}", f"{eff:.4f}"])
+        elif ftype == FRAME_STATS and len(payload) == STATS.size:
+            pushed, dropped = STATS.unpack(payload)
+            print(f"[stats] pushed={pushed} dropped={dropped}", file=err)
+        else:
+            bad += 1
+
+    print(f"[done] bad_frames={bad} seq_gaps={lost}", file=err)
+    return 0 if bad == 0 else 1
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("file", nargs="?", help="captured binary stream (default: stdin)")
+    ap.add_argument("--port", help="read live from a serial port instead")
+    ap.add_argument("--baud", type=int, default=115200)
+    args = ap.parse_args()
+
+    if args.port:
+        import serial  # pyserial, only needed for live capture
+        stream = serial.Serial(args.port, args.baud, timeout=1)
+    elif args.file:
+        stream = open(args.file, "rb")
+    else:
+        stream = sys.stdin.buffer
+
+    try:
+        return decode(stream, sys.stdout, sys.stderr)
+    except KeyboardInterrupt:
+        return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,163 @@
+#!/usr/bin/env python3
+"""Render an EduGrid event trace as a timeline.
+
+Accepts either the binary dump from GET /api/trace or a serial console log
+containing a '#TRACE-BEGIN' ... '#TRACE-END' hex block (press 't' on the
+console). Layout: see include/edugrid_trace.h.
+
+Usage:
+    curl -o trace.bin http://192.168.1.1/api/trace
+    edugrid_trace_render.py trace.bin
+    edugrid_trace_render.py console.log --csv > trace.csv
+"""
+
+import argparse
+import struct
+import sys
+
+MAGIC = 0x52544745
+HEADER = struct.Struct("<IHHII")    # TraceDumpHeader_t up to v2
+HEADER_V3 = struct.Struct("<IHHIII")  # v3: + dropped
+EVENTS = {
+    1: struct.Struct("<IBBHI"),      # v1: t_ms, type, a8, a16, a32
+    2: struct.Struct("<IBBBxHxxI"),  # v2: t_ms, type, ch, a8, a16, a32
+    3: struct.Struct("<IBBBxHxxI"),  # v3: as v2
+}
+CH_NONE = 0xFF
+
+MODES = {0: "MANUAL", 1: "AUTO", 2: "IV_SWEEP"}
+PWM_SOURCES = {0: "unknown", 1: "init", 2: "manual-ramp", 3: "ui-step",
+               4: "mppt", 5: "iv-sweep", 6: "border", 7: "settle-cal",
+               8: "vref-pi", 9: "charge", 10: "trip", 11: "freq-map",
+               12: "scope"}
+IV_PHASES = {0: "Idle", 1: "Arm", 2: "Sample", 3: "Done", 4: "Refine", 5: "Down"}
+SENSORS = {0: "PV", 1: "LOAD"}
+TASKS = {0: "control", 1: "websocket"}
+SETTLE_RESULTS = {0: "ok", 1: "no response", 2: "not settled", 3: "aborted"}
+ACQ_PROFILES = {0: "sweep", 1: "track", 2: "display"}
+FREEZE_EVENTS = {0: "hold", 1: "resume (P moved)", 2: "resume (V_in moved)", 3: "resume (timeout)"}
+CHARGE_STATES = {0: "mppt", 1: "cc", 2: "cv"}
+PROT_STATES = {0: "ok", 1: "tripped", 2: "latched", 3: "unarmed"}
+ALERT_CAUSES = ((1, "I_in"), (2, "V_in"), (4, "I_out"), (8, "V_out"))
+FREQ_MAP_RESULTS = {0: "ok", 1: "no power", 2: "aborted"}
+SCOPE_RESULTS = {0: "ok", 1: "timeout", 2: "aborted"}
+
+
+def _f32(bits):
+    return struct.unpack("<f", struct.pack("<I", bits))[0]
+
+
+def _ip(bits):
+    return ".".join(str((bits >> s) & 0xFF) for s in (0, 8, 16, 24))
+
+
+def describe(etype, a8, a16, a32):
+    """Return (name, text) for one event."""
+    if etype == 1:
+        return "BOOT", f"reset reason {a8}"
+    if etype == 2:
+        return "MODE", f"{MODES.get(a16, a16)} -> {MODES.get(a8, a8)}"
+    if etype == 3:
+        return "PWM", f"{a32:3d}% -> {a16:3d}%  ({PWM_SOURCES.get(a8, a8)})"
+    if etype == 4:
+        return "IV", f"phase {IV_PHASES.get(a8, a8)}  point {a16}  duty {a32}%"
+    if etype == 5:
+        return "CAL", f"{SENSORS.get(a8, a8)} zero offset {_f32(a32):+.4f} A"
+    if etype == 6:
+        return "WS+", f"client {a8} connected from {_ip(a32)}"
+    if etype == 7:
+        return "WS-", f"client {a8} disconnected"
+    if etype == 8:
+        return "OVERRUN", f"{TASKS.get(a8, a8)} loop took {a32 / 1000.0:.1f} ms (budget {a16} ms)"
+    if etype == 9:
+        return "SETTLE", f"{SETTLE_RESULTS.get(a8, a8)}: measured {a32 / 1000.0:.1f} ms, settle {a16} ms"
+    if etype == 10:
+        return "ACQ", (f"profile {ACQ_PROFILES.get(a8, a8)}: avg {a32 >> 16} x {a32 & 0xFFFF} us, "
+                       f"step period {a16} ms")
+    if etype == 11:
+        return "FREEZE", f"{FREEZE_EVENTS.get(a8, a8)} at {a16}%, P {a32 / 1000.0:.2f} W"
+    if etype == 12:
+        return "CHARGE", f"-> {CHARGE_STATES.get(a8, a8)}, ceiling {a16}%, P_out {a32 / 1000.0:.2f} W"
+    if etype == 13:
+        cause = "+".join(name for bit, name in ALERT_CAUSES if a16 & bit) or "-"
+        return "PROTECT", f"-> {PROT_STATES.get(a8, a8)}, cause {cause}, seen after {a32} us"
+    if etype == 14:
+        if a8 == 0:
+            return "FMAP", f"run {FREQ_MAP_RESULTS.get(a16, a16)} after {a32 / 1000.0:.1f} s"
+        return "FMAP", f"frequency {a32 / 1000.0:.1f} -> {a16 / 10.0:.1f} kHz"
+    if etype == 15:
+        return "SCOPE", f"capture {SCOPE_RESULTS.get(a8, a8)}: {a16} samples every {a32} us"
+    if etype == 16:
+        return "I2C", f"bus recovery #{a32} after {a16} failed {SENSORS.get(a8, a8)} reads"
+    return f"?{etype}", f"a8={a8} a16={a16} a32=0x{a32:08x}"
+
+
+def load(path):
+    with open(path, "rb") as f:
+        data = f.read()
+    if len(data) >= HEADER.size and struct.unpack_from("<I", data)[0] == MAGIC:
+        return data
+    # Serial log: take the last complete hex block.
+    text = data.decode("ascii", errors="replace").splitlines()
+    block = None
+    for line in text:
+        line = line.strip()
+        if line == "#TRACE-BEGIN":
+            block = bytearray()
+        elif line == "#TRACE-END" and block is not None:
+            data, block = bytes(block), None
+        elif block is not None and line:
+            try:
+                block += bytes.fromhex(line)
+            except ValueError:
+                block = None   # interleaved output, drop the block
+    if struct.unpack_from("<I", data.ljust(4, b"\0"))[0] != MAGIC:
+        raise SystemExit("no trace dump found in " + path)
+    return data
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("file", help="binary dump or serial log")
+    ap.add_argument("--csv", action="store_true", help="machine readable output")
+    args = ap.parse_args()
+
+    data = load(args.file)
+    magic, version, event_size, total, now_ms = HEADER.unpack_from(data)
+    event = EVENTS.get(version)
+    if event is None or event_size != event.size:
+        raise SystemExit(f"unsupported dump (version {version}, event size {event_size})")
+    header = HEADER_V3 if version >= 3 else HEADER
+    dropped = header.unpack_from(data)[5] if version >= 3 else 0
+    count = (len(data) - header.size) // event.size
+    first_seq = total - count
+
+    if args.csv:
+        print("seq,t_ms,ch,event,detail")
+    else:
+        print(f"# {count} events (seq {first_seq}..{total - 1}), dump taken at t={now_ms / 1000.0:.3f} s")
+        if dropped:
+            print(f"# {dropped} events dropped while the ring was frozen")
+
+    prev = None
+    for k in range(count):
+        fields = event.unpack_from(data, header.size + k * event.size)
+        if version == 1:
+            t_ms, etype, a8, a16, a32 = fields
+            ch = CH_NONE
+        else:
+            t_ms, etype, ch, a8, a16, a32 = fields
+        name, text = describe(etype, a8, a16, a32)
+        chs = "" if ch == CH_NONE else str(ch)
+        if args.csv:
+            print(f"{first_seq + k},{t_ms},{chs},{name},\"{text}\"")
+            continue
+        delta = "" if prev is None else f"+{(t_ms - prev) & 0xFFFFFFFF:>7d} ms"
+        prev = t_ms
+        chs = "" if ch == CH_NONE else f"ch{ch}"
+        print(f"{t_ms / 1000.0:12.3f} s {delta:>11s}  {chs:<4s} {name:<8s} {text}")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,370 @@
+/*************************************************************************
+ * @file edugrid_channel.cpp
+ * @date 2026/10/18
+ *
+ ************************************************************************/
+
+/*************************************************************************
+ * Include
+ ************************************************************************/
+#include <edugrid_channel.h>
+#include <edugrid_measurement.h>
+#include <edugrid_iv_archive.h>
+#include <edugrid_telemetry.h>
+#include <edugrid_trace.h>
+
+/*************************************************************************
+ * Variable Definition
+ ************************************************************************/
+static const ChannelConfig_t s_config[] = EDUGRID_CHANNEL_TABLE;
+static_assert(sizeof(s_config) / sizeof(s_config[0]) == EDUGRID_NUM_CHANNELS,
+              "EDUGRID_CHANNEL_TABLE needs exactly EDUGRID_NUM_CHANNELS rows");
+
+static edugrid_channel s_channels[EDUGRID_NUM_CHANNELS];
+
+uint8_t edugrid_channel::_rr_start = 0;
+
+volatile bool  edugrid_channel::_knobs_pending = false;
+ChannelKnobs_t edugrid_channel::_knobs         = {};
+ChannelKnobs_t edugrid_channel::_req_knobs     = {};
+uint32_t       edugrid_channel::_knobs_seq     = 0;
+
+// The web task requests, the control task takes the request over
+static portMUX_TYPE s_knobsMux = portMUX_INITIALIZER_UNLOCKED;
+
+/*************************************************************************
+ * Function Definition
+ ************************************************************************/
+edugrid_channel::edugrid_channel(void)
+  : mppt(meas, pwm),
+    settle(meas, pwm, mppt),
+    charge(meas, pwm, mppt),
+    protect(meas, pwm, mppt),
+    fmap(meas, pwm, mppt),
+    teff(meas, mppt, charge),
+    energy(meas),
+    scope(meas, pwm, mppt),
+    _index(0),
+    _profile(ACQ_PROFILE_NONE),
+    _mode(MANUALLY),
+    _knobs_seen(0),
+    _noise{},
+    _noise_duty(0),
+    _noise_duty_ms(0),
+    _noise_last_ms(0),
+    _noise_hist_duty{},
+    _noise_hist_v{},
+    _noise_hist_i{},
+    _noise_hist_len(0)
+{
+}
+
+edugrid_channel& edugrid_channel::at(uint8_t index)
+{
+  return s_channels[(index < EDUGRID_NUM_CHANNELS) ? index : 0];
+}
+
+const ChannelConfig_t& edugrid_channel::config(uint8_t index)
+{
+  return s_config[(index < EDUGRID_NUM_CHANNELS) ? index : 0];
+}
+
+void edugrid_channel::beginPowerStages(void)
+{
+  // Start with the stored knobs, before any task runs
+  _takeKnobs();
+  for (uint8_t ch = 0; ch < EDUGRID_NUM_CHANNELS; ++ch)
+  {
+    const ChannelConfig_t& cfg = s_config[ch];
+    edugrid_channel& c = s_channels[ch];
+    c._index = ch;
+    c.mppt.setIndex(ch);
+    c.settle.setIndex(ch);
+    c.charge.setIndex(ch);
+    c.fmap.setIndex(ch);
+    c.energy.setIndex(ch);
+    c.scope.setIndex(ch);
+
+    Serial.printf("[PWM] CH%u LEDC %u pin=%d freq[Hz]=%d\n",
+                  (unsigned)ch, (unsigned)cfg.ledc_channel, (int)cfg.pwm_pin, CONVERTER_FREQUENCY);
+    c.pwm.begin(ch, cfg.ledc_channel, CONVERTER_FREQUENCY, cfg.pwm_pin);
+    if (c._knobs_seen != _knobs_seq)
+    {
+      c._applyKnobs(_knobs);
+      c._knobs_seen = _knobs_seq;
+    }
+
+    /* IR2104 gate driver: off until armProtection() */
+    c.protect.begin(ch, cfg.sd_pin, cfg.alert_pin);
+  }
+}
+
+void edugrid_channel::requestKnobs(const ChannelKnobs_t& knobs)
+{
+  portENTER_CRITICAL(&s_knobsMux);
+  _req_knobs     = knobs;
+  _knobs_pending = true;
+  portEXIT_CRITICAL(&s_knobsMux);
+}
+
+void edugrid_channel::armProtection(void)
+{
+  for (uint8_t ch = 0; ch < EDUGRID_NUM_CHANNELS; ++ch)
+  {
+    s_channels[ch].protect.arm();
+  }
+}
+
+void edugrid_channel::applyAcquisition(void)
+{
+  const AcqProfile_t p = _wantProfile();
+  const AcqSetting_t s = edugrid_measurement::profileSetting(p);
+  meas.configure(s.avg_samples, s.conv_us);
+  mppt.set_step_period_ms(edugrid_measurement::stepPeriodFor(s.avg_samples, s.conv_us, settleMs()));
+
+  // Readings from before the switch belong to another window
+  _noise_hist_len = 0;
+  if (p != _profile)
+  {
+    edugrid_trace::record(TRACE_EV_ACQ_PROFILE, (uint8_t)p, (uint16_t)mppt.get_step_period_ms(),
+                          ((uint32_t)s.avg_samples << 16) | s.conv_us, _index);
+  }
+  _profile = p;
+}
+
+uint16_t edugrid_channel::settleMs(void) const
+{
+  return (settle.settleMs() != 0) ? settle.settleMs() : edugrid_measurement::configuredSettleMs();
+}
+
+const AcqNoiseStats_t& edugrid_channel::noiseStats(AcqProfile_t p) const
+{
+  return _noise[(p < ACQ_PROFILE_COUNT) ? p : ACQ_PROFILE_TRACK];
+}
+
+void edugrid_channel::service(void)
+{
+  /* 0) Knobs of a configuration commit, only ever written from here */
+  if (_knobs_seen != _knobs_seq)
+  {
+    _applyKnobs(_knobs);
+    _knobs_seen = _knobs_seq;
+  }
+
+  /* 1) Always update sensor cache first */
+  // Everything below reads the cached values of this channel.
+  meas.update();
+
+  /* 1a) A fast trip already cut the gate driver; park the duty, retry */
+  protect.service();
+  const bool running = protect.running();
+
+  /* 1b) A finished sweep leaves its noise estimate, an archive record and
+   *     the tracking-efficiency reference behind; the acquisition profile follows the mode (AUTO with the
+   *     V_ref cascade or under a CC/CV ceiling keeps the sweep profile) */
+  const OperatingModes_t mode = mppt.get_mode_state();
+  if (mode != _mode)
+  {
+    if (_mode == IV_SWEEP && mppt.iv_sweep_done())
+    {
+      _noiseFromSweep();
+      edugrid_iv_archive::capture(_index, mppt);
+      teff.capture();
+    }
+    _mode = mode;
+  }
+  if (_wantProfile() != _profile)
+  {
+    applyAcquisition();
+  }
+
+  /* 2) Keep duty within safe/allowed borders */
+  pwm.checkAndSetPwmBorders();
+
+  /* 3) Settle-time calibration, the efficiency map and a scope capture own
+   *    the duty while they run (one at a time); the manual ramp then only
+   *    follows it, and the tracker waits.  Otherwise the map picks the
+   *    frequency. */
+  if (running && !fmap.active() && !scope.active()) settle.service();
+  if (running && !settle.active() && !scope.active()) fmap.service();
+  if (running && !settle.active() && !fmap.active()) scope.service();
+  const bool calibrating = settle.active() || fmap.active() || scope.active();
+
+  /* 4) Honour the manual slew limiter that makes slider movements smooth */
+  pwm.serviceManualRamp(mppt.get_mode_state() == MANUALLY && !calibrating);
+
+  /* 5) Output limits first, so the tracker steps under this pass' ceiling,
+   *    then execute the logic for the current operating mode (not while
+   *    the gate driver is off: P&O would chase the open-circuit point) */
+  if (running && !calibrating) {
+    charge.service();
+    mppt.service();
+  }
+  if (running) teff.service();
+  _trackNoise();
+
+  /* 6) Energy counts whether or not the gate driver runs */
+  energy.service();
+
+#ifdef EDUGRID_TELEMETRY_ON
+  // Only a snapshot into the lock-free ring; the UART work happens in the
+  // low-priority telemetry task so it can never stretch the control pass.
+  edugrid_telemetry::push(_index);
+#endif
+}
+
+/*************************************************************************
+ * Private
+ ************************************************************************/
+AcqProfile_t edugrid_channel::_wantProfile(void) const
+{
+  return edugrid_measurement::profileFor(mppt.get_mode_state(), mppt.get_vref_enabled(),
+                                         charge.state() != CHARGE_MPPT);
+}
+
+void edugrid_channel::_applyKnobs(const ChannelKnobs_t& k)
+{
+  pwm.setPwmLimits(k.pwm_min_pct, k.pwm_max_pct);
+  pwm.setManualSlew(k.manual_slew_step_pct, k.manual_slew_interval_ms);
+  mppt.set_step_size_pct(k.mppt_step_pct);
+  mppt.set_power_eps_w(k.mpp_power_eps_w);
+  settle.setInterval_s(k.settle_cal_interval_s);
+  mppt.set_iv_sweep_points(k.iv_sweep_points);
+  mppt.set_iv_sweep_bidir(k.iv_sweep_bidir);
+  mppt.set_iv_bg_interval_s(k.iv_bg_interval_s);
+  mppt.set_iv_bg_points(k.iv_bg_points);
+  mppt.set_freeze_enabled(k.mppt_freeze);
+  mppt.set_vref_gains(k.vref_kp, k.vref_ki);
+  mppt.set_vref_step_v(k.vref_step_v);
+  mppt.set_vref_enabled(k.mppt_vref);
+  charge.setLimits(k.charge_v_max, k.charge_i_max);
+  mppt.set_pout_weight(k.mppt_pout_weight);
+  pwm.setDither(k.pwm_dither);
+  mppt.set_drift_enabled(k.mppt_drift);
+}
+
+void edugrid_channel::_takeKnobs(void)
+{
+  if (!_knobs_pending) return;
+  // Take the whole request over at once, never half of a web-task write
+  portENTER_CRITICAL(&s_knobsMux);
+  _knobs         = _req_knobs;
+  _knobs_pending = false;
+  ++_knobs_seq;
+  portEXIT_CRITICAL(&s_knobsMux);
+}
+
+void edugrid_channel::_addNoise(AcqProfile_t p, float var_v, float var_i)
+{
+  AcqNoiseStats_t& st = _noise[p];
+  if (st.n >= EDUGRID_NOISE_MAX_N)
+  {
+    st.n /= 2; st.sum_var_v *= 0.5f; st.sum_var_i *= 0.5f;
+  }
+  st.n++;
+  st.sum_var_v += var_v;
+  st.sum_var_i += var_i;
+}
+
+void edugrid_channel::_trackNoise(void)
+{
+  if (_profile >= ACQ_PROFILE_COUNT || settle.active() || fmap.active() || scope.active()) return;
+
+  // Runs after the tracker, so this pass's reading (taken at its start) is
+  // still from the dwell at _noise_duty even when the duty just changed.
+  // Only settled readings from a window of their own count: a step period
+  // into the dwell, then one window (plus a pass) apart.
+  const uint32_t now     = millis();
+  const uint8_t  duty    = pwm.getPWM();
+  const bool     settled = (now - _noise_duty_ms) >= mppt.get_step_period_ms();
+  const bool     fresh   = (_noise_last_ms == _noise_duty_ms) ||
+                           (now - _noise_last_ms) >= edugrid_measurement::windowMsFor(meas.avgSamples(), meas.convUs())
+                                                     + TASK_CONTROL_INTERVAL_MS;
+  if (settled && fresh)
+  {
+    _noiseSample(_noise_duty);
+    _noise_last_ms = now;
+  }
+
+  if (duty != _noise_duty)
+  {
+    _noise_duty    = duty;
+    _noise_duty_ms = now;
+    _noise_last_ms = now;
+  }
+}
+
+void edugrid_channel::_noiseSample(uint8_t duty)
+{
+  const float v = meas.getVoltagePV();
+  const float i = meas.getCurrentPV();
+  if (v < PV_PRESENT_V) return;
+
+  // Pair with the newest reading at the same duty: steady duty in MANUAL,
+  // the P&O oscillation around the MPP in AUTO
+  for (int8_t k = (int8_t)_noise_hist_len - 1; k >= 0; --k)
+  {
+    if (_noise_hist_duty[k] == duty)
+    {
+      const float dv = v - _noise_hist_v[k];
+      const float di = i - _noise_hist_i[k];
+      _addNoise(_profile, 0.5f * dv * dv, 0.5f * di * di);
+      break;
+    }
+  }
+
+  if (_noise_hist_len == EDUGRID_NOISE_HISTORY)
+  {
+    for (uint8_t k = 1; k < EDUGRID_NOISE_HISTORY; ++k)
+    {
+      _noise_hist_duty[k - 1] = _noise_hist_duty[k];
+      _noise_hist_v[k - 1]    = _noise_hist_v[k];
+      _noise_hist_i[k - 1]    = _noise_hist_i[k];
+    }
+    --_noise_hist_len;
+  }
+  _noise_hist_duty[_noise_hist_len] = duty;
+  _noise_hist_v[_noise_hist_len]    = v;
+  _noise_hist_i[_noise_hist_len]    = i;
+  ++_noise_hist_len;
+}
+
+void edugrid_channel::_noiseFromSweep(void)
+{
+  // The I-V curve is smooth on the scale of a few duty steps, so a point's
+  // offset from the line through its neighbours is mostly noise, with
+  // variance (1 + a^2 + b^2) sigma^2 for interpolation weights a + b = 1.
+  // Only the finely refined stretches of the up pass qualify; the coarse
+  // ones were left coarse because they are straight, not because they are
+  // straight to within the noise.
+  const uint16_t n = mppt.iv_up_count();
+  for (uint16_t k = 1; k + 1 < n; ++k)
+  {
+    const IvPoint_t& p0 = mppt.iv_point(k - 1);
+    const IvPoint_t& p1 = mppt.iv_point(k);
+    const IvPoint_t& p2 = mppt.iv_point(k + 1);
+    if (p2.v < PV_PRESENT_V) break;   // past the short-circuit end
+    if (p2.duty - p0.duty > 4 * IV_SWEEP_STEP_PCT) continue;
+
+    const float a = (float)(p1.duty - p0.duty) / (float)(p2.duty - p0.duty);
+    const float b = 1.0f - a;
+    const float g = 1.0f + a * a + b * b;
+    const float ev = p1.v - (b * p0.v + a * p2.v);
+    const float ei = p1.i - (b * p0.i + a * p2.i);
+    _addNoise(ACQ_PROFILE_SWEEP, ev * ev / g, ei * ei / g);
+  }
+}
+
+void edugrid_channel::serviceAll(void)
+{
+  // A new INA averaging setting is applied between passes, never mid-read;
+  // new knobs likewise reach each channel at the start of its pass.
+  edugrid_measurement::serviceAcquisition();
+  _takeKnobs();
+
+  for (uint8_t k = 0; k < EDUGRID_NUM_CHANNELS; ++k)
+  {
+    s_channels[(_rr_start + k) % EDUGRID_NUM_CHANNELS].service();
+  }
+  _rr_start = (uint8_t)((_rr_start + 1) % EDUGRID_NUM_CHANNELS);
+}
@@ -0,0 +1,124 @@
+/*************************************************************************
+ * @file edugrid_charger.cpp
+ * @date 2026/10/18
+ *
+ ************************************************************************/
+
+/*************************************************************************
+ * Include
+ ************************************************************************/
+#include <edugrid_charger.h>
+#include <edugrid_measurement.h>
+#include <edugrid_trace.h>
+#include <math.h>
+
+/*************************************************************************
+ * Function Definition
+ ************************************************************************/
+edugrid_charger::edugrid_charger(edugrid_meas_channel& meas, edugrid_pwm_channel& pwm,
+                                 const edugrid_mpp_tracker& mppt)
+  : _meas(meas),
+    _pwm(pwm),
+    _mppt(mppt),
+    _index(0),
+    _v_max(CHARGE_V_MAX),
+    _i_max(CHARGE_I_MAX),
+    _state(CHARGE_MPPT),
+    _ceiling(PWM_ABS_MAX_MPPT),
+    _last_ms(0)
+{
+}
+
+void edugrid_charger::setLimits(float v_max, float i_max)
+{
+  _v_max = (v_max > 0.0f) ? v_max : 0.0f;
+  _i_max = (i_max > 0.0f) ? i_max : 0.0f;
+}
+
+const char* edugrid_charger::stateToStr(ChargeState_t state)
+{
+  switch (state) {
+    case CHARGE_CC: return "cc";
+    case CHARGE_CV: return "cv";
+    default:        return "mppt";
+  }
+}
+
+void edugrid_charger::service(void)
+{
+  if (!enabled() || !_tracking() || !_meas.sensorLoadOk()) {
+    if (_state != CHARGE_MPPT) _release();
+    return;
+  }
+
+  // Headroom of each enabled limit in % of the limit; the tighter one rules
+  float         head  = INFINITY;
+  ChargeState_t which = CHARGE_MPPT;
+  if (_v_max > 0.0f) {
+    head  = (_v_max - _meas.getVoltageLoad()) / _v_max * 100.0f;
+    which = CHARGE_CV;
+  }
+  if (_i_max > 0.0f) {
+    const float h = (_i_max - _meas.getCurrentLoad()) / _i_max * 100.0f;
+    if (h < head) { head = h; which = CHARGE_CC; }
+  }
+
+  const uint32_t now = millis();
+  if (_state == CHARGE_MPPT) {
+    if (head >= CHARGE_ENGAGE_PCT) return;
+    // Take over at the tracker's duty, so the hand-over does not jump
+    _ceiling = _pwm.getPWMFine() / (float)PWM_FINE_PER_PCT;
+  } else if ((now - _last_ms) < edugrid_measurement::windowMsFor(_meas.avgSamples(), _meas.convUs())) {
+    // One step per fresh load reading.  Engaged, the channel runs the
+    // sweep profile, whose window fits in a control pass; this only holds
+    // back the pass before that switch, or a sweep profile configured longer
+    return;
+  }
+  _last_ms = now;
+
+  // Anti-windup: the ceiling only climbs while it is what holds the duty
+  // (clamped to it); a tracker stepping below it on its own releases it
+  // through the headroom
+  if (head > 0.0f && _pwm.getPWMFine() < _pwm.getDutyCeiling()) {
+    if (head >= CHARGE_RELEASE_PCT) _release();
+    return;
+  }
+
+  const float border = _pwm.getPwmBorderUpper();
+  _ceiling += CHARGE_GAIN * head;
+  if (_ceiling < _pwm.getPwmLowerLimit()) _ceiling = _pwm.getPwmLowerLimit();
+  if (_ceiling >= border) {
+    // Climbed back to the border: the tracker alone stays below the limits
+    _release();
+    return;
+  }
+
+  if (which != _state) {
+    _state = which;
+    edugrid_trace::record(TRACE_EV_CHARGE, _state, (uint16_t)_ceiling,
+                          (uint32_t)(_meas.getPowerLoad() * 1000.0f), _index);
+  }
+  // Rounded down: a fraction above the ceiling is already too much
+  _pwm.setDutyCeiling((uint16_t)(_ceiling * PWM_FINE_PER_PCT), PWM_SRC_CHARGE);
+}
+
+/*************************************************************************
+ * Private
+ ************************************************************************/
+bool edugrid_charger::_tracking(void) const
+{
+  // A background sweep returns to AUTO, the battery stays protected meanwhile
+  const OperatingModes_t mode = _mppt.get_mode_state();
+  return (mode == AUTO) || (mode == IV_SWEEP && _mppt.iv_sweep_background() && _mppt.iv_sweep_in_progress());
+}
+
+void edugrid_charger::_release(void)
+{
+  _pwm.setDutyCeiling(PWM_DUTY_NO_CEILING, PWM_SRC_CHARGE);
+  _ceiling = _pwm.getPwmBorderUpper();
+  if (_state != CHARGE_MPPT) {
+    _state = CHARGE_MPPT;
+    edugrid_trace::record(TRACE_EV_CHARGE, _state, (uint16_t)_ceiling,
+                          (uint32_t)(_meas.getPowerLoad() * 1000.0f), _index);
+  }
+}
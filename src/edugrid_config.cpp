@@ -0,0 +1,561 @@
+/*************************************************************************
+ * @file edugrid_config.cpp
+ * @date 2026/10/18
+ *
+ ************************************************************************/
+
+/*************************************************************************
+ * Include
+ ************************************************************************/
+#include <edugrid_config.h>
+#include <edugrid_filesystem.h>
+#include <edugrid_measurement.h>
+#include <edugrid_channel.h>
+#include <LittleFS.h>
+#include <esp_rom_crc.h>
+#include <type_traits>
+#include <limits>
+#include <math.h>
+
+/*************************************************************************
+ * Define
+ ************************************************************************/
+
+/*************************************************************************
+ * Variable Definition
+ ************************************************************************/
+EdugridConfig_t edugrid_config::_cfg;
+
+// The web task replaces the struct while other tasks copy it out through
+// snapshot(); both copies are guarded so nobody sees a half-written blob.
+static portMUX_TYPE s_cfgMux = portMUX_INITIALIZER_UNLOCKED;
+
+/*************************************************************************
+ * Helpers
+ ************************************************************************/
+static void _copyStr(char* dst, size_t dst_len, const char* src)
+{
+    strncpy(dst, src ? src : "", dst_len - 1);
+    dst[dst_len - 1] = '\0';
+}
+
+static uint32_t _crc(const EdugridConfig_t& cfg, size_t len)
+{
+    return esp_rom_crc32_le(0, reinterpret_cast<const uint8_t*>(&cfg), len);
+}
+
+/*************************************************************************
+ * Function Definition
+ ************************************************************************/
+
+/** Load the configuration once during setup() --> call after init_filesystem()
+ *
+ * Order: live blob, then the temp file of an interrupted commit, then the
+ * legacy text files (ssid/password/logname.config) + compiled defaults.  In
+ * the last case the result is written back so the next boot reads one blob.
+ */
+void edugrid_config::load(void)
+{
+    EdugridConfig_t cfg;
+    _setDefaults(cfg);
+
+    if (_readBlob(CONFIG_FILEPATH_BLOB, cfg))
+    {
+        Serial.println("| OK | Config blob loaded");
+    }
+    else if (_readBlob(CONFIG_FILEPATH_BLOB_TMP, cfg))
+    {
+        // A commit was cut off after the temp file was complete; finish it.
+        Serial.println("|WARN| Config recovered from temp file");
+        _writeBlob(cfg);
+    }
+    else
+    {
+        Serial.println("|WARN| No valid config blob, importing legacy files");
+        _importLegacyFiles(cfg);
+        if (!_validate(cfg, nullptr))
+        {
+            _setDefaults(cfg);
+        }
+        _writeBlob(cfg);
+    }
+
+    portENTER_CRITICAL(&s_cfgMux);
+    _cfg = cfg;
+    portEXIT_CRITICAL(&s_cfgMux);
+}
+
+const EdugridConfig_t& edugrid_config::get(void)
+{
+    return _cfg;
+}
+
+void edugrid_config::snapshot(EdugridConfig_t& out)
+{
+    portENTER_CRITICAL(&s_cfgMux);
+    out = _cfg;
+    portEXIT_CRITICAL(&s_cfgMux);
+}
+
+/** Validate, persist and apply a configuration
+ * @param cfg Complete configuration (usually get() patched by the caller)
+ * @param err Optional human readable reason on failure
+ * @return true if the configuration is live
+ */
+bool edugrid_config::commit(const EdugridConfig_t& cfg, String* err)
+{
+    if (!_validate(cfg, err))
+    {
+        return false;
+    }
+    if (!_writeBlob(cfg))
+    {
+        if (err) *err = "flash write failed";
+        return false;
+    }
+
+    portENTER_CRITICAL(&s_cfgMux);
+    _cfg = cfg;
+    portEXIT_CRITICAL(&s_cfgMux);
+
+    apply();
+    return true;
+}
+
+/** Hand the tunable knobs to the running modules
+ * Wi-Fi credentials are only read by initWiFi() and need a reboot.
+ */
+void edugrid_config::apply(void)
+{
+    const EdugridConfig_t& cfg = _cfg;
+
+    // The knobs are shared: every converter channel gets the same values.
+    // The control task copies them into the modules between passes, so a
+    // commit never writes tracker or PWM state the other core is using.
+    ChannelKnobs_t k;
+    k.pwm_min_pct             = cfg.pwm_min_pct;
+    k.pwm_max_pct             = cfg.pwm_max_pct;
+    k.manual_slew_step_pct    = cfg.manual_slew_step_pct;
+    k.manual_slew_interval_ms = cfg.manual_slew_interval_ms;
+    k.mppt_step_pct           = cfg.mppt_step_pct;
+    k.mpp_power_eps_w         = cfg.mpp_power_eps_w;
+    k.settle_cal_interval_s   = cfg.settle_cal_interval_s;
+    k.iv_sweep_points         = cfg.iv_sweep_points;
+    k.iv_sweep_bidir          = (cfg.iv_sweep_bidir != 0);
+    k.iv_bg_interval_s        = cfg.iv_bg_interval_s;
+    k.iv_bg_points            = cfg.iv_bg_points;
+    k.mppt_freeze             = (cfg.mppt_freeze != 0);
+    k.vref_kp                 = cfg.vref_kp;
+    k.vref_ki                 = cfg.vref_ki;
+    k.vref_step_v             = cfg.vref_step_v;
+    k.mppt_vref               = (cfg.mppt_vref != 0);
+    k.charge_v_max            = cfg.charge_v_max;
+    k.charge_i_max            = cfg.charge_i_max;
+    k.mppt_pout_weight        = cfg.mppt_pout_weight;
+    k.pwm_dither              = (cfg.pwm_dither != 0);
+    k.mppt_drift              = (cfg.mppt_drift != 0);
+    edugrid_channel::requestKnobs(k);
+
+    // The INA228s are reconfigured by the control task on its next tick; each
+    // channel's step period is recomputed from its active profile there.
+    edugrid_measurement::requestProfile(ACQ_PROFILE_SWEEP, cfg.sweep_avg_samples, cfg.sweep_conv_us);
+    edugrid_measurement::requestProfile(ACQ_PROFILE_DISPLAY, cfg.display_avg_samples, cfg.display_conv_us);
+    edugrid_measurement::requestAcquisition(cfg.ina_avg_samples,
+                                            cfg.ina_conv_us,
+                                            cfg.ina_extra_settle_ms);
+}
+
+void edugrid_config::toJson(JsonObject obj)
+{
+    const EdugridConfig_t& cfg = _cfg;
+
+    obj["version"]                 = EDUGRID_CONFIG_VERSION;
+    obj["wlan_ssid"]               = cfg.wlan_ssid;
+    obj["wlan_pw_set"]             = (cfg.wlan_pw[0] != '\0');   // never echo the password
+    obj["log_name"]                = cfg.log_name;
+    obj["mppt_step_pct"]           = cfg.mppt_step_pct;
+    obj["mpp_power_eps_w"]         = cfg.mpp_power_eps_w;
+    obj["ina_avg_samples"]         = cfg.ina_avg_samples;
+    obj["ina_conv_us"]             = cfg.ina_conv_us;
+    obj["ina_extra_settle_ms"]     = cfg.ina_extra_settle_ms;
+    obj["step_period_ms"]          = edugrid_measurement::stepPeriodFor(cfg.ina_avg_samples,
+                                                                        cfg.ina_conv_us,
+                                                                        cfg.ina_extra_settle_ms);
+    obj["pwm_min_pct"]             = cfg.pwm_min_pct;
+    obj["pwm_max_pct"]             = cfg.pwm_max_pct;
+    obj["manual_slew_step_pct"]    = cfg.manual_slew_step_pct;
+    obj["manual_slew_interval_ms"] = cfg.manual_slew_interval_ms;
+    obj["ws_push_interval_ms"]     = cfg.ws_push_interval_ms;
+    obj["settle_cal_interval_s"]   = cfg.settle_cal_interval_s;
+    obj["sweep_avg_samples"]       = cfg.sweep_avg_samples;
+    obj["sweep_conv_us"]           = cfg.sweep_conv_us;
+    obj["display_avg_samples"]     = cfg.display_avg_samples;
+    obj["display_conv_us"]         = cfg.display_conv_us;
+    obj["iv_sweep_points"]         = cfg.iv_sweep_points;
+    obj["iv_sweep_bidir"]          = cfg.iv_sweep_bidir;
+    obj["iv_bg_interval_s"]        = cfg.iv_bg_interval_s;
+    obj["iv_bg_points"]            = cfg.iv_bg_points;
+    obj["mppt_freeze"]             = cfg.mppt_freeze;
+    obj["mppt_vref"]               = cfg.mppt_vref;
+    obj["vref_kp"]                 = cfg.vref_kp;
+    obj["vref_ki"]                 = cfg.vref_ki;
+    obj["vref_step_v"]             = cfg.vref_step_v;
+    obj["charge_v_max"]            = cfg.charge_v_max;
+    obj["charge_i_max"]            = cfg.charge_i_max;
+    obj["mppt_pout_weight"]        = cfg.mppt_pout_weight;
+    obj["pwm_dither"]              = cfg.pwm_dither;
+    obj["mppt_drift"]              = cfg.mppt_drift;
+}
+
+/** Apply the keys present in `json` on top of `cfg`
+ * @return false on a type error; range checks happen in commit()
+ */
+bool edugrid_config::patchFromJson(JsonVariantConst json, EdugridConfig_t& cfg, String* err)
+{
+    if (!json.is<JsonObjectConst>())
+    {
+        if (err) *err = "body must be a JSON object";
+        return false;
+    }
+
+    // Small helpers so every key is handled the same way: absent = keep,
+    // present but wrong type = reject the whole request.  Integer fields
+    // only take whole numbers inside their type's range, never a silently
+    // truncated or wrapped value.
+    bool ok = true;
+    auto num = [&](const char* key, auto& field) {
+        typedef typename std::remove_reference<decltype(field)>::type T;
+        JsonVariantConst v = json[key];
+        if (v.isNull()) return;
+        if (!v.is<float>()) { ok = false; if (err) *err = String("not a number: ") + key; return; }
+        const double d = v.as<double>();
+        if (!isfinite(d) ||
+            (std::is_integral<T>::value &&
+             (d != floor(d) || d < (double)std::numeric_limits<T>::lowest() || d > (double)std::numeric_limits<T>::max())))
+        {
+            ok = false; if (err) *err = String("out of range: ") + key; return;
+        }
+        field = v.as<T>();
+    };
+    auto str = [&](const char* key, char* field, size_t len) {
+        JsonVariantConst v = json[key];
+        if (v.isNull()) return;
+        const char* s = v.as<const char*>();
+        if (!s || strlen(s) >= len) { ok = false; if (err) *err = String("bad string: ") + key; return; }
+        _copyStr(field, len, s);
+    };
+
+    str("wlan_ssid", cfg.wlan_ssid, sizeof(cfg.wlan_ssid));
+    str("wlan_pw",   cfg.wlan_pw,   sizeof(cfg.wlan_pw));
+    str("log_name",  cfg.log_name,  sizeof(cfg.log_name));
+    num("mppt_step_pct",           cfg.mppt_step_pct);
+    num("mpp_power_eps_w",         cfg.mpp_power_eps_w);
+    num("ina_avg_samples",         cfg.ina_avg_samples);
+    num("ina_conv_us",             cfg.ina_conv_us);
+    num("ina_extra_settle_ms",     cfg.ina_extra_settle_ms);
+    num("pwm_min_pct",             cfg.pwm_min_pct);
+    num("pwm_max_pct",             cfg.pwm_max_pct);
+    num("manual_slew_step_pct",    cfg.manual_slew_step_pct);
+    num("manual_slew_interval_ms", cfg.manual_slew_interval_ms);
+    num("ws_push_interval_ms",     cfg.ws_push_interval_ms);
+    num("settle_cal_interval_s",   cfg.settle_cal_interval_s);
+    num("sweep_avg_samples",       cfg.sweep_avg_samples);
+    num("sweep_conv_us",           cfg.sweep_conv_us);
+    num("display_avg_samples",     cfg.display_avg_samples);
+    num("display_conv_us",         cfg.display_conv_us);
+    num("iv_sweep_points",         cfg.iv_sweep_points);
+    num("iv_sweep_bidir",          cfg.iv_sweep_bidir);
+    num("iv_bg_interval_s",        cfg.iv_bg_interval_s);
+    num("iv_bg_points",            cfg.iv_bg_points);
+    num("mppt_freeze",             cfg.mppt_freeze);
+    num("mppt_vref",               cfg.mppt_vref);
+    num("vref_kp",                 cfg.vref_kp);
+    num("vref_ki",                 cfg.vref_ki);
+    num("vref_step_v",             cfg.vref_step_v);
+    num("charge_v_max",            cfg.charge_v_max);
+    num("charge_i_max",            cfg.charge_i_max);
+    num("mppt_pout_weight",        cfg.mppt_pout_weight);
+    num("pwm_dither",              cfg.pwm_dither);
+    num("mppt_drift",              cfg.mppt_drift);
+    return ok;
+}
+
+/** Write wifi settings to esp32 Flash (effective after reboot)
+ * @param ssid Name for WiFi AP
+ * @param pw Password for WiFi AP
+ */
+void edugrid_config::setWiFiCredentials(const String& ssid, const String& pw)
+{
+    EdugridConfig_t cfg = _cfg;
+    _copyStr(cfg.wlan_ssid, sizeof(cfg.wlan_ssid), ssid.c_str());
+    _copyStr(cfg.wlan_pw,   sizeof(cfg.wlan_pw),   pw.c_str());
+
+    String err;
+    if (!commit(cfg, &err))
+    {
+        Serial.print("|FAIL| WiFi credentials rejected: ");
+        Serial.println(err);
+    }
+}
+
+/*************************************************************************
+ * Private
+ ************************************************************************/
+void edugrid_config::_setDefaults(EdugridConfig_t& cfg)
+{
+    memset(&cfg, 0, sizeof(cfg));
+    _copyStr(cfg.wlan_ssid, sizeof(cfg.wlan_ssid), EDUGRID_CONFIG_DEFAULT_SSID);
+    _copyStr(cfg.wlan_pw,   sizeof(cfg.wlan_pw),   EDUGRID_CONFIG_DEFAULT_PW);
+    _copyStr(cfg.log_name,  sizeof(cfg.log_name),  EDUGRID_CONFIG_DEFAULT_LOGNAME);
+
+    cfg.mppt_step_pct           = MPPT_DUTY_STEP_PCT;
+    cfg.mpp_power_eps_w         = MPP_POWER_EPS_W;
+    cfg.ina_avg_samples         = INA_AVG_SAMPLES;
+    cfg.ina_conv_us             = INA_CONV_US;
+    cfg.ina_extra_settle_ms     = INA_EXTRA_SETTLE_MS;
+    cfg.pwm_min_pct             = PWM_MIN_DUTY_PCT;
+    cfg.pwm_max_pct             = PWM_MAX_DUTY_PCT;
+    cfg.manual_slew_step_pct    = MANUAL_SLEW_STEP_PCT;
+    cfg.manual_slew_interval_ms = MANUAL_SLEW_INTERVAL_MS;
+    cfg.ws_push_interval_ms     = WS_PUSH_INTERVAL_MS;
+    cfg.settle_cal_interval_s   = SETTLE_CAL_INTERVAL_S;
+    cfg.sweep_avg_samples       = INA_SWEEP_AVG_SAMPLES;
+    cfg.sweep_conv_us           = INA_SWEEP_CONV_US;
+    cfg.display_avg_samples     = INA_DISPLAY_AVG_SAMPLES;
+    cfg.display_conv_us         = INA_DISPLAY_CONV_US;
+    cfg.iv_sweep_points         = IV_SWEEP_BUDGET;
+    cfg.iv_sweep_bidir          = IV_SWEEP_BIDIR;
+    cfg.iv_bg_interval_s        = IV_BG_INTERVAL_S;
+    cfg.iv_bg_points            = IV_BG_POINTS;
+    cfg.mppt_freeze             = MPPT_FREEZE;
+    cfg.mppt_vref               = MPPT_VREF;
+    cfg.vref_kp                 = MPPT_VREF_KP;
+    cfg.vref_ki                 = MPPT_VREF_KI;
+    cfg.vref_step_v             = MPPT_VREF_STEP_V;
+    cfg.charge_v_max            = CHARGE_V_MAX;
+    cfg.charge_i_max            = CHARGE_I_MAX;
+    cfg.mppt_pout_weight        = MPPT_POUT_WEIGHT;
+    cfg.pwm_dither              = PWM_DITHER;
+    cfg.mppt_drift              = MPPT_DRIFT;
+}
+
+void edugrid_config::_importLegacyFiles(EdugridConfig_t& cfg)
+{
+    // Pre-blob firmware stored one plain-text file per setting.  Only take
+    // over values that actually exist so defaults fill the gaps.
+    const struct { const char* path; char* field; size_t len; } legacy[] = {
+        { CONFIG_FILEPATH_SSID,    cfg.wlan_ssid, sizeof(cfg.wlan_ssid) },
+        { CONFIG_FILEPATH_PW,      cfg.wlan_pw,   sizeof(cfg.wlan_pw)   },
+        { CONFIG_FILEPATH_LOGNAME, cfg.log_name,  sizeof(cfg.log_name)  },
+    };
+
+    for (const auto& item : legacy)
+    {
+        if (!LittleFS.exists(item.path)) continue;
+        String value = edugrid_filesystem::getContent_str(item.path);
+        value.trim();
+        if (value.length() > 0 && value.length() < item.len)
+        {
+            _copyStr(item.field, item.len, value.c_str());
+        }
+    }
+}
+
+bool edugrid_config::_readBlob(const char* path, EdugridConfig_t& cfg)
+{
+    if (edugrid_filesystem::get_filesystem_state() != STATE_FILESYSTEM_OK) return false;
+    if (!LittleFS.exists(path)) return false;
+
+    File file = LittleFS.open(path, FILE_READ);
+    if (!file) return false;
+
+    EdugridConfigHeader_t hdr;
+    bool ok = (file.read(reinterpret_cast<uint8_t*>(&hdr), sizeof(hdr)) == sizeof(hdr))
+              && (hdr.magic == EDUGRID_CONFIG_MAGIC)
+              && (hdr.version >= 1) && (hdr.version <= EDUGRID_CONFIG_VERSION)
+              && (hdr.size > 0) && (hdr.size <= sizeof(EdugridConfig_t));
+
+    // Read into a defaults-filled copy: an older, shorter payload simply
+    // leaves the newer fields at their compiled defaults.
+    EdugridConfig_t tmp = cfg;
+    if (ok)
+    {
+        ok = (file.read(reinterpret_cast<uint8_t*>(&tmp), hdr.size) == hdr.size)
+             && (_crc(tmp, hdr.size) == hdr.crc);
+    }
+    file.close();
+
+    // v2 fields sit in what was tail padding of the v1 struct, so the size
+    // check alone does not protect them.
+    if (ok && hdr.version < 2)
+    {
+        tmp.settle_cal_interval_s = SETTLE_CAL_INTERVAL_S;
+    }
+    if (ok && hdr.version < 3)
+    {
+        tmp.sweep_avg_samples   = INA_SWEEP_AVG_SAMPLES;
+        tmp.sweep_conv_us       = INA_SWEEP_CONV_US;
+        tmp.display_avg_samples = INA_DISPLAY_AVG_SAMPLES;
+        tmp.display_conv_us     = INA_DISPLAY_CONV_US;
+    }
+    if (ok && hdr.version < 4)
+    {
+        tmp.iv_sweep_points = IV_SWEEP_BUDGET;
+        tmp.iv_sweep_bidir  = IV_SWEEP_BIDIR;
+    }
+    if (ok && hdr.version < 5)
+    {
+        tmp.iv_bg_interval_s = IV_BG_INTERVAL_S;
+        tmp.iv_bg_points     = IV_BG_POINTS;
+    }
+    if (ok && hdr.version < 6)
+    {
+        tmp.mppt_freeze = MPPT_FREEZE;
+    }
+    if (ok && hdr.version < 7)
+    {
+        tmp.mppt_vref   = MPPT_VREF;
+        tmp.vref_kp     = MPPT_VREF_KP;
+        tmp.vref_ki     = MPPT_VREF_KI;
+        tmp.vref_step_v = MPPT_VREF_STEP_V;
+    }
+    if (ok && hdr.version < 8)
+    {
+        tmp.charge_v_max = CHARGE_V_MAX;
+        tmp.charge_i_max = CHARGE_I_MAX;
+    }
+    if (ok && hdr.version < 9)
+    {
+        tmp.mppt_pout_weight = MPPT_POUT_WEIGHT;
+    }
+    if (ok && hdr.version < 10)
+    {
+        tmp.pwm_dither = PWM_DITHER;
+    }
+    if (ok && hdr.version < 11)
+    {
+        tmp.mppt_drift = MPPT_DRIFT;
+    }
+
+    if (!ok)
+    {
+        Serial.print("|FAIL| Config blob invalid: ");
+        Serial.println(path);
+        return false;
+    }
+
+    // Never trust the terminators of stored strings.
+    tmp.wlan_ssid[sizeof(tmp.wlan_ssid) - 1] = '\0';
+    tmp.wlan_pw[sizeof(tmp.wlan_pw) - 1]     = '\0';
+    tmp.log_name[sizeof(tmp.log_name) - 1]   = '\0';
+
+    if (!_validate(tmp, nullptr)) return false;
+    cfg = tmp;
+    return true;
+}
+
+bool edugrid_config::_writeBlob(const EdugridConfig_t& cfg)
+{
+    if (edugrid_filesystem::get_filesystem_state() != STATE_FILESYSTEM_OK) return false;
+
+    EdugridConfigHeader_t hdr;
+    hdr.magic   = EDUGRID_CONFIG_MAGIC;
+    hdr.version = EDUGRID_CONFIG_VERSION;
+    hdr.size    = sizeof(EdugridConfig_t);
+    hdr.crc     = _crc(cfg, sizeof(EdugridConfig_t));
+
+    File file = LittleFS.open(CONFIG_FILEPATH_BLOB_TMP, FILE_WRITE);
+    if (!file)
+    {
+        Serial.println("|FAIL| Failed to open config temp file");
+        return false;
+    }
+    const bool written =
+        (file.write(reinterpret_cast<const uint8_t*>(&hdr), sizeof(hdr)) == sizeof(hdr)) &&
+        (file.write(reinterpret_cast<const uint8_t*>(&cfg), sizeof(cfg)) == sizeof(cfg));
+    file.close();
+    if (!written)
+    {
+        Serial.println("|FAIL| Config temp file write failed");
+        LittleFS.remove(CONFIG_FILEPATH_BLOB_TMP);
+        return false;
+    }
+
+    // LittleFS renames atomically over an existing target.  Fall back to
+    // remove + rename; load() recovers from the temp file if we die between.
+    if (!LittleFS.rename(CONFIG_FILEPATH_BLOB_TMP, CONFIG_FILEPATH_BLOB))
+    {
+        LittleFS.remove(CONFIG_FILEPATH_BLOB);
+        if (!LittleFS.rename(CONFIG_FILEPATH_BLOB_TMP, CONFIG_FILEPATH_BLOB))
+        {
+            Serial.println("|FAIL| Config commit (rename) failed");
+            return false;
+        }
+    }
+    Serial.println("| OK | Config committed");
+    return true;
+}
+
+bool edugrid_config::_validate(const EdugridConfig_t& cfg, String* err)
+{
+    auto fail = [&](const char* why) {
+        if (err) *err = why;
+        return false;
+    };
+
+    if (strlen(cfg.wlan_ssid) == 0)                       return fail("wlan_ssid empty");
+    const size_t pw_len = strlen(cfg.wlan_pw);
+    if (pw_len != 0 && pw_len < 8)                        return fail("wlan_pw needs 8+ chars (or empty for open AP)");
+    if (cfg.log_name[0] != '/')                           return fail("log_name must start with '/'");
+    if (cfg.mppt_step_pct < 1 ||
+        cfg.mppt_step_pct > CONFIG_MPPT_STEP_MAX_PCT)     return fail("mppt_step_pct out of range");
+    if (!(cfg.mpp_power_eps_w >= 0.0f) ||
+        cfg.mpp_power_eps_w > CONFIG_MPP_EPS_MAX_W)       return fail("mpp_power_eps_w out of range");
+    if (!edugrid_measurement::isValidAveraging(cfg.ina_avg_samples))
+                                                          return fail("ina_avg_samples unsupported");
+    if (!edugrid_measurement::isValidConversionTime(cfg.ina_conv_us))
+                                                          return fail("ina_conv_us unsupported");
+    if (cfg.ina_extra_settle_ms > CONFIG_SETTLE_MAX_MS)   return fail("ina_extra_settle_ms out of range");
+    // Config may narrow the hard PWM window, never widen it.
+    if (cfg.pwm_min_pct < PWM_MIN_DUTY_PCT ||
+        cfg.pwm_max_pct > PWM_MAX_DUTY_PCT ||
+        cfg.pwm_min_pct >= cfg.pwm_max_pct)               return fail("pwm_min_pct/pwm_max_pct out of range");
+    if (cfg.manual_slew_step_pct < 1 ||
+        cfg.manual_slew_step_pct > 100)                   return fail("manual_slew_step_pct out of range");
+    if (cfg.manual_slew_interval_ms > CONFIG_SLEW_INTERVAL_MAX_MS)
+                                                          return fail("manual_slew_interval_ms out of range");
+    if (cfg.ws_push_interval_ms < CONFIG_WS_PUSH_MIN_MS ||
+        cfg.ws_push_interval_ms > CONFIG_WS_PUSH_MAX_MS)  return fail("ws_push_interval_ms out of range");
+    if (cfg.settle_cal_interval_s != 0 &&
+        cfg.settle_cal_interval_s < CONFIG_SETTLE_CAL_MIN_S)
+                                                          return fail("settle_cal_interval_s out of range");
+    if (!edugrid_measurement::isValidAveraging(cfg.sweep_avg_samples) ||
+        !edugrid_measurement::isValidConversionTime(cfg.sweep_conv_us))
+                                                          return fail("sweep_avg_samples/sweep_conv_us unsupported");
+    if (!edugrid_measurement::isValidAveraging(cfg.display_avg_samples) ||
+        !edugrid_measurement::isValidConversionTime(cfg.display_conv_us))
+                                                          return fail("display_avg_samples/display_conv_us unsupported");
+    if (cfg.iv_sweep_points < IV_SWEEP_COARSE_POINTS ||
+        cfg.iv_sweep_points > IV_SWEEP_POINTS)            return fail("iv_sweep_points out of range");
+    if (cfg.iv_sweep_bidir > 1)                           return fail("iv_sweep_bidir must be 0 or 1");
+    if (cfg.iv_bg_interval_s != 0 &&
+        cfg.iv_bg_interval_s < CONFIG_IV_BG_MIN_S)        return fail("iv_bg_interval_s out of range");
+    if (cfg.iv_bg_points < IV_SWEEP_COARSE_POINTS ||
+        cfg.iv_bg_points > IV_SWEEP_POINTS)               return fail("iv_bg_points out of range");
+    if (cfg.mppt_freeze > 1)                              return fail("mppt_freeze must be 0 or 1");
+    if (cfg.mppt_vref > 1)                                return fail("mppt_vref must be 0 or 1");
+    if (!(cfg.vref_kp >= 0.0f) || cfg.vref_kp > CONFIG_VREF_KP_MAX ||
+        !(cfg.vref_ki >= 0.0f) || cfg.vref_ki > CONFIG_VREF_KI_MAX ||
+        (cfg.vref_kp == 0.0f && cfg.vref_ki == 0.0f))     return fail("vref_kp/vref_ki out of range");
+    if (!(cfg.vref_step_v >= CONFIG_VREF_STEP_MIN_V) ||
+        cfg.vref_step_v > CONFIG_VREF_STEP_MAX_V)         return fail("vref_step_v out of range");
+    if (!(cfg.charge_v_max >= 0.0f) ||
+        cfg.charge_v_max > CONFIG_CHARGE_V_MAX)           return fail("charge_v_max out of range");
+    if (!(cfg.charge_i_max >= 0.0f) ||
+        cfg.charge_i_max > INA_MAX_CURRENT_A)             return fail("charge_i_max out of range");
+    if (!(cfg.mppt_pout_weight >= 0.0f) ||
+        cfg.mppt_pout_weight > 1.0f)                      return fail("mppt_pout_weight out of range");
+    if (cfg.pwm_dither > 1)                               return fail("pwm_dither must be 0 or 1");
+    if (cfg.mppt_drift > 1)                               return fail("mppt_drift must be 0 or 1");
+    return true;
+}
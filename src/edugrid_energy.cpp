@@ -0,0 +1,276 @@
+/*************************************************************************
+ * @file edugrid_energy.cpp
+ * @date 2026/10/18
+ *
+ ************************************************************************/
+
+/*************************************************************************
+ * Include
+ ************************************************************************/
+#include <edugrid_energy.h>
+#include <edugrid_filesystem.h>
+#include <LittleFS.h>
+#include <esp_rom_crc.h>
+#include <sys/time.h>
+#include <time.h>
+
+/*************************************************************************
+ * Define
+ ************************************************************************/
+#define ENERGY_ACC_MASK          ((1ULL << INA_ACC_BITS) - 1ULL)
+#define ENERGY_S_PER_DAY         (86400L)
+
+/*************************************************************************
+ * Variable Definition
+ ************************************************************************/
+// Added to by the control task, copied out by the web task and loop();
+// every access holds the lock for a copy or a few additions.
+static portMUX_TYPE    s_energyMux = portMUX_INITIALIZER_UNLOCKED;
+static EnergyTotals_t  s_totals[EDUGRID_NUM_CHANNELS];
+static int16_t         s_utc_offset_min = 0;
+static bool            s_dirty    = false;
+static bool            s_save_now = false;   // rolled over: write without waiting
+static uint32_t        s_saved_ms = 0;
+
+/*************************************************************************
+ * Helpers
+ ************************************************************************/
+static void _header(EnergyFileHeader_t& hdr)
+{
+  memset(&hdr, 0, sizeof(hdr));
+  hdr.magic    = ENERGY_MAGIC;
+  hdr.version  = ENERGY_VERSION;
+  hdr.size     = sizeof(EnergyFileHeader_t) + sizeof(s_totals);
+  hdr.channels = EDUGRID_NUM_CHANNELS;
+}
+
+static uint32_t _crc(const EnergyFileHeader_t& hdr, const EnergyTotals_t* totals)
+{
+  EnergyFileHeader_t h = hdr;
+  h.crc = 0;
+  const uint32_t crc = esp_rom_crc32_le(0, reinterpret_cast<const uint8_t*>(&h), sizeof(h));
+  return esp_rom_crc32_le(crc, reinterpret_cast<const uint8_t*>(totals), sizeof(s_totals));
+}
+
+/** Local day and Monday-based week number; false while the clock is unset */
+static bool _localDay(uint32_t& day, uint32_t& week)
+{
+  const time_t now = time(nullptr);
+  if ((uint32_t)now < ENERGY_UNIX_VALID_S) return false;
+  const int64_t local = (int64_t)now + (int64_t)s_utc_offset_min * 60;
+  day  = (uint32_t)(local / ENERGY_S_PER_DAY);
+  week = (day + 3) / 7;                      // 1970-01-01 was a Thursday
+  return true;
+}
+
+static void _add(EnergyPeriod_t& to, const EnergyPeriod_t& add)
+{
+  to.pv.wh   += add.pv.wh;
+  to.pv.ah   += add.pv.ah;
+  to.load.wh += add.load.wh;
+  to.load.ah += add.load.ah;
+}
+
+/** Start a new day / week if the clock moved on; true if one rolled over */
+static bool _rollover(EnergyTotals_t& t, uint32_t day, uint32_t week)
+{
+  // First clock ever: what was counted so far belongs to this day
+  if (t.day == 0) {
+    t.day  = day;
+    t.week = week;
+    return false;
+  }
+  bool rolled = false;
+  if (day != t.day) {
+    t.yesterday = (day == t.day + 1) ? t.today : EnergyPeriod_t{};
+    t.today     = EnergyPeriod_t{};
+    t.day       = day;
+    rolled      = true;
+  }
+  if (week != t.week) {
+    t.last_week = (week == t.week + 1) ? t.this_week : EnergyPeriod_t{};
+    t.this_week = EnergyPeriod_t{};
+    t.week      = week;
+    rolled      = true;
+  }
+  return rolled;
+}
+
+/*************************************************************************
+ * Function Definition
+ ************************************************************************/
+edugrid_energy::edugrid_energy(edugrid_meas_channel& meas)
+  : _meas(meas),
+    _index(0),
+    _started(false),
+    _read_ms(0),
+    _hw_ok(false),
+    _side{}
+{
+}
+
+void edugrid_energy::service(void)
+{
+  const uint32_t now = millis();
+  if (_started && (now - _read_ms) < ENERGY_READ_MS) return;
+  _started = true;
+  _read_ms = now;
+
+  EnergyPeriod_t add = {};
+  const bool pv   = _readSide(false, now, add.pv);
+  const bool load = _readSide(true,  now, add.load);
+  _hw_ok = pv && load;
+  const bool counted = (add.pv.wh > 0.0) || (add.pv.ah > 0.0) || (add.load.wh > 0.0) || (add.load.ah > 0.0);
+
+  uint32_t day = 0, week = 0;
+  const bool clock = _localDay(day, week);
+
+  portENTER_CRITICAL(&s_energyMux);
+  EnergyTotals_t& t = s_totals[_index];
+  if (clock && _rollover(t, day, week)) s_save_now = s_dirty = true;
+  if (counted) {
+    _add(t.today, add);
+    _add(t.this_week, add);
+    _add(t.lifetime, add);
+    s_dirty = true;
+  }
+  portEXIT_CRITICAL(&s_energyMux);
+}
+
+void edugrid_energy::totals(uint8_t ch, EnergyTotals_t& out)
+{
+  portENTER_CRITICAL(&s_energyMux);
+  out = s_totals[(ch < EDUGRID_NUM_CHANNELS) ? ch : 0];
+  portEXIT_CRITICAL(&s_energyMux);
+}
+
+void edugrid_energy::setClock(uint32_t unix_s, int16_t utc_offset_min)
+{
+  if (utc_offset_min >  ENERGY_UTC_OFFSET_MAX_MIN) utc_offset_min =  ENERGY_UTC_OFFSET_MAX_MIN;
+  if (utc_offset_min < -ENERGY_UTC_OFFSET_MAX_MIN) utc_offset_min = -ENERGY_UTC_OFFSET_MAX_MIN;
+  struct timeval tv = { (time_t)unix_s, 0 };
+  settimeofday(&tv, nullptr);
+
+  portENTER_CRITICAL(&s_energyMux);
+  if (utc_offset_min != s_utc_offset_min) {
+    s_utc_offset_min = utc_offset_min;
+    s_dirty = true;
+  }
+  portEXIT_CRITICAL(&s_energyMux);
+}
+
+bool edugrid_energy::clockValid(void)
+{
+  return (uint32_t)time(nullptr) >= ENERGY_UNIX_VALID_S;
+}
+
+int16_t edugrid_energy::utcOffsetMin(void)
+{
+  return s_utc_offset_min;
+}
+
+void edugrid_energy::loadAll(void)
+{
+  if (edugrid_filesystem::get_filesystem_state() != STATE_FILESYSTEM_OK) return;
+  if (!LittleFS.exists(ENERGY_FILEPATH)) return;
+
+  File file = LittleFS.open(ENERGY_FILEPATH, FILE_READ);
+  if (!file) return;
+
+  EnergyFileHeader_t want, hdr;
+  _header(want);
+  static EnergyTotals_t tmp[EDUGRID_NUM_CHANNELS];
+  bool ok = (file.read(reinterpret_cast<uint8_t*>(&hdr), sizeof(hdr)) == sizeof(hdr))
+            && (memcmp(&hdr, &want, offsetof(EnergyFileHeader_t, utc_offset_min)) == 0)
+            && (file.read(reinterpret_cast<uint8_t*>(tmp), sizeof(tmp)) == sizeof(tmp))
+            && (_crc(hdr, tmp) == hdr.crc);
+  file.close();
+
+  if (!ok) {
+    Serial.printf("|WARN| Energy totals %s invalid or from another build, starting at zero\n", ENERGY_FILEPATH);
+    return;
+  }
+  portENTER_CRITICAL(&s_energyMux);
+  memcpy(s_totals, tmp, sizeof(s_totals));
+  s_utc_offset_min = hdr.utc_offset_min;
+  portEXIT_CRITICAL(&s_energyMux);
+  for (uint8_t ch = 0; ch < EDUGRID_NUM_CHANNELS; ++ch) {
+    Serial.printf("| OK | Energy totals CH%u loaded: PV %.1f Wh, load %.1f Wh lifetime\n",
+                  (unsigned)ch, tmp[ch].lifetime.pv.wh, tmp[ch].lifetime.load.wh);
+  }
+}
+
+void edugrid_energy::saveAll(void)
+{
+  const uint32_t now = millis();
+  if (!s_dirty) return;
+  if (!s_save_now && (now - s_saved_ms) < ENERGY_SAVE_MS) return;
+  if (edugrid_filesystem::get_filesystem_state() != STATE_FILESYSTEM_OK) return;
+
+  static EnergyTotals_t tmp[EDUGRID_NUM_CHANNELS];
+  EnergyFileHeader_t hdr;
+  _header(hdr);
+  portENTER_CRITICAL(&s_energyMux);
+  memcpy(tmp, s_totals, sizeof(tmp));
+  hdr.utc_offset_min = s_utc_offset_min;
+  s_dirty    = false;
+  s_save_now = false;
+  portEXIT_CRITICAL(&s_energyMux);
+  s_saved_ms = now;
+  hdr.crc = _crc(hdr, tmp);
+
+  // Same commit as the config blob: temp file, then rename over the old one
+  File file = LittleFS.open(ENERGY_FILEPATH_TMP, FILE_WRITE);
+  const bool written = file
+      && (file.write(reinterpret_cast<const uint8_t*>(&hdr), sizeof(hdr)) == sizeof(hdr))
+      && (file.write(reinterpret_cast<const uint8_t*>(tmp), sizeof(tmp)) == sizeof(tmp));
+  if (file) file.close();
+  if (!written) {
+    LittleFS.remove(ENERGY_FILEPATH_TMP);
+    Serial.printf("|FAIL| Energy totals: writing %s failed\n", ENERGY_FILEPATH_TMP);
+    return;
+  }
+  if (!LittleFS.rename(ENERGY_FILEPATH_TMP, ENERGY_FILEPATH)) {
+    LittleFS.remove(ENERGY_FILEPATH);
+    if (!LittleFS.rename(ENERGY_FILEPATH_TMP, ENERGY_FILEPATH)) {
+      Serial.println("|FAIL| Energy totals commit (rename) failed");
+    }
+  }
+}
+
+/*************************************************************************
+ * Private
+ ************************************************************************/
+bool edugrid_energy::_readSide(bool load, uint32_t now, EnergyCount_t& add)
+{
+  Side_t& s = _side[load ? 1 : 0];
+  InaAccumulators_t acc;
+  // A failed read keeps the last one: the next difference covers the gap
+  if (!_meas.readAccumulators(load, acc)) return false;
+
+  if (s.valid) {
+    const uint64_t de = (acc.energy - s.last.energy) & ENERGY_ACC_MASK;
+    const uint64_t dq = ((uint64_t)acc.charge - (uint64_t)s.last.charge) & ENERGY_ACC_MASK;
+    const int64_t  dq_signed = (int64_t)(dq << (64 - INA_ACC_BITS)) >> (64 - INA_ACC_BITS);
+
+    // The devices integrate the raw current; take the zero offset off
+    // (at the present voltage for the energy)
+    const double dt_s = (now - s.ms) / 1000.0;
+    const double i_off = load ? _meas.currentOffsetLoad() : _meas.currentOffsetPV();
+    const double v     = load ? _meas.getVoltageLoad()    : _meas.getVoltagePV();
+    const double e_j = (double)de * INA_ENERGY_LSB_J - i_off * v * dt_s;
+    const double q_c = (double)dq_signed * INA_CHARGE_LSB_C - i_off * dt_s;
+    add.wh = (e_j > 0.0) ? e_j / 3600.0 : 0.0;
+    add.ah = (q_c > 0.0) ? q_c / 3600.0 : 0.0;
+  }
+  s.last  = acc;
+  s.ms    = now;
+  s.valid = true;
+
+  // ~120 kWh / 2300 Ah at INA_MAX_CURRENT_A 16 A
+  const uint64_t q_abs = (uint64_t)((acc.charge < 0) ? -acc.charge : acc.charge);
+  if ((acc.energy >= ENERGY_RESET_COUNTS || q_abs >= ENERGY_RESET_COUNTS) && _meas.resetAccumulators(load)) {
+    s.last = InaAccumulators_t{ 0, 0 };
+  }
+  return true;
+}
@@ -22,10 +22,6 @@ File edugrid_filesystem::open_file;
 String edugrid_filesystem::file_content = "";
 int edugrid_filesystem::state_filesystem = 99;
 bool edugrid_filesystem::filesystem_mounted = false;
-String edugrid_filesystem::config_wlan_ssid = "";
-String edugrid_filesystem::config_wlan_pw = "";
-String edugrid_filesystem::json_config_str = "";
-String edugrid_filesystem::config_log_name = "";
 
 /*************************************************************************
  * Function Definition
@@ -106,16 +102,6 @@ int edugrid_filesystem::getContent_int(String path)
     return getContent_str(path).toInt();
 }
 
-void edugrid_filesystem::loadConfig()
-{
-    // Configuration files are plain text; each helper returns an empty string
-    // if the file does not exist so the Wi-Fi AP falls back to compiled
-    // defaults.
-    config_wlan_ssid = getContent_str(CONFIG_FILEPATH_SSID);
-    config_wlan_pw = getContent_str(CONFIG_FILEPATH_PW);
-    config_log_name = getContent_str(CONFIG_FILEPATH_LOGNAME);
-}
-
 /** Write an Arduino String to esp32 flash storage
  * @param path Absolut path in LittleFs (has to start with "/" !)
  * @param content Text to write 
@@ -181,19 +167,56 @@ void edugrid_filesystem::writeContent_str(String path, String content, bool appe
     }
 }
 
-/** Write wifi settings to esp32 Flash
- * @param ssid Name for WiFi AP
- * @param pw Password for WiFi AP
+/** Cut a file down to its first `new_size` bytes
+ * LittleFS has no truncate in the Arduino API, so the kept prefix is copied
+ * to a temp file which is then renamed over the original (atomic on LittleFS).
+ * @param path Absolut path in LittleFs (has to start with "/" !)
+ * @param new_size Number of bytes to keep
+ * @return true on success
  */
-void edugrid_filesystem::setWiFiCredentials(String ssid, String pw)
+bool edugrid_filesystem::truncateFile(const char* path, size_t new_size)
 {
-    // Update the cached values so the running access point reflects the new
-    // credentials immediately and persist them so the next reboot uses them
-    // automatically.
-    config_wlan_ssid = ssid;
-    config_wlan_pw = pw;
-    writeContent_str(CONFIG_FILEPATH_SSID, config_wlan_ssid);
-    writeContent_str(CONFIG_FILEPATH_PW, config_wlan_pw);
+    if (!filesystem_mounted) return false;
+
+    const String tmp_path = String(path) + ".tmp";
+    File src = LittleFS.open(path, FILE_READ);
+    File dst = LittleFS.open(tmp_path, FILE_WRITE);
+    if (!src || !dst)
+    {
+        Serial.println("|FAIL| Failed to open files for truncation");
+        if (src) src.close();
+        if (dst) dst.close();
+        return false;
+    }
+
+    uint8_t chunk[256];
+    size_t remaining = new_size;
+    bool ok = true;
+    while (remaining > 0 && ok)
+    {
+        const size_t want = (remaining < sizeof(chunk)) ? remaining : sizeof(chunk);
+        const size_t got = src.read(chunk, want);
+        ok = (got == want) && (dst.write(chunk, got) == got);
+        remaining -= got;
+    }
+    src.close();
+    dst.close();
+
+    // Fall back to remove + rename if the VFS refuses to replace the target.
+    if (ok && !LittleFS.rename(tmp_path, path))
+    {
+        LittleFS.remove(path);
+        ok = LittleFS.rename(tmp_path, path);
+    }
+    if (!ok)
+    {
+        Serial.print("|FAIL| File ");
+        Serial.print(path);
+        Serial.println(" failed to truncate");
+        LittleFS.remove(tmp_path);
+        return false;
+    }
+    return true;
 }
 
 /** Get the content of a file
@@ -205,4 +228,4 @@ void edugrid_filesystem::setWiFiCredentials(String ssid, String pw)
 //     file_content = getContent_str(path);
 
 //     return ;
-// }
\ No newline at end of file
+// }
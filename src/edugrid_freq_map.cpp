@@ -0,0 +1,377 @@
+/*************************************************************************
+ * @file edugrid_freq_map.cpp
+ * @date 2026/10/18
+ *
+ ************************************************************************/
+
+/*************************************************************************
+ * Include
+ ************************************************************************/
+#include <edugrid_freq_map.h>
+#include <edugrid_filesystem.h>
+#include <edugrid_measurement.h>
+#include <edugrid_trace.h>
+#include <LittleFS.h>
+#include <esp_rom_crc.h>
+#include <math.h>
+#include <time.h>
+
+/*************************************************************************
+ * Define
+ ************************************************************************/
+#define FREQ_MAP_POINTS          (FREQ_MAP_NUM_DUTIES * FREQ_MAP_NUM_FREQS)
+#define FREQ_MAP_UNIX_VALID_S    (1600000000UL)   /* anything earlier: clock never set */
+
+static const uint32_t kFreqs[] = FREQ_MAP_FREQS_HZ;
+static_assert(sizeof(kFreqs) / sizeof(kFreqs[0]) == FREQ_MAP_NUM_FREQS,
+              "FREQ_MAP_FREQS_HZ needs exactly FREQ_MAP_NUM_FREQS entries");
+static_assert(FREQ_MAP_NUM_DUTIES >= 2, "a map needs at least two duties");
+
+/*************************************************************************
+ * Variable Definition
+ ************************************************************************/
+// Written by the control task (end of a run) and setup(), read by the loop
+// and web tasks; every access copies a whole table under the lock.
+static portMUX_TYPE    s_mapMux = portMUX_INITIALIZER_UNLOCKED;
+static FreqMapTable_t  s_tables[EDUGRID_NUM_CHANNELS];
+static bool            s_dirty = false;
+
+/*************************************************************************
+ * Helpers
+ ************************************************************************/
+static void _header(FreqMapHeader_t& hdr)
+{
+  memset(&hdr, 0, sizeof(hdr));
+  hdr.magic    = FREQ_MAP_MAGIC;
+  hdr.version  = FREQ_MAP_VERSION;
+  hdr.size     = sizeof(FreqMapHeader_t) + sizeof(s_tables);
+  hdr.channels = EDUGRID_NUM_CHANNELS;
+  hdr.n_duty   = FREQ_MAP_NUM_DUTIES;
+  hdr.n_freq   = FREQ_MAP_NUM_FREQS;
+  for (uint8_t k = 0; k < FREQ_MAP_NUM_FREQS; ++k) hdr.freq_hz[k] = kFreqs[k];
+}
+
+static uint32_t _crc(const FreqMapHeader_t& hdr, const FreqMapTable_t* tables)
+{
+  FreqMapHeader_t h = hdr;
+  h.crc = 0;
+  const uint32_t crc = esp_rom_crc32_le(0, reinterpret_cast<const uint8_t*>(&h), sizeof(h));
+  return esp_rom_crc32_le(crc, reinterpret_cast<const uint8_t*>(tables), sizeof(s_tables));
+}
+
+/*************************************************************************
+ * Function Definition
+ ************************************************************************/
+edugrid_freq_map::edugrid_freq_map(edugrid_meas_channel& meas, edugrid_pwm_channel& pwm,
+                                   edugrid_mpp_tracker& mppt)
+  : _meas(meas),
+    _pwm(pwm),
+    _mppt(mppt),
+    _index(0),
+    _requested(false),
+    _select(true),
+    _phase(Phase::Idle),
+    _phase_ms(0),
+    _start_ms(0),
+    _point(0),
+    _readings(0),
+    _sum_in(0.0f),
+    _sum_out(0.0f),
+    _saved_duty(0),
+    _saved_freq(CONVERTER_FREQUENCY),
+    _saved_mode(MANUALLY),
+    _run{},
+    _result(FREQ_MAP_NEVER),
+    _select_ms(0)
+{
+}
+
+uint32_t edugrid_freq_map::frequencyHz(uint8_t k)
+{
+  return kFreqs[(k < FREQ_MAP_NUM_FREQS) ? k : 0];
+}
+
+const char* edugrid_freq_map::resultToStr(FreqMapResult_t result)
+{
+  switch (result) {
+    case FREQ_MAP_OK:       return "ok";
+    case FREQ_MAP_NO_POWER: return "no_power";
+    case FREQ_MAP_ABORTED:  return "aborted";
+    default:                return "never";
+  }
+}
+
+bool edugrid_freq_map::table(FreqMapTable_t& out) const
+{
+  portENTER_CRITICAL(&s_mapMux);
+  out = s_tables[_index];
+  portEXIT_CRITICAL(&s_mapMux);
+  return out.valid != 0;
+}
+
+float edugrid_freq_map::expectedEff(void) const
+{
+  FreqMapTable_t t;
+  if (!table(t)) return NAN;
+  const uint32_t f = (uint32_t)_pwm.getFrequency();
+  for (uint8_t k = 0; k < FREQ_MAP_NUM_FREQS; ++k) {
+    if (kFreqs[k] == f) return _effAt(t, k, _meas.getPowerPV());
+  }
+  return NAN;
+}
+
+void edugrid_freq_map::service(void)
+{
+  const uint32_t now = millis();
+
+  switch (_phase)
+  {
+    case Phase::Idle:
+      if (_shouldStart()) {
+        _start(now);
+      } else if (_select && (now - _select_ms) >= FREQ_MAP_SELECT_MS) {
+        _select_ms = now;
+        _selectFrequency();
+      }
+      return;
+
+    case Phase::Settle:
+    case Phase::Measure:
+      // The user, an IV sweep or a trip took the duty: stop right there
+      if (_mppt.get_mode_state() != _saved_mode || !_meas.sensorPvOk() || !_meas.sensorLoadOk() ||
+          _pwm.getPWM() != _run.duty[_point / FREQ_MAP_NUM_FREQS]) {
+        _pwm.setFrequency(_saved_freq);
+        _finish(FREQ_MAP_ABORTED);
+        return;
+      }
+      // One step period for the new point, then readings a window apart
+      if (_phase == Phase::Settle) {
+        if ((now - _phase_ms) < _mppt.get_step_period_ms()) return;
+        _phase = Phase::Measure;
+      } else if ((now - _phase_ms) < edugrid_measurement::windowMsFor(_meas.avgSamples(), _meas.convUs())
+                                      + TASK_CONTROL_INTERVAL_MS) {
+        return;
+      }
+      _phase_ms = now;
+      _sum_in  += _meas.getPowerPV();
+      _sum_out += _meas.getPowerLoad();
+      if (++_readings < FREQ_MAP_READINGS) return;
+
+      {
+        FreqMapCell_t& c = _run.cell[_point / FREQ_MAP_NUM_FREQS][_point % FREQ_MAP_NUM_FREQS];
+        c.p_in = _sum_in / FREQ_MAP_READINGS;
+        c.eff  = (c.p_in >= FREQ_MAP_MIN_P_W) ? _sum_out / _sum_in : 0.0f;
+        // A reading above 1 is sensor error at low power, not a result
+        if (c.eff > 1.0f) c.eff = 0.0f;
+      }
+      if (++_point < FREQ_MAP_POINTS) {
+        _applyPoint(now);
+        return;
+      }
+      // Back to where the run started; hand over once the window is full again
+      _pwm.setFrequency(_saved_freq);
+      _pwm.setPWM(_saved_duty, PWM_SRC_FREQ_MAP);
+      _phase    = Phase::Release;
+      _phase_ms = now;
+      return;
+
+    case Phase::Release:
+      if ((now - _phase_ms) < _mppt.get_step_period_ms()) return;
+      {
+        uint8_t ok = 0;
+        for (uint8_t d = 0; d < FREQ_MAP_NUM_DUTIES; ++d) {
+          for (uint8_t f = 0; f < FREQ_MAP_NUM_FREQS; ++f) {
+            if (_run.cell[d][f].eff > 0.0f) ++ok;
+          }
+        }
+        _finish((ok * 2 >= FREQ_MAP_POINTS) ? FREQ_MAP_OK : FREQ_MAP_NO_POWER);
+      }
+      return;
+
+    default:
+      _phase = Phase::Idle;
+      return;
+  }
+}
+
+void edugrid_freq_map::loadAll(void)
+{
+  if (edugrid_filesystem::get_filesystem_state() != STATE_FILESYSTEM_OK) return;
+  if (!LittleFS.exists(FREQ_MAP_FILEPATH)) return;
+
+  File file = LittleFS.open(FREQ_MAP_FILEPATH, FILE_READ);
+  if (!file) return;
+
+  // Other dimensions or frequencies (a rebuild) make the file worthless
+  FreqMapHeader_t want, hdr;
+  _header(want);
+  static FreqMapTable_t tmp[EDUGRID_NUM_CHANNELS];
+  bool ok = (file.read(reinterpret_cast<uint8_t*>(&hdr), sizeof(hdr)) == sizeof(hdr))
+            && (memcmp(&hdr, &want, offsetof(FreqMapHeader_t, crc)) == 0)
+            && (file.read(reinterpret_cast<uint8_t*>(tmp), sizeof(tmp)) == sizeof(tmp))
+            && (_crc(hdr, tmp) == hdr.crc);
+  file.close();
+
+  if (!ok) {
+    Serial.printf("|WARN| Efficiency map %s invalid or from another build, ignored\n", FREQ_MAP_FILEPATH);
+    return;
+  }
+  portENTER_CRITICAL(&s_mapMux);
+  memcpy(s_tables, tmp, sizeof(s_tables));
+  portEXIT_CRITICAL(&s_mapMux);
+  for (uint8_t ch = 0; ch < EDUGRID_NUM_CHANNELS; ++ch) {
+    if (tmp[ch].valid) Serial.printf("| OK | Efficiency map CH%u loaded\n", (unsigned)ch);
+  }
+}
+
+void edugrid_freq_map::saveAll(void)
+{
+  if (!s_dirty) return;
+  if (edugrid_filesystem::get_filesystem_state() != STATE_FILESYSTEM_OK) return;
+
+  static FreqMapTable_t tmp[EDUGRID_NUM_CHANNELS];
+  portENTER_CRITICAL(&s_mapMux);
+  memcpy(tmp, s_tables, sizeof(tmp));
+  s_dirty = false;
+  portEXIT_CRITICAL(&s_mapMux);
+
+  FreqMapHeader_t hdr;
+  _header(hdr);
+  hdr.crc = _crc(hdr, tmp);
+
+  // Same commit as the config blob: temp file, then rename over the old one
+  File file = LittleFS.open(FREQ_MAP_FILEPATH_TMP, FILE_WRITE);
+  const bool written = file
+      && (file.write(reinterpret_cast<const uint8_t*>(&hdr), sizeof(hdr)) == sizeof(hdr))
+      && (file.write(reinterpret_cast<const uint8_t*>(tmp), sizeof(tmp)) == sizeof(tmp));
+  if (file) file.close();
+  if (!written) {
+    LittleFS.remove(FREQ_MAP_FILEPATH_TMP);
+    Serial.printf("|FAIL| Efficiency map: writing %s failed\n", FREQ_MAP_FILEPATH_TMP);
+    return;
+  }
+  if (!LittleFS.rename(FREQ_MAP_FILEPATH_TMP, FREQ_MAP_FILEPATH)) {
+    LittleFS.remove(FREQ_MAP_FILEPATH);
+    if (!LittleFS.rename(FREQ_MAP_FILEPATH_TMP, FREQ_MAP_FILEPATH)) {
+      Serial.println("|FAIL| Efficiency map commit (rename) failed");
+      return;
+    }
+  }
+  Serial.println("| OK | Efficiency map saved");
+}
+
+/*************************************************************************
+ * Private
+ ************************************************************************/
+bool edugrid_freq_map::_shouldStart(void) const
+{
+  if (!_requested) return false;
+  if (_mppt.get_mode_state() == IV_SWEEP) return false;
+  return _meas.sensorPvOk() && _meas.sensorLoadOk() && _meas.getVoltagePV() >= PV_PRESENT_V;
+}
+
+void edugrid_freq_map::_start(uint32_t now)
+{
+  _requested  = false;
+  _saved_duty = _pwm.getPWM();
+  _saved_freq = _pwm.getFrequency();
+  _saved_mode = _mppt.get_mode_state();
+  _start_ms   = now;
+
+  // The run covers the duty window in force, so a charge ceiling holds
+  const uint8_t lo = _pwm.getPwmLowerLimit();
+  const uint8_t hi = _pwm.getPwmUpperLimit();
+  _run = FreqMapTable_t{};
+  for (uint8_t d = 0; d < FREQ_MAP_NUM_DUTIES; ++d) {
+    _run.duty[d] = (uint8_t)(lo + ((hi - lo) * d + (FREQ_MAP_NUM_DUTIES - 1) / 2) / (FREQ_MAP_NUM_DUTIES - 1));
+  }
+  _point = 0;
+  _applyPoint(now);
+
+  Serial.printf("[FMAP] CH%u start: %u duties %u..%u%% x %u frequencies\n", (unsigned)_index,
+                (unsigned)FREQ_MAP_NUM_DUTIES, (unsigned)lo, (unsigned)hi, (unsigned)FREQ_MAP_NUM_FREQS);
+}
+
+void edugrid_freq_map::_applyPoint(uint32_t now)
+{
+  const uint8_t d = _point / FREQ_MAP_NUM_FREQS;
+  const uint8_t f = _point % FREQ_MAP_NUM_FREQS;
+  _pwm.setFrequency((float)kFreqs[f]);
+  _pwm.setPWM(_run.duty[d], PWM_SRC_FREQ_MAP);
+  _readings = 0;
+  _sum_in   = 0.0f;
+  _sum_out  = 0.0f;
+  _phase    = Phase::Settle;
+  _phase_ms = now;
+}
+
+void edugrid_freq_map::_finish(FreqMapResult_t result)
+{
+  const uint32_t took_ms = millis() - _start_ms;
+  if (result == FREQ_MAP_OK) {
+    const time_t t = time(nullptr);
+    _run.unix_s = ((uint32_t)t >= FREQ_MAP_UNIX_VALID_S) ? (uint32_t)t : 0;
+    _run.valid  = 1;
+    portENTER_CRITICAL(&s_mapMux);
+    s_tables[_index] = _run;
+    s_dirty = true;
+    portEXIT_CRITICAL(&s_mapMux);
+    _select_ms = millis() - FREQ_MAP_SELECT_MS;   // pick from the new map right away
+    Serial.printf("[FMAP] CH%u map done in %lu s\n", (unsigned)_index, (unsigned long)(took_ms / 1000UL));
+  } else {
+    Serial.printf("[FMAP] CH%u no map (%s), keeping the previous one\n", (unsigned)_index, resultToStr(result));
+  }
+  edugrid_trace::record(TRACE_EV_FREQ_MAP, FREQ_MAP_EV_RUN, (uint16_t)result, took_ms, _index);
+  _result = result;
+  _phase  = Phase::Idle;
+}
+
+void edugrid_freq_map::_selectFrequency(void)
+{
+  if (_mppt.get_mode_state() == IV_SWEEP) return;
+  const float p = _meas.getPowerPV();
+  if (!_meas.sensorPvOk() || p < FREQ_MAP_MIN_P_W) return;
+
+  FreqMapTable_t t;
+  if (!table(t)) return;
+
+  const uint32_t cur = (uint32_t)_pwm.getFrequency();
+  float   cur_eff  = -1.0f;
+  float   best_eff = -1.0f;
+  uint8_t best     = 0;
+  for (uint8_t k = 0; k < FREQ_MAP_NUM_FREQS; ++k) {
+    const float e = _effAt(t, k, p);
+    if (!(e > 0.0f)) continue;
+    if (kFreqs[k] == cur) cur_eff = e;
+    if (e > best_eff) { best_eff = e; best = k; }
+  }
+  if (best_eff <= 0.0f || kFreqs[best] == cur) return;
+  if (cur_eff > 0.0f && best_eff < cur_eff + FREQ_MAP_HYST) return;
+
+  _pwm.setFrequency((float)kFreqs[best]);
+  edugrid_trace::record(TRACE_EV_FREQ_MAP, FREQ_MAP_EV_SELECT, (uint16_t)(kFreqs[best] / 100UL), cur, _index);
+}
+
+float edugrid_freq_map::_effAt(const FreqMapTable_t& t, uint8_t f, float p_in) const
+{
+  // P_in rises and falls again along the duty axis, so look for the two
+  // measured points nearest in power and interpolate if they enclose p_in
+  int8_t a = -1, b = -1;
+  for (uint8_t d = 0; d < FREQ_MAP_NUM_DUTIES; ++d) {
+    const FreqMapCell_t& c = t.cell[d][f];
+    if (!(c.eff > 0.0f)) continue;
+    const float dist = fabsf(c.p_in - p_in);
+    if (a < 0 || dist < fabsf(t.cell[a][f].p_in - p_in)) {
+      b = a;
+      a = (int8_t)d;
+    } else if (b < 0 || dist < fabsf(t.cell[b][f].p_in - p_in)) {
+      b = (int8_t)d;
+    }
+  }
+  if (a < 0) return NAN;
+  const FreqMapCell_t& ca = t.cell[a][f];
+  if (b < 0) return ca.eff;
+  const FreqMapCell_t& cb = t.cell[b][f];
+  if ((p_in - ca.p_in) * (p_in - cb.p_in) > 0.0f || fabsf(cb.p_in - ca.p_in) < 1e-3f) return ca.eff;
+  return ca.eff + (cb.eff - ca.eff) * (p_in - ca.p_in) / (cb.p_in - ca.p_in);
+}
@@ -0,0 +1,222 @@
+/*************************************************************************
+ * @file edugrid_i2c.cpp
+ * @date 2026/10/18
+ *
+ ************************************************************************/
+
+/*************************************************************************
+ * Include
+ ************************************************************************/
+#include <edugrid_i2c.h>
+#include <edugrid_channel.h>
+#include <edugrid_measurement.h>
+#include <edugrid_trace.h>
+#include <Wire.h>
+#if EDUGRID_I2C_ASYNC
+#include <freertos/semphr.h>
+#endif
+
+/*************************************************************************
+ * Variable Definition
+ ************************************************************************/
+#if EDUGRID_I2C_ASYNC
+static SemaphoreHandle_t s_bus  = nullptr;
+static TaskHandle_t      s_task = nullptr;
+#endif
+static I2cBusStats_t     s_stats = {};   // written by the worker only (s_statsMux)
+static portMUX_TYPE      s_statsMux = portMUX_INITIALIZER_UNLOCKED;
+
+/*************************************************************************
+ * Function Definition
+ ************************************************************************/
+void edugrid_i2c::begin(void)
+{
+  Wire.begin(PIN_I2C_SDA, PIN_I2C_SCL);
+  Wire.setClock(I2C_CLOCK_HZ);
+  // A device holding the bus costs one bounded wait, not the driver default
+  Wire.setTimeOut(I2C_TIMEOUT_MS);
+#if EDUGRID_I2C_ASYNC
+  if (s_bus == nullptr) s_bus = xSemaphoreCreateRecursiveMutex();
+#endif
+}
+
+void edugrid_i2c::start(void)
+{
+#if EDUGRID_I2C_ASYNC
+  if (s_bus == nullptr || s_task != nullptr) return;
+  // The control task's first pass takes a completed pair, not zeros
+  for (uint8_t ch = 0; ch < edugrid_channel::count(); ++ch) {
+    edugrid_channel::at(ch).meas.poll();
+  }
+  xTaskCreatePinnedToCore(_pollTask, "i2c", I2C_TASK_STACK, nullptr,
+                          I2C_TASK_PRIORITY, &s_task, I2C_TASK_CORE);
+  portENTER_CRITICAL(&s_statsMux);
+  s_stats.async = (s_task != nullptr);
+  portEXIT_CRITICAL(&s_statsMux);
+  Serial.printf("[I2C] %s polled reads once per conversion (every %u ms while one is due, timeout %u ms)\n",
+                (s_task != nullptr) ? "| OK |" : "|FAIL|", (unsigned)I2C_POLL_MS, (unsigned)I2C_TIMEOUT_MS);
+#endif
+}
+
+bool edugrid_i2c::running(void)
+{
+  return s_stats.async;
+}
+
+void edugrid_i2c::wake(void)
+{
+#if EDUGRID_I2C_ASYNC
+  if (s_task != nullptr) xTaskNotifyGive(s_task);
+#endif
+}
+
+void edugrid_i2c::lock(void)
+{
+#if EDUGRID_I2C_ASYNC
+  if (s_bus != nullptr) xSemaphoreTakeRecursive(s_bus, portMAX_DELAY);
+#endif
+}
+
+void edugrid_i2c::unlock(void)
+{
+#if EDUGRID_I2C_ASYNC
+  if (s_bus != nullptr) xSemaphoreGiveRecursive(s_bus);
+#endif
+}
+
+void edugrid_i2c::stats(I2cBusStats_t& out)
+{
+  portENTER_CRITICAL(&s_statsMux);
+  out = s_stats;
+  portEXIT_CRITICAL(&s_statsMux);
+}
+
+/*************************************************************************
+ * Private
+ ************************************************************************/
+void edugrid_i2c::_pollTask(void* arg)
+{
+  (void)arg;
+#if EDUGRID_I2C_ASYNC
+  uint32_t due[EDUGRID_NUM_CHANNELS]  = {};   // next read [millis()]
+  uint32_t sync[EDUGRID_NUM_CHANNELS] = {};   // last read that found a new conversion
+  bool     restart = true;
+  for (;;) {
+    const uint32_t t0  = micros();
+    const uint32_t now = millis();
+    uint32_t sleep_ms = UINT32_MAX;
+    uint32_t skipped = 0, unchanged = 0;
+    bool     polled = false;
+    for (uint8_t ch = 0; ch < edugrid_channel::count(); ++ch) {
+      edugrid_meas_channel& meas = edugrid_channel::at(ch).meas;
+      if (restart) { due[ch] = now; sync[ch] = now; }
+      if ((int32_t)(due[ch] - now) > 0) {
+        if (due[ch] - now < sleep_ms) sleep_ms = due[ch] - now;
+        continue;
+      }
+      // A settle or scope burst owns the bus for a while; its channel is
+      // paused meanwhile, so the others just skip one read too.
+      if (xSemaphoreTakeRecursive(s_bus, pdMS_TO_TICKS(I2C_POLL_MS)) != pdTRUE) {
+        ++skipped;
+        due[ch] = now + I2C_POLL_MS;
+        sleep_ms = I2C_POLL_MS;
+        continue;
+      }
+      const bool fresh = meas.poll();
+      xSemaphoreGiveRecursive(s_bus);
+      polled = true;
+
+      // The next conversion is a window after this one.  Results that did
+      // not move until well past it (inputs at a standstill) count as one too.
+      const uint32_t window = edugrid_measurement::windowMsFor(meas.avgSamples(), meas.convUs());
+      const uint32_t lead   = I2C_POLL_MS + window * I2C_POLL_LEAD_PCT / 100;
+      if (fresh || (now - sync[ch]) >= window + lead) {
+        sync[ch] = now;
+        due[ch]  = now + ((window > lead) ? window - lead : 0);
+      } else {
+        ++unchanged;
+        due[ch] = now + I2C_POLL_MS;
+      }
+      if (due[ch] - now < sleep_ms) sleep_ms = due[ch] - now;
+    }
+    restart = false;
+
+    if (polled || skipped) {
+      const uint32_t us = micros() - t0;
+      portENTER_CRITICAL(&s_statsMux);
+      s_stats.skipped   += skipped;
+      s_stats.unchanged += unchanged;
+      s_stats.cycle_us   = us;
+      if (us > s_stats.cycle_us_max) s_stats.cycle_us_max = us;
+      ++s_stats.cycles;
+      portEXIT_CRITICAL(&s_statsMux);
+    }
+
+    _serviceRecovery(millis());
+    // Until the next channel is due, or configure() restarted the conversions
+    if (sleep_ms < I2C_POLL_MS) sleep_ms = I2C_POLL_MS;
+    restart = (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(sleep_ms)) != 0);
+  }
+#endif
+}
+
+void edugrid_i2c::_serviceRecovery(uint32_t now)
+{
+  if (s_stats.recoveries > 0 && (now - s_stats.recover_ms) < I2C_RECOVER_HOLDOFF_MS) return;
+
+  // The device with the longest run of failed reads names the recovery
+  uint8_t  worst_ch = 0;
+  bool     worst_load = false;
+  uint16_t worst = 0;
+  for (uint8_t ch = 0; ch < edugrid_channel::count(); ++ch) {
+    const edugrid_meas_channel& m = edugrid_channel::at(ch).meas;
+    for (uint8_t side = 0; side < 2; ++side) {
+      const uint16_t n = m.deviceStats(side != 0).consecutive;
+      if (n > worst) { worst = n; worst_ch = ch; worst_load = (side != 0); }
+    }
+  }
+  if (worst < I2C_RECOVER_ERRORS) return;
+
+  lock();
+  const bool released = _recoverBus();
+  unlock();
+  portENTER_CRITICAL(&s_statsMux);
+  s_stats.recover_ms = now;
+  const uint32_t recoveries = ++s_stats.recoveries;
+  portEXIT_CRITICAL(&s_statsMux);
+  edugrid_trace::record(TRACE_EV_I2C_RECOVER, worst_load ? 1 : 0, worst, recoveries, worst_ch);
+  Serial.printf("[I2C] %s CH%u %s failed %u reads in a row, bus recovered (SDA %s)\n",
+                released ? "|WARN|" : "|FAIL|", (unsigned)worst_ch, worst_load ? "LOAD" : "PV",
+                (unsigned)worst, released ? "released" : "still low");
+}
+
+bool edugrid_i2c::_recoverBus(void)
+{
+#if EDUGRID_I2C_ASYNC
+  Wire.end();
+
+  // A device cut off mid-read still drives SDA for the rest of its byte:
+  // clock until it lets go, then put a STOP on the bus.
+  pinMode(PIN_I2C_SDA, INPUT_PULLUP);
+  digitalWrite(PIN_I2C_SCL, HIGH);
+  pinMode(PIN_I2C_SCL, OUTPUT_OPEN_DRAIN);
+  for (uint8_t k = 0; k < I2C_RECOVER_CLOCKS && digitalRead(PIN_I2C_SDA) == LOW; ++k) {
+    digitalWrite(PIN_I2C_SCL, LOW);
+    delayMicroseconds(5);
+    digitalWrite(PIN_I2C_SCL, HIGH);
+    delayMicroseconds(5);
+  }
+  digitalWrite(PIN_I2C_SDA, LOW);
+  pinMode(PIN_I2C_SDA, OUTPUT_OPEN_DRAIN);
+  delayMicroseconds(5);
+  digitalWrite(PIN_I2C_SDA, HIGH);     // SDA rising while SCL is high
+  delayMicroseconds(5);
+  pinMode(PIN_I2C_SDA, INPUT_PULLUP);
+  const bool released = (digitalRead(PIN_I2C_SDA) == HIGH);
+
+  begin();
+  return released;
+#else
+  return true;
+#endif
+}
@@ -0,0 +1,400 @@
+/*************************************************************************
+ * @file edugrid_iv_archive.cpp
+ * @date 2026/10/18
+ *
+ ************************************************************************/
+
+/*************************************************************************
+ * Include
+ ************************************************************************/
+#include <edugrid_iv_archive.h>
+#include <edugrid_filesystem.h>
+#include <LittleFS.h>
+#include <esp_rom_crc.h>
+#include <math.h>
+#include <time.h>
+
+/*************************************************************************
+ * Define
+ ************************************************************************/
+#define IV_ARCHIVE_PATH_LEN      (24)
+#define IV_ARCHIVE_VOC_EXTRAP    (1.25f)   /* Voc at most this far beyond the last point */
+#define IV_ARCHIVE_ISC_EXTRAP    (1.05f)   /* Isc likewise; more means the flat part was not reached */
+#define IV_ARCHIVE_UNIX_VALID_S  (1600000000UL)   /* anything earlier: clock never set */
+
+/*************************************************************************
+ * Variable Definition
+ ************************************************************************/
+uint32_t edugrid_iv_archive::_next_seq        = 1;
+uint32_t edugrid_iv_archive::_oldest_file_seq = 0;
+uint16_t edugrid_iv_archive::_file_count      = 0;
+
+// Written by the control task, read by the loop and web tasks; every access
+// copies a whole record under the lock.
+static portMUX_TYPE       s_ringMux = portMUX_INITIALIZER_UNLOCKED;
+static IvArchiveRecord_t  s_ring[IV_ARCHIVE_RAM_SLOTS];
+static bool               s_saved[IV_ARCHIVE_RAM_SLOTS];
+static uint32_t           s_head = 0;             // records captured since boot
+
+static IvArchiveRecord_t  s_build;                // control task
+static IvArchiveRecord_t  s_io;                   // loop task
+
+/*************************************************************************
+ * Helpers
+ ************************************************************************/
+static int16_t _toCounts(float x, float lsb)
+{
+  const long c = lroundf(x / lsb);
+  return (int16_t)((c > INT16_MAX) ? INT16_MAX : (c < -INT16_MAX) ? -INT16_MAX : c);
+}
+
+/** Peak of the parabola through three (x, y); false if it opens upwards */
+static bool _parabolaPeak(float x0, float y0, float x1, float y1, float x2, float y2, float& xp, float& yp)
+{
+  const float d01 = x0 - x1, d02 = x0 - x2, d12 = x1 - x2;
+  if (fabsf(d01) < 1e-6f || fabsf(d02) < 1e-6f || fabsf(d12) < 1e-6f) return false;
+  const float a = (y0 / (d01 * d02)) - (y1 / (d01 * d12)) + (y2 / (d02 * d12));
+  const float b = (y1 - y0) / (x1 - x0) - a * (x0 + x1);
+  if (a >= 0.0f) return false;
+  xp = -b / (2.0f * a);
+  const float lo = (x0 < x2) ? x0 : x2;
+  const float hi = (x0 < x2) ? x2 : x0;
+  if (xp < lo) xp = lo;
+  if (xp > hi) xp = hi;
+  yp = y0 + (xp - x0) * ((y1 - y0) / (x1 - x0) + a * (xp - x1));
+  return true;
+}
+
+/** Voc, Isc, Vmp, Imp of the up pass (sorted by duty: V falls along it) */
+static void _extract(const edugrid_mpp_tracker& m, uint16_t n_up, IvArchiveHeader_t& hdr)
+{
+  // Near Voc the curve is steep and near Isc flat, so a straight line
+  // through the two outermost points is a good extrapolation to either axis.
+  // A buck input rarely reaches the flat part; if the line still rises
+  // steeply, the current of the lowest point is kept (a lower bound).
+  const IvPoint_t& h0 = m.iv_point(0);
+  const IvPoint_t& h1 = m.iv_point(1);
+  hdr.voc = h0.v;
+  if (h1.i - h0.i > 1e-6f) {
+    const float voc = h0.v + h0.i * (h0.v - h1.v) / (h1.i - h0.i);
+    if (voc > h0.v && voc < h0.v * IV_ARCHIVE_VOC_EXTRAP) hdr.voc = voc;
+  }
+
+  const IvPoint_t& l0 = m.iv_point(n_up - 1);
+  const IvPoint_t& l1 = m.iv_point(n_up - 2);
+  hdr.isc = l0.i;
+  if (l1.v - l0.v > 1e-6f) {
+    const float isc = l0.i + l0.v * (l0.i - l1.i) / (l1.v - l0.v);
+    if (isc > l0.i && isc < l0.i * IV_ARCHIVE_ISC_EXTRAP) hdr.isc = isc;
+  }
+
+  // MPP: best point, moved to the peak of P(V) through its neighbours
+  uint16_t k = 0;
+  for (uint16_t j = 1; j < n_up; ++j) {
+    if (m.iv_point(j).v * m.iv_point(j).i > m.iv_point(k).v * m.iv_point(k).i) k = j;
+  }
+  const IvPoint_t& pk = m.iv_point(k);
+  hdr.vmp = pk.v;
+  hdr.imp = pk.i;
+  if (k > 0 && k + 1 < n_up) {
+    const IvPoint_t& a = m.iv_point(k - 1);
+    const IvPoint_t& b = m.iv_point(k + 1);
+    float vp, pp;
+    if (_parabolaPeak(a.v, a.v * a.i, pk.v, pk.v * pk.i, b.v, b.v * b.i, vp, pp) &&
+        vp > 0.0f && pp >= pk.v * pk.i) {
+      hdr.vmp = vp;
+      hdr.imp = pp / vp;
+    }
+  }
+}
+
+/** I at voltage v on the up pass of a record, NAN outside it */
+static float _currentAt(const IvArchiveRecord_t& rec, float v)
+{
+  for (uint8_t k = 0; k + 1 < rec.hdr.n_up; ++k) {
+    float va, ia, vb, ib;
+    edugrid_iv_archive::point(rec, k, va, ia);
+    edugrid_iv_archive::point(rec, k + 1, vb, ib);
+    if ((v <= va && v >= vb) || (v >= va && v <= vb)) {
+      return (fabsf(va - vb) < 1e-6f) ? 0.5f * (ia + ib) : ia + (ib - ia) * (v - va) / (vb - va);
+    }
+  }
+  return NAN;
+}
+
+static void _voltageRange(const IvArchiveRecord_t& rec, float& lo, float& hi)
+{
+  lo = INFINITY;
+  hi = 0.0f;
+  for (uint8_t k = 0; k < rec.hdr.n_up; ++k) {
+    float v, i;
+    edugrid_iv_archive::point(rec, k, v, i);
+    if (v < lo) lo = v;
+    if (v > hi) hi = v;
+  }
+}
+
+/*************************************************************************
+ * Function Definition
+ ************************************************************************/
+void edugrid_iv_archive::init(void)
+{
+  if (edugrid_filesystem::get_filesystem_state() != STATE_FILESYSTEM_OK) return;
+  if (!LittleFS.exists(IV_ARCHIVE_DIR)) LittleFS.mkdir(IV_ARCHIVE_DIR);
+
+  uint32_t max_seq = 0;
+  _oldest_file_seq = 0;
+  _file_count      = 0;
+  File dir = LittleFS.open(IV_ARCHIVE_DIR);
+  File f   = dir ? dir.openNextFile() : File();
+  while (f) {
+    const uint32_t seq = strtoul(f.name(), nullptr, 10);
+    if (seq > 0) {
+      if (seq > max_seq) max_seq = seq;
+      if (_oldest_file_seq == 0 || seq < _oldest_file_seq) _oldest_file_seq = seq;
+      ++_file_count;
+    }
+    f = dir.openNextFile();
+  }
+  _next_seq = max_seq + 1;
+
+  Serial.printf("| OK | IV archive: %u sweeps in %s, next #%lu\n",
+                (unsigned)_file_count, IV_ARCHIVE_DIR, (unsigned long)_next_seq);
+}
+
+void edugrid_iv_archive::capture(uint8_t ch, const edugrid_mpp_tracker& mppt)
+{
+  const uint16_t n    = mppt.iv_point_count();
+  const uint16_t n_up = mppt.iv_up_count();
+  if (n_up < 3 || n > IV_SWEEP_POINTS) return;
+
+  IvArchiveHeader_t& hdr = s_build.hdr;
+  memset(&hdr, 0, sizeof(hdr));
+
+  // One scale per sweep: the largest reading maps to IV_ARCHIVE_FULL_SCALE
+  float v_max = 0.0f, i_max = 0.0f;
+  for (uint16_t k = 0; k < n; ++k) {
+    const IvPoint_t& pt = mppt.iv_point(k);
+    if (fabsf(pt.v) > v_max) v_max = fabsf(pt.v);
+    if (fabsf(pt.i) > i_max) i_max = fabsf(pt.i);
+  }
+  hdr.v_lsb = (v_max > 0.0f) ? v_max / IV_ARCHIVE_FULL_SCALE : 1e-6f;
+  hdr.i_lsb = (i_max > 0.0f) ? i_max / IV_ARCHIVE_FULL_SCALE : 1e-6f;
+  for (uint16_t k = 0; k < n; ++k) {
+    const IvPoint_t& pt = mppt.iv_point(k);
+    s_build.pts[k].v     = _toCounts(pt.v, hdr.v_lsb);
+    s_build.pts[k].i     = _toCounts(pt.i, hdr.i_lsb);
+    s_build.pts[k].duty  = pt.duty;
+    s_build.pts[k].flags = (pt.dir < 0) ? IV_ARCHIVE_PT_DOWN : 0;
+  }
+  _extract(mppt, n_up, hdr);
+
+  const time_t now = time(nullptr);
+  hdr.magic       = IV_ARCHIVE_MAGIC;
+  hdr.version     = IV_ARCHIVE_VERSION;
+  hdr.size        = (uint16_t)(sizeof(IvArchiveHeader_t) + n * sizeof(IvArchivePoint_t));
+  hdr.seq         = _next_seq++;
+  hdr.uptime_ms   = millis();
+  hdr.unix_s      = ((uint32_t)now >= IV_ARCHIVE_UNIX_VALID_S) ? (uint32_t)now : 0;
+  hdr.ch          = ch;
+  hdr.n           = (uint8_t)n;
+  hdr.n_up        = (uint8_t)n_up;
+  hdr.temp_c10    = IV_ARCHIVE_TEMP_UNKNOWN;
+  hdr.duration_ms = mppt.iv_duration_ms();
+  hdr.crc         = _crc(s_build);
+
+  portENTER_CRITICAL(&s_ringMux);
+  const uint32_t slot = s_head % IV_ARCHIVE_RAM_SLOTS;
+  memcpy(&s_ring[slot], &s_build, hdr.size);
+  s_saved[slot] = false;
+  ++s_head;
+  portEXIT_CRITICAL(&s_ringMux);
+}
+
+void edugrid_iv_archive::service(void)
+{
+  if (edugrid_filesystem::get_filesystem_state() != STATE_FILESYSTEM_OK) return;
+
+  // Oldest unsaved record first, one per call so loop() never stalls long
+  bool found = false;
+  uint32_t slot = 0;
+  portENTER_CRITICAL(&s_ringMux);
+  const uint32_t first = (s_head > IV_ARCHIVE_RAM_SLOTS) ? s_head - IV_ARCHIVE_RAM_SLOTS : 0;
+  for (uint32_t k = first; k < s_head && !found; ++k) {
+    slot = k % IV_ARCHIVE_RAM_SLOTS;
+    if (!s_saved[slot]) {
+      memcpy(&s_io, &s_ring[slot], s_ring[slot].hdr.size);
+      found = true;
+    }
+  }
+  portEXIT_CRITICAL(&s_ringMux);
+  if (!found) return;
+
+  char path[IV_ARCHIVE_PATH_LEN];
+  _path(s_io.hdr.seq, path, sizeof(path));
+  File file = LittleFS.open(path, FILE_WRITE);
+  const bool written = file && (file.write(reinterpret_cast<const uint8_t*>(&s_io), s_io.hdr.size) == s_io.hdr.size);
+  if (file) file.close();
+
+  // Marked saved even on a failure: a full flash must not be retried every
+  // second.  The sweep stays readable from RAM until the ring wraps.
+  portENTER_CRITICAL(&s_ringMux);
+  if (s_ring[slot].hdr.seq == s_io.hdr.seq) s_saved[slot] = true;
+  portEXIT_CRITICAL(&s_ringMux);
+
+  if (!written) {
+    LittleFS.remove(path);
+    Serial.printf("|FAIL| IV archive: writing %s failed\n", path);
+    return;
+  }
+  if (_oldest_file_seq == 0) _oldest_file_seq = s_io.hdr.seq;
+  ++_file_count;
+
+  // Drop the oldest files beyond the limit; gaps (files deleted through the
+  // file manager) are skipped over.
+  while (_file_count > IV_ARCHIVE_MAX_FILES && _oldest_file_seq < s_io.hdr.seq) {
+    _path(_oldest_file_seq++, path, sizeof(path));
+    if (LittleFS.remove(path)) --_file_count;
+  }
+}
+
+bool edugrid_iv_archive::load(uint32_t seq, IvArchiveRecord_t& out)
+{
+  bool found = false;
+  portENTER_CRITICAL(&s_ringMux);
+  for (uint32_t k = 0; k < IV_ARCHIVE_RAM_SLOTS && k < s_head && !found; ++k) {
+    if (s_ring[k].hdr.seq == seq) {
+      memcpy(&out, &s_ring[k], s_ring[k].hdr.size);
+      found = true;
+    }
+  }
+  portEXIT_CRITICAL(&s_ringMux);
+  return found || _readFile(seq, out);
+}
+
+void edugrid_iv_archive::forEach(bool (*fn)(const IvArchiveHeader_t& hdr, bool in_flash, void* ctx), void* ctx)
+{
+  uint32_t last_file_seq = 0;
+  if (edugrid_filesystem::get_filesystem_state() == STATE_FILESYSTEM_OK) {
+    // Zero-padded names: directory order is sequence order
+    File dir = LittleFS.open(IV_ARCHIVE_DIR);
+    File f   = dir ? dir.openNextFile() : File();
+    while (f) {
+      IvArchiveHeader_t hdr;
+      if (f.read(reinterpret_cast<uint8_t*>(&hdr), sizeof(hdr)) == sizeof(hdr) &&
+          hdr.magic == IV_ARCHIVE_MAGIC && hdr.version == IV_ARCHIVE_VERSION) {
+        last_file_seq = hdr.seq;
+        if (!fn(hdr, true, ctx)) return;
+      }
+      f.close();
+      f = dir.openNextFile();
+    }
+  }
+
+  // Ring entries not on flash yet, oldest first
+  const uint32_t head  = s_head;
+  const uint32_t first = (head > IV_ARCHIVE_RAM_SLOTS) ? head - IV_ARCHIVE_RAM_SLOTS : 0;
+  for (uint32_t k = first; k < head; ++k) {
+    IvArchiveHeader_t hdr;
+    portENTER_CRITICAL(&s_ringMux);
+    hdr = s_ring[k % IV_ARCHIVE_RAM_SLOTS].hdr;
+    portEXIT_CRITICAL(&s_ringMux);
+    if (hdr.seq > last_file_seq && !fn(hdr, false, ctx)) return;
+  }
+}
+
+bool edugrid_iv_archive::diff(const IvArchiveRecord_t& a, const IvArchiveRecord_t& b, IvArchiveDiff_t& out)
+{
+  const IvArchiveHeader_t& ha = a.hdr;
+  const IvArchiveHeader_t& hb = b.hdr;
+  const float pa = ha.vmp * ha.imp;
+  const float pb = hb.vmp * hb.imp;
+
+  out.d_voc = hb.voc - ha.voc;
+  out.d_isc = hb.isc - ha.isc;
+  out.d_vmp = hb.vmp - ha.vmp;
+  out.d_imp = hb.imp - ha.imp;
+  out.d_pmp = pb - pa;
+  out.d_ff  = fillFactor(hb) - fillFactor(ha);
+  out.r_isc = (ha.isc > 0.0f) ? hb.isc / ha.isc : NAN;
+  out.r_pmp = (pa > 0.0f) ? pb / pa : NAN;
+  out.rs_a  = seriesResistance(a);
+  out.rs_b  = seriesResistance(b);
+
+  // Current difference on the voltage range both sweeps cover
+  float lo_a, hi_a, lo_b, hi_b;
+  _voltageRange(a, lo_a, hi_a);
+  _voltageRange(b, lo_b, hi_b);
+  const float lo = (lo_a > lo_b) ? lo_a : lo_b;
+  const float hi = (hi_a < hi_b) ? hi_a : hi_b;
+  out.n = 0;
+  if (!(hi > lo)) return false;
+  for (uint8_t k = 0; k < IV_ARCHIVE_DIFF_POINTS; ++k) {
+    const float v = lo + (hi - lo) * k / (IV_ARCHIVE_DIFF_POINTS - 1);
+    out.v[k]  = v;
+    out.di[k] = _currentAt(b, v) - _currentAt(a, v);
+  }
+  out.n = IV_ARCHIVE_DIFF_POINTS;
+  return true;
+}
+
+void edugrid_iv_archive::point(const IvArchiveRecord_t& rec, uint8_t k, float& v, float& i)
+{
+  v = rec.pts[k].v * rec.hdr.v_lsb;
+  i = rec.pts[k].i * rec.hdr.i_lsb;
+}
+
+float edugrid_iv_archive::fillFactor(const IvArchiveHeader_t& hdr)
+{
+  const float ideal = hdr.voc * hdr.isc;
+  return (ideal > 0.0f) ? (hdr.vmp * hdr.imp) / ideal : 0.0f;
+}
+
+float edugrid_iv_archive::seriesResistance(const IvArchiveRecord_t& rec)
+{
+  // Slope of the two points nearest Voc; includes the diode's own slope, so
+  // it is an upper bound, but a rising trend is what ageing contacts show.
+  if (rec.hdr.n_up < 2) return NAN;
+  float v0, i0, v1, i1;
+  point(rec, 0, v0, i0);
+  point(rec, 1, v1, i1);
+  return (i1 - i0 > 1e-6f) ? (v0 - v1) / (i1 - i0) : NAN;
+}
+
+/*************************************************************************
+ * Private
+ ************************************************************************/
+void edugrid_iv_archive::_path(uint32_t seq, char* out, size_t len)
+{
+  snprintf(out, len, "%s/%08lu.ivb", IV_ARCHIVE_DIR, (unsigned long)seq);
+}
+
+bool edugrid_iv_archive::_readFile(uint32_t seq, IvArchiveRecord_t& out)
+{
+  if (edugrid_filesystem::get_filesystem_state() != STATE_FILESYSTEM_OK) return false;
+
+  char path[IV_ARCHIVE_PATH_LEN];
+  _path(seq, path, sizeof(path));
+  File file = LittleFS.open(path, FILE_READ);
+  if (!file) return false;
+
+  IvArchiveHeader_t& hdr = out.hdr;
+  bool ok = (file.read(reinterpret_cast<uint8_t*>(&hdr), sizeof(hdr)) == sizeof(hdr))
+            && (hdr.magic == IV_ARCHIVE_MAGIC) && (hdr.version == IV_ARCHIVE_VERSION)
+            && (hdr.n <= IV_SWEEP_POINTS) && (hdr.n_up <= hdr.n)
+            && (hdr.size == sizeof(IvArchiveHeader_t) + hdr.n * sizeof(IvArchivePoint_t));
+  if (ok) {
+    const size_t len = hdr.n * sizeof(IvArchivePoint_t);
+    ok = (file.read(reinterpret_cast<uint8_t*>(out.pts), len) == len) && (_crc(out) == hdr.crc);
+  }
+  file.close();
+  return ok;
+}
+
+uint32_t edugrid_iv_archive::_crc(const IvArchiveRecord_t& rec)
+{
+  IvArchiveHeader_t hdr = rec.hdr;
+  hdr.crc = 0;
+  const uint32_t crc = esp_rom_crc32_le(0, reinterpret_cast<const uint8_t*>(&hdr), sizeof(hdr));
+  return esp_rom_crc32_le(crc, reinterpret_cast<const uint8_t*>(rec.pts), rec.hdr.n * sizeof(IvArchivePoint_t));
+}
@@ -8,6 +8,10 @@
  * Include
  ************************************************************************/
 #include <edugrid_logging.h>
+#include <edugrid_config.h>
+#include <LittleFS.h>
+#include <esp_rom_crc.h>
+#include <math.h>
 
 /*************************************************************************
  * Define
@@ -18,10 +22,51 @@
  ************************************************************************/
 bool edugrid_logging::log_active = false;
 bool edugrid_logging::safe_request = false;
-String edugrid_logging::log_message_buffer = "";
-uint8_t edugrid_logging::log_message_counter = 0;
 unsigned long edugrid_logging::log_start_time = 0;
 unsigned long edugrid_logging::all_messages = 0;
+uint32_t edugrid_logging::log_block_seq = 0;
+uint32_t edugrid_logging::dropped_rows = 0;
+
+/* Rows of the block that is currently being filled.  With RTC staging the
+ * area is not cleared by a soft reset, so recoverLogFile() can still write
+ * it; the magic + CRC tell a valid area from power-on garbage. */
+#ifdef EDUGRID_LOGGING_RTC_STAGING
+static RTC_NOINIT_ATTR LogStaging_t s_staging;
+#else
+static LogStaging_t s_staging;
+#endif
+
+/*************************************************************************
+ * Helpers
+ ************************************************************************/
+static uint32_t _crcRows(const LogRow_t* rows, uint32_t count)
+{
+  return esp_rom_crc32_le(0, reinterpret_cast<const uint8_t*>(rows), count * sizeof(LogRow_t));
+}
+
+static void _resetStaging(uint32_t seq)
+{
+  s_staging.magic = EDUGRID_LOGGING_STAGING_MAGIC;
+  s_staging.seq   = seq;
+  s_staging.count = 0;
+  s_staging.crc   = 0;
+}
+
+/** Check the staging area left behind by the previous run
+ * @return number of valid rows (0 if the area is garbage)
+ */
+static uint32_t _validStagedRows()
+{
+  if (s_staging.magic != EDUGRID_LOGGING_STAGING_MAGIC) return 0;
+  const uint32_t n = s_staging.count;
+  if (n > EDUGRID_LOGGING_MAX_MESSAGES_IN_BUFFER) return 0;
+  if (_crcRows(s_staging.rows, n) == s_staging.crc) return n;
+  // _stageRow() stores row, crc, count in that order; a reset between the
+  // last two leaves one more row covered by the CRC than counted.
+  if (n < EDUGRID_LOGGING_MAX_MESSAGES_IN_BUFFER &&
+      _crcRows(s_staging.rows, n + 1) == s_staging.crc) return n + 1;
+  return 0;
+}
 
 /*************************************************************************
  * Function Definition
@@ -46,14 +91,18 @@ String edugrid_logging::getLogState_str()
 
 void edugrid_logging::activateLogging()
 {
-  // Start a brand-new session: wipe the on-disk CSV file and clear the in-RAM
-  // buffer so that the user receives a clean dataset.
+  // Start a brand-new session: wipe the on-disk CSV file and clear the
+  // staging area so that the user receives a clean dataset.
   log_active = true;
   log_start_time = millis();
-  log_message_buffer = "";
-  log_message_buffer.reserve(EDUGRID_LOGGING_MAX_MESSAGES_IN_BUFFER * 48);
-  /* Clear log file content */
-  edugrid_filesystem::writeContent_str(edugrid_filesystem::config_log_name, "");
+  all_messages = 0;
+  log_block_seq = 0;
+  _resetStaging(log_block_seq);
+  /* Clear log file content, the header marks the file as framed */
+  EdugridConfig_t cfg;
+  edugrid_config::snapshot(cfg);
+  edugrid_filesystem::writeContent_str(cfg.log_name,
+                                       String(EDUGRID_LOGGING_FILE_HEADER) + "\n");
   Serial.print("| OK | Logging  ");
   Serial.println(getLogState_str());
   Serial.print("| OK | Logging start time: ");
@@ -73,7 +122,7 @@ void edugrid_logging::deactivateLogging()
   Serial.println(millis());
 
   /* Testing */
-  // Serial.println(edugrid_filesystem::getContent_str(edugrid_filesystem::config_log_name));
+  // Serial.println(edugrid_filesystem::getContent_str(edugrid_config::get().log_name));
 }
 
 void edugrid_logging::toggleLogging()
@@ -88,28 +137,49 @@ void edugrid_logging::toggleLogging()
   }
 }
 
-void edugrid_logging::appendLog(float vin, float vout, float iin, float iout)
+size_t edugrid_logging::formatRow(char* out, size_t len, const LogRow_t& row)
+{
+  // Tracking efficiency: empty fields until the first IV sweep
+  char teff[12] = "", teff_cum[12] = "";
+  if (!isnan(row.teff))     snprintf(teff, sizeof(teff), "%.4f", row.teff);
+  if (!isnan(row.teff_cum)) snprintf(teff_cum, sizeof(teff_cum), "%.4f", row.teff_cum);
+
+  const int n = snprintf(out, len, "%lu%s%.3f%s%.3f%s%.3f%s%.3f%s%s%s%s\n",
+                         (unsigned long)row.idx,
+                         EDUGRID_LOGGING_CSV_DELIMITER, row.vin,
+                         EDUGRID_LOGGING_CSV_DELIMITER, row.vout,
+                         EDUGRID_LOGGING_CSV_DELIMITER, row.iin,
+                         EDUGRID_LOGGING_CSV_DELIMITER, row.iout,
+                         EDUGRID_LOGGING_CSV_DELIMITER, teff,
+                         EDUGRID_LOGGING_CSV_DELIMITER, teff_cum);
+  if (n < 0) return 0;
+  return ((size_t)n < len) ? (size_t)n : len - 1;
+}
+
+void edugrid_logging::appendLog(float vin, float vout, float iin, float iout, float teff, float teff_cum)
 {
   /* Log only, if activated */
   if (getLogState() == EDUGRID_LOGGING_ACTIVE)
   {
-    log_message_counter += 1;
+    /* A full block whose flush failed gets one more attempt before new rows
+     * go in; if the file still cannot be opened, it makes room explicitly */
+    if (s_staging.count >= EDUGRID_LOGGING_MAX_MESSAGES_IN_BUFFER && !_flushBlock())
+    {
+      _dropBlock("file still not writable");
+    }
+
     all_messages += 1;
-    String line;
-    line.reserve(64);
-    line += all_messages;
-    line += EDUGRID_LOGGING_CSV_DELIMITER;
-    line += String(vin, 3);
-    line += EDUGRID_LOGGING_CSV_DELIMITER;
-    line += String(vout, 3);
-    line += EDUGRID_LOGGING_CSV_DELIMITER;
-    line += String(iin, 3);
-    line += EDUGRID_LOGGING_CSV_DELIMITER;
-    line += String(iout, 3);
-    line += '\n';
-
-    /* add new log line to buffer String */
-    log_message_buffer += line;
+    LogRow_t row;
+    row.idx  = all_messages;
+    row.vin  = vin;
+    row.vout = vout;
+    row.iin  = iin;
+    row.iout = iout;
+    row.teff     = teff;
+    row.teff_cum = teff_cum;
+
+    /* Rows stay binary until their block is flushed */
+    _stageRow(row);
 
     /* Check for logging timeout*/
     if ((millis() - log_start_time) >= EDUGRID_LOGGING_MAX_TIME_MS)
@@ -121,23 +191,238 @@ void edugrid_logging::appendLog(float vin, float vout, float iin, float iout)
   /* Limit in buffer reached --> write to flash
    * Only reached, if logging is ON
    */
-  if (log_message_counter >= EDUGRID_LOGGING_MAX_MESSAGES_IN_BUFFER)
+  if (s_staging.count >= EDUGRID_LOGGING_MAX_MESSAGES_IN_BUFFER && _flushBlock())
   {
-    edugrid_filesystem::writeContent_str(edugrid_filesystem::config_log_name, log_message_buffer, true);
-    log_message_buffer = "";
-    log_message_counter = 0;
-    Serial.println("| OK | Logging block safed to flash");
+    Serial.println("| OK | Logging block saved to flash");
   }
 
   if (safe_request)
   {
     safe_request = false;
     /* Always append last buffer iteration --> avoiding loss of logging data! */
-    edugrid_filesystem::writeContent_str(edugrid_filesystem::config_log_name, log_message_buffer, true);
+    if (!_flushBlock())
+    {
+      // The next session starts with an empty staging area
+      _dropBlock("session ended");
+    }
     /* Reset everything */
-    log_message_buffer = "";
-    log_message_counter = 0;
     all_messages = 0;
     Serial.println("| OK | Logging finished");
   }
-}
\ No newline at end of file
+}
+
+void edugrid_logging::_stageRow(const LogRow_t& row)
+{
+  if (s_staging.magic != EDUGRID_LOGGING_STAGING_MAGIC ||
+      s_staging.count >= EDUGRID_LOGGING_MAX_MESSAGES_IN_BUFFER)
+  {
+    _resetStaging(log_block_seq);
+  }
+  // Order matters for _validStagedRows(): row first, then CRC, then count.
+  const uint32_t n = s_staging.count;
+  s_staging.rows[n] = row;
+  s_staging.crc = esp_rom_crc32_le(s_staging.crc,
+                                   reinterpret_cast<const uint8_t*>(&s_staging.rows[n]),
+                                   sizeof(LogRow_t));
+  s_staging.count = n + 1;
+}
+
+/** Write the staged rows as one framed block (single open/close)
+ * @return true if the block is on flash (or there was nothing to write);
+ *         false leaves the rows staged if the file did not open, and drops
+ *         them if the write itself failed
+ */
+bool edugrid_logging::_flushBlock()
+{
+  const uint32_t count = s_staging.count;
+  if (count == 0) return true;
+
+  EdugridConfig_t cfg;
+  edugrid_config::snapshot(cfg);
+  File file = LittleFS.open(cfg.log_name, FILE_APPEND);
+  if (!file)
+  {
+    // Keep the rows staged; the caller retries or drops them.
+    Serial.println("|FAIL| Failed to open file for appending");
+    return false;
+  }
+
+  char line[EDUGRID_LOGGING_MAX_LINE_LEN];
+  uint32_t crc = 0;
+  bool ok = true;
+  for (uint32_t i = 0; i < count && ok; ++i)
+  {
+    const size_t n = formatRow(line, sizeof(line), s_staging.rows[i]);
+    crc = esp_rom_crc32_le(crc, reinterpret_cast<const uint8_t*>(line), n);
+    ok = (file.write(reinterpret_cast<const uint8_t*>(line), n) == n);
+  }
+  if (ok)
+  {
+    const int n = snprintf(line, sizeof(line), "%s%lu;%lu;%08lx\n",
+                           EDUGRID_LOGGING_TRAILER_TAG,
+                           (unsigned long)s_staging.seq,
+                           (unsigned long)count,
+                           (unsigned long)crc);
+    ok = (n > 0) && (file.write(reinterpret_cast<const uint8_t*>(line), (size_t)n) == (size_t)n);
+  }
+  file.close();
+
+  if (!ok)
+  {
+    // Whatever made it to flash has no valid trailer and is cut off by the
+    // next recoverLogFile(); the rows are dropped here to keep logging going.
+    _dropBlock("write failed");
+    return false;
+  }
+  log_block_seq = s_staging.seq + 1;
+  _resetStaging(log_block_seq);
+  return true;
+}
+
+/** Give up on the staged rows and start the next block
+ * @param why Reason for the log line
+ */
+void edugrid_logging::_dropBlock(const char* why)
+{
+  const uint32_t count = s_staging.count;
+  if (count == 0) return;
+  dropped_rows += count;
+  Serial.printf("|FAIL| Logging block %lu dropped (%s): %lu rows, %lu since boot\n",
+                (unsigned long)s_staging.seq, why, (unsigned long)count, (unsigned long)dropped_rows);
+  log_block_seq = s_staging.seq + 1;
+  _resetStaging(log_block_seq);
+}
+
+/** Scan the framed log file and restore a consistent state
+ *
+ * Walks the file line by line, keeping a running CRC of the row bytes since
+ * the last trailer.  The file is cut after the last trailer that matches in
+ * row count and CRC; everything behind it is a torn or corrupt block.
+ */
+void edugrid_logging::recoverLogFile()
+{
+  EdugridConfig_t cfg;
+  edugrid_config::snapshot(cfg);
+  const char* path = cfg.log_name;
+  const uint32_t staged = _validStagedRows();
+  const uint32_t staged_seq = s_staging.seq;
+
+  if (edugrid_filesystem::get_filesystem_state() != STATE_FILESYSTEM_OK) return;
+
+  size_t file_size = 0;
+  size_t valid_end = 0;
+  bool framed = false;
+  uint32_t next_seq = 0;
+
+  if (LittleFS.exists(path))
+  {
+    File file = LittleFS.open(path, FILE_READ);
+    if (file)
+    {
+      file_size = file.size();
+
+      char line[EDUGRID_LOGGING_MAX_LINE_LEN];
+      size_t len = 0;
+      size_t offset = 0;
+      bool first_line = true;
+      bool stop = false;
+      uint32_t crc = 0;
+      uint32_t rows = 0;
+      uint8_t chunk[128];
+
+      while (!stop && file.available())
+      {
+        const size_t got = file.read(chunk, sizeof(chunk));
+        if (got == 0) break;
+        for (size_t k = 0; k < got && !stop; ++k)
+        {
+          const char c = (char)chunk[k];
+          ++offset;
+          if (c != '\n')
+          {
+            if (len < sizeof(line) - 1) { line[len++] = c; }
+            else                        { stop = true; }   // not a line we wrote
+            continue;
+          }
+          line[len] = '\0';
+
+          if (first_line)
+          {
+            first_line = false;
+            framed = (strcmp(line, EDUGRID_LOGGING_FILE_HEADER) == 0);
+            if (!framed) { stop = true; break; }      // legacy file: hands off
+            valid_end = offset;
+          }
+          else if (strncmp(line, EDUGRID_LOGGING_TRAILER_TAG, strlen(EDUGRID_LOGGING_TRAILER_TAG)) == 0)
+          {
+            unsigned long seq = 0, n = 0, stored_crc = 0;
+            const bool parsed = (sscanf(line + strlen(EDUGRID_LOGGING_TRAILER_TAG),
+                                        "%lu;%lu;%lx", &seq, &n, &stored_crc) == 3);
+            if (!parsed || n != rows || stored_crc != crc) { stop = true; break; }
+            valid_end = offset;
+            next_seq = (uint32_t)seq + 1;
+            crc = 0;
+            rows = 0;
+          }
+          else
+          {
+            line[len] = '\n';   // the CRC covers the newline as written
+            crc = esp_rom_crc32_le(crc, reinterpret_cast<const uint8_t*>(line), len + 1);
+            ++rows;
+          }
+          len = 0;
+        }
+      }
+      file.close();
+    }
+  }
+
+  if (framed && valid_end < file_size)
+  {
+    Serial.printf("|WARN| Log tail corrupt, truncating %u -> %u bytes\n",
+                  (unsigned)file_size, (unsigned)valid_end);
+    edugrid_filesystem::truncateFile(path, valid_end);
+  }
+  else if (!framed && file_size > 0)
+  {
+    // Written before the framed format: keep it beside the live log and
+    // start a framed file, or every new block would land in a file whose
+    // tail can never be checked.
+    char old_path[EDUGRID_CONFIG_PATH_LEN + sizeof(EDUGRID_LOGGING_LEGACY_SUFFIX)];
+    snprintf(old_path, sizeof(old_path), "%s%s", path, EDUGRID_LOGGING_LEGACY_SUFFIX);
+    if (LittleFS.exists(old_path)) LittleFS.remove(old_path);
+    if (LittleFS.rename(path, old_path))
+    {
+      Serial.printf("|WARN| Unframed log moved to %s\n", old_path);
+      edugrid_filesystem::writeContent_str(path, String(EDUGRID_LOGGING_FILE_HEADER) + "\n");
+    }
+    else
+    {
+      Serial.println("|FAIL| Unframed log could not be moved");
+    }
+  }
+
+  log_block_seq = next_seq;
+
+  if (staged > 0)
+  {
+    // Rows that never reached flash before a soft reset: write them as one
+    // more block so the session ends with everything that was measured.
+    Serial.printf("| OK | Logging recovered %lu staged rows (block %lu)\n",
+                  (unsigned long)staged, (unsigned long)staged_seq);
+    if (!LittleFS.exists(path))
+    {
+      edugrid_filesystem::writeContent_str(path, String(EDUGRID_LOGGING_FILE_HEADER) + "\n");
+    }
+    s_staging.count = staged;
+    s_staging.seq = (log_block_seq > staged_seq) ? log_block_seq : staged_seq;
+    if (!_flushBlock())
+    {
+      _dropBlock("recovery");
+    }
+  }
+  else
+  {
+    _resetStaging(log_block_seq);
+  }
+}
@@ -0,0 +1,303 @@
+/************************************************************************
+ * @file   edugrid_meas_channel.cpp
+ * @date   2026/10/18
+ * @brief  INA228-based measurements of one converter channel
+ ***********************************************************************/
+
+#include "edugrid_meas_channel.h"
+#include "edugrid_measurement.h"
+#include "edugrid_trace.h"
+#include <math.h>
+
+// update() and poll() of all channels hand the readings over under this
+static portMUX_TYPE s_polledMux = portMUX_INITIALIZER_UNLOCKED;
+
+edugrid_meas_channel::edugrid_meas_channel(void)
+  : _index(0), _pv_addr(INA_PV_ADDR), _load_addr(INA_LOAD_ADDR),
+    _avg(INA_AVG_SAMPLES), _conv_us(INA_CONV_US),
+    _ok_pv(false), _ok_load(false),
+    _i_in_off(0.0f), _i_out_off(0.0f), _vin_raw_last(0.0f),
+    _polled(), _taken_ms(0), _stats(),
+    _v_in(0.0f), _i_in(0.0f), _p_in(0.0f),
+    _v_out(0.0f), _i_out(0.0f), _p_out(0.0f),
+    _eff(0.0f)
+{
+}
+
+void edugrid_meas_channel::begin(uint8_t index, uint8_t pv_addr, uint8_t load_addr) {
+  _index     = index;
+  _pv_addr   = pv_addr;
+  _load_addr = load_addr;
+
+  _ok_pv   = _ina_pv.begin(_pv_addr);
+  _ok_load = _ina_load.begin(_load_addr);
+
+  // Log the detected addresses so a new developer immediately sees which
+  // sensors responded during boot.
+  Serial.printf("[INA] CH%u PV   @ 0x%02X\n", (unsigned)_index, (unsigned)_pv_addr);
+  Serial.printf("[INA] CH%u LOAD @ 0x%02X\n", (unsigned)_index, (unsigned)_load_addr);
+  if (!_ok_pv || !_ok_load) {
+    Serial.printf("[INA] CH%u WARNING: device(s) not found (check I2C and addresses)\n",
+                  (unsigned)_index);
+  }
+}
+
+void edugrid_meas_channel::configure(uint16_t avg_samples, uint16_t conv_us) {
+  edugrid_i2c_lock bus;
+  _avg     = avg_samples;
+  _conv_us = conv_us;
+  if (_ok_pv)   { edugrid_measurement::configureInaDevice(_ina_pv,   avg_samples, conv_us); }
+  if (_ok_load) { edugrid_measurement::configureInaDevice(_ina_load, avg_samples, conv_us); }
+  edugrid_i2c::wake();
+}
+
+void edugrid_meas_channel::calibrateZeroOffsets(size_t samples) {
+  // Allow calibration even if only one sensor is present; we simply skip the
+  // missing device instead of aborting everything.
+  if ((!_ok_pv && !_ok_load) || samples == 0) return;
+
+  float iin = 0.0f, iout = 0.0f;
+  for (size_t i = 0; i < samples; ++i) {
+    // Convert mA to A once to keep the rest of the code consistent with the
+    // cached values that are all stored in amperes.
+    {
+      edugrid_i2c_lock bus;   // per sample: the polled reads go on meanwhile
+      if (_ok_pv)   { iin  += _ina_pv.getCurrent_mA()   / 1000.0f; }
+      if (_ok_load) { iout += _ina_load.getCurrent_mA() / 1000.0f; }
+    }
+    delay(2);
+  }
+  if (_ok_pv)   { _i_in_off  = iin  / samples; edugrid_trace::recordFloat(TRACE_EV_CALIBRATION, 0, _i_in_off,  _index); }
+  if (_ok_load) { _i_out_off = iout / samples; edugrid_trace::recordFloat(TRACE_EV_CALIBRATION, 1, _i_out_off, _index); }
+
+  Serial.printf("[CAL] CH%u current offsets: Iin=%0.4f A, Iout=%0.4f A\n",
+                (unsigned)_index, _i_in_off, _i_out_off);
+}
+
+void edugrid_meas_channel::update(void) {
+  if (edugrid_i2c::running()) {
+    _takePolled();
+  } else {
+    _readINA();
+  }
+
+  // No reverse readings in this topology; clamp negatives to zero
+  if (_v_in  < 0.0f) _v_in  = 0.0f;
+  if (_v_out < 0.0f) _v_out = 0.0f;
+  if (_i_in  < 0.0f) _i_in  = 0.0f;
+  if (_i_out < 0.0f) _i_out = 0.0f;
+
+  const bool pv_present = (_vin_raw_last >= PV_PRESENT_V);
+
+  // Compute powers from filtered V/I
+  _p_in  = _v_in  * _i_in;
+  _p_out = _v_out * _i_out;
+
+  if (!pv_present) {
+    // Keep V/I visible; only zero power & efficiency when PV absent
+    _p_in = _p_out = 0.0f;
+    _eff  = 0.0f;
+    return;
+  }
+
+  if (_p_in > 1e-3f) {
+    _eff = _p_out / _p_in;
+    if (_eff < 0.0f)  _eff = 0.0f;
+    if (_eff > 1.05f) _eff = 1.05f;  // small guard above 100% due to sensor noise
+  } else {
+    _eff = 0.0f;
+  }
+}
+
+bool edugrid_meas_channel::poll(void) {
+  float vin = 0.0f, iin = 0.0f, vout = 0.0f, iout = 0.0f;
+  const bool pv   = _ok_pv   && _pollDevice(_pv_addr,   _stats[0], vin,  iin);
+  const bool load = _ok_load && _pollDevice(_load_addr, _stats[1], vout, iout);
+  if (!pv && !load) return false;
+
+  // A device that failed keeps its last good pair; its counters tell.  The
+  // noise moves at least one result of every new conversion.
+  portENTER_CRITICAL(&s_polledMux);
+  const bool fresh = (pv   && (vin  != _polled.v_in  || iin  != _polled.i_in)) ||
+                     (load && (vout != _polled.v_out || iout != _polled.i_out));
+  if (pv)   { _polled.v_in  = vin;  _polled.i_in  = iin;  }
+  if (load) { _polled.v_out = vout; _polled.i_out = iout; }
+  _polled.ms = millis();
+  ++_polled.seq;
+  portEXIT_CRITICAL(&s_polledMux);
+  return fresh;
+}
+
+uint32_t edugrid_meas_channel::sampleAgeMs(void) const {
+  return edugrid_i2c::running() ? (uint32_t)(millis() - _taken_ms) : 0;
+}
+
+bool edugrid_meas_channel::armAlerts(float i_in_max, float v_in_max, float i_out_max, float v_out_max) {
+  edugrid_i2c_lock bus;
+  const bool pv   = _ok_pv   && _armDevice(_pv_addr,   i_in_max,  v_in_max);
+  const bool load = _ok_load && _armDevice(_load_addr, i_out_max, v_out_max);
+  takeAlertCause();   // drop flags latched before the limits were set
+  return pv && load;
+}
+
+uint8_t edugrid_meas_channel::takeAlertCause(void) {
+  edugrid_i2c_lock bus;
+  uint8_t  cause = 0;
+  uint16_t diag  = 0;
+  if (_ok_pv && _readReg(_pv_addr, INA_REG_DIAG_ALRT, diag)) {
+    if (diag & INA_DIAG_SHNTOL) cause |= INA_ALERT_I_IN;
+    if (diag & INA_DIAG_BUSOL)  cause |= INA_ALERT_V_IN;
+  }
+  if (_ok_load && _readReg(_load_addr, INA_REG_DIAG_ALRT, diag)) {
+    if (diag & INA_DIAG_SHNTOL) cause |= INA_ALERT_I_OUT;
+    if (diag & INA_DIAG_BUSOL)  cause |= INA_ALERT_V_OUT;
+  }
+  return cause;
+}
+
+bool edugrid_meas_channel::samplePV(float& v, float& i) {
+  if (!_ok_pv) { v = 0.0f; i = 0.0f; return false; }
+  edugrid_i2c_lock bus;
+  v = _ina_pv.getBusVoltage_V();
+  i = _ina_pv.getCurrent_mA() / 1000.0f - _i_in_off;
+  return true;
+}
+
+bool edugrid_meas_channel::sampleLoad(float& v, float& i) {
+  if (!_ok_load) { v = 0.0f; i = 0.0f; return false; }
+  edugrid_i2c_lock bus;
+  v = _ina_load.getBusVoltage_V();
+  i = _ina_load.getCurrent_mA() / 1000.0f - _i_out_off;
+  return true;
+}
+
+bool edugrid_meas_channel::readAccumulators(bool load, InaAccumulators_t& acc) {
+  if (load ? !_ok_load : !_ok_pv) return false;
+  const uint8_t addr = load ? _load_addr : _pv_addr;
+  edugrid_i2c_lock bus;
+  uint64_t energy = 0, charge = 0;
+  if (!_readReg40(addr, INA_REG_ENERGY, energy) || !_readReg40(addr, INA_REG_CHARGE, charge)) return false;
+  acc.energy = energy;
+  // Sign-extend the 40 bit two's complement
+  acc.charge = (int64_t)(charge << (64 - INA_ACC_BITS)) >> (64 - INA_ACC_BITS);
+  return true;
+}
+
+bool edugrid_meas_channel::resetAccumulators(bool load) {
+  if (load ? !_ok_load : !_ok_pv) return false;
+  const uint8_t addr = load ? _load_addr : _pv_addr;
+  // Keep CONVDLY / ADCRANGE as the driver set them
+  edugrid_i2c_lock bus;
+  uint16_t config = 0;
+  return _readReg(addr, INA_REG_CONFIG, config)
+      && _writeReg(addr, INA_REG_CONFIG, (uint16_t)(config | INA_CONFIG_RSTACC));
+}
+
+void edugrid_meas_channel::_readINA(void) {
+  // RAW readings (no offsets yet)
+  const float vin_raw  = _ok_pv   ? _ina_pv.getBusVoltage_V()           : 0.0f;
+  const float iin_raw  = _ok_pv   ? _ina_pv.getCurrent_mA() / 1000.0f   : 0.0f;
+  const float vout_raw = _ok_load ? _ina_load.getBusVoltage_V()         : 0.0f;
+  const float iout_raw = _ok_load ? _ina_load.getCurrent_mA() / 1000.0f : 0.0f;
+  _apply(vin_raw, iin_raw, vout_raw, iout_raw);
+}
+
+void edugrid_meas_channel::_takePolled(void) {
+  portENTER_CRITICAL(&s_polledMux);
+  const Polled_t p = _polled;
+  portEXIT_CRITICAL(&s_polledMux);
+  _taken_ms = p.ms;
+  _apply(p.v_in, p.i_in, p.v_out, p.i_out);
+}
+
+void edugrid_meas_channel::_apply(float vin_raw, float iin_raw, float vout_raw, float iout_raw) {
+  // Save raw PV bus for presence detection
+  _vin_raw_last = vin_raw;
+
+  // Apply offsets to currents
+  float vin  = vin_raw;
+  float iin  = iin_raw  - _i_in_off;
+  float vout = vout_raw;
+  float iout = iout_raw - _i_out_off;
+
+  // Deadband around zero
+  if (fabsf(vin)  < ZERO_V_CLAMP)  vin  = 0.0f;
+  if (fabsf(vout) < ZERO_V_CLAMP)  vout = 0.0f;
+  if (fabsf(iin)  < ZERO_I_CLAMP)  iin  = 0.0f;
+  if (fabsf(iout) < ZERO_I_CLAMP)  iout = 0.0f;
+
+  _v_in  = vin;
+  _i_in  = iin;
+  _v_out = vout;
+  _i_out = iout;
+}
+
+bool edugrid_meas_channel::_armDevice(uint8_t addr, float i_max, float v_max) {
+  // Limits are signed 16 bit (SOVL) and 15 bit (BOVL); 0x7FFF never trips
+  const float sovl = (i_max > 0.0f) ? i_max * INA_SHUNT_OHMS / INA_SOVL_LSB_V : 32767.0f;
+  const float bovl = (v_max > 0.0f) ? v_max / INA_BOVL_LSB_V : 32767.0f;
+  return _writeReg(addr, INA_REG_SOVL, (uint16_t)((sovl < 32767.0f) ? sovl : 32767.0f))
+      && _writeReg(addr, INA_REG_BOVL, (uint16_t)((bovl < 32767.0f) ? bovl : 32767.0f))
+      // ALERT active low, on every conversion (SLOWALERT 0), latched
+      && _writeReg(addr, INA_REG_DIAG_ALRT, INA_DIAG_ALATCH);
+}
+
+bool edugrid_meas_channel::_writeReg(uint8_t addr, uint8_t reg, uint16_t value) {
+  Wire.beginTransmission(addr);
+  Wire.write(reg);
+  Wire.write((uint8_t)(value >> 8));     // registers are big endian
+  Wire.write((uint8_t)(value & 0xFF));
+  return Wire.endTransmission() == 0;
+}
+
+bool edugrid_meas_channel::_readReg(uint8_t addr, uint8_t reg, uint16_t& value) {
+  Wire.beginTransmission(addr);
+  Wire.write(reg);
+  if (Wire.endTransmission(false) != 0) return false;
+  if (Wire.requestFrom(addr, (uint8_t)2) != 2) return false;
+  value  = (uint16_t)(Wire.read() << 8);
+  value |= (uint16_t)Wire.read();
+  return true;
+}
+
+bool edugrid_meas_channel::_pollDevice(uint8_t addr, I2cDeviceStats_t& st, float& v, float& i) {
+  const uint32_t t0 = micros();
+  uint32_t vbus = 0, current = 0;
+  const bool ok = _readReg24(addr, INA_REG_VBUS, vbus) && _readReg24(addr, INA_REG_CURRENT, current);
+  const uint32_t us = micros() - t0;
+  ++st.reads;
+  if (!ok) {
+    ++st.errors;
+    if (us >= (uint32_t)I2C_TIMEOUT_MS * 1000UL) ++st.timeouts;
+    if (st.consecutive < UINT16_MAX) ++st.consecutive;
+    return false;
+  }
+  st.consecutive = 0;
+  st.last_ok_ms  = millis();
+  if (us > st.us_max) st.us_max = (uint16_t)((us < UINT16_MAX) ? us : UINT16_MAX);
+
+  // The same scaling as the driver's getters: 20 bit results in bits 23..4
+  v = (float)(vbus >> 4) * INA_VBUS_LSB_V;
+  i = (float)((int32_t)(current << 8) >> 12) * INA_CURRENT_LSB_A;
+  return true;
+}
+
+bool edugrid_meas_channel::_readReg24(uint8_t addr, uint8_t reg, uint32_t& value) {
+  Wire.beginTransmission(addr);
+  Wire.write(reg);
+  if (Wire.endTransmission(false) != 0) return false;
+  if (Wire.requestFrom(addr, (uint8_t)3) != 3) return false;
+  value = 0;
+  for (uint8_t k = 0; k < 3; ++k) value = (value << 8) | (uint8_t)Wire.read();
+  return true;
+}
+
+bool edugrid_meas_channel::_readReg40(uint8_t addr, uint8_t reg, uint64_t& value) {
+  Wire.beginTransmission(addr);
+  Wire.write(reg);
+  if (Wire.endTransmission(false) != 0) return false;
+  if (Wire.requestFrom(addr, (uint8_t)5) != 5) return false;
+  value = 0;
+  for (uint8_t k = 0; k < 5; ++k) value = (value << 8) | (uint8_t)Wire.read();
+  return true;
+}
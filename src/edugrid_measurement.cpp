@@ -6,162 +6,183 @@
 
 #include "edugrid_measurement.h"
 #include <math.h>
-#include "edugrid_mpp_algorithm.h" 
+#include "edugrid_channel.h"
+#include "edugrid_i2c.h"
 
 /* ===== Static storage ===== */
-// The INA drivers are held as static objects so the measurement class can be
-// used without instantiation.  All modules access the public static members.
-Adafruit_INA228 edugrid_measurement::_ina_pv;
-Adafruit_INA228 edugrid_measurement::_ina_load;
-
-bool  edugrid_measurement::_ok_pv   = false;
-bool  edugrid_measurement::_ok_load = false;
-
-float edugrid_measurement::V_in  = 0.0f;
-float edugrid_measurement::I_in  = 0.0f;
-float edugrid_measurement::P_in  = 0.0f;
-float edugrid_measurement::V_out = 0.0f;
-float edugrid_measurement::I_out = 0.0f;
-float edugrid_measurement::P_out = 0.0f;
-float edugrid_measurement::eff   = 0.0f;
-
-/* ===== Private helpers / state ===== */
-// Global offset corrections and last raw PV voltage; only this file needs them
-// so they remain at translation-unit scope.
-static float _I_in_off  = 0.0f;      // current offset (PV)
-static float _I_out_off = 0.0f;      // current offset (LOAD)
-static float _vin_raw_last = 0.0f;   // raw PV bus (before smoothing), for presence detect
-
-
-static void _configureInaDevice(Adafruit_INA228& ina) {
+#define ACQ_DEFAULT_PROFILES { \
+  { INA_SWEEP_AVG_SAMPLES,   INA_SWEEP_CONV_US   },   /* ACQ_PROFILE_SWEEP */   \
+  { INA_AVG_SAMPLES,         INA_CONV_US         },   /* ACQ_PROFILE_TRACK */   \
+  { INA_DISPLAY_AVG_SAMPLES, INA_DISPLAY_CONV_US },   /* ACQ_PROFILE_DISPLAY */ \
+}
+volatile bool edugrid_measurement::_acq_pending   = false;
+AcqSetting_t  edugrid_measurement::_profiles[ACQ_PROFILE_COUNT]     = ACQ_DEFAULT_PROFILES;
+AcqSetting_t  edugrid_measurement::_req_profiles[ACQ_PROFILE_COUNT] = ACQ_DEFAULT_PROFILES;
+uint16_t      edugrid_measurement::_acq_settle_ms = INA_EXTRA_SETTLE_MS;
+uint16_t      edugrid_measurement::_req_settle_ms = INA_EXTRA_SETTLE_MS;
+
+// The web task requests, the control task takes the request over and
+// channels of any task read the live profiles: all copies go under this.
+static portMUX_TYPE s_acqMux = portMUX_INITIALIZER_UNLOCKED;
+
+/* Supported INA228 settings (datasheet AVG and VBUSCT/VSHCT tables) */
+static const uint16_t kAvgCounts[] = { 1, 4, 16, 64, 128, 256, 512, 1024 };
+static const INA228_AveragingCount kAvgEnums[] = {
+  INA228_COUNT_1, INA228_COUNT_4, INA228_COUNT_16, INA228_COUNT_64,
+  INA228_COUNT_128, INA228_COUNT_256, INA228_COUNT_512, INA228_COUNT_1024 };
+static const uint16_t kConvTimesUs[] = { 50, 84, 150, 280, 540, 1052, 2074, 4120 };
+static const INA228_ConversionTime kConvEnums[] = {
+  INA228_TIME_50_us, INA228_TIME_84_us, INA228_TIME_150_us, INA228_TIME_280_us,
+  INA228_TIME_540_us, INA228_TIME_1052_us, INA228_TIME_2074_us, INA228_TIME_4120_us };
+
+static int _indexOf(const uint16_t* table, size_t n, uint16_t value) {
+  for (size_t i = 0; i < n; ++i) {
+    if (table[i] == value) return (int)i;
+  }
+  return -1;
+}
+
+void edugrid_measurement::configureInaDevice(Adafruit_INA228& ina, uint16_t avg, uint16_t conv_us) {
   // The order matches the recommendations from the Adafruit driver: configure
   // the sense resistor value, choose averaging/conversion time, then enable the
   // continuous measurement mode so the chip keeps producing results in the
-  // background.
+  // background.  Values are validated by the caller.
+  const int a = _indexOf(kAvgCounts,   sizeof(kAvgCounts)   / sizeof(kAvgCounts[0]),   avg);
+  const int c = _indexOf(kConvTimesUs, sizeof(kConvTimesUs) / sizeof(kConvTimesUs[0]), conv_us);
   ina.setShunt(INA_SHUNT_OHMS, INA_MAX_CURRENT_A);
-  ina.setAveragingCount(INA228_COUNT_128);          // AVG = 128 samples
-  ina.setVoltageConversionTime(INA228_TIME_1052_us);
-  ina.setCurrentConversionTime(INA228_TIME_1052_us);
-  ina.setMode(INA228_MODE_CONT_BUS_SHUNT);          // voltage + current only
-}
-
-
-static void _calibrateZeroOffsets(size_t samples,
-                                  Adafruit_INA228* ina_pv,   bool ok_pv,
-                                  Adafruit_INA228* ina_load, bool ok_load) {
-  // Allow calibration even if only one sensor is present; we simply skip the
-  // missing channel instead of aborting everything.
-  if (!ok_pv && !ok_load) return;
-
-  float iin=0.0f, iout=0.0f;
-  for (size_t i=0; i<samples; ++i) {
-    // Convert mA to A once to keep the rest of the code consistent with the
-    // public variables that are all stored in amperes.
-    if (ok_pv)   { iin  += ina_pv->getCurrent_mA()  / 1000.0f; }
-    if (ok_load) { iout += ina_load->getCurrent_mA() / 1000.0f; }
-    delay(2);
-  }
-  if (ok_pv)   { _I_in_off  = iin  / samples; }
-  if (ok_load) { _I_out_off = iout / samples; }
-
-  Serial.printf("[CAL] Current offsets: Iin=%0.4f A, Iout=%0.4f A\n",
-                _I_in_off, _I_out_off);
+  ina.setAveragingCount(kAvgEnums[a >= 0 ? a : 4]);          // default AVG = 128 samples
+  ina.setVoltageConversionTime(kConvEnums[c >= 0 ? c : 5]);  // default 1052 us
+  ina.setCurrentConversionTime(kConvEnums[c >= 0 ? c : 5]);
+  ina.setMode(INA228_MODE_CONT_BUS_SHUNT);                   // voltage + current only
 }
 
 /* ===== Public API ===== */
 void edugrid_measurement::init(void) {
-  // If your PCB uses non-default I2C pins, call Wire.begin(SDA,SCL) earlier.
-  Wire.begin();
-  Wire.setClock(400000);
-
-  _ok_pv   = _ina_pv.begin(INA_PV_ADDR);
-  _ok_load = _ina_load.begin(INA_LOAD_ADDR);
-
-  // Log the detected addresses so a new developer immediately sees which
-  // sensors responded during boot.
-  Serial.print("[INA] PV   @ 0x"); Serial.println(INA_PV_ADDR,   HEX);
-  Serial.print("[INA] LOAD @ 0x"); Serial.println(INA_LOAD_ADDR, HEX);
-  if (!_ok_pv || !_ok_load) {
-    Serial.println("[INA] WARNING: device(s) not found (check I2C and addresses)");
-  }
+  // All converter channels share this bus (PIN_I2C_SDA / PIN_I2C_SCL);
+  // the INA pairs differ by address.
+  edugrid_i2c::begin();
 
-  if (_ok_pv)   { _configureInaDevice(_ina_pv); }
-  if (_ok_load) { _configureInaDevice(_ina_load); }
+  for (uint8_t ch = 0; ch < edugrid_channel::count(); ++ch) {
+    const ChannelConfig_t& cfg = edugrid_channel::config(ch);
+    edugrid_channel::at(ch).meas.begin(ch, cfg.ina_pv_addr, cfg.ina_load_addr);
+  }
 
-  /* After both INAs are configured, tell the MPPT code the shared step period */
-  // Align the MPPT cadence with the INA averaging window so each iteration uses
-  // fresh samples.
-  edugrid_mpp_algorithm::set_step_period_ms(INA_STEP_PERIOD_MS);
-  Serial.printf("[INA] Step period = %lu ms (AVG %lu, conv %lu us, settle %lu ms)\n",
-                (unsigned long)INA_STEP_PERIOD_MS,
-                (unsigned long)INA_AVG_SAMPLES,
-                (unsigned long)INA_CONV_US,
-                (unsigned long)INA_EXTRA_SETTLE_MS);
+  // Configure all INAs with the profile of their mode (compiled defaults,
+  // or whatever edugrid_config::apply() requested before init()).
+  _applyAcquisition();
 
   // One-time zero-offset capture (do this with PV/LOAD near 0 A for best accuracy)
-  _calibrateZeroOffsets(300, &_ina_pv, _ok_pv, &_ina_load, _ok_load);
+  calibrateZeroOffsets(300);
 }
 
-void edugrid_measurement::calibrateZeroOffsets(size_t samples) {
-  _calibrateZeroOffsets(samples, &_ina_pv, _ok_pv, &_ina_load, _ok_load);
+void edugrid_measurement::calibrateZeroOffsets(size_t samples, uint8_t channel) {
+  for (uint8_t ch = 0; ch < edugrid_channel::count(); ++ch) {
+    if (channel == EDUGRID_ALL_CHANNELS || channel == ch) {
+      edugrid_channel::at(ch).meas.calibrateZeroOffsets(samples);
+    }
+  }
 }
 
-void edugrid_measurement::getSensors(void) {
-  // Always read from hardware INA228
-  _readINA();
-
-  // No reverse readings in this topology; clamp negatives to zero
-  if (V_in  < 0.0f) V_in  = 0.0f;
-  if (V_out < 0.0f) V_out = 0.0f;
-  if (I_in  < 0.0f) I_in  = 0.0f;
-  if (I_out < 0.0f) I_out = 0.0f;
+void edugrid_measurement::serviceAcquisition(void) {
+  // Pick up a new averaging/conversion setting requested from another task.
+  if (_acq_pending) {
+    _applyAcquisition();
+  }
+}
 
-  const bool pv_present = (_vin_raw_last >= PV_PRESENT_V);
+void edugrid_measurement::requestAcquisition(uint16_t avg_samples, uint16_t conv_us, uint16_t settle_ms) {
+  if (!isValidAveraging(avg_samples) || !isValidConversionTime(conv_us)) return;
+  portENTER_CRITICAL(&s_acqMux);
+  _req_profiles[ACQ_PROFILE_TRACK] = { avg_samples, conv_us };
+  _req_settle_ms = settle_ms;
+  _acq_pending   = true;
+  portEXIT_CRITICAL(&s_acqMux);
+}
 
-  // Compute powers from filtered V/I
-  P_in  = V_in  * I_in;
-  P_out = V_out * I_out;
+void edugrid_measurement::requestProfile(AcqProfile_t profile, uint16_t avg_samples, uint16_t conv_us) {
+  if (profile >= ACQ_PROFILE_COUNT) return;
+  if (!isValidAveraging(avg_samples) || !isValidConversionTime(conv_us)) return;
+  portENTER_CRITICAL(&s_acqMux);
+  _req_profiles[profile] = { avg_samples, conv_us };
+  _acq_pending = true;
+  portEXIT_CRITICAL(&s_acqMux);
+}
 
-  if (!pv_present) {
-    // Keep V/I visible; only zero power & efficiency when PV absent
-    P_in = P_out = 0.0f;
-    eff  = 0.0f;
-    return;
+AcqProfile_t edugrid_measurement::profileFor(OperatingModes_t mode, bool vref, bool limited) {
+  switch (mode) {
+    case IV_SWEEP: return ACQ_PROFILE_SWEEP;
+    case AUTO:     return (vref || limited) ? ACQ_PROFILE_SWEEP : ACQ_PROFILE_TRACK;
+    default:       return ACQ_PROFILE_DISPLAY;
   }
+}
+
+AcqSetting_t edugrid_measurement::profileSetting(AcqProfile_t profile) {
+  portENTER_CRITICAL(&s_acqMux);
+  const AcqSetting_t s = _profiles[(profile < ACQ_PROFILE_COUNT) ? profile : ACQ_PROFILE_TRACK];
+  portEXIT_CRITICAL(&s_acqMux);
+  return s;
+}
 
-  if (P_in > 1e-3f) {
-    eff = P_out / P_in;
-    if (eff < 0.0f)  eff = 0.0f;
-    if (eff > 1.05f) eff = 1.05f;  // small guard above 100% due to sensor noise
-  } else {
-    eff = 0.0f;
+const char* edugrid_measurement::profileName(AcqProfile_t profile) {
+  switch (profile) {
+    case ACQ_PROFILE_SWEEP:   return "sweep";
+    case ACQ_PROFILE_TRACK:   return "track";
+    case ACQ_PROFILE_DISPLAY: return "display";
+    default:                  return "none";
   }
 }
 
-void edugrid_measurement::_readINA(void) {
-  // RAW readings (no offsets yet)
-  const float vin_raw  = _ok_pv   ? _ina_pv.getBusVoltage_V()           : 0.0f;
-  const float iin_raw  = _ok_pv   ? _ina_pv.getCurrent_mA() / 1000.0f   : 0.0f;
-  const float vout_raw = _ok_load ? _ina_load.getBusVoltage_V()         : 0.0f;
-  const float iout_raw = _ok_load ? _ina_load.getCurrent_mA() / 1000.0f : 0.0f;
+uint32_t edugrid_measurement::windowMsFor(uint16_t avg_samples, uint16_t conv_us) {
+  // Round conversion window up to the next millisecond so we never sample early
+  return (uint32_t)(((2ULL * conv_us * avg_samples) + 999ULL) / 1000ULL);
+}
 
-  // Save raw PV bus for presence detection
-  _vin_raw_last = vin_raw;
+uint32_t edugrid_measurement::stepPeriodFor(uint16_t avg_samples, uint16_t conv_us, uint16_t settle_ms) {
+  // A polled reading may be up to I2C_SAMPLE_AGE_MS old when the tracker
+  // takes it; waiting that much longer keeps it from the settled window.
+  return windowMsFor(avg_samples, conv_us) + settle_ms + I2C_SAMPLE_AGE_MS;
+}
 
-  // Apply offsets to currents
-  float vin  = vin_raw;
-  float iin  = iin_raw  - _I_in_off;
-  float vout = vout_raw;
-  float iout = iout_raw - _I_out_off;
+bool edugrid_measurement::isValidAveraging(uint16_t avg_samples) {
+  return _indexOf(kAvgCounts, sizeof(kAvgCounts) / sizeof(kAvgCounts[0]), avg_samples) >= 0;
+}
 
-  // Deadband around zero
-  if (fabsf(vin)  < ZERO_V_CLAMP)  vin  = 0.0f;
-  if (fabsf(vout) < ZERO_V_CLAMP)  vout = 0.0f;
-  if (fabsf(iin)  < ZERO_I_CLAMP)  iin  = 0.0f;
-  if (fabsf(iout) < ZERO_I_CLAMP)  iout = 0.0f;
+bool edugrid_measurement::isValidConversionTime(uint16_t conv_us) {
+  return _indexOf(kConvTimesUs, sizeof(kConvTimesUs) / sizeof(kConvTimesUs[0]), conv_us) >= 0;
+}
+
+void edugrid_measurement::_applyAcquisition(void) {
+  // Take the whole request over at once, never half of a web-task write
+  portENTER_CRITICAL(&s_acqMux);
+  for (uint8_t p = 0; p < ACQ_PROFILE_COUNT; ++p) {
+    _profiles[p] = _req_profiles[p];
+  }
+  _acq_settle_ms = _req_settle_ms;
+  _acq_pending   = false;
+  portEXIT_CRITICAL(&s_acqMux);
+
+  // Every channel reprograms its INAs for the profile of its mode and
+  // aligns its step period with that window, so each iteration uses fresh
+  // samples.
+  for (uint8_t ch = 0; ch < edugrid_channel::count(); ++ch) {
+    edugrid_channel::at(ch).applyAcquisition();
+  }
 
-  V_in  = vin;
-  I_in  = iin;
-  V_out = vout;
-  I_out = iout;
+  for (uint8_t p = 0; p < ACQ_PROFILE_COUNT; ++p) {
+    const AcqSetting_t s = profileSetting((AcqProfile_t)p);
+    Serial.printf("[INA] Profile %-7s AVG %4u, conv %4u us -> window %lu ms, step period %lu ms (settle %u ms)\n",
+                  profileName((AcqProfile_t)p), (unsigned)s.avg_samples, (unsigned)s.conv_us,
+                  (unsigned long)windowMsFor(s.avg_samples, s.conv_us),
+                  (unsigned long)stepPeriodFor(s.avg_samples, s.conv_us, _acq_settle_ms),
+                  (unsigned)_acq_settle_ms);
+  }
 }
+
+/* ===== Channel 0 getters ===== */
+float edugrid_measurement::getVoltagePV(void)   { return edugrid_channel::at(0).meas.getVoltagePV();   }
+float edugrid_measurement::getCurrentPV(void)   { return edugrid_channel::at(0).meas.getCurrentPV();   }
+float edugrid_measurement::getPowerPV(void)     { return edugrid_channel::at(0).meas.getPowerPV();     }
+float edugrid_measurement::getVoltageLoad(void) { return edugrid_channel::at(0).meas.getVoltageLoad(); }
+float edugrid_measurement::getCurrentLoad(void) { return edugrid_channel::at(0).meas.getCurrentLoad(); }
+float edugrid_measurement::getPowerLoad(void)   { return edugrid_channel::at(0).meas.getPowerLoad();   }
+float edugrid_measurement::getEfficiency(void)  { return edugrid_channel::at(0).meas.getEfficiency();  }
@@ -0,0 +1,941 @@
+/*************************************************************************
+ * @file   edugrid_mpp_tracker.cpp
+ * @date   2026/10/18
+ ************************************************************************/
+
+#include <edugrid_mpp_tracker.h>
+#include <edugrid_trace.h>
+#include <math.h>
+
+edugrid_mpp_tracker::edugrid_mpp_tracker(edugrid_meas_channel& meas, edugrid_pwm_channel& pwm)
+  : _meas(meas),
+    _pwm(pwm),
+    _index(0),
+    _lastObj(0.0f),
+    _dir(+1),
+    _step_pct(MPPT_DUTY_STEP_PCT),
+    _power_eps_w(MPP_POWER_EPS_W),
+    _drift_enabled(MPPT_DRIFT != 0),
+    _drift_mid(false),
+    _drift_px(0.0f),
+    _drift_w(0.0f),
+    _drift_steps(0),
+    _drift_due(false),
+    _pout_w(MPPT_POUT_WEIGHT),
+    _pout_var(0.0f),
+    _pout_pt{ -1, -1 },
+    _pout_eff{},
+    _freeze_enabled(MPPT_FREEZE != 0),
+    _frozen(false),
+    _freeze_ref_pending(false),
+    _hist_duty{},
+    _hist_p{},
+    _hist_n(0),
+    _hist_pos(0),
+    _hist_rev(0),
+    _hist_sign(0),
+    _freeze_p_ref(0.0f),
+    _freeze_v_ref(0.0f),
+    _freeze_gain_w(0.0f),
+    _freeze_start_ms(0),
+    _frozen_ms(0),
+    _freeze_gain_j(0.0f),
+    _freeze_count(0),
+    _vref_enabled(MPPT_VREF != 0),
+    _vref_kp(MPPT_VREF_KP),
+    _vref_ki(MPPT_VREF_KI),
+    _vref_step_v(MPPT_VREF_STEP_V),
+    _vref_v(0.0f),
+    _vref_i(0.0f),
+    _vref_sat(0),
+    _vref_pi_ms(0),
+    _vref_p_sum(0.0f),
+    _vref_obj_sum(0.0f),
+    _vref_pout_sum(0.0f),
+    _vref_p_n(0),
+    // The MPPT and IV sweep share one cadence that aligns with the INA228
+    // averaging window.  `_last_mppt_update_ms` stores the last time we
+    // applied a duty change so both modes respect the same timing budget.
+    _mppt_update_period_ms(kDefaultStepPeriodMs),
+    _last_mppt_update_ms(0),
+    _iv_phase(IVPhase::Idle),
+    _iv_count(0),
+    _iv_up(0),
+    _iv_last_ms(0),
+    _iv_start_ms(0),
+    _iv_finalize_applied(false),
+    _iv_budget(IV_SWEEP_BUDGET),
+    _iv_bidir(IV_SWEEP_BIDIR != 0),
+    _iv_sweep_bidir(false),
+    _iv_sweep_budget(IV_SWEEP_BUDGET),
+    _iv_bg_interval_s(IV_BG_INTERVAL_S),
+    _iv_bg_points(IV_BG_POINTS),
+    _iv_bg_requested(false),
+    _iv_bg_active(false),
+    _iv_bg_last(false),
+    _iv_bg_due_ms(0),
+    _iv_bg_saved_duty(0),
+    _iv_bg_saved_dir(+1),
+    _iv_bg_saved_obj(0.0f),
+    _iv_bg_saved_vref(0.0f),
+    _iv_bg_count(0),
+    _iv_bg_time_ms(0),
+    _iv_bg_loss_j(0.0f),
+    _auto_energy_j(0.0f),
+    _iv_duration_ms(0),
+    _iv_harvest_j(0.0f),
+    _iv_loss_j(0.0f),
+    _iv_hysteresis(0.0f),
+    _iv_pts{},
+    _mode_state(MANUALLY)
+{
+}
+
+void edugrid_mpp_tracker::set_step_size_pct(uint8_t pct) {
+  _step_pct = (pct > 0) ? pct : 1;
+}
+
+void edugrid_mpp_tracker::set_power_eps_w(float eps_w) {
+  _power_eps_w = (eps_w > 0.0f) ? eps_w : 0.0f;
+}
+
+void edugrid_mpp_tracker::set_freeze_enabled(bool enabled) {
+  if (enabled == _freeze_enabled) return;
+  _freeze_enabled = enabled;
+  _freeze_reset();
+}
+
+void edugrid_mpp_tracker::set_drift_enabled(bool enabled) {
+  if (enabled == _drift_enabled) return;
+  _drift_enabled = enabled;
+  _freeze_reset();
+}
+
+uint32_t edugrid_mpp_tracker::frozen_time_ms(void) const {
+  return _frozen_ms + (_frozen ? (millis() - _freeze_start_ms) : 0);
+}
+
+void edugrid_mpp_tracker::set_vref_enabled(bool enabled) {
+  if (enabled == _vref_enabled) return;
+  _vref_enabled = enabled;
+  // Switching the control structure inside AUTO starts from where the
+  // converter is: reference = present V_in, integrator = present duty
+  _freeze_reset();
+  _dir     = +1;
+  _lastObj = objective_w();
+  _vref_reset(_pwm.getPWMFine() / (float)PWM_FINE_PER_PCT);
+}
+
+void edugrid_mpp_tracker::set_vref_gains(float kp, float ki) {
+  _vref_kp = (kp > 0.0f) ? kp : 0.0f;
+  _vref_ki = (ki > 0.0f) ? ki : 0.0f;
+}
+
+void edugrid_mpp_tracker::set_vref_step_v(float step_v) {
+  _vref_step_v = (step_v > 0.0f) ? step_v : MPPT_VREF_STEP_V;
+}
+
+void edugrid_mpp_tracker::set_pout_weight(float w) {
+  if (!(w > 0.0f)) w = 0.0f;
+  if (w > 1.0f)    w = 1.0f;
+  if (w == _pout_w) return;
+  _pout_w = w;
+  // A hold and the last comparison were made on the old objective
+  _freeze_reset();
+  _lastObj    = objective_w();
+  _pout_pt[0] = _pout_pt[1] = -1;
+}
+
+float edugrid_mpp_tracker::objective_w(void) const {
+  const float p_in = _meas.getPowerPV();
+  if (_pout_w <= 0.0f || !_meas.sensorLoadOk()) return p_in;
+  return (1.0f - _pout_w) * p_in + _pout_w * _meas.getPowerLoad();
+}
+
+void edugrid_mpp_tracker::service(void)
+{
+  switch (_mode_state)
+  {
+    case MANUALLY:
+      // In Manual mode, the UI sets the PWM directly. Nothing to do here.
+      break;
+
+    case AUTO:
+      // A due background sweep takes over from the tracker; it starts on a
+      // step boundary so the restored P&O state matches a fresh reading.
+      if (_iv_bg_due(millis())) {
+        _iv_bg_start();
+        break;
+      }
+      if (_vref_enabled) {
+        _vref_track(millis());
+        break;
+      }
+      // find_mpp() has its own internal timer and only acts when the INA
+      // averaging window has passed.
+      find_mpp();
+      break;
+
+    case IV_SWEEP:
+      // Advance the IV sweep state machine one step; it manages its own timing.
+      iv_sweep_step();
+      break;
+
+    default:
+      break;
+  }
+}
+
+/* ===== Mode ===== */
+void edugrid_mpp_tracker::set_mode_state(OperatingModes_t mode)
+{
+  edugrid_trace::record(TRACE_EV_MODE, (uint8_t)mode, (uint16_t)_mode_state, 0, _index);
+  // Any other mode ends a background sweep without returning to AUTO
+  if (mode != IV_SWEEP) _iv_bg_active = false;
+  // A hold only survives as long as P&O itself
+  _freeze_reset();
+  _mode_state = mode;
+  // Reset P&O direction and last power when entering AUTO
+  if (mode == AUTO) {
+    // The first background sweep comes one interval after tracking starts
+    _iv_bg_due_ms = millis() + (uint32_t)_iv_bg_interval_s * 1000UL;
+    // Jumping into AUTO should not inherit stale slope information from a
+    // previous run; reset the internal state so the next iteration starts
+    // cleanly.
+    _dir = +1;
+    _lastObj = objective_w();
+    _vref_reset(_pwm.getPWMFine() / (float)PWM_FINE_PER_PCT);
+  }
+}
+
+void edugrid_mpp_tracker::toggle_mode_state(void)
+{
+  OperatingModes_t next = (OperatingModes_t)((int)_mode_state + 1);
+  if (next >= AUTO + 1) next = MANUALLY;
+  set_mode_state(next);
+}
+
+/* ===== P&O ===== */
+int edugrid_mpp_tracker::find_mpp(void)
+{
+  const uint32_t now = millis();
+  if ((now - _last_mppt_update_ms) < _mppt_update_period_ms) {
+    // Too early -> wait for the next INA228 averaged sample.
+    return 0; // wait until INA average+settle window has passed
+  }
+  const uint32_t dt_ms = now - _last_mppt_update_ms;
+  _last_mppt_update_ms = now;
+
+  const float Pin = _meas.getPowerPV();
+  // Harvest while tracking, the reference for the background sweep cost;
+  // a gap (other mode, calibration) is not counted
+  if (dt_ms <= 2 * _mppt_update_period_ms) _auto_energy_j += Pin * (float)dt_ms / 1000.0f;
+
+  // Everything below compares the objective, P_in unless P_out is weighted
+  const float obj = objective_w();
+  _pout_noise((int16_t)_pwm.getPWM(), _meas.getPowerLoad(), Pin);
+
+  // dP-P&O: a probe reads the step twice at the same duty.  The first
+  // reading (P_x) has the perturbation and one period of drift in it, the
+  // second only the drift: dP = (P_x - P_k) - (P_k+1 - P_x).  Steps in
+  // between subtract the drift of the last probe.
+  if (_drift_enabled && !_drift_mid && !_frozen && _drift_due) {
+    _drift_mid = true;
+    _drift_px  = obj;
+    return 0;
+  }
+
+  // Steady state: hold the duty instead of dithering around the MPP.  A
+  // resumed hold continues below as a normal step from the held duty.
+  if (_frozen && _freeze_hold(now, dt_ms, obj, _meas.getVoltagePV())) return 0;
+  if (_freeze_enabled && _freeze_detect(obj)) return 0;
+  float dP = obj - _lastObj;
+  if (_drift_mid) {
+    _drift_mid   = false;
+    _drift_w     = obj - _drift_px;
+    _drift_steps = 0;
+    _drift_due   = false;
+    dP = (_drift_px - _lastObj) - _drift_w;
+  } else if (_drift_enabled) {
+    if (_drift_steps < 255) ++_drift_steps;
+    if (fabsf(_drift_w) >= _obj_eps_w()) dP -= _drift_w;
+    _drift_due = (_drift_steps >= MPPT_DRIFT_PROBE_STEPS) &&
+                 (fabsf(dP) < MPPT_DRIFT_PROBE_K * (fabsf(_drift_w) + _obj_eps_w()));
+  }
+  _lastObj = obj;
+
+  // Fixed step (default ±1%), reverse direction when power drops (classic P&O)
+  if (fabsf(dP) < _obj_eps_w()) {
+    // tiny change: keep going same way, unless the duty is pinned at the
+    // border in that direction (a wide P_out dead band never flips there)
+    const uint8_t duty = _pwm.getPWM();
+    if (_pout_w > 0.0f && ((_dir >= 0 && duty >= _pwm.getPwmUpperLimit()) ||
+                           (_dir <  0 && duty <= _pwm.getPwmLowerLimit()))) {
+      _dir = -_dir;
+    }
+  } else if (dP < 0.0f) {
+    _dir = -_dir; // power decreased ⇒ flip direction
+  }
+
+  _pwm.pwmIncrementDecrement((_dir >= 0) ? +(int)_step_pct : -(int)_step_pct, PWM_SRC_MPPT);
+  return 0;
+}
+
+
+/* ===== Objective ===== */
+void edugrid_mpp_tracker::_pout_noise(int16_t point, float p_out, float p_in)
+{
+  if (_pout_w <= 0.0f || !_meas.sensorLoadOk()) return;
+  if (p_in < MPPT_POUT_NOISE_MIN_W) {
+    _pout_pt[0] = _pout_pt[1] = -1;
+    return;
+  }
+
+  // Pair with the last step at the same operating point: P&O around the
+  // MPP revisits one every second step, a hold every step.  The pair
+  // compares P_out / P_in, which a ramp of the irradiance hardly moves at
+  // one duty, so what is left is the load-side noise: half the squared
+  // difference (back in watts) estimates its variance.  A pair across a
+  // step change is clipped; a dead band inflated by it would swallow the
+  // following steps and let P&O run into a border.
+  const float eff = p_out / p_in;
+  for (uint8_t k = 0; k < 2; ++k) {
+    if (_pout_pt[k] != point) continue;
+    const float sigma = sqrtf(_pout_var);
+    const float clip  = MPPT_POUT_NOISE_CLIP * ((sigma > _power_eps_w) ? sigma : _power_eps_w);
+    float d = fabsf(eff - _pout_eff[k]) * p_in;
+    if (d > clip) d = clip;
+    _pout_var += MPPT_POUT_NOISE_ALPHA * (0.5f * d * d - _pout_var);
+    break;
+  }
+  _pout_pt[1]  = _pout_pt[0];
+  _pout_eff[1] = _pout_eff[0];
+  _pout_pt[0]  = point;
+  _pout_eff[0] = eff;
+}
+
+float edugrid_mpp_tracker::_obj_eps_w(void) const
+{
+  if (_pout_w <= 0.0f || !_meas.sensorLoadOk()) return _power_eps_w;
+  const float band = MPPT_POUT_NOISE_K * _pout_w * sqrtf(_pout_var);
+  return (band > _power_eps_w) ? band : _power_eps_w;
+}
+
+
+/* ===== Steady-state hold ===== */
+static uint32_t _toMilli(float w)
+{
+  return (w > 0.0f) ? (uint32_t)(w * 1000.0f) : 0;
+}
+
+void edugrid_mpp_tracker::_freeze_reset(void)
+{
+  if (_frozen) {
+    _frozen_ms += millis() - _freeze_start_ms;
+    _frozen = false;
+  }
+  _freeze_ref_pending = false;
+  _drift_mid = false;     // a probe never spans a hold or a restart ...
+  _drift_w   = 0.0f;      // ... and its drift is stale after one
+  _hist_n    = 0;
+  _hist_pos  = 0;
+  _hist_rev  = 0;
+  _hist_sign = 0;
+}
+
+bool edugrid_mpp_tracker::_freeze_detect(float obj)
+{
+  static constexpr uint8_t kMask = MPPT_FREEZE_HISTORY - 1;
+
+  // Reading of the dwell that just ended, at the duty it was taken at; the
+  // direction changes are counted on the way so most steps stop early
+  const uint8_t duty = _pwm.getPWM();
+  uint8_t rev = 0;
+  if (_hist_n > 0) {
+    const uint8_t prev = _hist_duty[(_hist_pos - 1) & kMask];
+    const int8_t  sign = (duty > prev) ? +1 : (duty < prev) ? -1 : 0;
+    if (sign != 0) {
+      rev = (_hist_sign != 0 && sign != _hist_sign) ? 1 : 0;
+      _hist_sign = sign;
+    }
+  }
+  _hist_rev = (uint16_t)((_hist_rev << 1) | rev);
+  _hist_duty[_hist_pos] = duty;
+  _hist_p[_hist_pos]    = obj;
+  _hist_pos = (_hist_pos + 1) & kMask;
+  if (_hist_n < MPPT_FREEZE_HISTORY) ++_hist_n;
+  if (_hist_n < MPPT_FREEZE_HISTORY) return false;
+  // (the window holds kMask steps between its readings)
+  if (__builtin_popcount(_hist_rev & ((1u << kMask) - 1u)) < MPPT_FREEZE_REVERSALS) return false;
+
+  // Limit cycle: the direction keeps turning within a few steps
+  uint8_t d_min = 255, d_max = 0;
+  float   p_sum = 0.0f;
+  for (uint8_t k = 0; k < MPPT_FREEZE_HISTORY; ++k) {
+    if (_hist_duty[k] < d_min) d_min = _hist_duty[k];
+    if (_hist_duty[k] > d_max) d_max = _hist_duty[k];
+    p_sum += _hist_p[k];
+  }
+  if ((d_max - d_min) > MPPT_FREEZE_SPAN_STEPS * _step_pct) return false;
+
+  // Stationary: every revisit of a duty reads the same power, otherwise
+  // P&O is following a ramp.  Hold at the duty whose readings averaged
+  // highest; what the dither would have cost is the gap between that and
+  // the cycle mean.
+  const float p_mean  = p_sum / MPPT_FREEZE_HISTORY;
+  const float dp_max  = p_mean * (MPPT_FREEZE_DP_PCT / 100.0f);
+  const float eps_w   = _obj_eps_w();
+  const float p_noise = (dp_max > eps_w) ? dp_max : eps_w;
+  uint8_t best_duty = _pwm.getPWM();
+  float   best_p    = -1.0f;
+  for (uint8_t k = 0; k < MPPT_FREEZE_HISTORY; ++k) {
+    float   sum = 0.0f, p_lo = _hist_p[k], p_hi = _hist_p[k];
+    uint8_t n = 0;
+    for (uint8_t j = 0; j < MPPT_FREEZE_HISTORY; ++j) {
+      if (_hist_duty[j] != _hist_duty[k]) continue;
+      sum += _hist_p[j];
+      ++n;
+      if (_hist_p[j] < p_lo) p_lo = _hist_p[j];
+      if (_hist_p[j] > p_hi) p_hi = _hist_p[j];
+    }
+    if ((p_hi - p_lo) > p_noise) return false;
+    if (sum / n > best_p) { best_p = sum / n; best_duty = _hist_duty[k]; }
+  }
+  const float gain_w = best_p - p_mean;
+  _freeze_gain_w = (gain_w > 0.0f) ? gain_w : 0.0f;
+
+  _frozen             = true;
+  _freeze_ref_pending = true;
+  _freeze_start_ms    = millis();
+  ++_freeze_count;
+  const uint16_t hold = _pwm.getDither() ? _freeze_vertex(best_duty, best_p)
+                                         : (uint16_t)(best_duty * PWM_FINE_PER_PCT);
+  if (hold != _pwm.getPWMFine()) _pwm.setPWMFine(hold, PWM_SRC_MPPT);
+  edugrid_trace::record(TRACE_EV_MPPT_FREEZE, MPPT_FREEZE_HOLD, best_duty,
+                        _toMilli(best_p), _index);
+  return true;
+}
+
+uint16_t edugrid_mpp_tracker::_freeze_vertex(uint8_t duty, float p) const
+{
+  // Off the P&O grid: vertex of the parabola through the cycle means at
+  // the best duty and both neighbours.  It lies within half a step of the
+  // best duty; without both neighbours (or not concave) it is the duty.
+  const uint16_t grid = (uint16_t)(duty * PWM_FINE_PER_PCT);
+  float   sum[2] = { 0.0f, 0.0f };
+  uint8_t n[2]   = { 0, 0 };
+  for (uint8_t k = 0; k < MPPT_FREEZE_HISTORY; ++k) {
+    if      (_hist_duty[k] + _step_pct == duty) { sum[0] += _hist_p[k]; ++n[0]; }
+    else if (_hist_duty[k] == duty + _step_pct) { sum[1] += _hist_p[k]; ++n[1]; }
+  }
+  if (n[0] == 0 || n[1] == 0) return grid;
+  const float p_lo  = sum[0] / n[0];
+  const float p_hi  = sum[1] / n[1];
+  const float curve = p_lo - 2.0f * p + p_hi;
+  if (!(curve < 0.0f)) return grid;
+  const float x = 0.5f * (p_lo - p_hi) / curve * _step_pct * PWM_FINE_PER_PCT;
+  return (uint16_t)((int32_t)grid + lroundf(x));
+}
+
+bool edugrid_mpp_tracker::_freeze_hold(uint32_t now, uint32_t dt_ms, float obj, float Vin)
+{
+  // The thresholds refer to the first reading taken at the held duty
+  if (_freeze_ref_pending) {
+    _freeze_ref_pending = false;
+    _freeze_p_ref = obj;
+    _freeze_v_ref = Vin;
+    return true;
+  }
+  if (dt_ms <= 2 * _mppt_update_period_ms) _freeze_gain_j += _freeze_gain_w * (float)dt_ms / 1000.0f;
+
+  const float dp_max = _freeze_p_ref * (MPPT_FREEZE_DP_PCT / 100.0f);
+  const float eps_w  = _obj_eps_w();
+  MpptFreezeEvent_t why;
+  if (fabsf(obj - _freeze_p_ref) > ((dp_max > eps_w) ? dp_max : eps_w)) {
+    why = MPPT_FREEZE_RESUME_DP;
+  } else if (fabsf(Vin - _freeze_v_ref) > _freeze_v_ref * (MPPT_FREEZE_DV_PCT / 100.0f)) {
+    why = MPPT_FREEZE_RESUME_DV;
+  } else if ((now - _freeze_start_ms) >= (uint32_t)MPPT_FREEZE_MAX_S * 1000UL) {
+    why = MPPT_FREEZE_RESUME_TIME;
+  } else {
+    return true;
+  }
+
+  edugrid_trace::record(TRACE_EV_MPPT_FREEZE, why, _pwm.getPWM(), _toMilli(obj), _index);
+  _freeze_reset();
+  // V_mpp hardly moves with irradiance, so head back towards the voltage of
+  // the hold: a higher duty loads the panel more and lowers V_in
+  _dir     = (Vin > _freeze_v_ref) ? +1 : -1;
+  _lastObj = obj;
+  return false;
+}
+
+
+/* ===== Voltage-reference cascade ===== */
+uint32_t edugrid_mpp_tracker::_auto_period_ms(void) const
+{
+  if (!_vref_enabled) return _mppt_update_period_ms;
+  return (_mppt_update_period_ms > MPPT_VREF_OUTER_MS) ? _mppt_update_period_ms : MPPT_VREF_OUTER_MS;
+}
+
+void edugrid_mpp_tracker::_vref_reset(float duty)
+{
+  _vref_v     = _meas.getVoltagePV();
+  _vref_i     = duty;
+  _vref_sat   = 0;
+  _vref_pi_ms = millis();
+  _vref_p_sum    = 0.0f;
+  _vref_obj_sum  = 0.0f;
+  _vref_pout_sum = 0.0f;
+  _vref_p_n      = 0;
+}
+
+void edugrid_mpp_tracker::_vref_track(uint32_t now)
+{
+  const float    Vin    = _meas.getVoltagePV();
+  const float    Pin    = _meas.getPowerPV();
+  const uint32_t period = _auto_period_ms();
+  const uint32_t dt_ms  = now - _last_mppt_update_ms;
+
+  // The inner loop needs a few passes to follow a new reference; P&O
+  // compares the mean of the second half of each step
+  if (dt_ms >= period / 2) {
+    _vref_p_sum    += Pin;
+    _vref_obj_sum  += objective_w();
+    _vref_pout_sum += _meas.getPowerLoad();
+    ++_vref_p_n;
+  }
+  if (dt_ms >= period) {
+    const float p   = _vref_p_sum / _vref_p_n;
+    const float obj = _vref_obj_sum / _vref_p_n;
+    // Steps of the reference are the operating points the noise pairs on
+    _pout_noise((int16_t)lroundf(_vref_v / _vref_step_v), _vref_pout_sum / _vref_p_n, p);
+    _last_mppt_update_ms = now;
+    _vref_p_sum    = 0.0f;
+    _vref_obj_sum  = 0.0f;
+    _vref_pout_sum = 0.0f;
+    _vref_p_n      = 0;
+    if (dt_ms <= 2 * period) _auto_energy_j += p * (float)dt_ms / 1000.0f;
+
+    const float dP = obj - _lastObj;
+    _lastObj = obj;
+    if (_vref_sat != 0) {
+      // Reference out of reach at a duty border: continue from the voltage
+      // there, back into the range (lower border = highest V_in)
+      _vref_v = Vin;
+      _dir    = (_vref_sat < 0) ? -1 : +1;
+    } else if (fabsf(dP) >= _obj_eps_w() && dP < 0.0f) {
+      _dir = -_dir;
+    }
+    _vref_v += (_dir >= 0) ? _vref_step_v : -_vref_step_v;
+    if (_vref_v < 0.0f) _vref_v = 0.0f;
+  }
+
+  _vref_pi(now, Vin);
+}
+
+void edugrid_mpp_tracker::_vref_pi(uint32_t now, float Vin)
+{
+  // After a pause (calibration, other mode) integrate one pass, not the gap
+  float dt_s = (float)(now - _vref_pi_ms) / 1000.0f;
+  if ((now - _vref_pi_ms) > 2 * TASK_CONTROL_INTERVAL_MS) dt_s = TASK_CONTROL_INTERVAL_MS / 1000.0f;
+  _vref_pi_ms = now;
+
+  // V_in above the reference -> more duty loads the panel harder
+  float e = Vin - _vref_v;
+  if (fabsf(e) < MPPT_VREF_DEADBAND_V) e = 0.0f;
+
+  // Anti-windup: no integration further into a border (conditional
+  // integration), and the integrator itself never leaves the duty window
+  const float lo = (float)_pwm.getPwmLowerLimit();
+  const float hi = _pwm.getPwmUpperLimitFine() / (float)PWM_FINE_PER_PCT;   // a CC/CV ceiling is fine duty
+  const float i_next = _vref_i + _vref_ki * e * dt_s;
+  const float u_next = _vref_kp * e + i_next;
+  if (!((u_next > hi && e > 0.0f) || (u_next < lo && e < 0.0f))) _vref_i = i_next;
+  if (_vref_i < lo) _vref_i = lo;
+  if (_vref_i > hi) _vref_i = hi;
+
+  float u = _vref_kp * e + _vref_i;
+  _vref_sat = 0;
+  if (u >= hi) { u = hi; if (e > 0.0f) _vref_sat = +1; }
+  if (u <= lo) { u = lo; if (e < 0.0f) _vref_sat = -1; }
+
+  // Whole percent settles on the nearer step; with dithering the loop
+  // holds the reference between two of them.  Saturated, the duty sits at
+  // the upper limit itself, which a CC/CV ceiling sets in fine duty
+  const uint16_t fine = (_vref_sat > 0)   ? _pwm.getPwmUpperLimitFine()
+                      : _pwm.getDither() ? (uint16_t)(u * PWM_FINE_PER_PCT + 0.5f)
+                      :                    (uint16_t)((uint8_t)(u + 0.5f) * PWM_FINE_PER_PCT);
+  if (fine != _pwm.getPWMFine()) _pwm.setPWMFine(fine, PWM_SRC_VREF_PI);
+}
+
+
+/* ========================= IV SWEEP ========================= */
+
+/** Distance of b from the chord a-c in the I-V plane scaled to Voc/Isc */
+static float _chordDev(const IvPoint_t& a, const IvPoint_t& b, const IvPoint_t& c, float v_s, float i_s)
+{
+  const float dx = (c.v - a.v) / v_s;
+  const float dy = (c.i - a.i) / i_s;
+  const float len = sqrtf(dx * dx + dy * dy);
+  if (len < 1e-6f) return 0.0f;
+  return fabsf(dx * (b.i - a.i) / i_s - dy * (b.v - a.v) / v_s) / len;
+}
+
+void edugrid_mpp_tracker::set_iv_sweep_points(uint8_t points)
+{
+  if (points < IV_SWEEP_COARSE_POINTS) points = IV_SWEEP_COARSE_POINTS;
+  if (points > IV_SWEEP_POINTS)        points = IV_SWEEP_POINTS;
+  _iv_budget = points;
+}
+
+void edugrid_mpp_tracker::set_iv_bg_interval_s(uint16_t interval_s)
+{
+  // Only a new interval re-arms (from now, so shortening it does not fire
+  // at once); writing the same one again keeps the running countdown
+  if (interval_s == _iv_bg_interval_s) return;
+  _iv_bg_interval_s = interval_s;
+  _iv_bg_due_ms     = millis() + (uint32_t)interval_s * 1000UL;
+}
+
+void edugrid_mpp_tracker::set_iv_bg_points(uint8_t points)
+{
+  if (points < IV_SWEEP_COARSE_POINTS) points = IV_SWEEP_COARSE_POINTS;
+  if (points > IV_SWEEP_POINTS)        points = IV_SWEEP_POINTS;
+  _iv_bg_points = points;
+}
+
+uint32_t edugrid_mpp_tracker::iv_bg_wait_ms(void) const
+{
+  const int32_t wait = (int32_t)(_iv_bg_due_ms - millis());
+  return (wait > 0) ? (uint32_t)wait : 0;
+}
+
+void edugrid_mpp_tracker::request_iv_sweep(void)
+{
+  request_iv_sweep(_iv_bidir);
+}
+
+void edugrid_mpp_tracker::request_iv_sweep(bool bidir)
+{
+  // A sweep is initiated from the web UI and ends in MANUAL, also when it
+  // interrupts a background sweep
+  _iv_bg_active = false;
+  _iv_bg_last   = false;
+  _iv_arm(bidir, _iv_budget);
+}
+
+void edugrid_mpp_tracker::_iv_arm(bool bidir, uint8_t budget)
+{
+  // We reset the state machine so that the next call to iv_sweep_step()
+  // starts from the minimum duty and builds a brand new curve.
+  _iv_finalize_applied = false;
+  _iv_sweep_bidir      = bidir;
+  _iv_sweep_budget     = budget;
+  set_mode_state(IV_SWEEP);
+  _iv_count       = 0;
+  _iv_up          = 0;
+  _iv_last_ms     = 0;
+  _iv_duration_ms = 0;
+  _iv_harvest_j   = 0.0f;
+  _iv_loss_j      = 0.0f;
+  _iv_hysteresis  = 0.0f;
+  _set_iv_phase(IVPhase::Arm);
+}
+
+
+void edugrid_mpp_tracker::iv_sweep_step(void)
+{
+  const uint32_t now = millis();
+  if ((now - _iv_last_ms) < _mppt_update_period_ms) {
+    return;  // wait until a fresh INA228 average is ready
+  }
+  _iv_last_ms = now;
+
+  // Every phase below first records the reading taken at the duty set on
+  // the previous step, then moves on.
+  switch (_iv_phase)
+  {
+    case IVPhase::Idle:
+      return;
+
+    case IVPhase::Arm:
+      // Jump to the sweep start duty and wait one full averaging window
+      _pwm.setPWM(IV_SWEEP_D_MIN_PCT, PWM_SRC_IV_SWEEP);
+      _iv_count    = 0;
+      _iv_up       = 0;
+      _iv_start_ms = now;
+      _set_iv_phase(IVPhase::Sample);
+      return;
+
+    case IVPhase::Sample:
+    {
+      // Coarse pass over the whole range
+      _iv_record(+1, now);
+      const uint8_t next = _pwm.getPWM() + IV_SWEEP_COARSE_PCT;
+      if (next > IV_SWEEP_D_MAX_PCT || _iv_count >= IV_SWEEP_POINTS) {
+        _iv_after_up();
+        return;
+      }
+      _pwm.setPWM(next, PWM_SRC_IV_SWEEP);
+      if (_pwm.getPWM() != next) {
+        _iv_after_up();   // a narrower configured PWM border ends the pass
+      }
+      return;
+    }
+
+    case IVPhase::Refine:
+      _iv_record(+1, now);
+      _iv_after_up();
+      return;
+
+    case IVPhase::Down:
+    {
+      _iv_record(-1, now);
+      const int next = (int)_pwm.getPWM() - IV_SWEEP_COARSE_PCT;
+      if (next < IV_SWEEP_D_MIN_PCT || _iv_count >= IV_SWEEP_POINTS) {
+        _iv_finish();
+        return;
+      }
+      _pwm.setPWM((uint8_t)next, PWM_SRC_IV_SWEEP);
+      return;
+    }
+
+    case IVPhase::Done:
+    default:
+      _iv_finish();
+      return;
+  }
+}
+
+void edugrid_mpp_tracker::_iv_record(int8_t dir, uint32_t now)
+{
+  if (_iv_count >= IV_SWEEP_POINTS) return;
+
+  IvPoint_t pt;
+  pt.v    = _meas.getVoltagePV();
+  pt.i    = _meas.getCurrentPV();
+  pt.t_ms = now - _iv_start_ms;
+  pt.duty = _pwm.getPWM();
+  pt.dir  = dir;
+
+  // The dwell that ends with this reading ran at this point's power
+  _iv_harvest_j  += pt.v * pt.i * (float)(pt.t_ms - _iv_duration_ms) / 1000.0f;
+  _iv_duration_ms = pt.t_ms;
+
+  // Up-pass points stay sorted by duty for the refinement; the down pass
+  // only starts once the up pass is complete and is appended behind it.
+  uint16_t pos = _iv_count;
+  if (dir > 0) {
+    pos = _iv_up;
+    while (pos > 0 && _iv_pts[pos - 1].duty > pt.duty) --pos;
+    memmove(&_iv_pts[pos + 1], &_iv_pts[pos], (size_t)(_iv_count - pos) * sizeof(IvPoint_t));
+    ++_iv_up;
+  }
+  _iv_pts[pos] = pt;
+  ++_iv_count;
+}
+
+int16_t edugrid_mpp_tracker::_iv_next_refine(void) const
+{
+  const uint16_t n = _iv_up;
+  if (n < 2) return -1;
+
+  float    v_s = 0.0f, i_s = 0.0f, p_max = -1.0f;
+  uint16_t k_mpp = 0;
+  for (uint16_t k = 0; k < n; ++k) {
+    const IvPoint_t& pt = _iv_pts[k];
+    if (pt.v > v_s) v_s = pt.v;
+    if (pt.i > i_s) i_s = pt.i;
+    if (pt.v * pt.i > p_max) { p_max = pt.v * pt.i; k_mpp = k; }
+  }
+  if (v_s < PV_PRESENT_V || i_s <= ZERO_I_CLAMP) return -1;   // no curve to refine
+
+  const auto width = [&](uint16_t k) { return (uint8_t)(_iv_pts[k + 1].duty - _iv_pts[k].duty); };
+  const auto mid   = [&](uint16_t k) {
+    return (int16_t)(_iv_pts[k].duty + (width(k) / (2 * IV_SWEEP_STEP_PCT)) * IV_SWEEP_STEP_PCT);
+  };
+
+  // 1) Pin the MPP down to the finest step: the wider of its two segments
+  int16_t  best_k = -1;
+  uint8_t  best_w = 2 * IV_SWEEP_STEP_PCT - 1;
+  for (int16_t k = (int16_t)k_mpp - 1; k <= (int16_t)k_mpp; ++k) {
+    if (k < 0 || k + 1 >= (int16_t)n) continue;
+    if (width(k) > best_w) { best_w = width(k); best_k = k; }
+  }
+  if (best_k >= 0) return mid(best_k);
+
+  // 2) Bisect where the curve bends most (the knee), while it bends more
+  //    than the tolerance and the segment can still be split
+  float dev_prev = 0.0f;   // deviation of point k
+  float best_dev = IV_SWEEP_LIN_TOL;
+  for (uint16_t k = 0; k + 1 < n; ++k) {
+    const float dev_next = (k + 2 < n) ? _chordDev(_iv_pts[k], _iv_pts[k + 1], _iv_pts[k + 2], v_s, i_s) : 0.0f;
+    const float dev      = (dev_prev > dev_next) ? dev_prev : dev_next;
+    if (width(k) >= 2 * IV_SWEEP_STEP_PCT && dev > best_dev) {
+      best_dev = dev;
+      best_k   = k;
+    }
+    dev_prev = dev_next;
+  }
+  return (best_k >= 0) ? mid(best_k) : -1;
+}
+
+void edugrid_mpp_tracker::_iv_after_up(void)
+{
+  // The down pass gets its coarse points from the budget first
+  const uint16_t down   = _iv_sweep_bidir ? (IV_SWEEP_COARSE_POINTS - 1) : 0;
+  const uint16_t budget = (_iv_sweep_budget > down + IV_SWEEP_COARSE_POINTS) ? (_iv_sweep_budget - down)
+                                                                       : IV_SWEEP_COARSE_POINTS;
+  if (_iv_up < budget && _iv_count < IV_SWEEP_POINTS) {
+    const int16_t duty = _iv_next_refine();
+    if (duty >= 0) {
+      _pwm.setPWM((uint8_t)duty, PWM_SRC_IV_SWEEP);
+      if (_iv_phase != IVPhase::Refine) _set_iv_phase(IVPhase::Refine);
+      return;
+    }
+  }
+
+  // Down pass on the coarse grid below the highest duty reached
+  if (_iv_sweep_bidir && _iv_up > 0 &&
+      _iv_pts[_iv_up - 1].duty >= IV_SWEEP_D_MIN_PCT + IV_SWEEP_COARSE_PCT) {
+    _pwm.setPWM(_iv_pts[_iv_up - 1].duty - IV_SWEEP_COARSE_PCT, PWM_SRC_IV_SWEEP);
+    _set_iv_phase(IVPhase::Down);
+    return;
+  }
+  _iv_finish();
+}
+
+void edugrid_mpp_tracker::_iv_finish(void)
+{
+  if (_iv_finalize_applied) return;
+  _iv_finalize_applied = true;
+
+  float p_max = 0.0f;
+  for (uint16_t k = 0; k < _iv_up; ++k) {
+    const float p = _iv_pts[k].v * _iv_pts[k].i;
+    if (p > p_max) p_max = p;
+  }
+  const float loss = p_max * (float)_iv_duration_ms / 1000.0f - _iv_harvest_j;
+  _iv_loss_j = (loss > 0.0f) ? loss : 0.0f;
+
+  // Down-pass points against the up-pass point at the same duty; a
+  // charged input capacitor makes a fast sweep read high going down
+  _iv_hysteresis = 0.0f;
+  for (uint16_t k = _iv_up; k < _iv_count && p_max > 0.0f; ++k) {
+    for (uint16_t u = 0; u < _iv_up; ++u) {
+      if (_iv_pts[u].duty != _iv_pts[k].duty) continue;
+      const float h = (_iv_pts[k].v * _iv_pts[k].i - _iv_pts[u].v * _iv_pts[u].i) / p_max;
+      if (fabsf(h) > fabsf(_iv_hysteresis)) _iv_hysteresis = h;
+      break;
+    }
+  }
+
+  if (_iv_phase != IVPhase::Done) _set_iv_phase(IVPhase::Done);
+  if (_iv_bg_active) {
+    _iv_bg_restore(p_max);
+    return;
+  }
+  _pwm.setPWM(PWM_MAX_DUTY_PCT, PWM_SRC_IV_SWEEP);
+  _pwm.requestManualTarget(PWM_MAX_DUTY_PCT);
+  set_mode_state(MANUALLY);
+}
+
+bool edugrid_mpp_tracker::_iv_bg_due(uint32_t now) const
+{
+  if (!_iv_bg_requested && (_iv_bg_interval_s == 0 || (int32_t)(now - _iv_bg_due_ms) < 0)) return false;
+  // Only on a step boundary and with a panel to characterise
+  return ((now - _last_mppt_update_ms) >= _auto_period_ms())
+         && _meas.sensorPvOk() && (_meas.getVoltagePV() >= PV_PRESENT_V);
+}
+
+void edugrid_mpp_tracker::_iv_bg_start(void)
+{
+  _iv_bg_requested  = false;
+  _iv_bg_saved_duty = _pwm.getPWMFine();
+  _iv_bg_saved_dir  = _dir;
+  _iv_bg_saved_obj  = _lastObj;
+  _iv_bg_saved_vref = _vref_v;
+  _iv_bg_last       = true;
+  // No down pass: hysteresis is a lab measurement, not worth the energy here
+  _iv_arm(false, _iv_bg_points);
+  _iv_bg_active     = true;
+}
+
+void edugrid_mpp_tracker::_iv_bg_restore(float p_max)
+{
+  const uint32_t now = millis();
+  _iv_bg_active = false;
+  ++_iv_bg_count;
+  _iv_bg_time_ms += _iv_duration_ms;
+  _iv_bg_loss_j  += _iv_loss_j;
+
+  // Next sweep after the interval, or later if this one was expensive:
+  // its loss amortised over the gap stays below IV_BG_MAX_COST_PCT of P_max
+  uint32_t gap_ms = (uint32_t)_iv_bg_interval_s * 1000UL;
+  if (p_max > 0.0f) {
+    const float cost_ms = _iv_loss_j / (p_max * (IV_BG_MAX_COST_PCT / 100.0f)) * 1000.0f;
+    if (cost_ms > (float)gap_ms) gap_ms = (cost_ms < 86400000.0f) ? (uint32_t)cost_ms : 86400000UL;
+  }
+
+  // Back to the tracked duty with the P&O state from before the sweep; the
+  // first comparison waits for a reading taken at that duty.
+  _pwm.setPWMFine(_iv_bg_saved_duty, PWM_SRC_IV_SWEEP);
+  set_mode_state(AUTO);
+  _iv_bg_due_ms        = now + gap_ms;
+  _dir                 = _iv_bg_saved_dir;
+  _lastObj             = _iv_bg_saved_obj;
+  _vref_v              = _iv_bg_saved_vref;
+  _last_mppt_update_ms = now;
+}
+
+void edugrid_mpp_tracker::_set_iv_phase(IVPhase phase)
+{
+  // Every transition lands in the event trace, so a sweep that never reaches
+  // Done is visible after the fact.
+  _iv_phase = phase;
+  edugrid_trace::record(TRACE_EV_IV_PHASE, (uint8_t)phase, _iv_count, _pwm.getPWM(), _index);
+}
+
+
+/* ========================= Debug & Accessors ========================= */
+
+void edugrid_mpp_tracker::serial_debug(void) const
+{
+  Serial.print("[MPPT] ch=");
+  Serial.print(_index);
+  Serial.print(" mode=");
+  switch (_mode_state) {
+    case MANUALLY: Serial.print("MANUALLY"); break;
+    case AUTO:     Serial.print("AUTO");     break;
+    case IV_SWEEP: Serial.print("IV_SWEEP"); break;
+    default:       Serial.print("UNK");      break;
+  }
+  Serial.print(" PWM=");  Serial.print(_pwm.getPWM());
+  Serial.print("% Pin="); Serial.print(_meas.getPowerPV(), 2);
+  Serial.print(" dP=");   Serial.print(objective_w() - _lastObj, 2);
+  Serial.print(" Dir=");  Serial.print(_dir);
+  if (_vref_enabled) {
+    Serial.print(" Vref="); Serial.print(_vref_v, 2);
+  }
+  if (_pout_w > 0.0f) {
+    Serial.print(" Pout="); Serial.print(_meas.getPowerLoad(), 2);
+    Serial.print(" w=");    Serial.print(_pout_w, 2);
+  }
+  Serial.println();
+}
+
+bool edugrid_mpp_tracker::iv_sweep_in_progress(void) const { return _iv_phase != IVPhase::Idle && _iv_phase != IVPhase::Done; }
+bool edugrid_mpp_tracker::iv_sweep_done(void) const        { return _iv_phase == IVPhase::Done; }
+
+void edugrid_mpp_tracker::iv_get_point(uint16_t idx, float& v, float& i) const
+{
+  if (idx < _iv_count) { v = _iv_pts[idx].v; i = _iv_pts[idx].i; }
+  else { v = 0.0f; i = 0.0f; }
+}
+
+const IvPoint_t& edugrid_mpp_tracker::iv_point(uint16_t idx) const
+{
+  static const IvPoint_t kNone = {};
+  return (idx < _iv_count) ? _iv_pts[idx] : kNone;
+}
@@ -0,0 +1,581 @@
+/*************************************************************************
+ * @file edugrid_payload.cpp
+ * @date 2026/10/18
+ *
+ ************************************************************************/
+
+/*************************************************************************
+ * Include
+ ************************************************************************/
+#include <edugrid_payload.h>
+#include <edugrid_channel.h>
+#include <edugrid_measurement.h>
+#include <edugrid_mpp_algorithm.h>
+#include <edugrid_pwm_control.h>
+#include <edugrid_logging.h>
+#include <LittleFS.h>
+#include <math.h>
+
+/*************************************************************************
+ * Helpers
+ ************************************************************************/
+#if EDUGRID_NUM_CHANNELS > 1
+static void _channelToJson(JsonObject obj, const edugrid_channel& c)
+{
+  obj["ch"]   = c.index();
+  obj["mode"] = edugrid_payload::modeToStr(c.mppt.get_mode_state());
+  obj["pwm"]  = c.pwm.getPWM();
+  obj["vin"]  = c.meas.getVoltagePV();
+  obj["iin"]  = c.meas.getCurrentPV();
+  obj["pin"]  = c.meas.getPowerPV();
+  obj["vout"] = c.meas.getVoltageLoad();
+  obj["iout"] = c.meas.getCurrentLoad();
+  obj["pout"] = c.meas.getPowerLoad();
+  obj["eff"]  = c.meas.getEfficiency();
+}
+#endif
+
+static float _round3(float x)
+{
+  return roundf(x * 1000.0f) / 1000.0f;
+}
+
+/** Sweep parameters shared by the list, a single sweep and a diff */
+static void _ivSummaryToJson(JsonObject obj, const IvArchiveHeader_t& hdr)
+{
+  obj["seq"]    = hdr.seq;
+  obj["ch"]     = hdr.ch;
+  obj["t_s"]    = hdr.uptime_ms / 1000UL;
+  obj["unix"]   = hdr.unix_s;            // 0: clock not set
+  obj["n"]      = hdr.n;
+  obj["voc"]    = _round3(hdr.voc);
+  obj["isc"]    = _round3(hdr.isc);
+  obj["vmp"]    = _round3(hdr.vmp);
+  obj["imp"]    = _round3(hdr.imp);
+  obj["pmp"]    = _round3(hdr.vmp * hdr.imp);
+  obj["ff"]     = _round3(edugrid_iv_archive::fillFactor(hdr));
+  if (hdr.temp_c10 == IV_ARCHIVE_TEMP_UNKNOWN) obj["temp"] = nullptr;
+  else                                         obj["temp"] = hdr.temp_c10 / 10.0f;
+}
+
+static void _nullableToJson(JsonObject obj, const char* key, float x, float scale)
+{
+  if (isnan(x)) obj[key] = nullptr;
+  else          obj[key] = roundf(x * scale) / scale;
+}
+
+static void _periodToJson(JsonObject parent, const char* key, const EnergyPeriod_t& p)
+{
+  JsonObject o = parent.createNestedObject(key);
+  o["pv_wh"]   = round(p.pv.wh   * 1000.0) / 1000.0;
+  o["pv_ah"]   = round(p.pv.ah   * 1000.0) / 1000.0;
+  o["load_wh"] = round(p.load.wh * 1000.0) / 1000.0;
+  o["load_ah"] = round(p.load.ah * 1000.0) / 1000.0;
+}
+
+/*************************************************************************
+ * Function Definition
+ ************************************************************************/
+const char* edugrid_payload::modeToStr(OperatingModes_t mode)
+{
+  switch (mode) {
+    case MANUALLY: return "MANUAL";
+    case AUTO:     return "AUTO";
+    case IV_SWEEP: return "IV_SWEEP";
+    default:       return "UNKNOWN";
+  }
+}
+
+/** Totals over all channels plus the "channels" array (multi-converter
+ *  builds only; the top-level keys always describe channel 0). */
+void edugrid_payload::channelsToJson(JsonDocument& doc)
+{
+#if EDUGRID_NUM_CHANNELS > 1
+  float pin = 0.0f, pout = 0.0f;
+  JsonArray arr = doc.createNestedArray("channels");
+  for (uint8_t ch = 0; ch < edugrid_channel::count(); ++ch) {
+    const edugrid_channel& c = edugrid_channel::at(ch);
+    _channelToJson(arr.createNestedObject(), c);
+    pin  += c.meas.getPowerPV();
+    pout += c.meas.getPowerLoad();
+  }
+  doc["pin_total"]  = pin;
+  doc["pout_total"] = pout;
+#else
+  (void)doc;
+#endif
+}
+
+void edugrid_payload::liveJson(String& out)
+{
+  // Build a fresh doc each tick to avoid cross-tick reuse issues
+  // The websocket payload mirrors the REST API but is pushed automatically to
+  // keep the dashboard live without polling.  A stack-allocated document keeps
+  // heap fragmentation low.
+  StaticJsonDocument<K_WS_JSON_CAPACITY> doc;
+
+  // --- Converter / PWM (numeric; add units in JS to reduce payload) ---
+  const uint8_t pwm_pct = edugrid_pwm_control::getPWM();
+  doc["pwm"]       = pwm_pct;                                   // percent (0..100)
+  doc["pwm_raw"]   = pwm_pct;                                   // legacy key kept for JS compatibility
+  doc["pwm_min"]   = edugrid_pwm_control::getPwmLowerLimit();   // percent
+  doc["pwm_max"]   = edugrid_pwm_control::getPwmUpperLimit();   // percent
+  const float freq_hz = edugrid_pwm_control::getFrequency();
+  doc["freq_hz"]   = freq_hz;
+
+  // --- Mode as string the UI expects ---
+  doc["mode"] = modeToStr(edugrid_mpp_algorithm::get_mode_state());
+
+  // --- Measurements (numbers; format and round in JS) ---
+  doc["vin"]   = edugrid_measurement::getVoltagePV();
+  doc["iin"]   = edugrid_measurement::getCurrentPV();
+  doc["pin"]   = edugrid_measurement::getPowerPV();
+
+  doc["vout"]  = edugrid_measurement::getVoltageLoad();
+  doc["iout"]  = edugrid_measurement::getCurrentLoad();
+  doc["pout"]  = edugrid_measurement::getPowerLoad();
+
+  doc["eff"]   = edugrid_measurement::getEfficiency(); // 0..1 (multiply by 100 in JS)
+
+  // --- Steady-state hold of the tracker ---
+  const edugrid_mpp_tracker& mppt = edugrid_channel::at(0).mppt;
+  doc["frozen"]        = mppt.is_frozen();
+  doc["frozen_s"]      = mppt.frozen_time_ms() / 1000UL;
+  doc["freeze_gain_j"] = roundf(mppt.freeze_gain_j() * 10.0f) / 10.0f;
+  // Reference of the V_ref cascade, null when duty P&O (or no AUTO) runs
+  if (mppt.get_vref_enabled() && mppt.get_mode_state() == AUTO) {
+    doc["vref"] = roundf(mppt.vref_v() * 100.0f) / 100.0f;
+  } else {
+    doc["vref"] = nullptr;
+  }
+  // Fast trip: "ok", "tripped" (retry pending) or "latched" (needs a reset)
+  const edugrid_protection& protect = edugrid_channel::at(0).protect;
+  doc["prot"]  = edugrid_protection::stateToStr(protect.state());
+  doc["trips"] = protect.tripCount();
+  // Output limit holding the duty ("cc" / "cv"), null while the tracker decides
+  const edugrid_charger& charge = edugrid_channel::at(0).charge;
+  if (charge.state() != CHARGE_MPPT) {
+    doc["charge"] = edugrid_charger::stateToStr(charge.state());
+  } else {
+    doc["charge"] = nullptr;
+  }
+  // Tracking efficiency against the last IV sweep (0..1): averaged and since
+  // boot, null until a sweep gave the reference
+  const edugrid_track_eff& teff = edugrid_channel::at(0).teff;
+  _nullableToJson(doc.as<JsonObject>(), "teff",     teff.etaNow(),   1000.0f);
+  _nullableToJson(doc.as<JsonObject>(), "teff_cum", teff.etaTotal(), 1000.0f);
+
+  // --- Other converters (multi-channel builds) ---
+  channelsToJson(doc);
+
+  // --- Misc state (string; unchanged) ---
+  doc["logging"] = edugrid_logging::getLogState_str();
+
+  // Serialize once into a pre-reserved buffer
+  out = "";
+  out.reserve(256 + 160 * (EDUGRID_NUM_CHANNELS - 1));
+  serializeJson(doc, out);
+}
+
+void edugrid_payload::ivSweepJson(const edugrid_mpp_tracker& mppt, String& out)
+{
+  const uint16_t n = mppt.iv_point_count();
+
+  // Sized for the points actually captured: an adaptive sweep has far
+  // fewer than the buffer holds, and this runs on the AsyncTCP stack.
+  DynamicJsonDocument doc(K_IV_JSON_CAPACITY(n));
+  JsonArray v_data = doc.createNestedArray("v");
+  JsonArray i_data = doc.createNestedArray("i");
+  JsonArray p_data = doc.createNestedArray("p");
+  JsonArray d_data = doc.createNestedArray("d");
+  JsonArray t_data = doc.createNestedArray("t");
+
+  // Fill arrays (keep your rounding so UI gets neat numbers)
+  for (uint16_t idx = 0; idx < n; ++idx) {
+    const IvPoint_t& pt = mppt.iv_point(idx);
+    const float p = pt.v * pt.i;
+
+    v_data.add(roundf(pt.v * 1000.0f) / 1000.0f);
+    i_data.add(roundf(pt.i * 1000.0f) / 1000.0f);
+    p_data.add(roundf(p    * 1000.0f) / 1000.0f);
+    d_data.add(pt.duty);
+    t_data.add(pt.t_ms);
+  }
+
+  // The first n_up points are the up pass (sorted by duty), the rest the
+  // optional down pass
+  doc["n_up"]        = mppt.iv_up_count();
+  doc["duration_ms"] = mppt.iv_duration_ms();
+  doc["loss_j"]      = roundf(mppt.iv_loss_j() * 100.0f) / 100.0f;
+  doc["hyst_pct"]    = roundf(mppt.iv_hysteresis() * 1000.0f) / 10.0f;
+  doc["in_progress"] = mppt.iv_sweep_in_progress();
+  doc["done"]        = mppt.iv_sweep_done();
+
+  // Background sweeps from AUTO: count, time off the tracked duty, and the
+  // loss against what the tracker harvested
+  const float harvest_j = mppt.auto_energy_j() + mppt.iv_bg_loss_j();
+  doc["background"]  = mppt.iv_sweep_background();
+  doc["bg_count"]    = mppt.iv_bg_count();
+  doc["bg_time_s"]   = mppt.iv_bg_time_ms() / 1000.0f;
+  doc["bg_loss_j"]   = roundf(mppt.iv_bg_loss_j() * 100.0f) / 100.0f;
+  doc["bg_cost_pct"] = (harvest_j > 0.0f) ? roundf(mppt.iv_bg_loss_j() / harvest_j * 10000.0f) / 100.0f : 0.0f;
+  doc["bg_next_s"]   = (mppt.get_iv_bg_interval_s() == 0) ? -1L : (long)(mppt.iv_bg_wait_ms() / 1000UL);
+
+  // Pre-reserve response to avoid reallocations
+  out = "";
+  out.reserve(  (size_t)(n * 5 /*arrays*/ * 10 /*avg chars/num*/ + 128) );
+  serializeJson(doc, out);
+}
+
+void edugrid_payload::settleJson(uint8_t ch, String& out)
+{
+  const edugrid_channel& c = edugrid_channel::at(ch);
+  StaticJsonDocument<K_SETTLE_JSON_CAPACITY> doc;
+
+  doc["ch"]             = c.index();
+  doc["running"]        = c.settle.active();
+  doc["result"]         = edugrid_settle_cal::resultToStr(c.settle.lastResult());
+  doc["measured_ms"]    = c.settle.measuredUs() / 1000.0f;
+  doc["tau_ms"]         = c.settle.tauUs() / 1000.0f;
+  doc["settle_ms"]      = c.settleMs();                                     // in use
+  doc["step_period_ms"] = c.mppt.get_step_period_ms();
+  doc["interval_s"]     = c.settle.getInterval_s();
+  doc["age_s"]          = (c.settle.lastResult() == SETTLE_CAL_NEVER)
+                              ? -1L : (long)((millis() - c.settle.lastRunMs()) / 1000UL);
+
+  out = "";
+  serializeJson(doc, out);
+}
+
+void edugrid_payload::protectJson(uint8_t ch, String& out)
+{
+  static const struct { uint8_t bit; const char* name; } kCauses[] = {
+    { INA_ALERT_I_IN, "i_in" }, { INA_ALERT_V_IN, "v_in" }, { INA_ALERT_I_OUT, "i_out" }, { INA_ALERT_V_OUT, "v_out" }
+  };
+  const edugrid_protection& p = edugrid_channel::at(ch).protect;
+  StaticJsonDocument<K_PROTECT_JSON_CAPACITY> doc;
+
+  doc["ch"]        = ch;
+  doc["state"]     = edugrid_protection::stateToStr(p.state());
+  doc["trips"]     = p.tripCount();
+  doc["retries"]   = p.retries();                                        // in this window
+  doc["age_s"]     = (p.tripCount() == 0) ? -1L : (long)((millis() - p.lastTripMs()) / 1000UL);
+  doc["detect_us"] = p.lastDetectUs();                                   // ISR -> control task
+  JsonArray cause  = doc.createNestedArray("cause");
+  JsonObject limit = doc.createNestedObject("limits");
+  for (const auto& c : kCauses) {
+    if (p.lastCause() & c.bit) cause.add(c.name);
+    limit[c.name] = p.limit(c.bit);
+  }
+
+  out = "";
+  serializeJson(doc, out);
+}
+
+void edugrid_payload::effmapJson(uint8_t ch, String& out)
+{
+  const edugrid_channel& c = edugrid_channel::at(ch);
+  static FreqMapTable_t t;   // web task only; keeps 300+ bytes off its stack
+  const bool valid = c.fmap.table(t);
+  StaticJsonDocument<K_EFFMAP_JSON_CAPACITY> doc;
+
+  doc["ch"]       = c.index();
+  doc["running"]  = c.fmap.active();
+  doc["progress"] = c.fmap.progress();
+  doc["points"]   = FREQ_MAP_NUM_DUTIES * FREQ_MAP_NUM_FREQS;
+  doc["result"]   = edugrid_freq_map::resultToStr(c.fmap.lastResult());
+  doc["select"]   = c.fmap.getSelect();
+  doc["freq_hz"]  = c.pwm.getFrequency();                                 // in use
+  doc["valid"]    = valid;
+  if (!valid) {
+    out = "";
+    serializeJson(doc, out);
+    return;
+  }
+  const float eff_now = c.fmap.expectedEff();
+  if (!isnan(eff_now)) doc["eff_now"] = eff_now;                          // map value at this P_in
+  doc["unix_s"]   = t.unix_s;
+
+  JsonArray freqs = doc.createNestedArray("freq");
+  for (uint8_t f = 0; f < FREQ_MAP_NUM_FREQS; ++f) freqs.add(edugrid_freq_map::frequencyHz(f));
+  JsonArray duty = doc.createNestedArray("duty");
+  JsonArray eff  = doc.createNestedArray("eff");                          // [duty][freq], 0 = none
+  JsonArray p_in = doc.createNestedArray("p_in");
+  for (uint8_t d = 0; d < FREQ_MAP_NUM_DUTIES; ++d) {
+    duty.add(t.duty[d]);
+    JsonArray er = eff.createNestedArray();
+    JsonArray pr = p_in.createNestedArray();
+    for (uint8_t f = 0; f < FREQ_MAP_NUM_FREQS; ++f) {
+      er.add(t.cell[d][f].eff);
+      pr.add(t.cell[d][f].p_in);
+    }
+  }
+
+  out = "";
+  serializeJson(doc, out);
+}
+
+void edugrid_payload::energyJson(uint8_t ch, String& out)
+{
+  const edugrid_channel& c = edugrid_channel::at(ch);
+  EnergyTotals_t t;
+  edugrid_energy::totals(c.index(), t);
+  StaticJsonDocument<K_ENERGY_JSON_CAPACITY> doc;
+
+  doc["ch"]             = c.index();
+  doc["hw"]             = c.energy.hardwareOk();                         // both accumulators read
+  doc["clock"]          = edugrid_energy::clockValid();
+  doc["utc_offset_min"] = edugrid_energy::utcOffsetMin();
+  doc["day"]            = t.day;                                         // days since 1970, 0 = no clock yet
+  doc["week"]           = t.week;
+  JsonObject root = doc.as<JsonObject>();
+  _periodToJson(root, "today",     t.today);
+  _periodToJson(root, "yesterday", t.yesterday);
+  _periodToJson(root, "this_week", t.this_week);
+  _periodToJson(root, "last_week", t.last_week);
+  _periodToJson(root, "lifetime",  t.lifetime);
+
+  out = "";
+  serializeJson(doc, out);
+}
+
+void edugrid_payload::scopeJson(uint8_t ch, String& out)
+{
+  const edugrid_channel& c = edugrid_channel::at(ch);
+  StaticJsonDocument<K_SCOPE_JSON_CAPACITY> doc;
+
+  doc["ch"]      = c.index();
+  doc["running"] = c.scope.active();
+  doc["armed"]   = c.scope.armed();
+  doc["result"]  = edugrid_scope::resultToStr(c.scope.lastResult());
+
+  ScopeHeader_t hdr;
+  if (edugrid_scope::lastHeader(hdr)) {
+    JsonObject cap = doc.createNestedObject("capture");
+    cap["seq"]       = hdr.seq;                                          // ?raw=1 downloads this one
+    cap["ch"]        = hdr.ch;
+    cap["trigger"]   = (hdr.trigger == SCOPE_TRIG_STEP) ? "step" : "level";
+    cap["n"]         = hdr.n;
+    cap["pre"]       = hdr.pre;                                          // index of t = 0
+    cap["period_us"] = hdr.period_us;
+    cap["duty_from"] = hdr.duty_from;
+    cap["duty_to"]   = hdr.duty_to;
+    if (hdr.trigger == SCOPE_TRIG_LEVEL) {
+      cap["signal"]  = edugrid_scope::signalToStr((ScopeSignal_t)hdr.signal);
+      cap["edge"]    = hdr.rising ? "rise" : "fall";
+      cap["level"]   = hdr.level;
+    }
+    cap["unix"]      = hdr.unix_s;                                       // 0: clock not set
+    cap["age_s"]     = (millis() - hdr.uptime_ms) / 1000UL;
+  }
+
+  out = "";
+  serializeJson(doc, out);
+}
+
+void edugrid_payload::i2cJson(uint8_t ch, String& out)
+{
+  const edugrid_channel& c = edugrid_channel::at(ch);
+  const ChannelConfig_t& cfg = edugrid_channel::config(ch);
+  I2cBusStats_t bus;
+  edugrid_i2c::stats(bus);
+  StaticJsonDocument<K_I2C_JSON_CAPACITY> doc;
+  const uint32_t now = millis();
+
+  doc["ch"]            = c.index();
+  doc["async"]         = bus.async;                                      // false: read in the control task
+  doc["poll_ms"]       = I2C_POLL_MS;
+  doc["timeout_ms"]    = I2C_TIMEOUT_MS;
+  doc["age_ms"]        = c.meas.sampleAgeMs();                           // of the readings in use
+  doc["cycles"]        = bus.cycles;
+  doc["skipped"]       = bus.skipped;
+  doc["unchanged"]     = bus.unchanged;                                  // reads that found no new conversion
+  doc["cycle_us"]      = bus.cycle_us;
+  doc["cycle_us_max"]  = bus.cycle_us_max;
+  doc["recoveries"]    = bus.recoveries;
+  doc["recover_age_s"] = (bus.recoveries == 0) ? -1L : (long)((now - bus.recover_ms) / 1000UL);
+
+  for (uint8_t side = 0; side < 2; ++side) {
+    const bool load = (side != 0);
+    const I2cDeviceStats_t& st = c.meas.deviceStats(load);
+    JsonObject d = doc.createNestedObject(load ? "load" : "pv");
+    d["addr"]        = load ? cfg.ina_load_addr : cfg.ina_pv_addr;
+    d["found"]       = load ? c.meas.sensorLoadOk() : c.meas.sensorPvOk();
+    d["reads"]       = st.reads;
+    d["errors"]      = st.errors;
+    d["timeouts"]    = st.timeouts;
+    d["consecutive"] = st.consecutive;
+    d["us_max"]      = st.us_max;                                        // slowest good VBUS + CURRENT read
+    d["ok_age_ms"]   = (st.reads == st.errors) ? -1L : (long)(now - st.last_ok_ms);
+  }
+
+  out = "";
+  serializeJson(doc, out);
+}
+
+void edugrid_payload::acquisitionJson(uint8_t ch, String& out)
+{
+  const edugrid_channel& c = edugrid_channel::at(ch);
+  StaticJsonDocument<K_ACQ_JSON_CAPACITY> doc;
+
+  doc["ch"]     = c.index();
+  doc["active"] = edugrid_measurement::profileName(c.profile());
+  JsonArray arr = doc.createNestedArray("profiles");
+  for (uint8_t k = 0; k < ACQ_PROFILE_COUNT; ++k) {
+    const AcqProfile_t    p  = (AcqProfile_t)k;
+    const AcqSetting_t    s  = edugrid_measurement::profileSetting(p);
+    const AcqNoiseStats_t& n = c.noiseStats(p);
+    const uint32_t step_ms   = edugrid_measurement::stepPeriodFor(s.avg_samples, s.conv_us, c.settleMs());
+
+    JsonObject o = arr.createNestedObject();
+    o["name"]           = edugrid_measurement::profileName(p);
+    o["avg"]            = s.avg_samples;
+    o["conv_us"]        = s.conv_us;
+    o["window_ms"]      = edugrid_measurement::windowMsFor(s.avg_samples, s.conv_us);
+    o["step_period_ms"] = step_ms;
+    if (p == ACQ_PROFILE_SWEEP) {
+      // One point per step period, on the grid of the control task
+      const uint32_t tick_ms = ((step_ms + TASK_CONTROL_INTERVAL_MS - 1) / TASK_CONTROL_INTERVAL_MS)
+                               * TASK_CONTROL_INTERVAL_MS;
+      // At most the point budget; both coarse passes are always taken
+      uint16_t points = c.mppt.get_iv_sweep_points();
+      if (c.mppt.get_iv_sweep_bidir() && points < 2 * IV_SWEEP_COARSE_POINTS - 1) {
+        points = 2 * IV_SWEEP_COARSE_POINTS - 1;
+      }
+      o["sweep_s"] = points * tick_ms / 1000.0f;
+    }
+    // Noise as 1-sigma of a single reading; null until samples exist
+    o["n"] = n.n;
+    if (n.n > 0) {
+      o["sigma_mv"] = sqrtf(n.sum_var_v / n.n) * 1000.0f;
+      o["sigma_ma"] = sqrtf(n.sum_var_i / n.n) * 1000.0f;
+    } else {
+      o["sigma_mv"] = nullptr;
+      o["sigma_ma"] = nullptr;
+    }
+  }
+
+  out = "";
+  serializeJson(doc, out);
+}
+
+void edugrid_payload::ivArchiveListJson(Print& out)
+{
+  struct Ctx { Print& out; bool first; } ctx = { out, true };
+
+  out.print(F("{\"next\":"));
+  out.print(edugrid_iv_archive::nextSeq());
+  out.print(F(",\"sweeps\":["));
+  edugrid_iv_archive::forEach([](const IvArchiveHeader_t& hdr, bool in_flash, void* p) {
+    Ctx& c = *static_cast<Ctx*>(p);
+    StaticJsonDocument<K_IVS_ENTRY_JSON_CAPACITY> doc;
+    JsonObject obj = doc.to<JsonObject>();
+    _ivSummaryToJson(obj, hdr);
+    obj["flash"] = in_flash;
+    if (!c.first) c.out.print(',');
+    c.first = false;
+    serializeJson(doc, c.out);
+    return true;
+  }, &ctx);
+  out.print(F("]}"));
+}
+
+void edugrid_payload::ivArchiveSweepJson(const IvArchiveRecord_t& rec, String& out)
+{
+  const IvArchiveHeader_t& hdr = rec.hdr;
+  DynamicJsonDocument doc(K_IVS_SWEEP_JSON_CAPACITY(hdr.n));
+  JsonObject obj = doc.to<JsonObject>();
+
+  _ivSummaryToJson(obj, hdr);
+  obj["n_up"]        = hdr.n_up;
+  obj["duration_ms"] = hdr.duration_ms;
+  _nullableToJson(obj, "rs", edugrid_iv_archive::seriesResistance(rec), 1000.0f);
+
+  JsonArray v_data = obj.createNestedArray("v");
+  JsonArray i_data = obj.createNestedArray("i");
+  JsonArray d_data = obj.createNestedArray("d");
+  for (uint8_t k = 0; k < hdr.n; ++k) {
+    float v, i;
+    edugrid_iv_archive::point(rec, k, v, i);
+    v_data.add(_round3(v));
+    i_data.add(_round3(i));
+    d_data.add(rec.pts[k].duty);
+  }
+
+  out = "";
+  out.reserve((size_t)(hdr.n * 3 * 8 + 256));
+  serializeJson(doc, out);
+}
+
+void edugrid_payload::ivArchiveDiffJson(const IvArchiveRecord_t& a, const IvArchiveRecord_t& b, String& out)
+{
+  IvArchiveDiff_t d;
+  const bool overlap = edugrid_iv_archive::diff(a, b, d);
+  StaticJsonDocument<K_IVS_DIFF_JSON_CAPACITY> doc;
+  JsonObject obj = doc.to<JsonObject>();
+
+  obj["a"]     = a.hdr.seq;
+  obj["b"]     = b.hdr.seq;
+  obj["d_voc"] = _round3(d.d_voc);
+  obj["d_isc"] = _round3(d.d_isc);
+  obj["d_vmp"] = _round3(d.d_vmp);
+  obj["d_imp"] = _round3(d.d_imp);
+  obj["d_pmp"] = _round3(d.d_pmp);
+  obj["d_ff"]  = _round3(d.d_ff);
+  _nullableToJson(obj, "r_isc", d.r_isc, 1000.0f);
+  _nullableToJson(obj, "r_pmp", d.r_pmp, 1000.0f);
+  _nullableToJson(obj, "rs_a",  d.rs_a,  1000.0f);
+  _nullableToJson(obj, "rs_b",  d.rs_b,  1000.0f);
+
+  JsonArray v_data  = obj.createNestedArray("v");
+  JsonArray di_data = obj.createNestedArray("di");
+  for (uint8_t k = 0; overlap && k < d.n; ++k) {
+    v_data.add(_round3(d.v[k]));
+    if (isnan(d.di[k])) di_data.add(nullptr);
+    else                di_data.add(_round3(d.di[k]));
+  }
+
+  out = "";
+  serializeJson(doc, out);
+}
+
+String edugrid_payload::fileListHtml(void)
+{
+  String returnText;
+
+  auto listDir = [&](const char* path) {
+    // Iterate through a directory and append one HTML table row per entry.
+    File root = LittleFS.open(path);
+    if (!root) return;
+    File f = root.openNextFile();
+    while (f) {
+      returnText += "<tr align='left'><td>" + String(path) + String(f.name()) + "</td><td>"
+                    + humanReadableSize(f.size()) + "</td>";
+      returnText += "<td><button onclick=\"downloadDeleteButton('"
+                    + String(path) + String(f.name())
+                    + "', 'download')\">Download</button>";
+      returnText += "<td><button onclick=\"downloadDeleteButton('"
+                    + String(path) + String(f.name())
+                    + "', 'delete')\">Delete</button></tr>";
+      f = root.openNextFile();
+    }
+    root.close();
+  };
+
+  returnText += "<table><tr><th align='left'>Name</th><th align='left'>Size</th><th></th><th></th></tr>";
+  listDir("/log/");
+  listDir("/www/");
+  listDir("/config/");
+  listDir("/ivs/");
+  listDir("/");
+  returnText += "</table>";
+  return returnText;
+}
+
+String edugrid_payload::humanReadableSize(const size_t bytes)
+{
+  if (bytes < 1024) return String(bytes) + " B";
+  if (bytes < (1024 * 1024)) return String(bytes / 1024.0) + " KB";
+  if (bytes < (1024 * 1024 * 1024)) return String(bytes / 1024.0 / 1024.0) + " MB";
+  return String(bytes / 1024.0 / 1024.0 / 1024.0) + " GB";
+}
@@ -0,0 +1,202 @@
+/*************************************************************************
+ * @file edugrid_protection.cpp
+ * @date 2026/10/18
+ *
+ ************************************************************************/
+
+/*************************************************************************
+ * Include
+ ************************************************************************/
+#include <edugrid_protection.h>
+#include <edugrid_trace.h>
+#include <hal/gpio_ll.h>
+
+/*************************************************************************
+ * Function Definition
+ ************************************************************************/
+edugrid_protection::edugrid_protection(edugrid_meas_channel& meas, edugrid_pwm_channel& pwm,
+                                       edugrid_mpp_tracker& mppt)
+  : _meas(meas),
+    _pwm(pwm),
+    _mppt(mppt),
+    _index(0),
+    _sd_pin(-1),
+    _alert_pin(-1),
+    _i_in_max(PROT_I_IN_MAX_A),
+    _v_in_max(PROT_V_IN_MAX_V),
+    _i_out_max(PROT_I_OUT_MAX_A),
+    _v_out_max(PROT_V_OUT_MAX_V),
+    _gate_on(false),
+    _isr_trips(0),
+    _isr_us(0),
+    _state(PROT_UNARMED),
+    _reset_requested(false),
+    _seen_trips(0),
+    _last_cause(0),
+    _last_trip_ms(0),
+    _last_detect_us(0),
+    _burst(0),
+    _burst_ms(0)
+{
+}
+
+void edugrid_protection::begin(uint8_t index, int8_t sd_pin, int8_t alert_pin)
+{
+  _index     = index;
+  _sd_pin    = sd_pin;
+  _alert_pin = alert_pin;
+  // Gate driver stays off until arm(): no switching before the limits hold
+  if (_sd_pin >= 0) {
+    pinMode(_sd_pin, OUTPUT);
+    digitalWrite(_sd_pin, LOW);
+  }
+  if (_alert_pin >= 0) {
+    pinMode(_alert_pin, INPUT_PULLUP);
+  }
+}
+
+void edugrid_protection::setLimits(float i_in_max, float v_in_max, float i_out_max, float v_out_max)
+{
+  _i_in_max  = i_in_max;
+  _v_in_max  = v_in_max;
+  _i_out_max = i_out_max;
+  _v_out_max = v_out_max;
+}
+
+void edugrid_protection::arm(void)
+{
+  if (_sd_pin < 0) return;
+
+  if (_alert_pin < 0 || !_meas.armAlerts(_i_in_max, _v_in_max, _i_out_max, _v_out_max)) {
+    Serial.printf("|WARN| CH%u no INA228 alert: gate driver enabled without fast trip\n", (unsigned)_index);
+    _state = PROT_UNARMED;
+    digitalWrite(_sd_pin, HIGH);
+    return;
+  }
+
+  attachInterruptArg(digitalPinToInterrupt(_alert_pin), _isr, this, FALLING);
+  _state = PROT_OK;
+  _enable();
+  Serial.printf("[PROT] CH%u SD=%d ALERT=%d: I_in<%.1f A V_in<%.1f V I_out<%.1f A V_out<%.1f V\n",
+                (unsigned)_index, (int)_sd_pin, (int)_alert_pin,
+                _i_in_max, _v_in_max, _i_out_max, _v_out_max);
+}
+
+void edugrid_protection::service(void)
+{
+  if (_state == PROT_UNARMED) return;
+  const uint32_t now = millis();
+
+  const uint16_t trips = _isr_trips;
+  if (trips != _seen_trips) {
+    _seen_trips = trips;
+    _trip(now);
+  }
+
+  if (_reset_requested) {
+    _reset_requested = false;
+    if (_state != PROT_OK) {
+      Serial.printf("[PROT] CH%u reset\n", (unsigned)_index);
+      _burst        = 0;
+      _last_trip_ms = now - PROT_RETRY_MS;   // retry right below
+      _state        = PROT_TRIPPED;
+    }
+  }
+
+  if (_state != PROT_TRIPPED || (now - _last_trip_ms) < PROT_RETRY_MS) return;
+
+  // Flags set since the last read mean the fault is still there; reading
+  // them releases ALERT, which pulls again on the next conversion
+  const uint8_t cause = _meas.takeAlertCause();
+  if (cause != 0) {
+    _last_cause   = cause;
+    _last_trip_ms = now;
+    return;
+  }
+  _enable();
+  if (_state == PROT_OK && _mppt.get_mode_state() == AUTO) {
+    // P&O starts over from the lower border, not from pre-trip slopes
+    _mppt.set_mode_state(AUTO);
+  }
+}
+
+float edugrid_protection::limit(uint8_t cause_bit) const
+{
+  switch (cause_bit) {
+    case INA_ALERT_I_IN:  return _i_in_max;
+    case INA_ALERT_V_IN:  return _v_in_max;
+    case INA_ALERT_I_OUT: return _i_out_max;
+    case INA_ALERT_V_OUT: return _v_out_max;
+    default:              return 0.0f;
+  }
+}
+
+const char* edugrid_protection::stateToStr(ProtState_t state)
+{
+  switch (state) {
+    case PROT_OK:      return "ok";
+    case PROT_TRIPPED: return "tripped";
+    case PROT_LATCHED: return "latched";
+    default:           return "unarmed";
+  }
+}
+
+/*************************************************************************
+ * Private
+ ************************************************************************/
+void IRAM_ATTR edugrid_protection::_isr(void* arg)
+{
+  // Direct register write: digitalWrite() is not guaranteed to sit in IRAM
+  edugrid_protection* self = static_cast<edugrid_protection*>(arg);
+  gpio_ll_set_level(&GPIO, (gpio_num_t)self->_sd_pin, 0);
+  if (self->_gate_on) {
+    self->_gate_on   = false;
+    self->_isr_us    = micros();
+    self->_isr_trips = self->_isr_trips + 1;
+  }
+}
+
+void edugrid_protection::_trip(uint32_t now)
+{
+  _last_detect_us = micros() - _isr_us;
+  _last_cause     = _meas.takeAlertCause();
+  _last_trip_ms   = now;
+  if (_burst == 0 || (now - _burst_ms) > (uint32_t)PROT_RETRY_WINDOW_S * 1000UL) {
+    _burst    = 0;
+    _burst_ms = now;
+  }
+  ++_burst;
+
+  // Come back at the safe end of the duty window, also in MANUAL
+  const uint8_t low = _pwm.getPwmLowerLimit();
+  _pwm.setPWM(low, PWM_SRC_TRIP);
+  _pwm.requestManualTarget(low);
+  if (_mppt.get_mode_state() == IV_SWEEP) {
+    _mppt.set_mode_state(_mppt.iv_sweep_background() ? AUTO : MANUALLY);
+  }
+
+  _setState((_burst > PROT_MAX_RETRIES) ? PROT_LATCHED : PROT_TRIPPED, _last_cause, _last_detect_us);
+  Serial.printf("[PROT] CH%u trip #%u cause=0x%X (seen after %lu us) -> %s\n",
+                (unsigned)_index, (unsigned)_seen_trips, (unsigned)_last_cause,
+                (unsigned long)_last_detect_us, stateToStr(_state));
+}
+
+void edugrid_protection::_enable(void)
+{
+  _gate_on = true;
+  digitalWrite(_sd_pin, HIGH);
+  // ALERT is latched: an edge between the two lines above left it low, and
+  // the ISR may have run before SD went high, so check the level once more
+  if (digitalRead(_alert_pin) == LOW) {
+    _isr(this);
+    return;
+  }
+  _setState(PROT_OK, 0, 0);
+}
+
+void edugrid_protection::_setState(ProtState_t state, uint8_t cause, uint32_t detect_us)
+{
+  if (state == _state) return;
+  _state = state;
+  edugrid_trace::record(TRACE_EV_PROTECT, _state, cause, detect_us, _index);
+}
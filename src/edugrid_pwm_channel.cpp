@@ -0,0 +1,228 @@
+/*************************************************************************
+ * @file edugrid_pwm_channel.cpp
+ * @date 2026/10/18
+ ************************************************************************/
+
+#include <edugrid_pwm_channel.h>
+#include <edugrid_trace.h>
+#include <soc/ledc_struct.h>
+
+/* ===== construction ===== */
+edugrid_pwm_channel::edugrid_pwm_channel(void)
+    : _index(0),
+      _ledc_channel(0),
+      _pin(-1),
+      _freq_hz(CONVERTER_FREQUENCY),
+      _duty(PWM_ABS_INIT),                  // start safe
+      _duty_fine(PWM_ABS_INIT * PWM_FINE_PER_PCT),
+      _dither(PWM_DITHER != 0),
+      _abs_min(PWM_ABS_MIN_MPPT),
+      _abs_max(PWM_ABS_MAX_MPPT),
+      _ceiling(PWM_DUTY_NO_CEILING),
+      _manual_target(PWM_ABS_INIT),
+      _manual_last_step_ms(0),
+      _manual_slew_step(MANUAL_SLEW_STEP_PCT),
+      _manual_slew_interval(MANUAL_SLEW_INTERVAL_MS)
+{
+#if CONFIG_FREERTOS_UNICORE == 0
+    _mux = portMUX_INITIALIZER_UNLOCKED;
+#endif
+}
+
+/* ===== private helpers ===== */
+void edugrid_pwm_channel::_applyToHardware(uint16_t fine)
+{
+    // Convert from a fine percentage into the raw LEDC timer counts (8-bit
+    // resolution, 0..255); dithering keeps PWM_DITHER_FRAC_BITS more of it
+    static constexpr uint32_t kFull = 100UL * PWM_FINE_PER_PCT;
+    if (fine > kFull) fine = kFull;
+    if (!_dither) {
+        ledcWrite(_ledc_channel, ((uint32_t)fine * PWM_RESOLUTION_STEPS + kFull / 2) / kFull);
+        return;
+    }
+    const uint32_t q = ((uint32_t)fine * (PWM_RESOLUTION_STEPS << PWM_DITHER_FRAC_BITS) + kFull / 2) / kFull;
+
+    // ledcWrite() sets up a plain duty update with the fraction cleared;
+    // put the fraction back before the update latches at the next period.
+    // The peripheral then adds one tick in `frac` of every 16 periods.
+    ledcWrite(_ledc_channel, q >> PWM_DITHER_FRAC_BITS);
+    if ((q & ((1UL << PWM_DITHER_FRAC_BITS) - 1)) == 0) return;
+    const uint8_t group = _ledc_channel / 8, ch = _ledc_channel % 8;
+    LEDC.channel_group[group].channel[ch].duty.duty        = q;
+    LEDC.channel_group[group].channel[ch].conf1.duty_start = 1;
+    if (group != 0) LEDC.channel_group[group].channel[ch].conf0.low_speed_update = 1;
+}
+
+uint16_t edugrid_pwm_channel::_upperFine(void) const
+{
+    // The lower border wins over a ceiling below it
+    const uint16_t lo = _abs_min * PWM_FINE_PER_PCT;
+    const uint16_t hi = _abs_max * PWM_FINE_PER_PCT;
+    if (_ceiling >= hi) return hi;
+    return (_ceiling > lo) ? _ceiling : lo;
+}
+
+/* ===== public API ===== */
+void edugrid_pwm_channel::begin(uint8_t index, uint8_t ledc_channel, int freq_hz, int pin)
+{
+    _index = index;
+    _ledc_channel = ledc_channel;
+    _pin = pin;
+    _freq_hz = freq_hz;
+    ledcSetup(_ledc_channel, (double)_freq_hz, PWM_RESOLUTION_BITS);
+    ledcAttachPin(_pin, _ledc_channel); // attach ONCE
+    // Borders keep their current value (compiled defaults or whatever the
+    // config store applied) so init order does not matter.
+    setPWM(PWM_ABS_INIT, PWM_SRC_INIT);
+}
+
+void edugrid_pwm_channel::setPin(int pin)
+{
+    if (pin == _pin) return;
+    _pin = pin;
+    ledcAttachPin(_pin, _ledc_channel);
+    _applyToHardware(_duty_fine);
+}
+
+void edugrid_pwm_channel::setFrequency(float freq_hz)
+{
+    if (freq_hz <= 0) return;
+    _freq_hz = (int)freq_hz;
+
+    // Reconfigure LEDC, then re-apply current duty
+    ledcSetup(_ledc_channel, (double)_freq_hz, PWM_RESOLUTION_BITS);
+    _applyToHardware(_duty_fine);
+}
+
+void edugrid_pwm_channel::setDither(bool enabled)
+{
+    if (enabled == _dither) return;
+#if CONFIG_FREERTOS_UNICORE == 0
+    portENTER_CRITICAL(&_mux);
+#endif
+    _dither = enabled;
+    _applyToHardware(_duty_fine);
+#if CONFIG_FREERTOS_UNICORE == 0
+    portEXIT_CRITICAL(&_mux);
+#endif
+}
+
+void edugrid_pwm_channel::setPWM(uint8_t pwm_in, PwmSource_t src)
+{
+    setPWMFine((uint16_t)(pwm_in * PWM_FINE_PER_PCT), src);
+}
+
+void edugrid_pwm_channel::setPWMFine(uint16_t fine_in, PwmSource_t src)
+{
+    const uint16_t lo = _abs_min * PWM_FINE_PER_PCT;
+    const uint16_t hi = _upperFine();
+    if (fine_in < lo) fine_in = lo;
+    if (fine_in > hi) fine_in = hi;
+    const uint8_t old = _duty;
+    const uint8_t pct = (uint8_t)((fine_in + PWM_FINE_PER_PCT / 2) / PWM_FINE_PER_PCT);
+#if CONFIG_FREERTOS_UNICORE == 0
+    portENTER_CRITICAL(&_mux);
+#endif
+    _duty      = pct;
+    _duty_fine = fine_in;
+    _applyToHardware(_duty_fine);
+#if CONFIG_FREERTOS_UNICORE == 0
+    portEXIT_CRITICAL(&_mux);
+#endif
+    if (pct != old) {
+        edugrid_trace::record(TRACE_EV_PWM, src, pct, old, _index);
+    }
+}
+
+void edugrid_pwm_channel::requestManualTarget(uint8_t target)
+{
+    const uint8_t upper = getPwmUpperLimit();
+    if (target < _abs_min) target = _abs_min;
+    if (target > upper)    target = upper;
+    _manual_target = target;
+    _manual_last_step_ms = millis() - _manual_slew_interval;
+}
+
+void edugrid_pwm_channel::serviceManualRamp(bool manual_active)
+{
+    const uint32_t now = millis();
+
+    if (!manual_active) {
+        // In AUTO/IV modes the MPPT logic drives the duty.  Reset the ramp so
+        // the next manual request starts from the live duty without a jump.
+        _manual_target = _duty;
+        _manual_last_step_ms = now;
+        return;
+    }
+
+    if (_manual_target == _duty) {
+        return;
+    }
+
+    if ((now - _manual_last_step_ms) < _manual_slew_interval) {
+        // Enforce the configured slew rate.
+        return;
+    }
+
+    _manual_last_step_ms = now;
+
+    int current = _duty;
+    const int target = _manual_target;
+
+    if (target > current) {
+        current += _manual_slew_step;
+        if (current > target) current = target;
+    } else {
+        current -= _manual_slew_step;
+        if (current < target) current = target;
+    }
+
+    setPWM(static_cast<uint8_t>(current), PWM_SRC_MANUAL_RAMP);
+}
+
+void edugrid_pwm_channel::pwmIncrementDecrement(int step, PwmSource_t src)
+{
+    int val = (int)_duty + step;
+    if (val < 0)   val = 0;
+    if (val > 100) val = 100;
+    setPWM((uint8_t)val, src);
+    // Align manual ramp state with the new duty to avoid fighting external updates
+    _manual_target = _duty;
+    _manual_last_step_ms = millis();
+}
+
+void edugrid_pwm_channel::setPwmLimits(uint8_t min_pct, uint8_t max_pct)
+{
+    // Never leave the hard window of the power stage.
+    if (min_pct < PWM_ABS_MIN_MPPT) min_pct = PWM_ABS_MIN_MPPT;
+    if (max_pct > PWM_ABS_MAX_MPPT) max_pct = PWM_ABS_MAX_MPPT;
+    if (min_pct >= max_pct) return;
+    _abs_min = min_pct;
+    _abs_max = max_pct;
+    // The control task clamps the live duty on its next checkAndSetPwmBorders().
+}
+
+void edugrid_pwm_channel::setManualSlew(uint8_t step_pct, uint16_t interval_ms)
+{
+    _manual_slew_step = (step_pct > 0) ? step_pct : 1;
+    _manual_slew_interval = interval_ms;
+}
+
+void edugrid_pwm_channel::checkAndSetPwmBorders(void)
+{
+    // Clamp cached duty to current borders and re-apply if needed
+    const uint16_t lo = _abs_min * PWM_FINE_PER_PCT;
+    const uint16_t hi = _upperFine();
+    uint16_t clamped = _duty_fine;
+    if (clamped < lo) clamped = lo;
+    if (clamped > hi) clamped = hi;
+
+    if (clamped != _duty_fine) setPWMFine(clamped, PWM_SRC_BORDER);
+}
+
+void edugrid_pwm_channel::setDutyCeiling(uint16_t fine, PwmSource_t src)
+{
+    if (fine == _ceiling) return;
+    _ceiling = fine;
+    if (_duty_fine > _upperFine()) setPWMFine(_duty_fine, src);   // clamps
+}
@@ -0,0 +1,428 @@
+/*************************************************************************
+ * @file edugrid_scope.cpp
+ * @date 2026/10/18
+ *
+ ************************************************************************/
+
+/*************************************************************************
+ * Include
+ ************************************************************************/
+#include <edugrid_scope.h>
+#include <edugrid_trace.h>
+#include <time.h>
+
+/*************************************************************************
+ * Variable Definition
+ ************************************************************************/
+// One capture runs at a time (control task), so all channels share the
+// buffer: ~10 KB instead of per-channel copies.  s_owner / s_reading keep
+// a capture and a download from touching it at the same time.
+static portMUX_TYPE   s_scopeMux = portMUX_INITIALIZER_UNLOCKED;
+static ScopeSample_t  s_buf[SCOPE_SAMPLES];
+static ScopeHeader_t  s_hdr = {};       // of s_buf, n = 0: nothing to download
+static int8_t         s_owner   = -1;   // channel capturing into s_buf
+static bool           s_reading = false;
+static uint32_t       s_seq     = 0;
+
+static const char* const kSignalNames[SCOPE_SIG_COUNT] = { "v_in", "i_in", "v_out", "i_out" };
+
+/*************************************************************************
+ * Helpers
+ ************************************************************************/
+/** Both devices back to back; t_us holds the raw micros() until _publish() */
+static void _sample(edugrid_meas_channel& meas, ScopeSample_t& s)
+{
+  s.t_us = (int32_t)micros();
+  meas.samplePV(s.v_in, s.i_in);
+  meas.sampleLoad(s.v_out, s.i_out);
+}
+
+/** Paced burst into s_buf[first..first+n), continuing the pacing of `next` */
+static void _burst(edugrid_meas_channel& meas, uint16_t first, uint16_t n, uint16_t period_us, uint32_t& next)
+{
+  for (uint16_t k = first; k < first + n; ++k) {
+    const int32_t wait = (int32_t)(next - micros());
+    if (wait > 0) delayMicroseconds((uint32_t)wait);
+    _sample(meas, s_buf[k % SCOPE_SAMPLES]);
+    next += period_us;
+  }
+}
+
+static float _signal(const ScopeSample_t& s, ScopeSignal_t sig)
+{
+  switch (sig) {
+    case SCOPE_SIG_I_IN:  return s.i_in;
+    case SCOPE_SIG_V_OUT: return s.v_out;
+    case SCOPE_SIG_I_OUT: return s.i_out;
+    default:              return s.v_in;
+  }
+}
+
+static void _reverse(uint16_t first, uint16_t last)
+{
+  while (first + 1 < last) {
+    const ScopeSample_t tmp = s_buf[first];
+    s_buf[first++] = s_buf[--last];
+    s_buf[last]    = tmp;
+  }
+}
+
+/** Turn the ring so that `first` becomes index 0 */
+static void _rotate(uint16_t first)
+{
+  if (first == 0) return;
+  _reverse(0, first);
+  _reverse(first, SCOPE_SAMPLES);
+  _reverse(0, SCOPE_SAMPLES);
+}
+
+/*************************************************************************
+ * Function Definition
+ ************************************************************************/
+edugrid_scope::edugrid_scope(edugrid_meas_channel& meas, edugrid_pwm_channel& pwm, edugrid_mpp_tracker& mppt)
+  : _meas(meas),
+    _pwm(pwm),
+    _mppt(mppt),
+    _index(0),
+    _requested(false),
+    _pending(defaultRequest()),
+    _req(defaultRequest()),
+    _phase(Phase::Idle),
+    _phase_ms(0),
+    _saved_fine(0),
+    _step_to(0),
+    _saved_mode(MANUALLY),
+    _saved_avg(0),
+    _saved_conv(0),
+    _fast_on(false),
+    _ring_pos(0),
+    _ring_fill(0),
+    _prev(0.0f),
+    _next_us(0),
+    _run_result(SCOPE_OK),
+    _result(SCOPE_NEVER)
+{
+}
+
+ScopeRequest_t edugrid_scope::defaultRequest(void)
+{
+  ScopeRequest_t req;
+  req.trigger   = SCOPE_TRIG_STEP;
+  req.signal    = SCOPE_SIG_V_IN;
+  req.rising    = true;
+  req.level     = 0.0f;
+  req.step_pct  = SCOPE_STEP_PCT;
+  req.period_us = SCOPE_SAMPLE_US;
+  req.pre_pct   = SCOPE_PRE_PCT;
+  return req;
+}
+
+const char* edugrid_scope::resultToStr(ScopeResult_t result)
+{
+  switch (result) {
+    case SCOPE_OK:      return "ok";
+    case SCOPE_TIMEOUT: return "timeout";
+    case SCOPE_ABORTED: return "aborted";
+    default:            return "never";
+  }
+}
+
+const char* edugrid_scope::signalToStr(ScopeSignal_t signal)
+{
+  return kSignalNames[(signal < SCOPE_SIG_COUNT) ? signal : SCOPE_SIG_V_IN];
+}
+
+bool edugrid_scope::signalFromStr(const char* name, ScopeSignal_t& signal)
+{
+  for (uint8_t k = 0; k < SCOPE_SIG_COUNT; ++k) {
+    if (strcmp(name, kSignalNames[k]) == 0) { signal = (ScopeSignal_t)k; return true; }
+  }
+  return false;
+}
+
+void edugrid_scope::request(const ScopeRequest_t& req)
+{
+  ScopeRequest_t r = req;
+  if (r.period_us < SCOPE_SAMPLE_US_MIN) r.period_us = SCOPE_SAMPLE_US_MIN;
+  if (r.period_us > SCOPE_SAMPLE_US_MAX) r.period_us = SCOPE_SAMPLE_US_MAX;
+  if (r.pre_pct > 90) r.pre_pct = 90;
+  if (r.step_pct >  SCOPE_STEP_PCT_MAX) r.step_pct =  SCOPE_STEP_PCT_MAX;
+  if (r.step_pct < -SCOPE_STEP_PCT_MAX) r.step_pct = -SCOPE_STEP_PCT_MAX;
+  if (r.signal >= SCOPE_SIG_COUNT) r.signal = SCOPE_SIG_V_IN;
+
+  portENTER_CRITICAL(&s_scopeMux);
+  _pending   = r;
+  _requested = true;
+  portEXIT_CRITICAL(&s_scopeMux);
+}
+
+void edugrid_scope::service(void)
+{
+  const uint32_t now = millis();
+
+  switch (_phase)
+  {
+    case Phase::Idle:
+      if (!_requested) return;
+      if (_mppt.get_mode_state() == IV_SWEEP || !_meas.sensorPvOk()) return;
+      // Another channel or a download holds the buffer: next pass
+      if (_claim()) _start(now);
+      return;
+
+    case Phase::Hold:
+      // The user (or an IV sweep request) took over: leave the duty alone
+      if (_lost()) {
+        _finish(SCOPE_ABORTED);
+        return;
+      }
+      // Capture from a settled operating point
+      if ((now - _phase_ms) < _mppt.get_step_period_ms()) return;
+      _captureStep();
+      _pwm.setPWMFine(_saved_fine, PWM_SRC_SCOPE);
+      _run_result = SCOPE_OK;
+      _phase_ms   = millis();   // the burst itself took a while
+      _phase      = Phase::Release;
+      return;
+
+    case Phase::Armed:
+      if (_lost()) {
+        _finish(SCOPE_ABORTED);
+        return;
+      }
+      if ((now - _phase_ms) >= SCOPE_ARM_TIMEOUT_MS) {
+        _restore();
+        _run_result = SCOPE_TIMEOUT;
+        _phase_ms   = now;
+        _phase      = Phase::Release;
+        return;
+      }
+      _serviceArmed();
+      return;
+
+    case Phase::Release:
+      // Hand back only once the normal averaging window is full again
+      if ((now - _phase_ms) < _mppt.get_step_period_ms()) return;
+      _finish(_run_result);
+      return;
+
+    default:
+      _phase = Phase::Idle;
+      return;
+  }
+}
+
+bool edugrid_scope::lastHeader(ScopeHeader_t& hdr)
+{
+  portENTER_CRITICAL(&s_scopeMux);
+  hdr = s_hdr;
+  const bool ok = (s_owner < 0) && (s_hdr.n > 0);
+  portEXIT_CRITICAL(&s_scopeMux);
+  return ok;
+}
+
+bool edugrid_scope::dump(Print& out)
+{
+  ScopeHeader_t hdr;
+  portENTER_CRITICAL(&s_scopeMux);
+  const bool ok = (s_owner < 0) && (s_hdr.n > 0);
+  if (ok) {
+    hdr       = s_hdr;
+    s_reading = true;
+  }
+  portEXIT_CRITICAL(&s_scopeMux);
+  if (!ok) return false;
+
+  out.write(reinterpret_cast<const uint8_t*>(&hdr), sizeof(hdr));
+  out.write(reinterpret_cast<const uint8_t*>(s_buf), hdr.n * sizeof(ScopeSample_t));
+
+  portENTER_CRITICAL(&s_scopeMux);
+  s_reading = false;
+  portEXIT_CRITICAL(&s_scopeMux);
+  return true;
+}
+
+/*************************************************************************
+ * Private
+ ************************************************************************/
+bool edugrid_scope::_claim(void)
+{
+  portENTER_CRITICAL(&s_scopeMux);
+  const bool ok = (s_owner < 0) && !s_reading;
+  if (ok) {
+    s_owner    = (int8_t)_index;
+    s_hdr.n    = 0;   // the old capture is about to be overwritten
+    _req       = _pending;
+    _requested = false;
+  }
+  portEXIT_CRITICAL(&s_scopeMux);
+  return ok;
+}
+
+void edugrid_scope::_start(uint32_t now)
+{
+  _saved_fine = _pwm.getPWMFine();
+  _saved_mode = _mppt.get_mode_state();
+  _phase_ms   = now;
+
+  if (_req.trigger == SCOPE_TRIG_STEP) {
+    // Step the other way at a border
+    const int from  = _pwm.getPWM();
+    const int lower = _pwm.getPwmLowerLimit();
+    const int upper = _pwm.getPwmUpperLimit();
+    int to = from + _req.step_pct;
+    if (to > upper || to < lower) to = from - _req.step_pct;
+    if (to > upper) to = upper;
+    if (to < lower) to = lower;
+    _step_to = (uint8_t)to;
+    _phase   = Phase::Hold;
+    Serial.printf("[SCOPE] CH%u step capture %d%% -> %d%%, %u us per sample\n",
+                  (unsigned)_index, from, to, (unsigned)_req.period_us);
+    return;
+  }
+
+  _step_to   = _pwm.getPWM();
+  _ring_pos  = 0;
+  _ring_fill = 0;
+  _fast();
+  _phase     = Phase::Armed;
+  Serial.printf("[SCOPE] CH%u armed: %s %s %.3f, %u us per sample\n",
+                (unsigned)_index, signalToStr(_req.signal), _req.rising ? "rising past" : "falling past",
+                _req.level, (unsigned)_req.period_us);
+}
+
+void edugrid_scope::_captureStep(void)
+{
+  const uint16_t pre = (uint16_t)((uint32_t)SCOPE_SAMPLES * _req.pre_pct / 100U);
+  edugrid_i2c_lock bus;   // no polled read between two samples
+
+  _fast();
+  uint32_t next = micros();
+  _burst(_meas, 0, pre, _req.period_us, next);
+  // t = 0 at the duty write; the pacing runs on across it
+  const uint32_t t_step = micros();
+  _pwm.setPWM(_step_to, PWM_SRC_SCOPE);
+  _burst(_meas, pre, SCOPE_SAMPLES - pre, _req.period_us, next);
+  // Back to the normal acquisition setting before anything else reads
+  _restore();
+
+  _publish(pre, SCOPE_SAMPLES, t_step);
+}
+
+void edugrid_scope::_serviceArmed(void)
+{
+  const uint16_t pre_want = (uint16_t)((uint32_t)SCOPE_SAMPLES * _req.pre_pct / 100U);
+  const uint32_t t_end    = micros() + SCOPE_ARM_SLICE_US;
+  edugrid_i2c_lock bus;
+  _next_us = micros();   // the gap since the last pass is in the timestamps
+
+  while ((int32_t)(micros() - t_end) < 0) {
+    const int32_t wait = (int32_t)(_next_us - micros());
+    if (wait > 0) delayMicroseconds((uint32_t)wait);
+    ScopeSample_t& s = s_buf[_ring_pos];
+    _sample(_meas, s);
+    _next_us += _req.period_us;
+
+    const float x = _signal(s, _req.signal);
+    const bool crossed = (_ring_fill > 0) &&
+                         (_req.rising ? (_prev < _req.level && x >= _req.level)
+                                      : (_prev > _req.level && x <= _req.level));
+    _prev = x;
+    if (!crossed) {
+      _ring_pos = (uint16_t)((_ring_pos + 1) % SCOPE_SAMPLES);
+      if (_ring_fill < SCOPE_SAMPLES) ++_ring_fill;
+      continue;
+    }
+
+    // Trigger sample at _ring_pos; the rest follows it around the ring,
+    // over the oldest samples only (pre + post never exceeds the buffer)
+    const uint16_t pre  = (_ring_fill < pre_want) ? _ring_fill : pre_want;
+    const uint16_t post = SCOPE_SAMPLES - pre_want;
+    const uint32_t t0   = (uint32_t)s.t_us;
+    _burst(_meas, _ring_pos + 1, post - 1, _req.period_us, _next_us);
+    _restore();
+    _rotate((uint16_t)((_ring_pos + SCOPE_SAMPLES - pre) % SCOPE_SAMPLES));
+    _publish(pre, pre + post, t0);
+
+    _run_result = SCOPE_OK;
+    _phase_ms   = millis();
+    _phase      = Phase::Release;
+    return;
+  }
+}
+
+void edugrid_scope::_fast(void)
+{
+  // No averaging, shortest conversion; give the first result time to land
+  _saved_avg  = _meas.avgSamples();
+  _saved_conv = _meas.convUs();
+  _meas.configure(SCOPE_AVG, SCOPE_CONV_US);
+  _fast_on = true;
+  delayMicroseconds(4UL * SCOPE_AVG * SCOPE_CONV_US);
+}
+
+void edugrid_scope::_restore(void)
+{
+  if (!_fast_on) return;
+  _fast_on = false;
+  // A mode change already programmed the profile of the new mode
+  if (_meas.avgSamples() != SCOPE_AVG || _meas.convUs() != SCOPE_CONV_US) return;
+  _meas.configure(_saved_avg, _saved_conv);
+}
+
+void edugrid_scope::_publish(uint16_t pre, uint16_t n, uint32_t t0_us)
+{
+  for (uint16_t k = 0; k < n; ++k) {
+    s_buf[k].t_us = (int32_t)((uint32_t)s_buf[k].t_us - t0_us);
+  }
+
+  ScopeHeader_t hdr = {};
+  hdr.magic     = SCOPE_MAGIC;
+  hdr.version   = SCOPE_VERSION;
+  hdr.hdr_size  = sizeof(ScopeHeader_t);
+  hdr.n         = n;
+  hdr.pre       = pre;
+  hdr.period_us = _req.period_us;
+  hdr.conv_us   = SCOPE_CONV_US;
+  hdr.avg       = SCOPE_AVG;
+  hdr.ch        = _index;
+  hdr.trigger   = _req.trigger;
+  hdr.signal    = _req.signal;
+  hdr.rising    = _req.rising ? 1 : 0;
+  hdr.duty_from = (uint8_t)((_saved_fine + PWM_FINE_PER_PCT / 2) / PWM_FINE_PER_PCT);
+  hdr.duty_to   = _step_to;
+  hdr.level     = _req.level;
+  const time_t t = time(nullptr);
+  hdr.unix_s    = ((uint32_t)t >= SCOPE_UNIX_VALID_S) ? (uint32_t)t : 0;
+  hdr.uptime_ms = millis();
+
+  portENTER_CRITICAL(&s_scopeMux);
+  hdr.seq = ++s_seq;
+  s_hdr   = hdr;
+  s_owner = -1;
+  portEXIT_CRITICAL(&s_scopeMux);
+
+  Serial.printf("[SCOPE] CH%u capture #%lu: %u samples, trigger at %u\n",
+                (unsigned)_index, (unsigned long)hdr.seq, (unsigned)n, (unsigned)pre);
+}
+
+void edugrid_scope::_finish(ScopeResult_t result)
+{
+  _restore();
+  portENTER_CRITICAL(&s_scopeMux);
+  if (s_owner == (int8_t)_index) s_owner = -1;
+  portEXIT_CRITICAL(&s_scopeMux);
+
+  if (result != SCOPE_OK) {
+    Serial.printf("[SCOPE] CH%u no capture (%s)\n", (unsigned)_index, resultToStr(result));
+  }
+  ScopeHeader_t hdr;
+  const uint16_t n = (result == SCOPE_OK && lastHeader(hdr)) ? hdr.n : 0;
+  edugrid_trace::record(TRACE_EV_SCOPE, (uint8_t)result, n, _req.period_us, _index);
+  _result = result;
+  _phase  = Phase::Idle;
+}
+
+bool edugrid_scope::_lost(void) const
+{
+  return _mppt.get_mode_state() != _saved_mode || !_meas.sensorPvOk();
+}
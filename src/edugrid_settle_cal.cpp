@@ -0,0 +1,289 @@
+/*************************************************************************
+ * @file edugrid_settle_cal.cpp
+ * @date 2026/10/18
+ *
+ ************************************************************************/
+
+/*************************************************************************
+ * Include
+ ************************************************************************/
+#include <edugrid_settle_cal.h>
+#include <edugrid_measurement.h>
+#include <edugrid_trace.h>
+#include <math.h>
+
+/*************************************************************************
+ * Define
+ ************************************************************************/
+#define SETTLE_CAL_SAMPLES  (SETTLE_CAL_PRE_SAMPLES + SETTLE_CAL_POST_SAMPLES)
+
+#if SETTLE_CAL_TAIL_SAMPLES >= SETTLE_CAL_POST_SAMPLES
+#error "SETTLE_CAL_TAIL_SAMPLES must be shorter than the post-step window"
+#endif
+#if SETTLE_CAL_SMOOTH < 1 || SETTLE_CAL_SMOOTH > SETTLE_CAL_PRE_SAMPLES
+#error "SETTLE_CAL_SMOOTH must be 1..SETTLE_CAL_PRE_SAMPLES"
+#endif
+
+/*************************************************************************
+ * Variable Definition
+ ************************************************************************/
+// One probe runs at a time (control task), so all channels share the burst
+// buffers: ~1.6 KB instead of per-channel copies.
+static float    s_v[SETTLE_CAL_SAMPLES];
+static float    s_i[SETTLE_CAL_SAMPLES];
+static uint32_t s_t[SETTLE_CAL_SAMPLES];   // [us] relative to the duty step
+
+/*************************************************************************
+ * Helpers
+ ************************************************************************/
+static void _meanStd(const float* x, uint16_t n, float& mean, float& sd)
+{
+  float sum = 0.0f, sq = 0.0f;
+  for (uint16_t k = 0; k < n; ++k) { sum += x[k]; }
+  mean = sum / n;
+  for (uint16_t k = 0; k < n; ++k) { sq += (x[k] - mean) * (x[k] - mean); }
+  sd = sqrtf(sq / n);
+}
+
+/** Paced burst into s_v/s_i[first..first+n); timestamps are absolute micros() */
+static void _burst(edugrid_meas_channel& meas, uint16_t first, uint16_t n)
+{
+  uint32_t next = micros();
+  for (uint16_t k = first; k < first + n; ++k) {
+    const int32_t wait = (int32_t)(next - micros());
+    if (wait > 0) delayMicroseconds((uint32_t)wait);
+    meas.samplePV(s_v[k], s_i[k]);
+    s_t[k] = micros();
+    next += SETTLE_CAL_SAMPLE_US;
+  }
+}
+
+/**
+ * Settling time of one signal after the step.
+ * Final value = mean of the tail; settled = the running mean of the last
+ * SETTLE_CAL_SMOOTH samples stays within max(BAND_FRAC * step, NOISE_K *
+ * sigma) of it, so single noisy samples do not stretch the result.
+ * `floor` is the smallest step that counts as a response (sensor deadband).
+ */
+static SettleCalResult_t _settleOf(const float* x, float floor, uint32_t& settle_us, uint32_t& tau_us)
+{
+  float mu0, sd0, mu1, sd1;
+  _meanStd(x, SETTLE_CAL_PRE_SAMPLES, mu0, sd0);
+  _meanStd(x + SETTLE_CAL_SAMPLES - SETTLE_CAL_TAIL_SAMPLES, SETTLE_CAL_TAIL_SAMPLES, mu1, sd1);
+
+  const float amp   = fabsf(mu1 - mu0);
+  const float noise = SETTLE_CAL_NOISE_K * fmaxf(sd0, sd1);
+  if (!(amp > noise) || amp < floor) return SETTLE_CAL_NO_RESPONSE;
+
+  const float band = fmaxf(SETTLE_CAL_BAND_FRAC * amp, noise);
+  int   last_out = -1;
+  float run      = 0.0f;
+  for (uint16_t k = SETTLE_CAL_PRE_SAMPLES - SETTLE_CAL_SMOOTH + 1; k < SETTLE_CAL_SAMPLES; ++k) {
+    run += x[k];
+    if (k < SETTLE_CAL_PRE_SAMPLES) continue;
+    if (fabsf(run / SETTLE_CAL_SMOOTH - mu1) > band) last_out = k;
+    run -= x[k - SETTLE_CAL_SMOOTH + 1];
+  }
+  if (last_out >= SETTLE_CAL_SAMPLES - SETTLE_CAL_TAIL_SAMPLES) return SETTLE_CAL_NOT_SETTLED;
+
+  // First sample after the last one outside the band
+  settle_us = s_t[(last_out < 0) ? SETTLE_CAL_PRE_SAMPLES : last_out + 1];
+
+  tau_us = settle_us;
+  for (uint16_t k = SETTLE_CAL_PRE_SAMPLES; k < SETTLE_CAL_SAMPLES; ++k) {
+    if (fabsf(x[k] - mu0) >= 0.632f * amp) { tau_us = s_t[k]; break; }
+  }
+  return SETTLE_CAL_OK;
+}
+
+/*************************************************************************
+ * Function Definition
+ ************************************************************************/
+edugrid_settle_cal::edugrid_settle_cal(edugrid_meas_channel& meas, edugrid_pwm_channel& pwm,
+                                       edugrid_mpp_tracker& mppt)
+  : _meas(meas),
+    _pwm(pwm),
+    _mppt(mppt),
+    _index(0),
+    _requested(false),
+    // Automatic runs stay off until edugrid_config::apply() sets the interval
+    _interval_s(0),
+    _phase(Phase::Idle),
+    _phase_ms(0),
+    _probe_idx(0),
+    _probes_ok(0),
+    _saved_duty(0),
+    _first_dir(+1),
+    _saved_mode(MANUALLY),
+    _run_result(SETTLE_CAL_OK),
+    _run_worst_us(0),
+    _run_tau_us(0),
+    _result(SETTLE_CAL_NEVER),
+    _settle_ms(0),
+    _measured_us(0),
+    _tau_us(0),
+    _last_run_ms(0),
+    _ran_once(false)
+{
+}
+
+const char* edugrid_settle_cal::resultToStr(SettleCalResult_t result)
+{
+  switch (result) {
+    case SETTLE_CAL_OK:          return "ok";
+    case SETTLE_CAL_NO_RESPONSE: return "no_response";
+    case SETTLE_CAL_NOT_SETTLED: return "not_settled";
+    case SETTLE_CAL_ABORTED:     return "aborted";
+    default:                     return "never";
+  }
+}
+
+void edugrid_settle_cal::service(void)
+{
+  const uint32_t now = millis();
+
+  switch (_phase)
+  {
+    case Phase::Idle:
+      if (_shouldStart(now)) _start(now);
+      return;
+
+    case Phase::Hold:
+      // The user (or an IV sweep request) took over: leave the duty alone
+      if (_mppt.get_mode_state() != _saved_mode || !_meas.sensorPvOk()) {
+        _finish(SETTLE_CAL_ABORTED);
+        return;
+      }
+      // Start every probe from a settled operating point
+      if ((now - _phase_ms) < _mppt.get_step_period_ms()) return;
+
+      {
+        uint32_t settle_us = 0, tau_us = 0;
+        const int8_t dir = (_probe_idx & 1) ? -_first_dir : _first_dir;
+        const SettleCalResult_t r = _probe(dir, settle_us, tau_us);
+        if (r == SETTLE_CAL_OK) {
+          ++_probes_ok;
+          if (settle_us > _run_worst_us) { _run_worst_us = settle_us; _run_tau_us = tau_us; }
+        } else if (_run_result != SETTLE_CAL_NOT_SETTLED) {
+          _run_result = r;
+        }
+      }
+      _phase_ms = millis();   // the burst itself took a while
+
+      if (++_probe_idx >= SETTLE_CAL_PROBES) {
+        _pwm.setPWM(_saved_duty, PWM_SRC_SETTLE_CAL);
+        _phase = Phase::Release;
+      }
+      return;
+
+    case Phase::Release:
+      // Hand back only once the normal averaging window is full again
+      if ((now - _phase_ms) < _mppt.get_step_period_ms()) return;
+      _finish(_run_result);
+      return;
+
+    default:
+      _phase = Phase::Idle;
+      return;
+  }
+}
+
+/*************************************************************************
+ * Private
+ ************************************************************************/
+bool edugrid_settle_cal::_shouldStart(uint32_t now) const
+{
+  const OperatingModes_t mode = _mppt.get_mode_state();
+  if (mode == IV_SWEEP || !_meas.sensorPvOk()) return false;
+  if (_requested) return true;
+
+  // Periodic re-runs follow panel and load changes while tracking
+  if (_interval_s == 0 || mode != AUTO) return false;
+  if (_meas.getVoltagePV() < PV_PRESENT_V) return false;
+  return !_ran_once || (now - _last_run_ms) >= (uint32_t)_interval_s * 1000UL;
+}
+
+void edugrid_settle_cal::_start(uint32_t now)
+{
+  _requested    = false;
+  _saved_duty   = _pwm.getPWM();
+  _saved_mode   = _mppt.get_mode_state();
+  _first_dir    = (_saved_duty + SETTLE_CAL_STEP_PCT <= _pwm.getPwmUpperLimit()) ? +1 : -1;
+  _probe_idx    = 0;
+  _probes_ok    = 0;
+  _run_result   = SETTLE_CAL_OK;
+  _run_worst_us = 0;
+  _run_tau_us   = 0;
+  _phase_ms     = now;
+  _phase        = Phase::Hold;
+
+  Serial.printf("[SETTLE] CH%u start at %u%% duty\n", (unsigned)_index, (unsigned)_saved_duty);
+}
+
+SettleCalResult_t edugrid_settle_cal::_probe(int8_t dir, uint32_t& settle_us, uint32_t& tau_us)
+{
+  // Fast, lightly averaged conversions for the burst; give the first
+  // result time to land before sampling.
+  const uint16_t avg  = _meas.avgSamples();
+  const uint16_t conv = _meas.convUs();
+  edugrid_i2c_lock bus;   // the burst alone on the bus, paced exactly
+  _meas.configure(SETTLE_CAL_AVG, SETTLE_CAL_CONV_US);
+  delayMicroseconds(4UL * SETTLE_CAL_AVG * SETTLE_CAL_CONV_US);
+
+  _burst(_meas, 0, SETTLE_CAL_PRE_SAMPLES);
+  const uint8_t from = _pwm.getPWM();
+  _pwm.setPWM((uint8_t)(from + dir * SETTLE_CAL_STEP_PCT), PWM_SRC_SETTLE_CAL);
+  const uint32_t t_step = micros();
+  _burst(_meas, SETTLE_CAL_PRE_SAMPLES, SETTLE_CAL_POST_SAMPLES);
+
+  // Back to the normal acquisition setting before anything else reads
+  _meas.configure(avg, conv);
+
+  for (uint16_t k = 0; k < SETTLE_CAL_SAMPLES; ++k) {
+    s_t[k] = (k < SETTLE_CAL_PRE_SAMPLES) ? 0 : s_t[k] - t_step;
+  }
+
+  uint32_t sv = 0, tv = 0, si = 0, ti = 0;
+  const SettleCalResult_t rv = _settleOf(s_v, ZERO_V_CLAMP, sv, tv);
+  const SettleCalResult_t ri = _settleOf(s_i, ZERO_I_CLAMP, si, ti);
+
+  // A signal that is still moving makes the probe unusable; one that did
+  // not respond at all (e.g. current at a stiff operating point) is ignored.
+  if (rv == SETTLE_CAL_NOT_SETTLED || ri == SETTLE_CAL_NOT_SETTLED) return SETTLE_CAL_NOT_SETTLED;
+  if (rv != SETTLE_CAL_OK && ri != SETTLE_CAL_OK) return SETTLE_CAL_NO_RESPONSE;
+
+  settle_us = (sv > si) ? sv : si;
+  tau_us    = (sv > si) ? tv : ti;
+  return SETTLE_CAL_OK;
+}
+
+void edugrid_settle_cal::_finish(SettleCalResult_t result)
+{
+  // Half the probes must have seen a clean step; any probe that did not
+  // settle inside the window already turned the run into a failure.
+  if (result == SETTLE_CAL_OK && _probes_ok * 2 < SETTLE_CAL_PROBES) {
+    result = SETTLE_CAL_NO_RESPONSE;
+  }
+
+  if (result == SETTLE_CAL_OK) {
+    uint32_t settle_ms = (uint32_t)ceilf(_run_worst_us * SETTLE_CAL_MARGIN / 1000.0f);
+    if (settle_ms < SETTLE_CAL_MIN_MS) settle_ms = SETTLE_CAL_MIN_MS;
+    _settle_ms   = (uint16_t)settle_ms;
+    _measured_us = _run_worst_us;
+    _tau_us      = _run_tau_us;
+    _mppt.set_step_period_ms(edugrid_measurement::stepPeriodFor(_meas.avgSamples(), _meas.convUs(), _settle_ms));
+
+    Serial.printf("[SETTLE] CH%u settled in %.1f ms (tau %.1f ms) -> settle %u ms, step period %lu ms\n",
+                  (unsigned)_index, _measured_us / 1000.0f, _tau_us / 1000.0f,
+                  (unsigned)_settle_ms, (unsigned long)_mppt.get_step_period_ms());
+  } else {
+    Serial.printf("[SETTLE] CH%u no result (%s), step period stays %lu ms\n",
+                  (unsigned)_index, resultToStr(result), (unsigned long)_mppt.get_step_period_ms());
+  }
+
+  edugrid_trace::record(TRACE_EV_SETTLE_CAL, (uint8_t)result, _settle_ms, _run_worst_us, _index);
+  _result      = result;
+  _last_run_ms = millis();
+  _ran_once    = true;
+  _phase       = Phase::Idle;
+}
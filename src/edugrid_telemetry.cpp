@@ -3,6 +3,21 @@
  * @date 2025/08/18
  ************************************************************************/
 #include <edugrid_telemetry.h>
+#include <atomic>
+
+/* ===== Ring storage =====
+ * Single producer (control task) / single consumer (drain task).  Each side
+ * only writes its own index, so no lock is needed; the acquire/release pair
+ * makes the record contents visible before the index that publishes them. */
+static TelemetryRecord_t      s_ring[TELEMETRY_RING_SIZE];
+static std::atomic<uint32_t>  s_head(0);     // next slot to write (producer)
+static std::atomic<uint32_t>  s_tail(0);     // next slot to read  (consumer)
+static std::atomic<uint32_t>  s_pushed(0);
+static std::atomic<uint32_t>  s_dropped(0);
+static uint16_t               s_seq = 0;
+static uint32_t               s_decimate[EDUGRID_NUM_CHANNELS] = {0};
+static TelemetryFormat_t      s_format = TELEMETRY_FORMAT_HUMAN;
+static TaskHandle_t           s_task = nullptr;
 
 static const char* modeToStr(OperatingModes_t m) {
   switch (m) {
@@ -13,37 +28,205 @@ static const char* modeToStr(OperatingModes_t m) {
   }
 }
 
-void edugrid_telemetry::telemetryPrint(void)
-{
-  // Human readable dump of the most important runtime values.  Triggered from
-  // the MPPT task when EDUGRID_TELEMETRY_ON is defined.
-  Serial.println("* ------------------------------------ *");
-  Serial.println("* PWM CONTROL");
-  Serial.println("* ------------------------------------ *");
-  Serial.print("Freq / Hz: ");
-  Serial.println(edugrid_pwm_control::getFrequency());
-  Serial.print("PWM / %: ");
-  Serial.println(edugrid_pwm_control::getPWM());
-
-  Serial.println("* ------------------------------------ *");
-  Serial.println("* MEASUREMENTS (INA228)");
-  Serial.println("* ------------------------------------ *");
-  Serial.print("V_in  [V]: "); Serial.println(edugrid_measurement::V_in, 3);
-  Serial.print("I_in  [A]: "); Serial.println(edugrid_measurement::I_in, 3);
-  Serial.print("P_in  [W]: "); Serial.println(edugrid_measurement::P_in, 2);
-  Serial.print("V_out [V]: "); Serial.println(edugrid_measurement::V_out, 3);
-  Serial.print("I_out [A]: "); Serial.println(edugrid_measurement::I_out, 3);
-  Serial.print("P_out [W]: "); Serial.println(edugrid_measurement::P_out, 2);
-  Serial.print("Eff   [%]: "); Serial.println(edugrid_measurement::eff * 100.0f, 1);
-
-  Serial.println("* ------------------------------------ *");
-  Serial.println("* MPPT");
-  Serial.println("* ------------------------------------ *");
-  Serial.print("Mode: "); Serial.println(modeToStr(edugrid_mpp_algorithm::get_mode_state()));
-
-  Serial.println("* ------------------------------------ *");
-  Serial.println("* MISC");
-  Serial.println("* ------------------------------------ *");
-
-  Serial.println();
+/* CRC-16/CCITT-FALSE, bitwise: frames are ~35 bytes, a table is not worth
+ * the flash. */
+static uint16_t _crc16(uint16_t crc, const uint8_t* data, size_t len) {
+  for (size_t i = 0; i < len; ++i) {
+    crc ^= (uint16_t)data[i] << 8;
+    for (uint8_t b = 0; b < 8; ++b) {
+      crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+    }
+  }
+  return crc;
+}
+
+/* Consistent Overhead Byte Stuffing: removes every 0x00 so it can delimit
+ * frames.  `out` needs len + len/254 + 1 bytes. */
+static size_t _cobsEncode(const uint8_t* in, size_t len, uint8_t* out) {
+  size_t read = 0, write = 1, code_idx = 0;
+  uint8_t code = 1;
+  while (read < len) {
+    if (in[read] == 0) {
+      out[code_idx] = code;
+      code = 1;
+      code_idx = write++;
+      ++read;
+    } else {
+      out[write++] = in[read++];
+      if (++code == 0xFF) {
+        out[code_idx] = code;
+        code = 1;
+        code_idx = write++;
+      }
+    }
+  }
+  out[code_idx] = code;
+  return write;
+}
+
+/* ===== Public API ===== */
+void edugrid_telemetry::begin(TelemetryFormat_t format)
+{
+  s_format = format;
+  if (s_task != nullptr) return;
+  xTaskCreatePinnedToCore(_drainTask, "telemetry", TELEMETRY_TASK_STACK, nullptr,
+                          TELEMETRY_TASK_PRIORITY, &s_task, TELEMETRY_TASK_CORE);
+}
+
+void edugrid_telemetry::_fill(TelemetryRecord_t& rec, uint8_t ch)
+{
+  const edugrid_channel& c = edugrid_channel::at(ch);
+  rec.t_ms    = millis();
+  rec.ch      = c.index();
+  rec.mode    = (uint8_t)c.mppt.get_mode_state();
+  rec.pwm_pct = c.pwm.getPWM();
+  rec.freq_hz = (uint32_t)c.pwm.getFrequency();
+  rec.vin     = c.meas.getVoltagePV();
+  rec.iin     = c.meas.getCurrentPV();
+  rec.vout    = c.meas.getVoltageLoad();
+  rec.iout    = c.meas.getCurrentLoad();
+}
+
+void edugrid_telemetry::push(uint8_t ch)
+{
+  if (ch >= EDUGRID_NUM_CHANNELS) return;
+  if (++s_decimate[ch] < TELEMETRY_PUSH_DECIMATION) return;
+  s_decimate[ch] = 0;
+
+  s_pushed.fetch_add(1, std::memory_order_relaxed);
+  const uint32_t head = s_head.load(std::memory_order_relaxed);
+  const uint32_t tail = s_tail.load(std::memory_order_acquire);
+  if ((head - tail) >= TELEMETRY_RING_SIZE) {
+    // Consumer is behind (UART saturated): drop the newest, keep the stream
+    // contiguous up to here.  The seq gap shows the loss on the host side.
+    s_dropped.fetch_add(1, std::memory_order_relaxed);
+    ++s_seq;
+    return;
+  }
+
+  TelemetryRecord_t& rec = s_ring[head & (TELEMETRY_RING_SIZE - 1)];
+  _fill(rec, ch);
+  rec.seq = s_seq++;
+
+  s_head.store(head + 1, std::memory_order_release);
+}
+
+void edugrid_telemetry::getStats(uint32_t& pushed, uint32_t& dropped)
+{
+  pushed  = s_pushed.load(std::memory_order_relaxed);
+  dropped = s_dropped.load(std::memory_order_relaxed);
+}
+
+/* ===== Drain task ===== */
+void edugrid_telemetry::_drainTask(void* pvParameters)
+{
+  (void)pvParameters;
+  uint32_t since_stats = 0;
+  for (;;)
+  {
+    const uint32_t tail = s_tail.load(std::memory_order_relaxed);
+    const uint32_t head = s_head.load(std::memory_order_acquire);
+    if (tail == head) {
+      vTaskDelay(pdMS_TO_TICKS(TELEMETRY_DRAIN_IDLE_MS));
+      continue;
+    }
+
+    // Copy out first so the slot can be reused while the UART is busy.
+    const TelemetryRecord_t rec = s_ring[tail & (TELEMETRY_RING_SIZE - 1)];
+    s_tail.store(tail + 1, std::memory_order_release);
+
+    // Serial.write() blocks this (lowest priority) task when the UART
+    // buffer is full, which is exactly where the back-pressure belongs.
+    if (s_format == TELEMETRY_FORMAT_BINARY) {
+      _emitFrame(TELEMETRY_FRAME_RECORD, &rec, sizeof(rec));
+    } else {
+      _emitHuman(rec);
+    }
+
+    if (++since_stats >= TELEMETRY_STATS_EVERY) {
+      since_stats = 0;
+      uint32_t pushed, dropped;
+      getStats(pushed, dropped);
+      TelemetryStats_t st;
+      st.pushed  = pushed;
+      st.dropped = dropped;
+      if (s_format == TELEMETRY_FORMAT_BINARY) {
+        _emitFrame(TELEMETRY_FRAME_STATS, &st, sizeof(st));
+      } else {
+        Serial.printf("[TEL] pushed=%lu dropped=%lu\n",
+                      (unsigned long)st.pushed, (unsigned long)st.dropped);
+      }
+    }
+  }
+}
+
+void edugrid_telemetry::_emitFrame(uint8_t type, const void* payload, size_t len)
+{
+  uint8_t raw[1 + sizeof(TelemetryRecord_t) + 2];
+  if (len > sizeof(TelemetryRecord_t)) return;
+
+  raw[0] = type;
+  memcpy(&raw[1], payload, len);
+  const uint16_t crc = _crc16(0xFFFF, raw, 1 + len);
+  raw[1 + len] = (uint8_t)(crc & 0xFF);
+  raw[2 + len] = (uint8_t)(crc >> 8);
+
+  uint8_t frame[sizeof(raw) + sizeof(raw) / 254 + 2];
+  size_t n = _cobsEncode(raw, 3 + len, frame);
+  frame[n++] = 0x00;   // frame delimiter
+  Serial.write(frame, n);
+}
+
+void edugrid_telemetry::_emitHuman(const TelemetryRecord_t& rec)
+{
+  // Same dump as before, but assembled once and handed to the UART driver
+  // in a single write instead of ~30 print calls.
+  const float pin  = rec.vin  * rec.iin;
+  const float pout = rec.vout * rec.iout;
+  const float eff  = (pin > 1e-3f) ? (pout / pin) : 0.0f;
+
+  char buf[640];
+  const int n = snprintf(buf, sizeof(buf),
+    "* ------------------------------------ *\n"
+    "* CHANNEL %u - PWM CONTROL\n"
+    "* ------------------------------------ *\n"
+    "Freq / Hz: %lu\n"
+    "PWM / %%: %u\n"
+    "* ------------------------------------ *\n"
+    "* MEASUREMENTS (INA228)\n"
+    "* ------------------------------------ *\n"
+    "V_in  [V]: %.3f\n"
+    "I_in  [A]: %.3f\n"
+    "P_in  [W]: %.2f\n"
+    "V_out [V]: %.3f\n"
+    "I_out [A]: %.3f\n"
+    "P_out [W]: %.2f\n"
+    "Eff   [%%]: %.1f\n"
+    "* ------------------------------------ *\n"
+    "* MPPT\n"
+    "* ------------------------------------ *\n"
+    "Mode: %s\n"
+    "* ------------------------------------ *\n"
+    "* MISC\n"
+    "* ------------------------------------ *\n"
+    "t [ms]: %lu  seq: %u\n"
+    "\n",
+    (unsigned)rec.ch,
+    (unsigned long)rec.freq_hz, (unsigned)rec.pwm_pct,
+    rec.vin, rec.iin, pin, rec.vout, rec.iout, pout, eff * 100.0f,
+    modeToStr((OperatingModes_t)rec.mode),
+    (unsigned long)rec.t_ms, (unsigned)rec.seq);
+  if (n > 0) {
+    Serial.write(reinterpret_cast<const uint8_t*>(buf), ((size_t)n < sizeof(buf)) ? (size_t)n : sizeof(buf) - 1);
+  }
+}
+
+void edugrid_telemetry::telemetryPrint(uint8_t ch)
+{
+  // Human readable dump of the most important runtime values, printed
+  // synchronously from the caller's context.
+  TelemetryRecord_t rec;
+  _fill(rec, ch);
+  rec.seq = s_seq;
+  _emitHuman(rec);
 }
@@ -0,0 +1,145 @@
+/*************************************************************************
+ * @file edugrid_trace.cpp
+ * @date 2026/10/18
+ *
+ ************************************************************************/
+
+/*************************************************************************
+ * Include
+ ************************************************************************/
+#include <edugrid_trace.h>
+#include <atomic>
+
+/*************************************************************************
+ * Variable Definition
+ ************************************************************************/
+static TraceEvent_t          s_ring[TRACE_RING_SIZE];
+static std::atomic<uint32_t> s_head(0);        // next sequence number to claim
+static std::atomic<bool>     s_frozen(false);  // set while dump() copies the ring
+static std::atomic<uint32_t> s_writers(0);     // _record() calls past the frozen check
+static std::atomic<uint32_t> s_dropped(0);     // events rejected while frozen
+
+// dump() prints from this copy, so the ring is only frozen for a memcpy
+// instead of the whole (serial: most of a second) output.  One dump or
+// clear() at a time.
+static TraceEvent_t          s_snap[TRACE_RING_SIZE];
+static std::atomic<bool>     s_busy(false);
+
+/*************************************************************************
+ * Helpers
+ ************************************************************************/
+static void _writeHex(Print& out, const void* data, size_t len)
+{
+  static const char kHex[] = "0123456789abcdef";
+  const uint8_t* p = static_cast<const uint8_t*>(data);
+  char line[2 * sizeof(TraceDumpHeader_t) + 2];
+  size_t n = 0;
+  for (size_t i = 0; i < len && n + 2 < sizeof(line); ++i)
+  {
+    line[n++] = kHex[p[i] >> 4];
+    line[n++] = kHex[p[i] & 0x0F];
+  }
+  line[n++] = '\n';
+  out.write(reinterpret_cast<const uint8_t*>(line), n);
+}
+
+static void _claim(void)
+{
+  bool idle = false;
+  while (!s_busy.compare_exchange_weak(idle, true)) { idle = false; delay(1); }
+}
+
+/** Stop new events and wait for the ones already being written */
+static void _freeze(void)
+{
+  s_frozen.store(true);
+  while (s_writers.load() != 0) { delay(1); }   // a preempted writer needs the CPU
+}
+
+static void _thaw(void)
+{
+  s_frozen.store(false);
+}
+
+/*************************************************************************
+ * Function Definition
+ ************************************************************************/
+void edugrid_trace::_record(TraceEventType_t type, uint8_t a8, uint16_t a16, uint32_t a32, uint8_t ch)
+{
+  // Announce first, then check: _freeze() either sees this writer or this
+  // writer sees the freeze (both sequentially consistent)
+  s_writers.fetch_add(1);
+  if (s_frozen.load()) {
+    s_writers.fetch_sub(1);
+    s_dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  const uint32_t seq = s_head.fetch_add(1, std::memory_order_relaxed);
+  TraceEvent_t& ev = s_ring[seq & (TRACE_RING_SIZE - 1)];
+  ev.t_ms = millis();
+  ev.type = type;
+  ev.ch   = ch;
+  ev.a8   = a8;
+  ev.reserved0 = 0;
+  ev.a16  = a16;
+  ev.reserved1 = 0;
+  ev.a32  = a32;
+  s_writers.fetch_sub(1, std::memory_order_release);
+}
+
+void edugrid_trace::recordFloat(TraceEventType_t type, uint8_t a8, float value, uint8_t ch)
+{
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  record(type, a8, 0, bits, ch);
+}
+
+void edugrid_trace::dump(Print& out, bool hex)
+{
+  _claim();
+  TraceDumpHeader_t hdr;
+  hdr.magic      = TRACE_DUMP_MAGIC;
+  hdr.version    = TRACE_DUMP_VERSION;
+  hdr.event_size = sizeof(TraceEvent_t);
+
+  _freeze();
+  hdr.total      = s_head.load(std::memory_order_acquire);
+  hdr.now_ms     = millis();
+  memcpy(s_snap, s_ring, sizeof(s_snap));
+  _thaw();
+  // Read after the thaw so the count covers this freeze as well
+  hdr.dropped    = s_dropped.load(std::memory_order_relaxed);
+  const uint32_t count = (hdr.total < TRACE_RING_SIZE) ? hdr.total : TRACE_RING_SIZE;
+
+  if (hex)
+  {
+    out.println(TRACE_SERIAL_BEGIN);
+    _writeHex(out, &hdr, sizeof(hdr));
+  }
+  else
+  {
+    out.write(reinterpret_cast<const uint8_t*>(&hdr), sizeof(hdr));
+  }
+
+  for (uint32_t seq = hdr.total - count; seq != hdr.total; ++seq)
+  {
+    const TraceEvent_t& ev = s_snap[seq & (TRACE_RING_SIZE - 1)];
+    if (hex) { _writeHex(out, &ev, sizeof(ev)); }
+    else     { out.write(reinterpret_cast<const uint8_t*>(&ev), sizeof(ev)); }
+  }
+
+  if (hex) { out.println(TRACE_SERIAL_END); }
+
+  s_busy.store(false);
+}
+
+void edugrid_trace::clear(void)
+{
+  _claim();
+  _freeze();
+  memset(s_ring, 0, sizeof(s_ring));
+  s_head.store(0, std::memory_order_release);
+  s_dropped.store(0, std::memory_order_relaxed);
+  _thaw();
+  s_busy.store(false);
+}
@@ -0,0 +1,180 @@
+/*************************************************************************
+ * @file edugrid_track_eff.cpp
+ * @date 2026/10/18
+ *
+ ************************************************************************/
+
+/*************************************************************************
+ * Include
+ ************************************************************************/
+#include <edugrid_track_eff.h>
+#include <math.h>
+
+/*************************************************************************
+ * Function Definition
+ ************************************************************************/
+edugrid_track_eff::edugrid_track_eff(const edugrid_meas_channel& meas, const edugrid_mpp_tracker& mppt,
+                                     const edugrid_charger& charge)
+  : _meas(meas),
+    _mppt(mppt),
+    _charge(charge),
+    _ref_v{},
+    _ref_i{},
+    _ref_n(0),
+    _ref_ms(0),
+    _diode_ok(false),
+    _diode_i_ph(0.0f),
+    _diode_ln_a(0.0f),
+    _diode_inv_b(0.0f),
+    _p_avail(0.0f),
+    _p_in_avg(0.0f),
+    _p_avail_avg(0.0f),
+    _avg_valid(false),
+    _e_harvest_j(0.0),
+    _e_avail_j(0.0),
+    _last_ms(0)
+{
+}
+
+void edugrid_track_eff::capture(void)
+{
+  const uint16_t n = _mppt.iv_up_count();
+  float p_max = 0.0f, v_mpp = 0.0f, i_ph = 0.0f;
+  for (uint16_t k = 0; k < n; ++k) {
+    const IvPoint_t& pt = _mppt.iv_point(k);
+    if (pt.v * pt.i > p_max) { p_max = pt.v * pt.i; v_mpp = pt.v; }
+    if (pt.i > i_ph) i_ph = pt.i;
+  }
+  // A sweep in the dark (or an aborted one) is no reference
+  if (n < 2 || p_max < TRACK_EFF_MIN_P_W) return;
+
+  for (uint16_t k = 0; k < n; ++k) {
+    _ref_v[k] = _mppt.iv_point(k).v;
+    _ref_i[k] = _mppt.iv_point(k).i;
+  }
+  _ref_n  = n;
+  _ref_ms = millis();
+  // Taken just now, under the present irradiance
+  _p_avail = p_max;
+
+  // Diode branch from the MPP to Voc, ln(I_ph - I) = ln(a) + V / b by
+  // least squares: it continues the reference past its first point, where
+  // a panel that just got brighter sits until P&O catches up
+  float sx = 0.0f, sy = 0.0f, sxx = 0.0f, sxy = 0.0f;
+  uint16_t m = 0;
+  for (uint16_t k = 0; k < n; ++k) {
+    const float d = i_ph - _ref_i[k];
+    if (_ref_v[k] < v_mpp || d <= 0.0f) continue;
+    const float y = logf(d);
+    sx  += _ref_v[k];
+    sy  += y;
+    sxx += _ref_v[k] * _ref_v[k];
+    sxy += _ref_v[k] * y;
+    ++m;
+  }
+  const float den   = m * sxx - sx * sx;
+  const float inv_b = (m >= 2 && den > 0.0f) ? (m * sxy - sx * sy) / den : 0.0f;
+  _diode_ok = (inv_b > 0.0f);
+  if (_diode_ok) {
+    _diode_i_ph  = i_ph;
+    _diode_ln_a  = (sy - inv_b * sx) / m;
+    _diode_inv_b = inv_b;
+  }
+}
+
+void edugrid_track_eff::service(void)
+{
+  const uint32_t now   = millis();
+  const uint32_t dt_ms = now - _last_ms;
+  _last_ms = now;
+  if (_ref_n == 0) return;
+
+  // AUTO and the background sweeps it runs; a gap (other mode, gate driver
+  // off) is not counted, neither is a duty the charger holds down
+  const OperatingModes_t mode = _mppt.get_mode_state();
+  const bool bg = (mode == IV_SWEEP) && _mppt.iv_sweep_background();
+  if ((mode != AUTO && !bg) || dt_ms > 2 * TASK_CONTROL_INTERVAL_MS) return;
+  if (_charge.state() != CHARGE_MPPT || !_meas.sensorPvOk()) return;
+
+  // More light adds photocurrent at every voltage alike: the present
+  // reading against the reference at its voltage shifts the whole curve.
+  // A sweep in progress is far from the operating point and keeps the
+  // shift from before it.
+  const float v = _meas.getVoltagePV();
+  if (!bg && v >= PV_PRESENT_V) {
+    _p_avail = _refPowerMax(_meas.getCurrentPV() - _refCurrentAt(v));
+  }
+
+  const float p_in    = _meas.getPowerPV();
+  const float p_avail = availableW();
+  const float dt_s    = (float)dt_ms / 1000.0f;
+  _e_harvest_j += p_in * dt_s;
+  _e_avail_j   += p_avail * dt_s;
+
+  if (!_avg_valid) {
+    _p_in_avg    = p_in;
+    _p_avail_avg = p_avail;
+    _avg_valid   = true;
+  } else {
+    const float a = (float)dt_ms / (float)TRACK_EFF_TAU_MS;
+    _p_in_avg    += a * (p_in - _p_in_avg);
+    _p_avail_avg += a * (p_avail - _p_avail_avg);
+  }
+}
+
+float edugrid_track_eff::availableW(void) const
+{
+  if (_ref_n == 0) return NAN;
+  // P_in above the estimate: the estimate is off, the panel is not
+  const float p_in = _meas.getPowerPV();
+  return (_p_avail > p_in) ? _p_avail : p_in;
+}
+
+float edugrid_track_eff::etaNow(void) const
+{
+  if (_ref_n == 0 || !_avg_valid || _p_avail_avg <= 0.0f) return NAN;
+  return _p_in_avg / _p_avail_avg;
+}
+
+float edugrid_track_eff::etaTotal(void) const
+{
+  if (_ref_n == 0 || _e_avail_j <= 0.0) return NAN;
+  return (float)(_e_harvest_j / _e_avail_j);
+}
+
+uint32_t edugrid_track_eff::refAgeMs(void) const
+{
+  return (_ref_n > 0) ? millis() - _ref_ms : 0;
+}
+
+/*************************************************************************
+ * Private
+ ************************************************************************/
+float edugrid_track_eff::_refCurrentAt(float v) const
+{
+  // Up-pass points run from low duty (near Voc) to high duty, so V_in
+  // falls along the array; noise may break that locally, the first
+  // bracketing pair wins
+  if (v >= _ref_v[0]) {
+    return _diode_ok ? _diode_i_ph - expf(_diode_ln_a + v * _diode_inv_b) : _ref_i[0];
+  }
+  for (uint16_t k = 0; k + 1 < _ref_n; ++k) {
+    const float v0 = _ref_v[k], v1 = _ref_v[k + 1];
+    if (v <= v0 && v >= v1) {
+      const float span = v0 - v1;
+      if (span <= 0.0f) return _ref_i[k];
+      return _ref_i[k] + (_ref_i[k + 1] - _ref_i[k]) * (v0 - v) / span;
+    }
+  }
+  return _ref_i[_ref_n - 1];
+}
+
+float edugrid_track_eff::_refPowerMax(float di) const
+{
+  float p_max = 0.0f;
+  for (uint16_t k = 0; k < _ref_n; ++k) {
+    const float p = _ref_v[k] * (_ref_i[k] + di);
+    if (p > p_max) p_max = p;
+  }
+  return p_max;
+}
@@ -8,9 +8,14 @@
  ************************************************************************/
 #include <LittleFS.h>
 #include <math.h>
+#include <time.h>
+#include <AsyncJson.h>
 #include <edugrid_webserver.h>
+#include <edugrid_config.h>
+#include <edugrid_trace.h>
 #include "edugrid_mpp_algorithm.h"
 #include "edugrid_measurement.h"
+#include "edugrid_channel.h"
 
 /*************************************************************************
  * Statics
@@ -25,6 +30,8 @@ AsyncWebServer   server(80);
 /* Query parameter keys */
 static const char *PARAM_INPUT_1 = "ID";
 static const char *PARAM_INPUT_2 = "STATE";
+static const char *PARAM_INPUT_3 = "STATE2";
+static const char *PARAM_CHANNEL = "ch";      // optional converter channel, default 0
 
 /*************************************************************************
  * Helpers
@@ -51,14 +58,27 @@ String edugrid_webserver::processor(const String &var)
   return String();
 }
 
+/** Converter channel addressed by a request (?ch=N), channel 0 if absent
+ *  or out of range so single-converter clients keep working unchanged. */
+static edugrid_channel& _requestChannel(AsyncWebServerRequest *request)
+{
+  if (request->hasParam(PARAM_CHANNEL)) {
+    const long ch = request->getParam(PARAM_CHANNEL)->value().toInt();
+    if (ch >= 0 && ch < edugrid_channel::count()) {
+      return edugrid_channel::at((uint8_t)ch);
+    }
+  }
+  return edugrid_channel::at(0);
+}
+
 /*************************************************************************
  * WiFi + HTTP + WS init
  ************************************************************************/
 void edugrid_webserver::initWiFi(void)
 {
   /* Access-Point mode (SSID/pw from filesystem config) */
-  WiFi.softAP(edugrid_filesystem::config_wlan_ssid.c_str(),
-              edugrid_filesystem::config_wlan_pw.c_str());
+  WiFi.softAP(edugrid_config::get().wlan_ssid,
+              edugrid_config::get().wlan_pw);
 
   /* AP network config */
   IPAddress local_ip(192, 168, 1, 1);
@@ -68,6 +88,7 @@ void edugrid_webserver::initWiFi(void)
 
   /* WebSocket server (port 81) */
   webSocket.begin();
+  webSocket.onEvent(webSocketEvent);
 
   /* HTTP routes */
   server.on("/", HTTP_GET, [](AsyncWebServerRequest *request){
@@ -99,39 +120,21 @@ void edugrid_webserver::initWiFi(void)
 
     /* --- IV SWEEP API --- */
   server.on("/ivsweep/start", HTTP_GET, [](AsyncWebServerRequest *request){
-    // Trigger the non-blocking state machine in the MPPT task.
-    edugrid_mpp_algorithm::request_iv_sweep();
+    // Trigger the non-blocking state machine in the MPPT task.  ?bidir=0|1
+    // overrides the configured down pass for this sweep.
+    edugrid_mpp_tracker& mppt = _requestChannel(request).mppt;
+    if (request->hasParam("bidir")) {
+      mppt.request_iv_sweep(request->getParam("bidir")->value().toInt() != 0);
+    } else {
+      mppt.request_iv_sweep();
+    }
     request->send(200, "application/json", "{\"status\":\"started\"}");
   });
 
 // === Fast, heap-safe IV sweep JSON ===
 server.on("/ivsweep/data", HTTP_GET, [](AsyncWebServerRequest *request){
-  const uint16_t n = edugrid_mpp_algorithm::iv_point_count();
-
-  // Capacity: 3 arrays (v,i,p) + 2 booleans
-  StaticJsonDocument<K_IV_JSON_CAPACITY> doc;
-  JsonArray v_data = doc.createNestedArray("v");
-  JsonArray i_data = doc.createNestedArray("i");
-  JsonArray p_data = doc.createNestedArray("p");
-
-  // Fill arrays (keep your rounding so UI gets neat numbers)
-  for (uint16_t idx = 0; idx < n; ++idx) {
-    float v, cur;
-    edugrid_mpp_algorithm::iv_get_point(idx, v, cur);
-    const float p = v * cur;
-
-    v_data.add(roundf(v   * 1000.0f) / 1000.0f);
-    i_data.add(roundf(cur * 1000.0f) / 1000.0f);
-    p_data.add(roundf(p   * 1000.0f) / 1000.0f);
-  }
-
-  doc["in_progress"] = edugrid_mpp_algorithm::iv_sweep_in_progress();
-  doc["done"]        = edugrid_mpp_algorithm::iv_sweep_done();
-
-  // Pre-reserve response to avoid reallocations
   String out;
-  out.reserve(  (size_t)(n * 3 /*arrays*/ * 12 /*avg chars/num*/ + 96) );
-  serializeJson(doc, out);
+  edugrid_payload::ivSweepJson(_requestChannel(request).mppt, out);
 
   // No-cache so browser doesn’t reuse stale curves during a sweep
   AsyncWebServerResponse* res = request->beginResponse(200, "application/json", out);
@@ -181,15 +184,16 @@ server.on("/ivsweep/data", HTTP_GET, [](AsyncWebServerRequest *request){
       _state = request->getParam(PARAM_INPUT_2)->value();
       Serial.print("[UI] ID="); Serial.print(_id);
       Serial.print(" STATE=");  Serial.println(_state);
+      edugrid_channel& chan = _requestChannel(request);
 
       if (_id.equals(WEBSERVER_ID_MPP_SWITCH)) {
-        edugrid_mpp_algorithm::toggle_mode_state();
+        chan.mppt.toggle_mode_state();
       } else if (_id.equals(WEBSERVER_ID_PWM_INCREMENT)) {
-        edugrid_pwm_control::pwmIncrementDecrement(5);
+        chan.pwm.pwmIncrementDecrement(5, PWM_SRC_UI_STEP);
       } else if (_id.equals(WEBSERVER_ID_PWM_DECREMENT)) {
-        edugrid_pwm_control::pwmIncrementDecrement(-5);
+        chan.pwm.pwmIncrementDecrement(-5, PWM_SRC_UI_STEP);
       } else if (_id.equals(WEBSERVER_ID_PWM_SLIDER)) {
-          edugrid_pwm_control::requestManualTarget(
+          chan.pwm.requestManualTarget(
             (uint8_t)_state.toInt());
       } else if (_id.equals(WEBSERVER_ID_MODE_LABEL)) {
         // Client must send the desired state: "AUTO" or "MANUAL".
@@ -199,9 +203,9 @@ server.on("/ivsweep/data", HTTP_GET, [](AsyncWebServerRequest *request){
         s.toUpperCase();
 
         if (s == "AUTO" || s == "1") {
-          edugrid_mpp_algorithm::set_mode_state(AUTO);
+          chan.mppt.set_mode_state(AUTO);
         } else if (s == "MANUAL" || s == "MANUALLY" || s == "0") {
-          edugrid_mpp_algorithm::set_mode_state(MANUALLY);
+          chan.mppt.set_mode_state(MANUALLY);
         } else {
           // Unknown request -> do nothing (keeps current mode)
         }
@@ -211,16 +215,23 @@ server.on("/ivsweep/data", HTTP_GET, [](AsyncWebServerRequest *request){
         // No-op label
       } else if (_id.equals(WEBSERVER_ID_REBOOT_REQUEST)) {
         ESP.restart();
+      } else if (_id.equals(WEBSERVER_ID_WIFI_SAVE)) {
+        // admin.html: STATE = SSID, STATE2 = password (active after reboot)
+        if (request->hasParam(PARAM_INPUT_3)) {
+          edugrid_config::setWiFiCredentials(_state, request->getParam(PARAM_INPUT_3)->value());
+        }
       }
     }
     request->send(200, "text/plain", "OK");
   });
 
   // === Zero-offset calibration endpoint ===
-  // Hit: GET /calibrate_zero
+  // Hit: GET /calibrate_zero (all channels) or /calibrate_zero?ch=N
   server.on("/calibrate_zero", HTTP_GET, [](AsyncWebServerRequest *req){
     // Tip: For best results, run this when PV is disconnected and no load is attached.
-    edugrid_measurement::calibrateZeroOffsets(400);  // ~0.8s total
+    const uint8_t ch = req->hasParam(PARAM_CHANNEL) ? _requestChannel(req).index()
+                                                    : EDUGRID_ALL_CHANNELS;
+    edugrid_measurement::calibrateZeroOffsets(400, ch);  // ~0.8s per channel
     req->send(200, "text/plain", "OK");
   });
 
@@ -233,17 +244,25 @@ server.on("/ivsweep/data", HTTP_GET, [](AsyncWebServerRequest *request){
   server.on("/api/now", HTTP_GET, [](AsyncWebServerRequest* req){
     // Create a small, temporary JSON document on the stack.
     // This is much more efficient than using the global `doc`.
-    StaticJsonDocument<256> json_doc;
-
-    // Populate the JSON object with sensor data, rounding to 3 decimal places.
-    json_doc["vin"]  = edugrid_measurement::V_in;
-    json_doc["iin"]  = edugrid_measurement::I_in;
-    json_doc["vout"] = edugrid_measurement::V_out;
-    json_doc["iout"] = edugrid_measurement::I_out;
-    json_doc["pin"]  = edugrid_measurement::P_in;
-    json_doc["pout"] = edugrid_measurement::P_out;
+    StaticJsonDocument<K_NOW_JSON_CAPACITY> json_doc;
+
+    // Populate the JSON object with sensor data of channel 0.
+    json_doc["vin"]  = edugrid_measurement::getVoltagePV();
+    json_doc["iin"]  = edugrid_measurement::getCurrentPV();
+    json_doc["vout"] = edugrid_measurement::getVoltageLoad();
+    json_doc["iout"] = edugrid_measurement::getCurrentLoad();
+    json_doc["pin"]  = edugrid_measurement::getPowerPV();
+    json_doc["pout"] = edugrid_measurement::getPowerLoad();
     // For efficiency, round to one decimal place for the UI.
-    json_doc["eff"]  = round(edugrid_measurement::eff * 1000.0f) / 10.0f;
+    json_doc["eff"]  = round(edugrid_measurement::getEfficiency() * 1000.0f) / 10.0f;
+    // MPPT tracking efficiency [%], averaged and since boot; null before
+    // the first IV sweep
+    const edugrid_track_eff& teff = edugrid_channel::at(0).teff;
+    const float teff_now = teff.etaNow();
+    const float teff_cum = teff.etaTotal();
+    if (isnan(teff_now)) json_doc["teff"] = nullptr; else json_doc["teff"] = round(teff_now * 1000.0f) / 10.0f;
+    if (isnan(teff_cum)) json_doc["teff_cum"] = nullptr; else json_doc["teff_cum"] = round(teff_cum * 1000.0f) / 10.0f;
+    edugrid_payload::channelsToJson(json_doc);
 
     // Serialize the JSON object into a String to be sent.
     String out;
@@ -251,12 +270,253 @@ server.on("/ivsweep/data", HTTP_GET, [](AsyncWebServerRequest *request){
     req->send(200, "application/json", out);
   });
 
+  /* --- Settle-time calibration --- */
+  // GET /api/settle?ch=N reports the last result; ?run=1 starts a run (the
+  // channel must not be sweeping; tracking pauses for ~1-2 s).
+  server.on("/api/settle", HTTP_GET, [](AsyncWebServerRequest* req){
+    edugrid_channel& c = _requestChannel(req);
+    if (req->hasParam("run")) {
+      c.settle.request();
+    }
+    String out;
+    edugrid_payload::settleJson(c.index(), out);
+    req->send(200, "application/json", out);
+  });
+
+  /* --- Efficiency map --- */
+  // GET /api/effmap?ch=N: map run state and the stored duty x frequency
+  // table; ?run=1 measures a new map (tracking pauses for about a minute),
+  // ?select=0|1 turns the frequency pick off/on (off keeps the frequency).
+  server.on("/api/effmap", HTTP_GET, [](AsyncWebServerRequest* req){
+    edugrid_channel& c = _requestChannel(req);
+    if (req->hasParam("select")) {
+      c.fmap.setSelect(req->getParam("select")->value().toInt() != 0);
+    }
+    if (req->hasParam("run")) {
+      c.fmap.request();
+    }
+    String out;
+    edugrid_payload::effmapJson(c.index(), out);
+    req->send(200, "application/json", out);
+  });
+
+  /* --- Scope capture --- */
+  // GET /api/scope?ch=N reports the capture state and the newest capture;
+  // ?run=step[&step=3] steps the duty by that many % and records around the
+  // step, ?run=level&sig=v_in|i_in|v_out|i_out&level=X[&edge=rise|fall]
+  // arms a level trigger (both with optional &period_us= and &pre= [%]).
+  // Tracking pauses for the capture.  ?raw=1 downloads the newest capture
+  // as ScopeHeader_t + samples (format in edugrid_scope.h).
+  server.on("/api/scope", HTTP_GET, [](AsyncWebServerRequest* req){
+    if (req->hasParam("raw")) {
+      ScopeHeader_t hdr;
+      if (!edugrid_scope::lastHeader(hdr)) {
+        req->send(404, "text/plain", "ERROR: no capture");
+        return;
+      }
+      AsyncResponseStream* res = req->beginResponseStream("application/octet-stream");
+      edugrid_scope::dump(*res);
+      res->addHeader("Content-Disposition", "attachment; filename=\"edugrid_scope.bin\"");
+      res->addHeader("Cache-Control", "no-store");
+      req->send(res);
+      return;
+    }
+    edugrid_channel& c = _requestChannel(req);
+    if (req->hasParam("run")) {
+      ScopeRequest_t r = edugrid_scope::defaultRequest();
+      const String run = req->getParam("run")->value();
+      if (run == "level") {
+        r.trigger = SCOPE_TRIG_LEVEL;
+        if (!req->hasParam("sig") || !req->hasParam("level") ||
+            !edugrid_scope::signalFromStr(req->getParam("sig")->value().c_str(), r.signal)) {
+          req->send(400, "text/plain", "ERROR: level trigger needs sig and level");
+          return;
+        }
+        r.level  = req->getParam("level")->value().toFloat();
+        r.rising = !req->hasParam("edge") || req->getParam("edge")->value() != "fall";
+      } else if (run == "step") {
+        if (req->hasParam("step")) r.step_pct = (int8_t)req->getParam("step")->value().toInt();
+        if (r.step_pct == 0) {
+          req->send(400, "text/plain", "ERROR: step must not be 0");
+          return;
+        }
+      } else {
+        req->send(400, "text/plain", "ERROR: run must be step or level");
+        return;
+      }
+      if (req->hasParam("period_us")) r.period_us = (uint16_t)req->getParam("period_us")->value().toInt();
+      if (req->hasParam("pre"))       r.pre_pct   = (uint8_t)req->getParam("pre")->value().toInt();
+      c.scope.request(r);
+    }
+    String out;
+    edugrid_payload::scopeJson(c.index(), out);
+    req->send(200, "application/json", out);
+  });
+
+  /* --- I2C bus --- */
+  // GET /api/i2c?ch=N: polled-read worker (passes, slowest pass, bus
+  // recoveries) and the read / error / timeout counters of both INA228s.
+  server.on("/api/i2c", HTTP_GET, [](AsyncWebServerRequest* req){
+    String out;
+    edugrid_payload::i2cJson(_requestChannel(req).index(), out);
+    req->send(200, "application/json", out);
+  });
+
+  /* --- Fast trip --- */
+  // GET /api/protect?ch=N: trip state, count, last cause and the limits;
+  // ?reset=1 clears a latch (the gate driver only comes back if ALERT is high).
+  server.on("/api/protect", HTTP_GET, [](AsyncWebServerRequest* req){
+    edugrid_channel& c = _requestChannel(req);
+    if (req->hasParam("reset")) {
+      c.protect.reset();
+    }
+    String out;
+    edugrid_payload::protectJson(c.index(), out);
+    req->send(200, "application/json", out);
+  });
+
+  /* --- Energy totals --- */
+  // GET /api/energy?ch=N: PV and load Wh / Ah of today, yesterday, this and
+  // last week and lifetime, from the INA228 accumulators.
+  server.on("/api/energy", HTTP_GET, [](AsyncWebServerRequest* req){
+    String out;
+    edugrid_payload::energyJson(_requestChannel(req).index(), out);
+    req->send(200, "application/json", out);
+  });
+
+  // GET /api/time?unix=S&tz=M sets the wall clock (UTC seconds, local time
+  // minus UTC in minutes); the UI sends the browser's on every load, since
+  // the access point has no NTP.  Without parameters it only reports.
+  server.on("/api/time", HTTP_GET, [](AsyncWebServerRequest* req){
+    if (req->hasParam("unix")) {
+      const uint32_t unix_s = (uint32_t)strtoul(req->getParam("unix")->value().c_str(), nullptr, 10);
+      const int16_t  tz     = req->hasParam("tz") ? (int16_t)req->getParam("tz")->value().toInt() : 0;
+      if (unix_s < ENERGY_UNIX_VALID_S) {
+        req->send(400, "text/plain", "ERROR: unix out of range");
+        return;
+      }
+      edugrid_energy::setClock(unix_s, tz);
+    }
+    StaticJsonDocument<JSON_OBJECT_SIZE(3)> json_doc;
+    json_doc["unix_s"]         = (uint32_t)time(nullptr);
+    json_doc["valid"]          = edugrid_energy::clockValid();
+    json_doc["utc_offset_min"] = edugrid_energy::utcOffsetMin();
+    String out;
+    serializeJson(json_doc, out);
+    req->send(200, "application/json", out);
+  });
+
+  /* --- Acquisition profiles --- */
+  // GET /api/acq?ch=N: averaging/conversion of the sweep, track and display
+  // profiles, the step period each gives, and the noise measured with it.
+  server.on("/api/acq", HTTP_GET, [](AsyncWebServerRequest* req){
+    String out;
+    edugrid_payload::acquisitionJson(_requestChannel(req).index(), out);
+    req->send(200, "application/json", out);
+  });
+
+  /* --- IV sweep archive --- */
+  // Records are ~600 B each; static so two of them do not sit on the
+  // AsyncTCP stack (all handlers run in that one task).
+  static IvArchiveRecord_t s_ivs_a, s_ivs_b;
+
+  // GET /api/ivs/diff?a=&b=: b relative to a.  Registered before /api/ivs,
+  // which would otherwise match it as a prefix.
+  server.on("/api/ivs/diff", HTTP_GET, [](AsyncWebServerRequest* req){
+    if (!req->hasParam("a") || !req->hasParam("b")) {
+      req->send(400, "text/plain", "ERROR: a and b required");
+      return;
+    }
+    if (!edugrid_iv_archive::load(strtoul(req->getParam("a")->value().c_str(), nullptr, 10), s_ivs_a) ||
+        !edugrid_iv_archive::load(strtoul(req->getParam("b")->value().c_str(), nullptr, 10), s_ivs_b)) {
+      req->send(404, "text/plain", "ERROR: sweep not found");
+      return;
+    }
+    String out;
+    edugrid_payload::ivArchiveDiffJson(s_ivs_a, s_ivs_b, out);
+    req->send(200, "application/json", out);
+  });
+
+  // GET /api/ivs lists the stored sweeps; ?seq=N returns one as JSON, with
+  // &raw=1 as the record bytes (format in edugrid_iv_archive.h).
+  server.on("/api/ivs", HTTP_GET, [](AsyncWebServerRequest* req){
+    if (!req->hasParam("seq")) {
+      AsyncResponseStream* res = req->beginResponseStream("application/json");
+      edugrid_payload::ivArchiveListJson(*res);
+      res->addHeader("Cache-Control", "no-store");
+      req->send(res);
+      return;
+    }
+    const uint32_t seq = strtoul(req->getParam("seq")->value().c_str(), nullptr, 10);
+    if (!edugrid_iv_archive::load(seq, s_ivs_a)) {
+      req->send(404, "text/plain", "ERROR: sweep not found");
+      return;
+    }
+    if (req->hasParam("raw")) {
+      AsyncResponseStream* res = req->beginResponseStream("application/octet-stream");
+      res->write(reinterpret_cast<const uint8_t*>(&s_ivs_a), s_ivs_a.hdr.size);
+      res->addHeader("Content-Disposition",
+                     String("attachment; filename=\"iv_") + seq + ".ivb\"");
+      req->send(res);
+      return;
+    }
+    String out;
+    edugrid_payload::ivArchiveSweepJson(s_ivs_a, out);
+    req->send(200, "application/json", out);
+  });
+
+  /* --- Event trace (flight recorder) --- */
+  // Binary dump: TraceDumpHeader_t + events, oldest first.  Render it with
+  // script/host/edugrid_trace_render.py.  ?clear=1 empties the ring afterwards.
+  server.on("/api/trace", HTTP_GET, [](AsyncWebServerRequest* req){
+    AsyncResponseStream* res = req->beginResponseStream("application/octet-stream");
+    edugrid_trace::dump(*res, false);
+    if (req->hasParam("clear")) {
+      edugrid_trace::clear();
+    }
+    res->addHeader("Content-Disposition", "attachment; filename=\"edugrid_trace.bin\"");
+    res->addHeader("Cache-Control", "no-store");
+    req->send(res);
+  });
+
+  /* --- Runtime configuration API --- */
+  // GET returns the cached blob (never the Wi-Fi password).  PUT takes a
+  // partial JSON object, validates it, commits it atomically to flash and
+  // applies the tunable knobs to the running firmware.
+  server.on("/api/config", HTTP_GET, [](AsyncWebServerRequest* req){
+    StaticJsonDocument<K_CONFIG_JSON_CAPACITY> json_doc;
+    edugrid_config::toJson(json_doc.to<JsonObject>());
+    String out;
+    serializeJson(json_doc, out);
+    req->send(200, "application/json", out);
+  });
+
+  AsyncCallbackJsonWebHandler* config_put = new AsyncCallbackJsonWebHandler("/api/config",
+    [](AsyncWebServerRequest* req, JsonVariant& json){
+      EdugridConfig_t cfg = edugrid_config::get();
+      String err;
+      if (!edugrid_config::patchFromJson(json, cfg, &err) ||
+          !edugrid_config::commit(cfg, &err)) {
+        req->send(400, "application/json", "{\"error\":\"" + err + "\"}");
+        return;
+      }
+      StaticJsonDocument<K_CONFIG_JSON_CAPACITY> json_doc;
+      JsonObject obj = json_doc.to<JsonObject>();
+      edugrid_config::toJson(obj);
+      obj["reboot_required"] = !json["wlan_ssid"].isNull() || !json["wlan_pw"].isNull();
+      String out;
+      serializeJson(json_doc, out);
+      req->send(200, "application/json", out);
+    });
+  config_put->setMethod(HTTP_PUT | HTTP_POST);
+  server.addHandler(config_put);
+
   server.begin();
 
   Serial.print("|WiFi| EduGrid Webserver started at ");
   Serial.println(WiFi.softAPIP());
-  Serial.print("       Name: ");     Serial.println(edugrid_filesystem::config_wlan_ssid);
-  Serial.print("       Password: "); Serial.println(edugrid_filesystem::config_wlan_pw);
+  Serial.print("       Name: ");     Serial.println(edugrid_config::get().wlan_ssid);
+  Serial.print("       Password: "); Serial.println(edugrid_config::get().wlan_pw);
 }
 
 /*************************************************************************
@@ -269,54 +529,32 @@ void edugrid_webserver::webSocketLoop(void)
 
   static uint32_t lastPush = 0;
   const uint32_t now = millis();
-  if (now - lastPush < WS_PUSH_INTERVAL_MS) return;
+  EdugridConfig_t cfg;
+  edugrid_config::snapshot(cfg);
+  if (now - lastPush < cfg.ws_push_interval_ms) return;
   lastPush = now;
 
-  // Build a fresh doc each tick to avoid cross-tick reuse issues
-  // The websocket payload mirrors the REST API but is pushed automatically to
-  // keep the dashboard live without polling.  A stack-allocated document keeps
-  // heap fragmentation low.
-  StaticJsonDocument< JSON_OBJECT_SIZE(20) > doc;
-
-  // --- Converter / PWM (numeric; add units in JS to reduce payload) ---
-  const uint8_t pwm_pct = edugrid_pwm_control::getPWM();
-  doc["pwm"]       = pwm_pct;                                   // percent (0..100)
-  doc["pwm_raw"]   = pwm_pct;                                   // legacy key kept for JS compatibility
-  doc["pwm_min"]   = edugrid_pwm_control::getPwmLowerLimit();   // percent
-  doc["pwm_max"]   = edugrid_pwm_control::getPwmUpperLimit();   // percent
-  const float freq_hz = edugrid_pwm_control::getFrequency();
-  doc["freq_hz"]   = freq_hz;
-
-  // --- Mode as string the UI expects ---
-  switch (edugrid_mpp_algorithm::get_mode_state()) {
-    case MANUALLY: doc["mode"] = "MANUAL";   break;
-    case AUTO:     doc["mode"] = "AUTO";     break;
-    case IV_SWEEP: doc["mode"] = "IV_SWEEP"; break;
-    default:       doc["mode"] = "UNKNOWN";  break;
-  }
-
-  // --- Measurements (numbers; format and round in JS) ---
-  doc["vin"]   = edugrid_measurement::V_in;
-  doc["iin"]   = edugrid_measurement::I_in;
-  doc["pin"]   = edugrid_measurement::P_in;
-
-  doc["vout"]  = edugrid_measurement::V_out;
-  doc["iout"]  = edugrid_measurement::I_out;
-  doc["pout"]  = edugrid_measurement::P_out;
-
-  doc["eff"]   = edugrid_measurement::eff; // 0..1 (multiply by 100 in JS)
-
-  // --- Misc state (string; unchanged) ---
-  doc["logging"] = edugrid_logging::getLogState_str();
-
-  // Serialize once into a pre-reserved buffer
   String out;
-  out.reserve(256);
-  serializeJson(doc, out);
+  edugrid_payload::liveJson(out);
   webSocket.broadcastTXT(out);
 }
 
 
+/*************************************************************************
+ * WS events: only connects/disconnects are of interest (trace)
+ ************************************************************************/
+void edugrid_webserver::webSocketEvent(uint8_t num, WStype_t type, uint8_t* payload, size_t length)
+{
+  (void)payload;
+  (void)length;
+  if (type == WStype_CONNECTED) {
+    edugrid_trace::record(TRACE_EV_WS_CONNECT, num, 0, (uint32_t)webSocket.remoteIP(num));
+  } else if (type == WStype_DISCONNECTED) {
+    edugrid_trace::record(TRACE_EV_WS_DISCONNECT, num);
+  }
+}
+
+
 /*************************************************************************
  * File upload handler
  ************************************************************************/
@@ -344,34 +582,7 @@ void edugrid_webserver::handleUpload(AsyncWebServerRequest *request, String file
  ************************************************************************/
 String edugrid_webserver::listFiles(bool ishtml)
 {
-  String returnText;
-
-  auto listDir = [&](const char* path) {
-    // Iterate through a directory and append one HTML table row per entry.
-    File root = LittleFS.open(path);
-    if (!root) return;
-    File f = root.openNextFile();
-    while (f) {
-      returnText += "<tr align='left'><td>" + String(path) + String(f.name()) + "</td><td>"
-                    + edugrid_webserver::humanReadableSize(f.size()) + "</td>";
-      returnText += "<td><button onclick=\"downloadDeleteButton('"
-                    + String(path) + String(f.name())
-                    + "', 'download')\">Download</button>";
-      returnText += "<td><button onclick=\"downloadDeleteButton('"
-                    + String(path) + String(f.name())
-                    + "', 'delete')\">Delete</button></tr>";
-      f = root.openNextFile();
-    }
-    root.close();
-  };
-
-  returnText += "<table><tr><th align='left'>Name</th><th align='left'>Size</th><th></th><th></th></tr>";
-  listDir("/log/");
-  listDir("/www/");
-  listDir("/config/");
-  listDir("/");
-  returnText += "</table>";
-  return returnText;
+  return edugrid_payload::fileListHtml();
 }
 
 /*************************************************************************
@@ -379,8 +590,5 @@ String edugrid_webserver::listFiles(bool ishtml)
  ************************************************************************/
 String edugrid_webserver::humanReadableSize(const size_t bytes)
 {
-  if (bytes < 1024) return String(bytes) + " B";
-  if (bytes < (1024 * 1024)) return String(bytes / 1024.0) + " KB";
-  if (bytes < (1024 * 1024 * 1024)) return String(bytes / 1024.0 / 1024.0) + " MB";
-  return String(bytes / 1024.0 / 1024.0 / 1024.0) + " GB";
+  return edugrid_payload::humanReadableSize(bytes);
 }
@@ -12,12 +12,20 @@
 
 #include <edugrid_states.h>
 #include <edugrid_filesystem.h>
+#include <edugrid_config.h>
 #include <edugrid_webserver.h>
 #include <edugrid_pwm_control.h>
 #include <edugrid_mpp_algorithm.h>
 #include <edugrid_measurement.h>
+#include <edugrid_channel.h>
 #include <edugrid_logging.h>
 #include <edugrid_telemetry.h>
+#include <edugrid_trace.h>
+#include <edugrid_iv_archive.h>
+#include <edugrid_freq_map.h>
+#include <edugrid_energy.h>
+#include <edugrid_i2c.h>
+#include <esp_system.h>
 
 /************************************************************************
  * Defines
@@ -44,7 +52,13 @@ void coreTwo(void *pvParameters)
     // AsyncWebServer stack and the actual JSON broadcast of the live data.  We
     // call it periodically instead of from loop() so the UI stays responsive
     // regardless of what the rest of the firmware is doing.
+    const uint32_t t0 = micros();
     edugrid_webserver::webSocketLoop();
+    const uint32_t elapsed_us = micros() - t0;
+    if (elapsed_us > TASK_WEBSOCKET_INTERVAL_MS * 1000UL) {
+      edugrid_trace::record(TRACE_EV_LOOP_OVERRUN, TRACE_TASK_WEBSOCKET,
+                            TASK_WEBSOCKET_INTERVAL_MS, elapsed_us);
+    }
     // A short delay yields to other RTOS tasks while keeping the broadcast
     // cadence defined in edugrid_states.h.
     vTaskDelay(pdMS_TO_TICKS(TASK_WEBSOCKET_INTERVAL_MS));
@@ -59,46 +73,21 @@ void coreThree(void *pvParameters)
   (void)pvParameters;
   for (;;)
   {
-    /* 1) Always update sensor cache first */
-    // Update the cached measurements from both INA228s.  All other modules read
-    // from this cache so it must be refreshed first.
-    edugrid_measurement::getSensors();
-
-    /* 2) Keep duty within safe/allowed borders (this is good practice) */
-    // Keep the converter duty inside the configured safe window and honour the
-    // manual slew limiter that makes slider movements smooth.
-    edugrid_pwm_control::checkAndSetPwmBorders();
-    edugrid_pwm_control::serviceManualRamp();
-
-    /* 3) Execute the logic for the current operating mode */
-    switch (edugrid_mpp_algorithm::get_mode_state())
-    {
-      case MANUALLY:
-        // In Manual mode, the UI sets the PWM directly. Nothing to do here.
-        break;
-
-      case AUTO:
-        // The find_mpp() function has its own internal timer.
-        // We call it every loop, and it will only act when it's time.
-        // Perturb & Observe algorithm adjusts the duty cycle when the MPPT
-        // timer inside the module says it is time to sample again.
-        edugrid_mpp_algorithm::find_mpp();
-        break;
-
-      case IV_SWEEP:
-        // The iv_sweep_step() function acts as a state machine.
-        // Calling it every loop tick drives the sweep forward one step at a time.
-        // Advance the IV sweep state machine one step.  The helper manages its
-        // own timing so we simply call it as fast as the task cadence allows.
-        edugrid_mpp_algorithm::iv_sweep_step();
-        break;
+    const uint32_t t0 = micros();
+
+    // Sense, clamp, ramp and track every converter channel.  The channels
+    // take turns being first so none of them always sees the most jitter.
+    edugrid_channel::serviceAll();
+
+    // One pass must fit into the task interval; anything longer (I2C
+    // stalls, a slow flash access) is recorded in the event trace.
+    const uint32_t elapsed_us = micros() - t0;
+    if (elapsed_us > TASK_CONTROL_INTERVAL_MS * 1000UL) {
+      edugrid_trace::record(TRACE_EV_LOOP_OVERRUN, TRACE_TASK_CONTROL,
+                            TASK_CONTROL_INTERVAL_MS, elapsed_us);
     }
 
-#ifdef EDUGRID_TELEMETRY_ON
-    edugrid_telemetry::telemetryPrint();
-#endif
-
-    /* 4) Loop timing */
+    /* Loop timing */
     // Use a single, consistent delay for the whole task.
     // This makes the loop predictable and responsive.
     vTaskDelay(pdMS_TO_TICKS(TASK_CONTROL_INTERVAL_MS));
@@ -123,36 +112,50 @@ void setup()
   Serial.println(F("|WARN| Debug mode is ACTIVE"));
 #endif
 
+  edugrid_trace::record(TRACE_EV_BOOT, (uint8_t)esp_reset_reason());
+
   /* Filesystem & Config */
   Serial.println(F("[FS] init_filesystem()"));
   edugrid_filesystem::init_filesystem();
-  Serial.println(F("[FS] loadConfig()"));
-  edugrid_filesystem::loadConfig();
+  Serial.println(F("[CFG] edugrid_config::load()"));
+  edugrid_config::load();
+  // Request the runtime knobs (PWM borders, MPPT step, INA averaging); the
+  // channels and INAs take them over as they initialise, so they start
+  // with the stored values.
+  edugrid_config::apply();
+  // Cut a torn block off the CSV log and write rows that survived a reset.
+  Serial.println(F("[LOG] recoverLogFile()"));
+  edugrid_logging::recoverLogFile();
+  // Continue the IV sweep numbering of the stored history.
+  edugrid_iv_archive::init();
+  // Measured converter efficiency per duty x frequency, if there is one.
+  edugrid_freq_map::loadAll();
+  // Energy totals (day / week / lifetime) counted before the reset.
+  edugrid_energy::loadAll();
 
   /* Network / Web server */
   Serial.println(F("[WIFI] initWiFi()"));
   edugrid_webserver::initWiFi();
   Serial.println(F("[WIFI] initWiFi() done"));
 
-  /* PWM power stage */
-  Serial.print  (F("[PWM] initPwmPowerConverter freq[Hz]="));
-  Serial.println(CONVERTER_FREQUENCY);
-  edugrid_pwm_control::initPwmPowerConverter(CONVERTER_FREQUENCY, PIN_POWER_CONVERTER_PWM);
-
-  /* IR2104 gate driver enable */
-  Serial.print  (F("[PWM] IR2104 SD pin="));
-  Serial.print  (PIN_SD_ENABLE);
-  Serial.println(F(" -> HIGH (enable)"));
-  pinMode(PIN_SD_ENABLE, OUTPUT);
-  digitalWrite(PIN_SD_ENABLE, HIGH);
+  /* PWM power stages (one per channel), gate drivers still off */
+  Serial.print  (F("[CH] converter channels="));
+  Serial.println(edugrid_channel::count());
+  edugrid_channel::beginPowerStages();
 
-  /* Measurements backend (INA228) */
+  /* Measurements backend (INA228 pair per channel) */
   Serial.println(F("[MEAS] edugrid_measurement::init()"));
   edugrid_measurement::init();
 
+  /* INA228 alert limits -> SD fast trip, then the gate drivers come on */
+  Serial.println(F("[PROT] edugrid_channel::armProtection()"));
+  edugrid_channel::armProtection();
+
   // Start in MANUAL mode with a low duty cycle for safety on boot.
-  edugrid_mpp_algorithm::set_mode_state(MANUALLY);
-  edugrid_pwm_control::setPWM(10); // Start at 10% duty so the converter is safe
+  for (uint8_t ch = 0; ch < edugrid_channel::count(); ++ch) {
+    edugrid_channel::at(ch).mppt.set_mode_state(MANUALLY);
+    edugrid_channel::at(ch).pwm.setPWM(10, PWM_SRC_INIT); // Start at 10% duty so the converter is safe
+  }
 
   /****** END OF SETUP, START TASKS ******/
   Serial.println(F("[RTOS] starting tasks..."));
@@ -160,9 +163,21 @@ void setup()
   // Task 2: Websocket/WiFi on core 0
   xTaskCreatePinnedToCore(coreTwo,   "coreTwo",   10000, nullptr, 1, &core2, 0);
 
+  // Task 3a: INA228 reads on core 1, so the control task never waits on I2C
+  edugrid_i2c::start();
+
   // Task 3: MPPT & sensors on core 1
   xTaskCreatePinnedToCore(coreThree, "coreThree", 10000, nullptr, 1, &core3, 1);
 
+#ifdef EDUGRID_TELEMETRY_ON
+  // Task 4: telemetry drain (lowest priority, core 0)
+#ifdef EDUGRID_TELEMETRY_BINARY
+  edugrid_telemetry::begin(TELEMETRY_FORMAT_BINARY);
+#else
+  edugrid_telemetry::begin(TELEMETRY_FORMAT_HUMAN);
+#endif
+#endif
+
 #ifdef OTA_UPDATES_ENABLE
   Serial.println(F("[OTA] OTA Updates are ENABLED"));
 #endif
@@ -182,11 +197,31 @@ void loop()
   // Persist one line of CSV data to the log buffer each second.  The logging
   // module takes care of checking whether logging is active and when to flush
   // the buffered lines to flash.
+  // With several converters the log follows channel 0.
+  const edugrid_track_eff& teff = edugrid_channel::at(0).teff;
   edugrid_logging::appendLog(
-      edugrid_measurement::V_in,
-      edugrid_measurement::V_out,
-      edugrid_measurement::I_in,
-      edugrid_measurement::I_out);
+      edugrid_measurement::getVoltagePV(),
+      edugrid_measurement::getVoltageLoad(),
+      edugrid_measurement::getCurrentPV(),
+      edugrid_measurement::getCurrentLoad(),
+      teff.etaNow(),
+      teff.etaTotal());
+
+  // Write finished IV sweeps from the RAM ring to flash (one per tick).
+  edugrid_iv_archive::service();
+
+  // Commit a new efficiency map to flash.
+  edugrid_freq_map::saveAll();
+
+  // Energy totals to flash every ENERGY_SAVE_MS and after a day rolled over.
+  edugrid_energy::saveAll();
+
+  // Serial console: 't' dumps the event trace (hex, see edugrid_trace.h).
+  while (Serial.available() > 0) {
+    if (Serial.read() == 't') {
+      edugrid_trace::dump(Serial, true);
+    }
+  }
 
   delay(TASK_LOOP_INTERVAL_MS);
 }